@@ -0,0 +1,148 @@
+// Eksblowfish for BF_LANES keys at once, instantiated by src/bcrypt.c. Before
+// including, define:
+//
+//   BF_LANES  Blowfish instances run side by side
+//   BF_NAME   the name of the function to define
+//
+// Every step below runs once per lane before the next step starts. The lanes
+// share nothing, so their S-box loads are independent and the CPU overlaps
+// them instead of waiting out each load in a single dependency chain.
+
+#define BF_F(c, x) ((((c)->s[0][(x) >> 24] + (c)->s[1][((x) >> 16) & 0xff]) ^ (c)->s[2][((x) >> 8) & 0xff]) + \
+                    (c)->s[3][(x) & 0xff])
+
+// The lane loops must be unrolled for the lanes to live in registers.
+#define BF_UNROLL _Pragma("GCC unroll 16")
+
+#define BF_ENCRYPT(ctx, l, r)                                                \
+    do                                                                       \
+    {                                                                        \
+        BF_UNROLL                                                            \
+        for (size_t lane = 0; lane < BF_LANES; lane++)                       \
+            l[lane] ^= ctx[lane].p[0];                                       \
+        for (int rnd = 1; rnd <= BF_ROUNDS; rnd += 2)                        \
+        {                                                                    \
+            BF_UNROLL                                                        \
+            for (size_t lane = 0; lane < BF_LANES; lane++)                   \
+                r[lane] ^= BF_F(&ctx[lane], l[lane]) ^ ctx[lane].p[rnd];     \
+            BF_UNROLL                                                        \
+            for (size_t lane = 0; lane < BF_LANES; lane++)                   \
+                l[lane] ^= BF_F(&ctx[lane], r[lane]) ^ ctx[lane].p[rnd + 1]; \
+        }                                                                    \
+        BF_UNROLL                                                            \
+        for (size_t lane = 0; lane < BF_LANES; lane++)                       \
+        {                                                                    \
+            uint32_t t = l[lane];                                            \
+            l[lane]    = r[lane] ^ ctx[lane].p[BF_ROUNDS + 1];               \
+            r[lane]    = t;                                                  \
+        }                                                                    \
+    } while (0)
+
+// bcrypt's Eksblowfish setup and the 64 encryptions of its magic text, for
+// BF_LANES keys under one salt; out receives each lane's six ciphertext words.
+static void BF_NAME(bf_ctx *ctx, const bf_key *key, const uint32_t salt[4], uint32_t cost, uint32_t (*out)[6])
+{
+    static const uint32_t magic[6] = {0x4f727068, 0x65616e42, 0x65686f6c, 0x64657253, 0x63727944, 0x6f756274};
+
+    bf_key         salt_key[BF_LANES];
+    const uint64_t rounds = (uint64_t)1 << cost;
+
+    for (size_t k = 0; k < BF_LANES; k++)
+    {
+        memcpy(&ctx[k], &bf_init, sizeof(bf_init));
+        for (int i = 0; i < BF_ROUNDS + 2; i++)
+            salt_key[k].w[i] = salt[i & 3];
+    }
+
+    // Step 0 keys with the key and mixes the salt into the chain; after that
+    // the key and the salt take turns as the key, 2^cost times each.
+    for (uint64_t step = 0; step <= 2 * rounds; step++)
+    {
+        const bf_key   *sched       = (step == 0 || (step & 1)) ? key : salt_key;
+        const uint32_t *mix         = (step == 0) ? salt : NULL;
+        uint32_t        l[BF_LANES] = {0};
+        uint32_t        r[BF_LANES] = {0};
+        size_t          s           = 0;
+
+        for (size_t k = 0; k < BF_LANES; k++)
+        {
+            for (int i = 0; i < BF_ROUNDS + 2; i++)
+                ctx[k].p[i] ^= sched[k].w[i];
+        }
+
+        for (int i = 0; i < BF_ROUNDS + 2; i += 2)
+        {
+            if (mix)
+            {
+                for (size_t k = 0; k < BF_LANES; k++)
+                {
+                    l[k] ^= mix[s & 3];
+                    r[k] ^= mix[(s + 1) & 3];
+                }
+                s += 2;
+            }
+
+            BF_ENCRYPT(ctx, l, r);
+
+            for (size_t k = 0; k < BF_LANES; k++)
+            {
+                ctx[k].p[i]     = l[k];
+                ctx[k].p[i + 1] = r[k];
+            }
+        }
+
+        for (int b = 0; b < 4; b++)
+        {
+            for (int i = 0; i < 256; i += 2)
+            {
+                if (mix)
+                {
+                    for (size_t k = 0; k < BF_LANES; k++)
+                    {
+                        l[k] ^= mix[s & 3];
+                        r[k] ^= mix[(s + 1) & 3];
+                    }
+                    s += 2;
+                }
+
+                BF_ENCRYPT(ctx, l, r);
+
+                for (size_t k = 0; k < BF_LANES; k++)
+                {
+                    ctx[k].s[b][i]     = l[k];
+                    ctx[k].s[b][i + 1] = r[k];
+                }
+            }
+        }
+    }
+
+    for (size_t k = 0; k < BF_LANES; k++)
+        memcpy(out[k], magic, sizeof(magic));
+
+    for (int i = 0; i < 64; i++)
+    {
+        for (int j = 0; j < 6; j += 2)
+        {
+            uint32_t l[BF_LANES];
+            uint32_t r[BF_LANES];
+
+            for (size_t k = 0; k < BF_LANES; k++)
+            {
+                l[k] = out[k][j];
+                r[k] = out[k][j + 1];
+            }
+
+            BF_ENCRYPT(ctx, l, r);
+
+            for (size_t k = 0; k < BF_LANES; k++)
+            {
+                out[k][j]     = l[k];
+                out[k][j + 1] = r[k];
+            }
+        }
+    }
+}
+
+#undef BF_F
+#undef BF_ENCRYPT
+#undef BF_UNROLL
@@ -0,0 +1,23 @@
+#ifndef CLIENT_BLOWFISH_H
+#define CLIENT_BLOWFISH_H
+
+#include <stdint.h>
+
+#define BF_ROUNDS 16
+#define BF_INTERLEAVE 4 // Eksblowfish instances one bcrypt thread runs side by side
+
+typedef struct bf_ctx
+{
+    uint32_t s[4][256];
+    uint32_t p[BF_ROUNDS + 2];
+} bf_ctx;
+
+// A key stretched to one word per P-array entry.
+typedef struct bf_key
+{
+    uint32_t w[BF_ROUNDS + 2];
+} bf_key;
+
+extern const bf_ctx bf_init;
+
+#endif // CLIENT_BLOWFISH_H
@@ -1,5 +1,6 @@
 #include "fsm.h"
-#include <crypt.h>
+#include "hash_engine.h"
+#include "keyspace.h"
 #include <inttypes.h>
 #include <pthread.h>
 #include <stdatomic.h>
@@ -9,14 +10,71 @@
 #include <stdlib.h>
 #include <string.h>
 
-static const char *charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@#%^&()_+-=.,:;?";
-#define CHARSET_SIZE (strlen(charset))
+#define GEN_BATCH_SIZE 256
+#define GEN_STREAM_BATCH_SIZE 8192 // claim size for engines that take candidates straight from the generator
+#define CACHE_LINE_SIZE 64
+#define PREFETCH_PERCENT 80
+#define PREFETCH_POLL_MS 20
 
-static atomic_uint_fast64_t task_counter;
-static atomic_bool          found;
-static char                 found_candidate[64];
-static pthread_mutex_t      found_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Targets sharing scheme, cost and salt, so a candidate costs one hash
+// computation however many there are. Members are the num_members targets
+// from first on; only the first is parsed in full. With more than one,
+// target compares against digests, every member's digest sorted and
+// indexed, and members[i] is the target whose digest is i-th.
+typedef struct hash_group
+{
+    hash_target   target;
+    uint8_t      *digests;
+    size_t        digests_cap;
+    size_t       *members;
+    size_t        first;
+    size_t        num_members;
+    digest_index  index;
+    atomic_size_t remaining;
+} hash_group;
 
-char *index_to_password(uint64_t index);
-void *worker(void *arg);
-int   create_threads(size_t number_of_threads, struct worker_state *ws);
+// One thread's slice of the WORK range, as offsets from ws->start_index.
+// [next, end) is unclaimed and pending is the start of the batch in flight
+// (UINT64_MAX when idle). Each range sits on its own cache line so the
+// owner's claims never contend with other threads.
+typedef struct thread_range
+{
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t lock;
+    uint64_t next;
+    uint64_t end;
+    uint64_t pending;
+} thread_range;
+
+// Long-lived worker threads created once per connection. Each WORK range is
+// published by bumping generation; threads park on work_ready between chunks
+// so their hash scratch space and generator stay warm.
+typedef struct worker_pool
+{
+    struct worker_state *ws;
+    pthread_t           *threads;
+    struct worker_arg   *args;
+    thread_range        *ranges;
+    size_t               nthreads;
+    pthread_mutex_t      lock; // serializes steals against checkpoint reports
+    uint64_t             last_checkpoint;
+    pthread_mutex_t      state_lock;
+    pthread_cond_t       work_ready;
+    pthread_cond_t       work_done;
+    uint64_t             generation;
+    size_t               active;
+    bool                 shutdown;
+    bool                 prefetched;
+} worker_pool;
+
+typedef struct worker_arg
+{
+    worker_pool *pool;
+    size_t       id;
+} worker_arg;
+
+// Marks a target cracked, here or by another worker; false if it already was.
+bool         mark_cracked(struct worker_state *ws, size_t target);
+void        *worker(void *arg);
+worker_pool *pool_create(size_t number_of_threads, struct worker_state *ws, struct fsm_error *err);
+int          pool_run(worker_pool *pool);
+void         pool_destroy(worker_pool *pool);
@@ -0,0 +1,39 @@
+#ifndef CLIENT_DES_H
+#define CLIENT_DES_H
+
+#include "hash_engine.h"
+#include <stdint.h>
+#include <string.h>
+
+#define DES_KEY_BITS 56
+#define DES_KEY_CHARS 8
+
+// Bit positions, zero-based: the E-box as indices into R, each round's 48
+// key bits as indices into the 56 key planes (seven per key character, most
+// significant first), where each S-box's outputs land in L after P, and
+// which pre-output bit becomes each bit of the final block.
+extern const uint8_t des_expansion[48];
+extern const uint8_t des_round_keys[16][48];
+extern const uint8_t des_sbox_out[8][4];
+extern const uint8_t des_output[64];
+
+// Bitsliced crypt(3) DES over 64 * words candidates at once: key holds the
+// 56 key planes, words 64-bit words each, and a clear bit in miss marks a
+// candidate whose result is one of the num_digests 8-byte digests.
+typedef void (*des_kernel)(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests,
+                           uint64_t *miss);
+
+void des_x64(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests, uint64_t *miss);
+
+void               des_prepare(hash_target *target);
+int                des_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                             des_kernel kernel, size_t lanes);
+const hash_engine *des_select_engine(void);
+
+#define DES_ENGINES 4
+
+// Fills engines with every DES engine the CPU runs, the 64-bit one first,
+// unchecked, and returns how many; des_test compares each against crypt_r.
+size_t des_engines(const hash_engine *engines[DES_ENGINES]);
+
+#endif // CLIENT_DES_H
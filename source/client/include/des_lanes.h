@@ -0,0 +1,102 @@
+// Bitsliced crypt(3) DES kernel, instantiated once per register width by
+// src/des.c and src/des_simd.c. Before including, define:
+//
+//   DES_WORDS   64-bit words per register, so 64 * DES_WORDS candidates a pass
+//   DES_NAME    the name of the kernel function to define
+//   DES_TARGET  (optional) the target attribute for the instruction set
+//
+// Bit j of every plane belongs to candidate j: L, R and the key are each an
+// array of planes, and the whole of DES turns into AND/OR/XOR/NOT on them.
+
+#include "des_sboxes.h"
+
+#if defined(DES_TARGET)
+    #define DES_ATTR __attribute__((target(DES_TARGET)))
+#else
+    #define DES_ATTR
+#endif
+
+#define DES_SBOX(n, S)                                                                                    \
+    do                                                                                                    \
+    {                                                                                                     \
+        const uint8_t *e  = &ebox[6 * (n)];                                                               \
+        const uint8_t *kb = &rk[6 * (n)];                                                                 \
+        const uint8_t *o  = des_sbox_out[n];                                                              \
+        vec            x1 = src[e[0]] ^ k[kb[0]];                                                         \
+        vec            x2 = src[e[1]] ^ k[kb[1]];                                                         \
+        vec            x3 = src[e[2]] ^ k[kb[2]];                                                         \
+        vec            x4 = src[e[3]] ^ k[kb[3]];                                                         \
+        vec            x5 = src[e[4]] ^ k[kb[4]];                                                         \
+        vec            x6 = src[e[5]] ^ k[kb[5]];                                                         \
+        S(x1, x2, x3, x4, x5, x6, dst[o[0]], dst[o[1]], dst[o[2]], dst[o[3]]);                            \
+    } while (0)
+
+DES_ATTR void DES_NAME(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests,
+                       uint64_t *miss)
+{
+    typedef uint64_t vec __attribute__((vector_size(8 * DES_WORDS)));
+
+    vec  k[DES_KEY_BITS];
+    vec  l[32] = {0};
+    vec  r[32] = {0};
+    vec  out[64];
+    vec  missed = ~(vec){0};
+    vec *a      = l;
+    vec *b      = r;
+
+    memcpy(k, key, sizeof(k));
+
+    // crypt(3) encrypts a zero block 25 times. The final permutation of one
+    // encryption and the initial permutation of the next cancel out, so only
+    // the halves' swap is left between them.
+    for (int iter = 0; iter < 25; iter++)
+    {
+        for (int round = 0; round < 16; round++)
+        {
+            const uint8_t *rk  = des_round_keys[round];
+            vec           *dst = (round & 1) ? b : a;
+            const vec     *src = (round & 1) ? a : b;
+
+            DES_SBOX(0, DES_S1);
+            DES_SBOX(1, DES_S2);
+            DES_SBOX(2, DES_S3);
+            DES_SBOX(3, DES_S4);
+            DES_SBOX(4, DES_S5);
+            DES_SBOX(5, DES_S6);
+            DES_SBOX(6, DES_S7);
+            DES_SBOX(7, DES_S8);
+        }
+
+        vec *t = a;
+        a      = b;
+        b      = t;
+    }
+
+    // a now holds R16, the first half of the pre-output block, and b holds L16.
+    for (int n = 0; n < 64; n++)
+    {
+        int idx = des_output[n];
+        out[n]  = (idx < 32) ? a[idx] : b[idx - 32];
+    }
+
+    // Every digest of a salt group is compared against the same output planes.
+    for (size_t d = 0; d < num_digests; d++)
+    {
+        const uint8_t *digest = digests + d * 8;
+        vec            diff   = {0};
+
+        for (int n = 0; n < 64; n++)
+        {
+            vec want = ((digest[n / 8] >> (7 - n % 8)) & 1) ? ~(vec){0} : (vec){0};
+
+            diff |= out[n] ^ want;
+        }
+
+        missed &= diff;
+    }
+
+    memcpy(miss, &missed, sizeof(missed));
+}
+
+#undef DES_ATTR
+#undef DES_SBOX
@@ -0,0 +1,871 @@
+#ifndef CLIENT_DES_SBOXES_H
+#define CLIENT_DES_SBOXES_H
+
+// Bitsliced DES S-boxes: DES_Sn(a1..a6, o1..o4) XORs S-box n's four output
+// bits for inputs a1 (most significant) to a6 into o1 (most significant) to
+// o4. Each is a decision diagram over the six inputs, written out as AND,
+// AND-NOT, OR, XOR and NOT gates with nodes shared between the four outputs
+// and the input order picked per S-box for the fewest gates. Inputs and
+// outputs are expressions of the including code's vec type.
+
+// 103 gates
+#define DES_S1(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a6;                                  \
+        vec t1 = t0 ^ a2;                              \
+        vec t2 = ~t1;                                  \
+        vec t3 = t1 ^ a5;                              \
+        vec t4 = ~a2;                                  \
+        vec t5 = a3 & t4;                              \
+        vec t6 = t3 ^ t5;                              \
+        vec t7 = a5 & a6;                              \
+        vec t8 = a3 & t3;                              \
+        vec t9 = t7 ^ t8;                              \
+        vec t10 = a4 & t9;                             \
+        vec t11 = t6 ^ t10;                            \
+        vec t12 = a6 | a2;                             \
+        vec t13 = a2 & a6;                             \
+        vec t14 = a5 & ~t13;                           \
+        vec t15 = ~t14;                                \
+        vec t16 = ~t13;                                \
+        vec t17 = t16 & ~a5;                           \
+        vec t18 = ~t12;                                \
+        vec t19 = a2 & ~a6;                            \
+        vec t20 = ~t19;                                \
+        vec t21 = a5 & t16;                            \
+        vec t22 = a2 ^ t21;                            \
+        vec t23 = a3 & t22;                            \
+        vec t24 = t15 ^ t23;                           \
+        vec t25 = t0 | a2;                             \
+        vec t26 = a5 & a2;                             \
+        vec t27 = t18 ^ t26;                           \
+        vec t28 = t18 ^ a5;                            \
+        vec t29 = a3 & t28;                            \
+        vec t30 = t27 ^ t29;                           \
+        vec t31 = a4 & t30;                            \
+        vec t32 = t24 ^ t31;                           \
+        vec t33 = a1 & t32;                            \
+        vec t34 = t11 ^ t33;                           \
+        vec t35 = a5 & a6;                             \
+        vec t36 = t18 ^ t35;                           \
+        vec t37 = a5 & t0;                             \
+        vec t38 = t16 ^ t37;                           \
+        vec t39 = a3 & t38;                            \
+        vec t40 = t36 ^ t39;                           \
+        vec t41 = a5 & t4;                             \
+        vec t42 = t12 ^ t41;                           \
+        vec t43 = a6 & ~a5;                            \
+        vec t44 = a3 & t43;                            \
+        vec t45 = t42 ^ t44;                           \
+        vec t46 = a4 & t45;                            \
+        vec t47 = t40 ^ t46;                           \
+        vec t48 = a5 & t12;                            \
+        vec t49 = t20 ^ t48;                           \
+        vec t50 = a3 & t49;                            \
+        vec t51 = t42 ^ t50;                           \
+        vec t52 = a5 & t25;                            \
+        vec t53 = t20 ^ t52;                           \
+        vec t54 = a5 & a6;                             \
+        vec t55 = t20 ^ t54;                           \
+        vec t56 = a3 & t55;                            \
+        vec t57 = t21 ^ t56;                           \
+        vec t58 = a4 & t57;                            \
+        vec t59 = t51 ^ t58;                           \
+        vec t60 = a1 & t59;                            \
+        vec t61 = t47 ^ t60;                           \
+        vec t62 = a5 & t4;                             \
+        vec t63 = t25 ^ t62;                           \
+        vec t64 = a3 & t42;                            \
+        vec t65 = t63 ^ t64;                           \
+        vec t66 = a3 & t18;                            \
+        vec t67 = t53 ^ t66;                           \
+        vec t68 = a4 & t67;                            \
+        vec t69 = t65 ^ t68;                           \
+        vec t70 = a5 & t4;                             \
+        vec t71 = t0 ^ t70;                            \
+        vec t72 = t19 & ~a5;                           \
+        vec t73 = a3 & t72;                            \
+        vec t74 = t53 ^ t73;                           \
+        vec t75 = a3 & t55;                            \
+        vec t76 = t72 ^ t75;                           \
+        vec t77 = a4 & t76;                            \
+        vec t78 = t74 ^ t77;                           \
+        vec t79 = a1 & t78;                            \
+        vec t80 = t69 ^ t79;                           \
+        vec t81 = a5 & t2;                             \
+        vec t82 = t19 ^ t81;                           \
+        vec t83 = ~t17;                                \
+        vec t84 = a3 & t83;                            \
+        vec t85 = t82 ^ t84;                           \
+        vec t86 = a5 & a2;                             \
+        vec t87 = t16 ^ t86;                           \
+        vec t88 = a4 & t87;                            \
+        vec t89 = t85 ^ t88;                           \
+        vec t90 = a5 & t0;                             \
+        vec t91 = t18 ^ t90;                           \
+        vec t92 = a5 & t18;                            \
+        vec t93 = a6 ^ t92;                            \
+        vec t94 = ~t22;                                \
+        vec t95 = a3 & t94;                            \
+        vec t96 = t93 ^ t95;                           \
+        vec t97 = a3 & t91;                            \
+        vec t98 = t71 ^ t97;                           \
+        vec t99 = a4 & t98;                            \
+        vec t100 = t96 ^ t99;                          \
+        vec t101 = a1 & t100;                          \
+        vec t102 = t89 ^ t101;                         \
+        o1 ^= t34;                                     \
+        o2 ^= t61;                                     \
+        o3 ^= t80;                                     \
+        o4 ^= t102;                                    \
+    } while (0)
+
+// 92 gates
+#define DES_S2(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a6;                                  \
+        vec t1 = t0 ^ a5;                              \
+        vec t2 = a6 | a5;                              \
+        vec t3 = a5 & ~t0;                             \
+        vec t4 = ~t3;                                  \
+        vec t5 = a1 & t4;                              \
+        vec t6 = t1 ^ t5;                              \
+        vec t7 = ~a5;                                  \
+        vec t8 = ~t1;                                  \
+        vec t9 = a6 & ~a5;                             \
+        vec t10 = a1 & t9;                             \
+        vec t11 = a6 ^ t10;                            \
+        vec t12 = a2 & t11;                            \
+        vec t13 = t6 ^ t12;                            \
+        vec t14 = a5 & t0;                             \
+        vec t15 = a1 & t14;                            \
+        vec t16 = a5 ^ t15;                            \
+        vec t17 = t16 | a2;                            \
+        vec t18 = a4 & t17;                            \
+        vec t19 = t13 ^ t18;                           \
+        vec t20 = t8 ^ a1;                             \
+        vec t21 = ~t2;                                 \
+        vec t22 = a1 & t3;                             \
+        vec t23 = ~t14;                                \
+        vec t24 = a1 & t23;                            \
+        vec t25 = a6 ^ t24;                            \
+        vec t26 = a5 | a1;                             \
+        vec t27 = ~t22;                                \
+        vec t28 = ~t9;                                 \
+        vec t29 = a1 & t28;                            \
+        vec t30 = t0 & ~a1;                            \
+        vec t31 = a2 & t30;                            \
+        vec t32 = t27 ^ t31;                           \
+        vec t33 = a3 & t32;                            \
+        vec t34 = t19 ^ t33;                           \
+        vec t35 = ~t20;                                \
+        vec t36 = t35 ^ a2;                            \
+        vec t37 = a1 & t14;                            \
+        vec t38 = a6 ^ t37;                            \
+        vec t39 = a1 & t14;                            \
+        vec t40 = ~t38;                                \
+        vec t41 = a2 & t40;                            \
+        vec t42 = t4 ^ t41;                            \
+        vec t43 = a4 & t42;                            \
+        vec t44 = t36 ^ t43;                           \
+        vec t45 = ~t39;                                \
+        vec t46 = a2 & t45;                            \
+        vec t47 = a6 ^ t46;                            \
+        vec t48 = a4 & t3;                             \
+        vec t49 = t47 ^ t48;                           \
+        vec t50 = a3 & t49;                            \
+        vec t51 = t44 ^ t50;                           \
+        vec t52 = a1 & t4;                             \
+        vec t53 = t7 ^ t52;                            \
+        vec t54 = a1 & t1;                             \
+        vec t55 = t4 ^ t54;                            \
+        vec t56 = a2 & t55;                            \
+        vec t57 = t53 ^ t56;                           \
+        vec t58 = a1 & ~t7;                            \
+        vec t59 = ~t58;                                \
+        vec t60 = t9 | a1;                             \
+        vec t61 = a2 & t60;                            \
+        vec t62 = t59 ^ t61;                           \
+        vec t63 = a4 & t62;                            \
+        vec t64 = t57 ^ t63;                           \
+        vec t65 = a1 & t21;                            \
+        vec t66 = t1 ^ t65;                            \
+        vec t67 = a2 & t25;                            \
+        vec t68 = t26 ^ t67;                           \
+        vec t69 = t1 & ~a1;                            \
+        vec t70 = a2 & a1;                             \
+        vec t71 = t69 ^ t70;                           \
+        vec t72 = a4 & t71;                            \
+        vec t73 = t68 ^ t72;                           \
+        vec t74 = a3 & t73;                            \
+        vec t75 = t64 ^ t74;                           \
+        vec t76 = ~t29;                                \
+        vec t77 = a2 & t25;                            \
+        vec t78 = t76 ^ t77;                           \
+        vec t79 = t4 | a1;                             \
+        vec t80 = a1 & a6;                             \
+        vec t81 = t14 ^ t80;                           \
+        vec t82 = a2 & t81;                            \
+        vec t83 = t79 ^ t82;                           \
+        vec t84 = a4 & t83;                            \
+        vec t85 = t78 ^ t84;                           \
+        vec t86 = a1 & t9;                             \
+        vec t87 = t14 ^ t86;                           \
+        vec t88 = a2 & t87;                            \
+        vec t89 = t66 ^ t88;                           \
+        vec t90 = a3 & t89;                            \
+        vec t91 = t85 ^ t90;                           \
+        o1 ^= t34;                                     \
+        o2 ^= t51;                                     \
+        o3 ^= t75;                                     \
+        o4 ^= t91;                                     \
+    } while (0)
+
+// 91 gates
+#define DES_S3(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a2;                                  \
+        vec t1 = t0 ^ a5;                              \
+        vec t2 = ~a6;                                  \
+        vec t3 = a2 & ~a6;                             \
+        vec t4 = ~t3;                                  \
+        vec t5 = a6 | a2;                              \
+        vec t6 = a6 ^ a2;                              \
+        vec t7 = a2 & ~t2;                             \
+        vec t8 = ~t5;                                  \
+        vec t9 = a5 & t8;                              \
+        vec t10 = t6 ^ t9;                             \
+        vec t11 = a4 & t10;                            \
+        vec t12 = t1 ^ t11;                            \
+        vec t13 = ~t6;                                 \
+        vec t14 = a5 & t4;                             \
+        vec t15 = ~t14;                                \
+        vec t16 = t2 | a2;                             \
+        vec t17 = a5 & a6;                             \
+        vec t18 = t0 ^ t17;                            \
+        vec t19 = a4 & t18;                            \
+        vec t20 = t15 ^ t19;                           \
+        vec t21 = a3 & t20;                            \
+        vec t22 = t12 ^ t21;                           \
+        vec t23 = t2 ^ a5;                             \
+        vec t24 = ~t23;                                \
+        vec t25 = ~t10;                                \
+        vec t26 = a4 & t25;                            \
+        vec t27 = t6 ^ t26;                            \
+        vec t28 = t18 & ~a4;                           \
+        vec t29 = a3 & t28;                            \
+        vec t30 = t27 ^ t29;                           \
+        vec t31 = a1 & t30;                            \
+        vec t32 = t22 ^ t31;                           \
+        vec t33 = ~t16;                                \
+        vec t34 = a5 & t3;                             \
+        vec t35 = t33 ^ t34;                           \
+        vec t36 = a5 & t2;                             \
+        vec t37 = t5 ^ t36;                            \
+        vec t38 = a4 & t37;                            \
+        vec t39 = t35 ^ t38;                           \
+        vec t40 = a5 & t2;                             \
+        vec t41 = t4 & ~a5;                            \
+        vec t42 = a4 & a2;                             \
+        vec t43 = t41 ^ t42;                           \
+        vec t44 = a3 & t43;                            \
+        vec t45 = t39 ^ t44;                           \
+        vec t46 = ~a5;                                 \
+        vec t47 = t4 | a5;                             \
+        vec t48 = ~t18;                                \
+        vec t49 = a4 & t48;                            \
+        vec t50 = t47 ^ t49;                           \
+        vec t51 = t50 | a3;                            \
+        vec t52 = a1 & t51;                            \
+        vec t53 = t45 ^ t52;                           \
+        vec t54 = a5 & t4;                             \
+        vec t55 = t13 ^ t54;                           \
+        vec t56 = t13 | a5;                            \
+        vec t57 = a4 & t56;                            \
+        vec t58 = t55 ^ t57;                           \
+        vec t59 = t37 | a4;                            \
+        vec t60 = a3 & t59;                            \
+        vec t61 = t58 ^ t60;                           \
+        vec t62 = ~t35;                                \
+        vec t63 = a5 & t16;                            \
+        vec t64 = t8 ^ t63;                            \
+        vec t65 = a4 & t64;                            \
+        vec t66 = t62 ^ t65;                           \
+        vec t67 = a5 & a6;                             \
+        vec t68 = t5 ^ t67;                            \
+        vec t69 = a4 & t68;                            \
+        vec t70 = t40 ^ t69;                           \
+        vec t71 = a3 & t70;                            \
+        vec t72 = t66 ^ t71;                           \
+        vec t73 = a1 & t72;                            \
+        vec t74 = t61 ^ t73;                           \
+        vec t75 = a4 & t46;                            \
+        vec t76 = t6 ^ t75;                            \
+        vec t77 = a3 & a5;                             \
+        vec t78 = t76 ^ t77;                           \
+        vec t79 = a5 & t4;                             \
+        vec t80 = t8 ^ t79;                            \
+        vec t81 = a4 & t24;                            \
+        vec t82 = t80 ^ t81;                           \
+        vec t83 = a5 & t0;                             \
+        vec t84 = t4 ^ t83;                            \
+        vec t85 = a4 & t7;                             \
+        vec t86 = t84 ^ t85;                           \
+        vec t87 = a3 & t86;                            \
+        vec t88 = t82 ^ t87;                           \
+        vec t89 = a1 & t88;                            \
+        vec t90 = t78 ^ t89;                           \
+        o1 ^= t32;                                     \
+        o2 ^= t53;                                     \
+        o3 ^= t74;                                     \
+        o4 ^= t90;                                     \
+    } while (0)
+
+// 86 gates
+#define DES_S4(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = a5 & ~a3;                             \
+        vec t1 = ~t0;                                  \
+        vec t2 = t0 ^ a1;                              \
+        vec t3 = ~a5;                                  \
+        vec t4 = t3 ^ a3;                              \
+        vec t5 = a3 & t3;                              \
+        vec t6 = a1 & ~t5;                             \
+        vec t7 = ~t6;                                  \
+        vec t8 = a4 & t7;                              \
+        vec t9 = t2 ^ t8;                              \
+        vec t10 = t3 & ~a3;                            \
+        vec t11 = ~t4;                                 \
+        vec t12 = a3 & ~t3;                            \
+        vec t13 = ~t10;                                \
+        vec t14 = a1 & t0;                             \
+        vec t15 = t13 ^ t14;                           \
+        vec t16 = ~a3;                                 \
+        vec t17 = a1 & t4;                             \
+        vec t18 = a5 ^ t17;                            \
+        vec t19 = a4 & t18;                            \
+        vec t20 = t15 ^ t19;                           \
+        vec t21 = a2 & t20;                            \
+        vec t22 = t9 ^ t21;                            \
+        vec t23 = ~t5;                                 \
+        vec t24 = a1 & t1;                             \
+        vec t25 = t23 ^ t24;                           \
+        vec t26 = a4 & a5;                             \
+        vec t27 = t25 ^ t26;                           \
+        vec t28 = a1 & t1;                             \
+        vec t29 = t12 ^ t28;                           \
+        vec t30 = t11 | a1;                            \
+        vec t31 = a1 & t4;                             \
+        vec t32 = a3 ^ t31;                            \
+        vec t33 = a4 & t32;                            \
+        vec t34 = t16 ^ t33;                           \
+        vec t35 = a2 & t34;                            \
+        vec t36 = t27 ^ t35;                           \
+        vec t37 = a1 & t0;                             \
+        vec t38 = t4 ^ t37;                            \
+        vec t39 = a1 & t23;                            \
+        vec t40 = t3 ^ t39;                            \
+        vec t41 = a4 & t40;                            \
+        vec t42 = t38 ^ t41;                           \
+        vec t43 = a1 & t23;                            \
+        vec t44 = t16 ^ t43;                           \
+        vec t45 = t1 | a1;                             \
+        vec t46 = a4 & t11;                            \
+        vec t47 = t45 ^ t46;                           \
+        vec t48 = a2 & t47;                            \
+        vec t49 = t42 ^ t48;                           \
+        vec t50 = a6 & t49;                            \
+        vec t51 = t22 ^ t50;                           \
+        vec t52 = ~t49;                                \
+        vec t53 = a6 & t52;                            \
+        vec t54 = t36 ^ t53;                           \
+        vec t55 = t0 | a1;                             \
+        vec t56 = a4 & t55;                            \
+        vec t57 = t38 ^ t56;                           \
+        vec t58 = ~t28;                                \
+        vec t59 = a4 & t32;                            \
+        vec t60 = t58 ^ t59;                           \
+        vec t61 = a2 & t60;                            \
+        vec t62 = t57 ^ t61;                           \
+        vec t63 = ~t44;                                \
+        vec t64 = a4 & t3;                             \
+        vec t65 = t63 ^ t64;                           \
+        vec t66 = a4 & t18;                            \
+        vec t67 = t30 ^ t66;                           \
+        vec t68 = a2 & t67;                            \
+        vec t69 = t65 ^ t68;                           \
+        vec t70 = ~t18;                                \
+        vec t71 = ~t29;                                \
+        vec t72 = a4 & t71;                            \
+        vec t73 = t70 ^ t72;                           \
+        vec t74 = a1 & t5;                             \
+        vec t75 = t4 ^ t74;                            \
+        vec t76 = a4 & t11;                            \
+        vec t77 = t75 ^ t76;                           \
+        vec t78 = a2 & t77;                            \
+        vec t79 = t73 ^ t78;                           \
+        vec t80 = a6 & t79;                            \
+        vec t81 = t62 ^ t80;                           \
+        vec t82 = ~t69;                                \
+        vec t83 = ~t79;                                \
+        vec t84 = a6 & t83;                            \
+        vec t85 = t82 ^ t84;                           \
+        o1 ^= t51;                                     \
+        o2 ^= t54;                                     \
+        o3 ^= t81;                                     \
+        o4 ^= t85;                                     \
+    } while (0)
+
+// 109 gates
+#define DES_S5(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = a6 & ~a3;                             \
+        vec t1 = ~a6;                                  \
+        vec t2 = a6 ^ a3;                              \
+        vec t3 = a3 & t1;                              \
+        vec t4 = a1 & t3;                              \
+        vec t5 = t0 ^ t4;                              \
+        vec t6 = a3 & ~t1;                             \
+        vec t7 = ~t6;                                  \
+        vec t8 = a6 | a3;                              \
+        vec t9 = ~t2;                                  \
+        vec t10 = a1 & t9;                             \
+        vec t11 = t7 ^ t10;                            \
+        vec t12 = ~t0;                                 \
+        vec t13 = a1 & t12;                            \
+        vec t14 = t1 ^ t13;                            \
+        vec t15 = a5 & t14;                            \
+        vec t16 = t5 ^ t15;                            \
+        vec t17 = a1 & a6;                             \
+        vec t18 = t8 ^ t17;                            \
+        vec t19 = ~a3;                                 \
+        vec t20 = a1 & t2;                             \
+        vec t21 = ~t3;                                 \
+        vec t22 = a1 & a3;                             \
+        vec t23 = t21 ^ t22;                           \
+        vec t24 = a5 & t23;                            \
+        vec t25 = t18 ^ t24;                           \
+        vec t26 = a4 & t25;                            \
+        vec t27 = t16 ^ t26;                           \
+        vec t28 = ~t8;                                 \
+        vec t29 = t8 ^ a1;                             \
+        vec t30 = a1 & t28;                            \
+        vec t31 = t7 ^ t30;                            \
+        vec t32 = ~t17;                                \
+        vec t33 = t7 | a1;                             \
+        vec t34 = a1 & a6;                             \
+        vec t35 = t6 ^ t34;                            \
+        vec t36 = a5 & t35;                            \
+        vec t37 = t33 ^ t36;                           \
+        vec t38 = a1 & t9;                             \
+        vec t39 = t1 ^ t38;                            \
+        vec t40 = a1 & ~a6;                            \
+        vec t41 = ~t40;                                \
+        vec t42 = a5 & t41;                            \
+        vec t43 = t39 ^ t42;                           \
+        vec t44 = a4 & t43;                            \
+        vec t45 = t37 ^ t44;                           \
+        vec t46 = a2 & t45;                            \
+        vec t47 = t27 ^ t46;                           \
+        vec t48 = ~t35;                                \
+        vec t49 = a5 & t48;                            \
+        vec t50 = t29 ^ t49;                           \
+        vec t51 = ~t11;                                \
+        vec t52 = a5 & t51;                            \
+        vec t53 = t7 ^ t52;                            \
+        vec t54 = a4 & t53;                            \
+        vec t55 = t50 ^ t54;                           \
+        vec t56 = a1 & t28;                            \
+        vec t57 = t2 ^ t56;                            \
+        vec t58 = a1 & t21;                            \
+        vec t59 = t28 ^ t58;                           \
+        vec t60 = t6 | a1;                             \
+        vec t61 = a1 & t8;                             \
+        vec t62 = t6 ^ t61;                            \
+        vec t63 = t62 | a4;                            \
+        vec t64 = a2 & t63;                            \
+        vec t65 = t55 ^ t64;                           \
+        vec t66 = a1 & t7;                             \
+        vec t67 = t8 ^ t66;                            \
+        vec t68 = t9 | a1;                             \
+        vec t69 = a5 & t68;                            \
+        vec t70 = t31 ^ t69;                           \
+        vec t71 = t21 & ~a1;                           \
+        vec t72 = a5 & t71;                            \
+        vec t73 = t59 ^ t72;                           \
+        vec t74 = a4 & t73;                            \
+        vec t75 = t70 ^ t74;                           \
+        vec t76 = ~t20;                                \
+        vec t77 = ~t67;                                \
+        vec t78 = a5 & t77;                            \
+        vec t79 = t76 ^ t78;                           \
+        vec t80 = ~t59;                                \
+        vec t81 = a5 & t32;                            \
+        vec t82 = t80 ^ t81;                           \
+        vec t83 = a4 & t82;                            \
+        vec t84 = t79 ^ t83;                           \
+        vec t85 = a2 & t84;                            \
+        vec t86 = t75 ^ t85;                           \
+        vec t87 = a1 & t8;                             \
+        vec t88 = t3 ^ t87;                            \
+        vec t89 = a5 & t8;                             \
+        vec t90 = t88 ^ t89;                           \
+        vec t91 = a5 & t71;                            \
+        vec t92 = t60 ^ t91;                           \
+        vec t93 = a4 & t92;                            \
+        vec t94 = t90 ^ t93;                           \
+        vec t95 = a1 & t28;                            \
+        vec t96 = a6 ^ t95;                            \
+        vec t97 = ~t57;                                \
+        vec t98 = a5 & t97;                            \
+        vec t99 = t96 ^ t98;                           \
+        vec t100 = a1 & t19;                           \
+        vec t101 = t1 ^ t100;                          \
+        vec t102 = a6 ^ a1;                            \
+        vec t103 = a5 & t102;                          \
+        vec t104 = t101 ^ t103;                        \
+        vec t105 = a4 & t104;                          \
+        vec t106 = t99 ^ t105;                         \
+        vec t107 = a2 & t106;                          \
+        vec t108 = t94 ^ t107;                         \
+        o1 ^= t47;                                     \
+        o2 ^= t65;                                     \
+        o3 ^= t86;                                     \
+        o4 ^= t108;                                    \
+    } while (0)
+
+// 93 gates
+#define DES_S6(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a2;                                  \
+        vec t1 = ~a6;                                  \
+        vec t2 = a6 ^ a2;                              \
+        vec t3 = a5 & t1;                              \
+        vec t4 = t0 ^ t3;                              \
+        vec t5 = ~t2;                                  \
+        vec t6 = a6 | a5;                              \
+        vec t7 = a1 & t6;                              \
+        vec t8 = t4 ^ t7;                              \
+        vec t9 = t1 & ~a2;                             \
+        vec t10 = a2 & ~t1;                            \
+        vec t11 = a6 & ~a2;                            \
+        vec t12 = t11 & ~a5;                           \
+        vec t13 = a1 & t12;                            \
+        vec t14 = t6 ^ t13;                            \
+        vec t15 = a4 & t14;                            \
+        vec t16 = t8 ^ t15;                            \
+        vec t17 = ~t11;                                \
+        vec t18 = a5 & a6;                             \
+        vec t19 = t2 ^ t18;                            \
+        vec t20 = t17 & ~a5;                           \
+        vec t21 = a1 & t20;                            \
+        vec t22 = t19 ^ t21;                           \
+        vec t23 = ~t9;                                 \
+        vec t24 = a5 & t1;                             \
+        vec t25 = t17 ^ t24;                           \
+        vec t26 = ~t6;                                 \
+        vec t27 = a1 & t10;                            \
+        vec t28 = t25 ^ t27;                           \
+        vec t29 = a4 & t28;                            \
+        vec t30 = t22 ^ t29;                           \
+        vec t31 = a3 & t30;                            \
+        vec t32 = t16 ^ t31;                           \
+        vec t33 = t5 ^ a5;                             \
+        vec t34 = ~t33;                                \
+        vec t35 = t33 ^ a1;                            \
+        vec t36 = a5 & ~t2;                            \
+        vec t37 = a5 & t10;                            \
+        vec t38 = t0 ^ t37;                            \
+        vec t39 = a1 & t36;                            \
+        vec t40 = t38 ^ t39;                           \
+        vec t41 = a4 & t40;                            \
+        vec t42 = t35 ^ t41;                           \
+        vec t43 = a5 & t23;                            \
+        vec t44 = t23 & ~a5;                           \
+        vec t45 = a5 & t2;                             \
+        vec t46 = ~a5;                                 \
+        vec t47 = ~t44;                                \
+        vec t48 = a1 & t47;                            \
+        vec t49 = t46 ^ t48;                           \
+        vec t50 = t10 ^ a5;                            \
+        vec t51 = a1 & t50;                            \
+        vec t52 = a5 ^ t51;                            \
+        vec t53 = a4 & t52;                            \
+        vec t54 = t49 ^ t53;                           \
+        vec t55 = a3 & t54;                            \
+        vec t56 = t42 ^ t55;                           \
+        vec t57 = a5 & t10;                            \
+        vec t58 = a6 ^ t57;                            \
+        vec t59 = a1 & t34;                            \
+        vec t60 = t58 ^ t59;                           \
+        vec t61 = ~t45;                                \
+        vec t62 = a1 & t43;                            \
+        vec t63 = t61 ^ t62;                           \
+        vec t64 = a4 & t63;                            \
+        vec t65 = t60 ^ t64;                           \
+        vec t66 = a5 & t17;                            \
+        vec t67 = t5 ^ t66;                            \
+        vec t68 = a2 | a5;                             \
+        vec t69 = a1 & t67;                            \
+        vec t70 = t68 ^ t69;                           \
+        vec t71 = a3 & t70;                            \
+        vec t72 = t65 ^ t71;                           \
+        vec t73 = a1 & t17;                            \
+        vec t74 = a5 ^ t73;                            \
+        vec t75 = a5 & t11;                            \
+        vec t76 = a2 ^ t75;                            \
+        vec t77 = a5 & t17;                            \
+        vec t78 = t10 ^ t77;                           \
+        vec t79 = a1 & t78;                            \
+        vec t80 = t76 ^ t79;                           \
+        vec t81 = a4 & t80;                            \
+        vec t82 = t74 ^ t81;                           \
+        vec t83 = a1 & t50;                            \
+        vec t84 = t0 ^ t83;                            \
+        vec t85 = a5 & t1;                             \
+        vec t86 = t9 ^ t85;                            \
+        vec t87 = a1 & t26;                            \
+        vec t88 = t86 ^ t87;                           \
+        vec t89 = a4 & t88;                            \
+        vec t90 = t84 ^ t89;                           \
+        vec t91 = a3 & t90;                            \
+        vec t92 = t82 ^ t91;                           \
+        o1 ^= t32;                                     \
+        o2 ^= t56;                                     \
+        o3 ^= t72;                                     \
+        o4 ^= t92;                                     \
+    } while (0)
+
+// 106 gates
+#define DES_S7(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a5;                                  \
+        vec t1 = a5 ^ a3;                              \
+        vec t2 = a5 | a3;                              \
+        vec t3 = a3 & a5;                              \
+        vec t4 = a4 & t3;                              \
+        vec t5 = t1 ^ t4;                              \
+        vec t6 = a3 & ~a5;                             \
+        vec t7 = ~t6;                                  \
+        vec t8 = a3 | a4;                              \
+        vec t9 = a2 & t8;                              \
+        vec t10 = t5 ^ t9;                             \
+        vec t11 = ~t1;                                 \
+        vec t12 = t11 ^ a4;                            \
+        vec t13 = ~t4;                                 \
+        vec t14 = ~a3;                                 \
+        vec t15 = ~t3;                                 \
+        vec t16 = a3 & ~a4;                            \
+        vec t17 = a2 & t16;                            \
+        vec t18 = t13 ^ t17;                           \
+        vec t19 = a6 & t18;                            \
+        vec t20 = t10 ^ t19;                           \
+        vec t21 = a4 & t0;                             \
+        vec t22 = t14 ^ t21;                           \
+        vec t23 = t0 | a3;                             \
+        vec t24 = ~t23;                                \
+        vec t25 = t0 ^ a4;                             \
+        vec t26 = a4 & a5;                             \
+        vec t27 = a4 & t15;                            \
+        vec t28 = t24 ^ t27;                           \
+        vec t29 = a4 & t2;                             \
+        vec t30 = t11 ^ t29;                           \
+        vec t31 = a4 & t11;                            \
+        vec t32 = t7 ^ t31;                            \
+        vec t33 = a2 & t32;                            \
+        vec t34 = t28 ^ t33;                           \
+        vec t35 = a4 & t0;                             \
+        vec t36 = t7 ^ t35;                            \
+        vec t37 = a4 & t24;                            \
+        vec t38 = t11 ^ t37;                           \
+        vec t39 = a2 & t16;                            \
+        vec t40 = t38 ^ t39;                           \
+        vec t41 = a6 & t40;                            \
+        vec t42 = t34 ^ t41;                           \
+        vec t43 = a1 & t42;                            \
+        vec t44 = t20 ^ t43;                           \
+        vec t45 = t14 ^ a4;                            \
+        vec t46 = a2 & t45;                            \
+        vec t47 = t25 ^ t46;                           \
+        vec t48 = ~t22;                                \
+        vec t49 = a2 & t48;                            \
+        vec t50 = ~t26;                                \
+        vec t51 = a2 & t50;                            \
+        vec t52 = t4 ^ t51;                            \
+        vec t53 = a6 & t52;                            \
+        vec t54 = t47 ^ t53;                           \
+        vec t55 = a4 & a3;                             \
+        vec t56 = ~t55;                                \
+        vec t57 = a4 & t15;                            \
+        vec t58 = a3 ^ t57;                            \
+        vec t59 = ~t58;                                \
+        vec t60 = a2 & t56;                            \
+        vec t61 = t59 ^ t60;                           \
+        vec t62 = ~t49;                                \
+        vec t63 = a6 & t62;                            \
+        vec t64 = t61 ^ t63;                           \
+        vec t65 = a1 & t64;                            \
+        vec t66 = t54 ^ t65;                           \
+        vec t67 = a4 & t0;                             \
+        vec t68 = t1 ^ t67;                            \
+        vec t69 = a2 & t50;                            \
+        vec t70 = t68 ^ t69;                           \
+        vec t71 = ~t30;                                \
+        vec t72 = a4 & t1;                             \
+        vec t73 = a2 & t72;                            \
+        vec t74 = t71 ^ t73;                           \
+        vec t75 = a6 & t74;                            \
+        vec t76 = t70 ^ t75;                           \
+        vec t77 = ~t67;                                \
+        vec t78 = ~t36;                                \
+        vec t79 = a2 & t78;                            \
+        vec t80 = t2 ^ t79;                            \
+        vec t81 = a4 & t6;                             \
+        vec t82 = t23 ^ t81;                           \
+        vec t83 = a4 & a3;                             \
+        vec t84 = t6 ^ t83;                            \
+        vec t85 = a2 & t84;                            \
+        vec t86 = t82 ^ t85;                           \
+        vec t87 = a6 & t86;                            \
+        vec t88 = t80 ^ t87;                           \
+        vec t89 = a1 & t88;                            \
+        vec t90 = t76 ^ t89;                           \
+        vec t91 = a2 & t14;                            \
+        vec t92 = t71 ^ t91;                           \
+        vec t93 = a2 & ~t77;                           \
+        vec t94 = ~t93;                                \
+        vec t95 = a6 & t94;                            \
+        vec t96 = t92 ^ t95;                           \
+        vec t97 = ~t12;                                \
+        vec t98 = a4 & ~t2;                            \
+        vec t99 = ~t98;                                \
+        vec t100 = a2 & t97;                           \
+        vec t101 = t99 ^ t100;                         \
+        vec t102 = a6 & ~t101;                         \
+        vec t103 = ~t102;                              \
+        vec t104 = a1 & t103;                          \
+        vec t105 = t96 ^ t104;                         \
+        o1 ^= t44;                                     \
+        o2 ^= t66;                                     \
+        o3 ^= t90;                                     \
+        o4 ^= t105;                                    \
+    } while (0)
+
+// 100 gates
+#define DES_S8(a1, a2, a3, a4, a5, a6, o1, o2, o3, o4) \
+    do                                                 \
+    {                                                  \
+        vec t0 = ~a5;                                  \
+        vec t1 = t0 ^ a3;                              \
+        vec t2 = a4 & a3;                              \
+        vec t3 = t1 ^ t2;                              \
+        vec t4 = ~a3;                                  \
+        vec t5 = ~t1;                                  \
+        vec t6 = a4 & t1;                              \
+        vec t7 = a5 ^ t6;                              \
+        vec t8 = a2 & t7;                              \
+        vec t9 = t3 ^ t8;                              \
+        vec t10 = a5 | a3;                             \
+        vec t11 = a3 & t0;                             \
+        vec t12 = a4 & a5;                             \
+        vec t13 = t10 ^ t12;                           \
+        vec t14 = ~t11;                                \
+        vec t15 = a5 | a4;                             \
+        vec t16 = a3 & ~t0;                            \
+        vec t17 = ~t16;                                \
+        vec t18 = a4 & t5;                             \
+        vec t19 = t17 ^ t18;                           \
+        vec t20 = t0 | a3;                             \
+        vec t21 = a4 & a5;                             \
+        vec t22 = t17 ^ t21;                           \
+        vec t23 = a2 & t2;                             \
+        vec t24 = t19 ^ t23;                           \
+        vec t25 = a1 & t24;                            \
+        vec t26 = t9 ^ t25;                            \
+        vec t27 = a4 & t0;                             \
+        vec t28 = t5 ^ t27;                            \
+        vec t29 = ~t21;                                \
+        vec t30 = a2 & t29;                            \
+        vec t31 = t28 ^ t30;                           \
+        vec t32 = a4 & t0;                             \
+        vec t33 = t11 ^ t32;                           \
+        vec t34 = a2 & t33;                            \
+        vec t35 = t10 ^ t34;                           \
+        vec t36 = a1 & t35;                            \
+        vec t37 = t31 ^ t36;                           \
+        vec t38 = ~t6;                                 \
+        vec t39 = a4 & t4;                             \
+        vec t40 = t0 ^ t39;                            \
+        vec t41 = a2 & t40;                            \
+        vec t42 = t38 ^ t41;                           \
+        vec t43 = t1 | a4;                             \
+        vec t44 = ~t20;                                \
+        vec t45 = t20 ^ a4;                            \
+        vec t46 = a4 & t1;                             \
+        vec t47 = t11 ^ t46;                           \
+        vec t48 = a2 & t47;                            \
+        vec t49 = t43 ^ t48;                           \
+        vec t50 = a1 & t49;                            \
+        vec t51 = t42 ^ t50;                           \
+        vec t52 = a6 & t51;                            \
+        vec t53 = t26 ^ t52;                           \
+        vec t54 = ~t28;                                \
+        vec t55 = a2 & t54;                            \
+        vec t56 = t45 ^ t55;                           \
+        vec t57 = a4 & t4;                             \
+        vec t58 = t11 ^ t57;                           \
+        vec t59 = t5 | a4;                             \
+        vec t60 = a2 & t59;                            \
+        vec t61 = t58 ^ t60;                           \
+        vec t62 = a1 & t61;                            \
+        vec t63 = t56 ^ t62;                           \
+        vec t64 = a4 & t4;                             \
+        vec t65 = t20 ^ t64;                           \
+        vec t66 = a2 & t2;                             \
+        vec t67 = t65 ^ t66;                           \
+        vec t68 = a1 & ~t67;                           \
+        vec t69 = ~t68;                                \
+        vec t70 = a6 & t69;                            \
+        vec t71 = t63 ^ t70;                           \
+        vec t72 = t13 ^ a2;                            \
+        vec t73 = a4 & t0;                             \
+        vec t74 = t20 ^ t73;                           \
+        vec t75 = a2 & t44;                            \
+        vec t76 = t74 ^ t75;                           \
+        vec t77 = a1 & t76;                            \
+        vec t78 = t72 ^ t77;                           \
+        vec t79 = ~t59;                                \
+        vec t80 = a2 & t79;                            \
+        vec t81 = ~t22;                                \
+        vec t82 = a2 & t81;                            \
+        vec t83 = t15 ^ t82;                           \
+        vec t84 = a1 & t83;                            \
+        vec t85 = t80 ^ t84;                           \
+        vec t86 = a6 & t85;                            \
+        vec t87 = t78 ^ t86;                           \
+        vec t88 = ~t37;                                \
+        vec t89 = a4 & t14;                            \
+        vec t90 = t44 ^ t89;                           \
+        vec t91 = a2 & t5;                             \
+        vec t92 = t90 ^ t91;                           \
+        vec t93 = ~t65;                                \
+        vec t94 = a2 & t93;                            \
+        vec t95 = t19 ^ t94;                           \
+        vec t96 = a1 & t95;                            \
+        vec t97 = t92 ^ t96;                           \
+        vec t98 = a6 & t97;                            \
+        vec t99 = t88 ^ t98;                           \
+        o1 ^= t53;                                     \
+        o2 ^= t71;                                     \
+        o3 ^= t87;                                     \
+        o4 ^= t99;                                     \
+    } while (0)
+
+#endif // CLIENT_DES_SBOXES_H
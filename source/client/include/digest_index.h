@@ -0,0 +1,86 @@
+#ifndef CLIENT_DIGEST_INDEX_H
+#define CLIENT_DIGEST_INDEX_H
+
+#include "fsm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DIGEST_INDEX_KEY_BITS 16  // filter bits per digest, before rounding up to a power of two
+#define DIGEST_INDEX_PROBES 4     // bits set per digest, all in one block
+#define DIGEST_INDEX_PER_BUCKET 4 // digests per radix bucket, on average
+
+// Lookup over a salt group's sorted digests, built once when the job
+// arrives. A blocked Bloom filter turns almost every candidate away after
+// one cache line: each digest sets its bits in a single 512-bit block. What
+// gets through is confirmed by binary search within the radix bucket of the
+// digest's leading bits, so a lookup costs about the same for ten digests as
+// for ten million.
+typedef struct digest_index
+{
+    const uint8_t *digests;
+    size_t         count;
+    size_t         digest_len;
+    uint64_t      *filter; // blocks of eight words
+    uint64_t       block_mask;
+    size_t        *buckets; // first digest of each bucket, then count
+    unsigned       bucket_shift;
+} digest_index;
+
+// digests must be sorted and outlive the index.
+int       digest_index_build(digest_index *index, const uint8_t *digests, size_t count, size_t digest_len,
+                             struct fsm_error *err);
+void      digest_index_free(digest_index *index);
+ptrdiff_t digest_index_find(const digest_index *index, const uint8_t *digest);
+
+// Digests are already uniform, but hashes in a list need not be, so the
+// leading eight bytes, loaded little-endian, are mixed before they pick the
+// block and bits.
+static inline uint64_t digest_index_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static inline uint64_t digest_index_hash(const uint8_t *digest)
+{
+    uint64_t h;
+
+    memcpy(&h, digest, sizeof(h));
+
+    return digest_index_mix(h);
+}
+
+// The filter block for a mixed hash. Callers testing several digests at once
+// prefetch every block first, so the cache misses overlap.
+static inline const uint64_t *digest_index_block(const digest_index *index, uint64_t h)
+{
+    return index->filter + ((h >> 40) & index->block_mask) * 8;
+}
+
+// False when the digest behind h is certainly not in the index.
+static inline bool digest_index_test(const digest_index *index, uint64_t h)
+{
+    const uint64_t *block = digest_index_block(index, h);
+
+    for (int i = 0; i < DIGEST_INDEX_PROBES; i++)
+    {
+        unsigned bit = (unsigned)(h >> (i * 9)) & 511;
+
+        if (!((block[bit / 64] >> (bit % 64)) & 1))
+            return false;
+    }
+
+    return true;
+}
+
+static inline bool digest_index_maybe(const digest_index *index, const uint8_t *digest)
+{
+    return digest_index_test(index, digest_index_hash(digest));
+}
+
+#endif // CLIENT_DIGEST_INDEX_H
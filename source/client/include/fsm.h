@@ -1,11 +1,13 @@
 #ifndef CLIENT_FSM_H
 #define CLIENT_FSM_H
 
+#include "protocol.h"
 #include <glob.h>
 #include <netinet/in.h>
 #include <poll.h>
 #include <pthread.h>
 #include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,30 +22,50 @@ typedef enum
     FSM_USER_START
 } fsm_state;
 
+#define RECV_BUF_SIZE 2048 // the longest message the server may send
+
 typedef struct worker_state
 {
     int sockfd;
 
-    char           *hash;
-    uint64_t        start_index;
-    uint64_t        work_size;
-    uint64_t        end_index;
-    uint64_t        checkpoint_interval;
-    uint32_t        timeout_seconds;
-    char            found_candidate[64];
-    pthread_mutex_t found_mutex;
+    protocol_mode         protocol;
+    uint32_t              caps; // capabilities the server agreed to
+    char                  recv_buf[RECV_BUF_SIZE];
+    size_t                recv_len;
+    char                **hashes;
+    atomic_bool          *cracked; // per target, by us or (via CRACKED) another worker
+    size_t                num_targets;
+    struct hash_group    *groups; // the targets as the threads check them, one hash computation each
+    size_t                num_groups;
+    atomic_size_t         remaining;
+    size_t                max_lanes; // widest engine among the targets
+    bool                  stream;    // every target's engine takes candidates straight from the generator
+    struct keyspace      *keyspace;
+    const char           *wordlist_path;
+    const char           *markov_path;
+    const char           *rainbow_path;
+    struct rainbow_table *rainbow; // set for jobs that build or look up a rainbow table
+    uint64_t              start_index;
+    uint64_t              work_size;
+    uint64_t              end_index;
+    uint64_t              checkpoint_interval;
+    uint32_t              timeout_seconds;
+    char                  found_candidate[64];
+    pthread_mutex_t       found_mutex;
 } worker_state;
 
 typedef struct arguments
 {
     int                     sockfd, threads;
-    char                   *server_addr, *server_port_str, *threads_str;
+    char                   *server_addr, *server_port_str, *threads_str, *wordlist_path, *markov_path,
+                           *rainbow_path, *protocol_str;
     in_port_t               server_port;
     struct sockaddr_storage server_addr_struct;
     atomic_bool             found;
     clock_t                 start_cpu, end_cpu;
     struct timespec         start_wall, end_wall;
     struct worker_state    *ws;
+    struct worker_pool     *pool;
     int                     timer_started;
 } arguments;
 
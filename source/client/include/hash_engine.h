@@ -0,0 +1,149 @@
+#ifndef CLIENT_HASH_ENGINE_H
+#define CLIENT_HASH_ENGINE_H
+
+#include "blowfish.h"
+#include "digest_index.h"
+#include "fsm.h"
+#include "yescrypt.h"
+#include <crypt.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HASH_MAX_SALT 64
+#define HASH_MAX_SETTING 128
+#define HASH_MAX_DIGEST 64
+#define HASH_MAX_LANES 512 // bitsliced DES on AVX-512
+
+typedef enum
+{
+    HASH_SCHEME_UNKNOWN,
+    HASH_SCHEME_DES,
+    HASH_SCHEME_MD5,
+    HASH_SCHEME_APR1,
+    HASH_SCHEME_SHA256,
+    HASH_SCHEME_SHA512,
+    HASH_SCHEME_BCRYPT,
+    HASH_SCHEME_YESCRYPT,
+    HASH_SCHEME_SCRYPT,
+    HASH_SCHEME_RAW_MD5,
+    HASH_SCHEME_RAW_SHA1,
+    HASH_SCHEME_RAW_SHA256,
+    HASH_SCHEME_NTLM
+} hash_scheme;
+
+// The job's hash, parsed once when it arrives. setting is everything crypt()
+// needs besides the key (prefix, parameters and salt); digest is the decoded
+// output the engines compare against instead of re-encoding every result.
+// A target standing for a salt group compares against digests instead:
+// num_digests of digest_len bytes each, sorted, looked up through index
+// when the group has one.
+typedef struct hash_target
+{
+    hash_scheme               scheme;
+    const struct hash_engine *engine;
+    const char               *encoded;
+    char                      setting[HASH_MAX_SETTING];
+    char                      salt[HASH_MAX_SALT + 1];
+    size_t                    salt_len;
+    uint8_t                   salt_bytes[HASH_MAX_SALT]; // decoded, for schemes that store the salt encoded
+    size_t                    salt_bytes_len;
+    uint8_t                   ebox[48];                  // DES E-box with the salt's swaps applied
+    yescrypt_params           yescrypt;
+    uint32_t                  cost; // rounds for MD5/SHA-crypt, log2 rounds for bcrypt
+    bool                      custom_cost;
+    uint8_t                   digest[HASH_MAX_DIGEST];
+    size_t                    digest_len;
+    const uint8_t            *digests;
+    size_t                    num_digests;
+    const digest_index       *index;
+} hash_target;
+
+// The raw-hash kernels start every lane from the state after the leading
+// message words all lanes share. Successive batches mostly share the same
+// prefix, so the last one's state (and, for the SHA family, the schedule
+// terms that only read prefix words) is kept for the next batch.
+typedef struct raw_prefix
+{
+    hash_scheme scheme;
+    size_t      shared;
+    uint32_t    words[16];
+    uint32_t    state[8];
+    uint32_t    sched[16];
+    size_t      sched_len;
+} raw_prefix;
+
+// Per-thread scratch space, kept across chunks so no engine allocates in the hot loop.
+typedef struct hash_scratch
+{
+    struct crypt_data cdata;
+    bf_ctx            bf[BF_INTERLEAVE];
+    yescrypt_arena    arena;
+    raw_prefix        prefix;
+} hash_scratch;
+
+struct candidate_gen;
+
+// check() tests one key. Engines with lanes > 1 also take up to lanes keys
+// at once through check_batch(), which returns the index of the matching key or -1.
+// Engines so fast that copying keys around would dominate set check_gen()
+// instead: it consumes count candidates straight from the generator and
+// returns the offset of the match or -1, leaving the generator past it.
+typedef struct hash_engine
+{
+    const char *name;
+    size_t      lanes;
+    bool (*check)(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+    int (*check_batch)(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch);
+    int (*check_gen)(const hash_target *target, struct candidate_gen *gen, uint64_t count, hash_scratch *scratch);
+} hash_engine;
+
+extern const hash_engine crypt_engine;
+extern const hash_engine des_engine;
+extern const hash_engine md5_crypt_engine;
+extern const hash_engine bcrypt_engine;
+extern const hash_engine sha256_crypt_engine;
+extern const hash_engine sha512_crypt_engine;
+extern const hash_engine yescrypt_engine;
+extern const hash_engine raw_hash_engine;
+
+int  hash_target_parse(hash_target *target, const char *encoded, struct fsm_error *err);
+void hash_scratch_init(hash_scratch *scratch);
+void hash_scratch_free(hash_scratch *scratch);
+
+// Working memory one thread needs for the target, 0 for schemes that need next to none.
+size_t hash_memory_per_thread(const hash_target *target);
+
+// Whether two targets differ only in their digest, so one hash computation
+// per candidate serves both.
+bool hash_target_same_setting(const hash_target *a, const hash_target *b);
+
+// Index of digest among target->digests, or -1.
+ptrdiff_t hash_digest_find(const hash_target *target, const uint8_t *digest);
+
+// What every engine compares a computed digest with.
+static inline bool hash_digest_match(const hash_target *target, const uint8_t *digest)
+{
+    if (target->digests == NULL)
+        return memcmp(digest, target->digest, target->digest_len) == 0;
+
+    if (target->index && !digest_index_maybe(target->index, digest))
+        return false;
+
+    return hash_digest_find(target, digest) >= 0;
+}
+
+static inline int hash_check_batch(const hash_target *target, const char *const *keys, const size_t *key_lens,
+                                   size_t n, hash_scratch *scratch)
+{
+    return target->engine->check_batch(target, keys, key_lens, n, scratch);
+}
+
+static inline bool hash_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return target->engine->check(target, key, key_len, scratch);
+}
+
+#endif // CLIENT_HASH_ENGINE_H
@@ -0,0 +1,89 @@
+#ifndef CLIENT_KEYSPACE_H
+#define CLIENT_KEYSPACE_H
+
+#include "fsm.h"
+#include "markov.h"
+#include "rules.h"
+#include "wordlist.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@#%^&()_+-=.,:;?";
+#define CHARSET_SIZE (sizeof(charset) - 1)
+
+#define MAX_CANDIDATE_LEN 63
+#define MAX_POSITION_CHARSET 255
+
+typedef enum
+{
+    KEYSPACE_BRUTE_FORCE,
+    KEYSPACE_MASK,
+    KEYSPACE_WORDLIST,
+    KEYSPACE_HYBRID
+} keyspace_mode;
+
+// The candidate space a job enumerates. Brute force walks every length of
+// charset in turn; a mask has one charset per position and a fixed length,
+// with place[i] holding the mixed-radix weight of position i; a wordlist
+// maps each index to one line, or with rules to (line, rule) word-major.
+// Hybrid pairs every line with every mask candidate, appended or prepended;
+// word-major keeps one word while the mask steps, mask-major keeps the mask
+// part of the buffer while the words change underneath it.
+//
+// With Markov statistics, brute force and mask positions draw their
+// characters from per-(position, previous character) orderings instead of
+// the charset itself, most likely first. Every ordering of a position keeps
+// the same radix (optionally cut to the threshold), so indices stay
+// mixed-radix and bijective.
+typedef struct keyspace
+{
+    keyspace_mode mode;
+    bool          prepend;
+    bool          mask_major;
+    size_t        length;
+    const char   *charsets[MAX_CANDIDATE_LEN];
+    uint8_t       radix[MAX_CANDIDATE_LEN];
+    uint64_t      place[MAX_CANDIDATE_LEN];
+    uint64_t      mask_size;
+    uint64_t      size;
+    char          storage[MAX_CANDIDATE_LEN][MAX_POSITION_CHARSET + 1];
+    wordlist      words;
+    rule_set      rules;
+    uint32_t     *markov_counts; // only held between the job header and finalize
+    size_t        markov_threshold;
+    char         *markov;
+    size_t        markov_tables;
+    size_t        markov_stride;
+} keyspace;
+
+// Per-thread candidate generator. Seeks to an index once, then steps the
+// candidate in place like an odometer so the hot loop never allocates or divides.
+typedef struct candidate_gen
+{
+    const keyspace *ks;
+    size_t          len;
+    uint64_t        line;
+    size_t          rule;
+    bool            skip; // current candidate cannot be represented, e.g. an overlong line
+    bool            word_skip;
+    size_t          word_len;
+    uint8_t         digits[MAX_CANDIDATE_LEN];
+    char            word[MAX_CANDIDATE_LEN + 1];
+    char            buf[MAX_CANDIDATE_LEN + 1];
+} candidate_gen;
+
+void keyspace_init(keyspace *ks);
+int  keyspace_add_position(keyspace *ks, const char *chars, struct fsm_error *err);
+int  keyspace_load_wordlist(keyspace *ks, const char *path, uint64_t expected_lines, struct fsm_error *err);
+int  keyspace_set_hybrid(keyspace *ks, bool prepend, bool mask_major, struct fsm_error *err);
+int  keyspace_load_markov(keyspace *ks, const char *path, size_t threshold, struct fsm_error *err);
+int  keyspace_add_rule(keyspace *ks, const char *text, struct fsm_error *err);
+int  keyspace_finalize(keyspace *ks, struct fsm_error *err);
+void keyspace_free(keyspace *ks);
+int  candidate_gen_seek(candidate_gen *gen, const keyspace *ks, uint64_t index);
+int  candidate_gen_next(candidate_gen *gen);
+
+#endif // CLIENT_KEYSPACE_H
@@ -0,0 +1,30 @@
+#ifndef CLIENT_MARKOV_H
+#define CLIENT_MARKOV_H
+
+#include "fsm.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Markov statistics file written by markov_train: the magic, then one
+// little-endian uint32 count per (position, previous byte, byte), position
+// major. Position 0 uses previous byte 0; the last table covers every
+// position from MARKOV_POSITIONS - 1 on.
+#define MARKOV_MAGIC "MARKOV1\n"
+#define MARKOV_MAGIC_LEN 8
+#define MARKOV_POSITIONS 16
+#define MARKOV_COUNTS ((size_t)MARKOV_POSITIONS * 256 * 256)
+
+int markov_load(const char *path, uint32_t **counts, struct fsm_error *err);
+
+static inline uint32_t markov_count(const uint32_t *counts, size_t position, unsigned char prev, unsigned char c)
+{
+    if (position >= MARKOV_POSITIONS)
+        position = MARKOV_POSITIONS - 1;
+
+    return counts[(position * 256 + prev) * 256 + c];
+}
+
+#endif // CLIENT_MARKOV_H
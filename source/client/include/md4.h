@@ -0,0 +1,76 @@
+#ifndef CLIENT_MD4_H
+#define CLIENT_MD4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MD4_DIGEST_LEN 16
+
+typedef struct md4_ctx
+{
+    uint32_t h[4];
+    uint64_t len;
+    size_t   used;
+    uint8_t  buf[64];
+} md4_ctx;
+
+extern const uint32_t md4_iv[4];
+
+// The 48 steps of the compression function as (function, a, b, c, d, word,
+// constant, shift), in the same form as MD5_STEPS so the multi-buffer kernels
+// expand it with their own STEP macro.
+#define MD4_STEPS(STEP)                                                                                              \
+    STEP(F, a, b, c, d, 0, 0, 3)                                                                                     \
+    STEP(F, d, a, b, c, 1, 0, 7)                                                                                     \
+    STEP(F, c, d, a, b, 2, 0, 11)                                                                                    \
+    STEP(F, b, c, d, a, 3, 0, 19)                                                                                    \
+    STEP(F, a, b, c, d, 4, 0, 3)                                                                                     \
+    STEP(F, d, a, b, c, 5, 0, 7)                                                                                     \
+    STEP(F, c, d, a, b, 6, 0, 11)                                                                                    \
+    STEP(F, b, c, d, a, 7, 0, 19)                                                                                    \
+    STEP(F, a, b, c, d, 8, 0, 3)                                                                                     \
+    STEP(F, d, a, b, c, 9, 0, 7)                                                                                     \
+    STEP(F, c, d, a, b, 10, 0, 11)                                                                                   \
+    STEP(F, b, c, d, a, 11, 0, 19)                                                                                   \
+    STEP(F, a, b, c, d, 12, 0, 3)                                                                                    \
+    STEP(F, d, a, b, c, 13, 0, 7)                                                                                    \
+    STEP(F, c, d, a, b, 14, 0, 11)                                                                                   \
+    STEP(F, b, c, d, a, 15, 0, 19)                                                                                   \
+    STEP(G, a, b, c, d, 0, 0x5a827999, 3)                                                                            \
+    STEP(G, d, a, b, c, 4, 0x5a827999, 5)                                                                            \
+    STEP(G, c, d, a, b, 8, 0x5a827999, 9)                                                                            \
+    STEP(G, b, c, d, a, 12, 0x5a827999, 13)                                                                          \
+    STEP(G, a, b, c, d, 1, 0x5a827999, 3)                                                                            \
+    STEP(G, d, a, b, c, 5, 0x5a827999, 5)                                                                            \
+    STEP(G, c, d, a, b, 9, 0x5a827999, 9)                                                                            \
+    STEP(G, b, c, d, a, 13, 0x5a827999, 13)                                                                          \
+    STEP(G, a, b, c, d, 2, 0x5a827999, 3)                                                                            \
+    STEP(G, d, a, b, c, 6, 0x5a827999, 5)                                                                            \
+    STEP(G, c, d, a, b, 10, 0x5a827999, 9)                                                                           \
+    STEP(G, b, c, d, a, 14, 0x5a827999, 13)                                                                          \
+    STEP(G, a, b, c, d, 3, 0x5a827999, 3)                                                                            \
+    STEP(G, d, a, b, c, 7, 0x5a827999, 5)                                                                            \
+    STEP(G, c, d, a, b, 11, 0x5a827999, 9)                                                                           \
+    STEP(G, b, c, d, a, 15, 0x5a827999, 13)                                                                          \
+    STEP(H, a, b, c, d, 0, 0x6ed9eba1, 3)                                                                            \
+    STEP(H, d, a, b, c, 8, 0x6ed9eba1, 9)                                                                            \
+    STEP(H, c, d, a, b, 4, 0x6ed9eba1, 11)                                                                           \
+    STEP(H, b, c, d, a, 12, 0x6ed9eba1, 15)                                                                          \
+    STEP(H, a, b, c, d, 2, 0x6ed9eba1, 3)                                                                            \
+    STEP(H, d, a, b, c, 10, 0x6ed9eba1, 9)                                                                           \
+    STEP(H, c, d, a, b, 6, 0x6ed9eba1, 11)                                                                           \
+    STEP(H, b, c, d, a, 14, 0x6ed9eba1, 15)                                                                          \
+    STEP(H, a, b, c, d, 1, 0x6ed9eba1, 3)                                                                            \
+    STEP(H, d, a, b, c, 9, 0x6ed9eba1, 9)                                                                            \
+    STEP(H, c, d, a, b, 5, 0x6ed9eba1, 11)                                                                           \
+    STEP(H, b, c, d, a, 13, 0x6ed9eba1, 15)                                                                          \
+    STEP(H, a, b, c, d, 3, 0x6ed9eba1, 3)                                                                            \
+    STEP(H, d, a, b, c, 11, 0x6ed9eba1, 9)                                                                           \
+    STEP(H, c, d, a, b, 7, 0x6ed9eba1, 11)                                                                           \
+    STEP(H, b, c, d, a, 15, 0x6ed9eba1, 15)
+
+void md4_init(md4_ctx *ctx);
+void md4_update(md4_ctx *ctx, const void *data, size_t len);
+void md4_final(md4_ctx *ctx, uint8_t out[MD4_DIGEST_LEN]);
+
+#endif // CLIENT_MD4_H
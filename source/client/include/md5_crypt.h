@@ -0,0 +1,100 @@
+#ifndef CLIENT_MD5_CRYPT_H
+#define CLIENT_MD5_CRYPT_H
+
+#include "hash_engine.h"
+#include "md5.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MD5_CRYPT_MAX_LANES 16 // widest SIMD engine
+#define MD5_CRYPT_SIMD_MAX_KEY 63
+#define MD5_CRYPT_SIMD_MSG 192 // longest round message for a SIMD-sized key, padded
+
+// One candidate's place in the rounds loop: the running digest and the key
+// bytes each round mixes back in.
+typedef struct md5_crypt_state
+{
+    uint8_t a[MD5_DIGEST_LEN];
+    uint8_t key[MD5_CRYPT_SIMD_MAX_KEY];
+    size_t  key_len;
+} md5_crypt_state;
+
+// $1$ and $apr1$ differ only in the magic string hashed into the initial digest.
+void md5_crypt_prepare(const hash_target *target, const char *key, size_t key_len, uint8_t a[MD5_DIGEST_LEN]);
+void md5_crypt_rounds(const hash_target *target, const char *key, size_t key_len, uint8_t a[MD5_DIGEST_LEN]);
+bool md5_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+
+// Picks the widest multi-buffer engine the CPU runs correctly, else the scalar one.
+const hash_engine *md5_crypt_select_engine(const hash_target *target);
+
+// Round kinds: the rounds loop only ever builds eight message layouts, picked
+// by round % 2, round % 3 and round % 7, that differ in where the digest sits.
+#define MD5_CRYPT_ODD 1
+#define MD5_CRYPT_SALT 2
+#define MD5_CRYPT_KEY 4
+#define MD5_CRYPT_KINDS 8
+
+static inline unsigned md5_crypt_round_kind(uint32_t round)
+{
+    return ((round & 1) ? MD5_CRYPT_ODD : 0) | ((round % 3 != 0) ? MD5_CRYPT_SALT : 0) |
+           ((round % 7 != 0) ? MD5_CRYPT_KEY : 0);
+}
+
+// Lays out the padded message for one kind of round in 64-byte blocks, with
+// the digest's bytes left for the caller to fill in at *digest_at, and
+// returns how many blocks it spans.
+static inline size_t md5_crypt_round_layout(uint8_t *msg, const md5_crypt_state *st, const char *salt, size_t slen,
+                                            unsigned kind, size_t *digest_at)
+{
+    size_t len = 0;
+
+    if (kind & MD5_CRYPT_ODD)
+    {
+        memcpy(msg, st->key, st->key_len);
+        len = st->key_len;
+    }
+    else
+    {
+        *digest_at = 0;
+        len        = MD5_DIGEST_LEN;
+    }
+
+    if (kind & MD5_CRYPT_SALT)
+    {
+        memcpy(msg + len, salt, slen);
+        len += slen;
+    }
+
+    if (kind & MD5_CRYPT_KEY)
+    {
+        memcpy(msg + len, st->key, st->key_len);
+        len += st->key_len;
+    }
+
+    if (kind & MD5_CRYPT_ODD)
+    {
+        *digest_at = len;
+        len += MD5_DIGEST_LEN;
+    }
+    else
+    {
+        memcpy(msg + len, st->key, st->key_len);
+        len += st->key_len;
+    }
+
+    size_t   blocks = (len + 1 + 8 + 63) / 64;
+    size_t   end    = blocks * 64;
+    uint64_t bits   = (uint64_t)len * 8;
+
+    msg[len] = 0x80;
+    memset(msg + len + 1, 0, end - len - 1);
+
+    for (int i = 0; i < 8; i++)
+        msg[end - 8 + i] = (uint8_t)(bits >> (8 * i));
+
+    return blocks;
+}
+
+#endif // CLIENT_MD5_CRYPT_H
@@ -0,0 +1,114 @@
+// Multi-buffer MD5-crypt rounds loop, instantiated once per instruction set
+// by src/md5_crypt_simd.c. Before including, define:
+//
+//   MD5_LANES   candidates hashed in lockstep
+//   MD5_TARGET  the target attribute for the instruction set, e.g. "avx2"
+//   MD5_NAME    the name of the kernel function to define
+//
+// Each lane's eight message layouts are built once up front; a round only
+// drops the previous digest into its layout. Lanes whose message spans fewer
+// blocks than the longest one keep their state through the extra compressions.
+
+#define MD5_VF(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_VG(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_VH(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_VI(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_VROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define MD5_VSTEP(fn, a, b, c, d, x, t, s) a = b + MD5_VROL(a + MD5_V##fn(b, c, d) + w[x] + (t), s);
+
+__attribute__((target(MD5_TARGET))) void MD5_NAME(const hash_target *target, md5_crypt_state *st, size_t n,
+                                                  bool *match)
+{
+    typedef uint32_t vec __attribute__((vector_size(sizeof(uint32_t) * MD5_LANES)));
+
+    _Alignas(64) uint8_t  layout[MD5_CRYPT_KINDS][MD5_LANES][MD5_CRYPT_SIMD_MSG];
+    _Alignas(64) uint32_t words[16][MD5_LANES];
+    size_t                digest_at[MD5_CRYPT_KINDS][MD5_LANES];
+    size_t                blocks[MD5_CRYPT_KINDS][MD5_LANES];
+    size_t                most[MD5_CRYPT_KINDS] = {0};
+    uint32_t              digest[4][MD5_LANES];
+    vec                   state[4];
+    vec                   w[16];
+
+    // Lanes past n repeat lane 0 so every lane does defined work.
+    for (unsigned kind = 0; kind < MD5_CRYPT_KINDS; kind++)
+    {
+        for (size_t l = 0; l < MD5_LANES; l++)
+        {
+            blocks[kind][l] = md5_crypt_round_layout(layout[kind][l], &st[l < n ? l : 0], target->salt,
+                                                     target->salt_len, kind, &digest_at[kind][l]);
+            most[kind]      = (blocks[kind][l] > most[kind]) ? blocks[kind][l] : most[kind];
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (size_t l = 0; l < MD5_LANES; l++)
+            memcpy(&digest[i][l], &st[l < n ? l : 0].a[i * 4], sizeof(uint32_t));
+    }
+
+    for (uint32_t round = 0; round < target->cost; round++)
+    {
+        unsigned kind = md5_crypt_round_kind(round);
+
+        for (size_t l = 0; l < MD5_LANES; l++)
+        {
+            uint8_t *at = &layout[kind][l][digest_at[kind][l]];
+
+            for (int i = 0; i < 4; i++)
+                memcpy(at + i * 4, &digest[i][l], sizeof(uint32_t));
+        }
+
+        for (int i = 0; i < 4; i++)
+            state[i] = (vec){0} + md5_iv[i];
+
+        for (size_t blk = 0; blk < most[kind]; blk++)
+        {
+            vec keep = {0};
+            vec a, b, c, d;
+
+            // x86 is little-endian, like MD5's word order.
+            for (size_t l = 0; l < MD5_LANES; l++)
+            {
+                const uint8_t *src = &layout[kind][l][blk * 64];
+
+                for (int i = 0; i < 16; i++)
+                    memcpy(&words[i][l], src + i * 4, sizeof(uint32_t));
+
+                keep[l] = (blocks[kind][l] <= blk) ? UINT32_MAX : 0;
+            }
+
+            memcpy(w, words, sizeof(w));
+
+            a = state[0];
+            b = state[1];
+            c = state[2];
+            d = state[3];
+
+            MD5_STEPS(MD5_VSTEP)
+
+            // Lanes whose message already ended keep the state they had.
+            state[0] = (state[0] & keep) | ((state[0] + a) & ~keep);
+            state[1] = (state[1] & keep) | ((state[1] + b) & ~keep);
+            state[2] = (state[2] & keep) | ((state[2] + c) & ~keep);
+            state[3] = (state[3] & keep) | ((state[3] + d) & ~keep);
+        }
+
+        memcpy(digest, state, sizeof(digest));
+    }
+
+    for (size_t l = 0; l < n; l++)
+    {
+        for (int i = 0; i < 4; i++)
+            memcpy(&st[l].a[i * 4], &digest[i][l], sizeof(uint32_t));
+
+        match[l] = hash_digest_match(target, st[l].a);
+    }
+}
+
+#undef MD5_VF
+#undef MD5_VG
+#undef MD5_VH
+#undef MD5_VI
+#undef MD5_VROL
+#undef MD5_VSTEP
@@ -0,0 +1,92 @@
+#ifndef CLIENT_PROTOCOL_H
+#define CLIENT_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct fsm_error;
+
+// Worker and server speak in messages of a type, a few numbers and at most
+// one trailing string. In binary mode each is a frame: a 4 byte header
+// (payload length as a big-endian uint16, the type, a zero byte), then
+// every number as a big-endian uint64, then the string up to the end of
+// the frame. Text mode carries the same messages as lines, a keyword and
+// its fields; it is meant for debugging by hand, not for workers that
+// predate HELLO, which the server does not speak to.
+//
+// The worker opens with HELLO, its version and capabilities, in either
+// mode; a binary frame starts with a zero byte and a text line never
+// does, so the server tells them apart from the first byte. The server
+// answers HELLO with the version both sides speak and the capabilities
+// both have, then sends the job. A worker that starts with anything else
+// is dropped.
+#define PROTOCOL_VERSION 1
+#define PROTOCOL_MIN_VERSION 1
+#define PROTOCOL_CAP_GROUPS 0x1U  // GROUP: hashes that share a salt are checked together
+#define PROTOCOL_CAP_RAINBOW 0x2U // RAINBOW build and lookup jobs
+#define PROTOCOL_CAPS (PROTOCOL_CAP_GROUPS | PROTOCOL_CAP_RAINBOW)
+
+#define PROTOCOL_FRAME_HEADER 4
+#define PROTOCOL_MAX_VALUES 33 // CHAIN: the first chain and the ends of up to 32
+#define PROTOCOL_MAX_MESSAGE 8192
+
+typedef enum protocol_mode
+{
+    PROTOCOL_BINARY,
+    PROTOCOL_TEXT
+} protocol_mode;
+
+typedef enum message_type
+{
+    MSG_HELLO = 1,      // version, capabilities
+    MSG_GROUP,          // count of the HASH messages that follow
+    MSG_HASH,           // hash
+    MSG_HYBRID,         // prepend, mask major
+    MSG_POS,            // charset of one mask position
+    MSG_WORDLIST,       // lines; path
+    MSG_RULE,           // rule
+    MSG_MARKOV,         // threshold; path
+    MSG_RAINBOW_BUILD,  // chain length; scheme
+    MSG_RAINBOW_LOOKUP, // chains; path
+    MSG_END,            // end of the job
+    MSG_READY,
+    MSG_WORK,    // start, length, checkpoint interval, timeout
+    MSG_CRACKED, // hash another worker cracked
+    MSG_STOP,
+    MSG_CHECKPOINT, // index
+    MSG_FOUND,      // hash length; hash, a space, password
+    MSG_CHAIN,      // first chain, then the end of each chain from it on
+    MSG_DONE,
+    MSG_NEXT,
+    MSG_TYPE_COUNT
+} message_type;
+
+// A decoded message. text is not NUL-terminated and points into the
+// buffer the message was decoded from.
+typedef struct protocol_message
+{
+    message_type type;
+    uint64_t     values[PROTOCOL_MAX_VALUES];
+    size_t       num_values;
+    const char  *text;
+    size_t       text_len;
+} protocol_message;
+
+// Bytes a binary frame takes, header included, going by its header.
+static inline size_t protocol_frame_length(const unsigned char header[PROTOCOL_FRAME_HEADER])
+{
+    return PROTOCOL_FRAME_HEADER + (((size_t)header[0] << 8) | header[1]);
+}
+
+// Writes msg as a frame or a line, newline included. Returns its length,
+// or -1 when it does not fit in cap bytes or a frame.
+ssize_t protocol_encode(protocol_mode mode, const protocol_message *msg, char *buf, size_t cap);
+// Reads one whole message: a frame, or a line without its newline that
+// the caller has NUL-terminated. Returns -1 when it is malformed.
+int     protocol_decode(protocol_mode mode, const char *data, size_t len, protocol_message *msg,
+                        struct fsm_error *err);
+const char *protocol_message_name(message_type type);
+
+#endif // CLIENT_PROTOCOL_H
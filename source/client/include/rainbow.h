@@ -0,0 +1,54 @@
+#ifndef CLIENT_RAINBOW_H
+#define CLIENT_RAINBOW_H
+
+#include "fsm.h"
+#include "hash_engine.h"
+#include "keyspace.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Rainbow table file written by the server once the workers have built
+// every chain: a text header (the magic, SCHEME, CHAIN_LEN, CHAINS, one POS
+// line per mask position, END), zero padding to a multiple of 16 bytes,
+// then CHAINS entries in native byte order, sorted by end, no end repeated.
+#define RAINBOW_MAGIC "RAINBOW1\n"
+#define RAINBOW_ALIGN 16
+#define RAINBOW_CHAINS_PER_LINE 32 // chains a thread builds per claim, and reports in one CHAIN line
+
+typedef struct rainbow_entry
+{
+    uint64_t end;
+    uint64_t start;
+} rainbow_entry;
+
+// A chain starts at a mask index and takes chain_len links: hash the
+// candidate at the current index, then reduce the digest to the next index
+// with a function that differs per column. Only the start and the last
+// index are kept. To look a digest up, assume it came from some column,
+// reduce and walk from there to the end, and regenerate each chain that
+// ends there to see whether the digest really is on it.
+typedef struct rainbow_table
+{
+    bool                 build;      // computing chains for the server rather than looking digests up
+    hash_target          probe;      // scheme and digest length, for raw_hash_digest()
+    uint64_t             chain_len;
+    uint64_t             num_chains;
+    size_t               positions;
+    const rainbow_entry *entries;
+    char                *map;
+    size_t               map_len;
+} rainbow_table;
+
+int  rainbow_build_init(rainbow_table *table, const char *scheme, uint64_t chain_len, struct fsm_error *err);
+// Maps the table and adds its mask positions to ks, which must have none yet.
+int  rainbow_open(rainbow_table *table, keyspace *ks, const char *path, uint64_t expected_chains,
+                  struct fsm_error *err);
+void rainbow_close(rainbow_table *table);
+
+uint64_t rainbow_chain_end(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, uint64_t start);
+// Whether digest sits in column of some chain; if so gen holds its key.
+bool     rainbow_lookup(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, const uint8_t *digest,
+                        uint64_t column);
+
+#endif // CLIENT_RAINBOW_H
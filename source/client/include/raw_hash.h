@@ -0,0 +1,48 @@
+#ifndef CLIENT_RAW_HASH_H
+#define CLIENT_RAW_HASH_H
+
+#include "hash_engine.h"
+#include "keyspace.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAW_HASH_MAX_LANES 16 // widest SIMD engine
+#define RAW_HASH_BLOCK_MSG 55 // longest message, in bytes, that still pads into one block
+
+// Round-one shifts of MD4 and MD5. The multi-buffer kernels run the first
+// sixteen steps as a loop so they can start wherever the shared prefix ends.
+static const uint8_t raw_md4_shift[4] = {3, 7, 11, 19};
+static const uint8_t raw_md5_shift[4] = {7, 12, 17, 22};
+
+extern const uint32_t raw_md5_k[64];
+
+// Single-block messages for one batch, word-major so a kernel loads one word
+// of every lane at once. Words are already in the hash's byte order; lanes
+// past n repeat lane 0. used[lane] counts the message words the lane's key
+// last filled, so the next key only clears what it no longer covers. A batch
+// starts out zeroed.
+typedef struct raw_hash_batch
+{
+    _Alignas(64) uint32_t words[16][RAW_HASH_MAX_LANES];
+    uint8_t               used[RAW_HASH_MAX_LANES];
+    size_t                n;
+} raw_hash_batch;
+
+// The plain digest of key; the kernels' self-tests compare against it.
+void raw_hash_digest(const hash_target *target, const char *key, size_t key_len, uint8_t *digest);
+bool raw_hash_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+
+// Lays out key as lane's padded message. Returns false when the message
+// (UTF-16 for NTLM) needs more than one block; those keys take raw_hash_check().
+bool raw_hash_load(const hash_target *target, const char *key, size_t key_len, raw_hash_batch *batch, size_t lane);
+
+// Counts the leading words every lane of the batch shares and returns the
+// state after that many steps, from the thread's cache when the previous
+// batch had the same prefix.
+const raw_prefix *raw_hash_prefix(const hash_target *target, const raw_hash_batch *batch, raw_prefix *cache);
+
+// Picks the widest multi-buffer engine the CPU runs correctly, else the scalar one.
+const hash_engine *raw_hash_select_engine(const hash_target *target);
+
+#endif // CLIENT_RAW_HASH_H
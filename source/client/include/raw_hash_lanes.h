@@ -0,0 +1,298 @@
+// Multi-buffer single-block MD4 (NTLM), MD5, SHA-1 and SHA-256, instantiated
+// once per instruction set by src/raw_hash_simd.c. Before including, define:
+//
+//   RAW_LANES   candidates hashed in lockstep
+//   RAW_TARGET  the target attribute for the instruction set, e.g. "avx2"
+//   RAW_NAME    the name of the kernel function to define
+//
+// Every lane starts from prefix->state, the state after the prefix->shared
+// leading words all lanes have in common, so the first sixteen steps run as a
+// loop that can begin part way through. After sixteen steps every working
+// variable is back in its own register and the rest is unrolled as usual.
+
+#define RAW_VROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define RAW_VROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define RAW_VF(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define RAW_VMAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define RAW_MD5_VG(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define RAW_MD5_VH(x, y, z) ((x) ^ (y) ^ (z))
+#define RAW_MD5_VI(x, y, z) ((y) ^ ((x) | ~(z)))
+#define RAW_MD4_VG(x, y, z) RAW_VMAJ(x, y, z)
+#define RAW_MD4_VH(x, y, z) ((x) ^ (y) ^ (z))
+
+// Round one already ran in the loop, so the unrolled list skips its F steps.
+#define RAW_MD5_VSTEP(fn, a, b, c, d, x, t, s) RAW_MD5_VSTEP_##fn(a, b, c, d, x, t, s)
+#define RAW_MD5_VSTEP_F(a, b, c, d, x, t, s)
+#define RAW_MD5_VSTEP_G(a, b, c, d, x, t, s) a = b + RAW_VROL(a + RAW_MD5_VG(b, c, d) + w[x] + (t), s);
+#define RAW_MD5_VSTEP_H(a, b, c, d, x, t, s) a = b + RAW_VROL(a + RAW_MD5_VH(b, c, d) + w[x] + (t), s);
+#define RAW_MD5_VSTEP_I(a, b, c, d, x, t, s) a = b + RAW_VROL(a + RAW_MD5_VI(b, c, d) + w[x] + (t), s);
+#define RAW_MD4_VSTEP(fn, a, b, c, d, x, t, s) RAW_MD4_VSTEP_##fn(a, b, c, d, x, t, s)
+#define RAW_MD4_VSTEP_F(a, b, c, d, x, t, s)
+#define RAW_MD4_VSTEP_G(a, b, c, d, x, t, s) a = RAW_VROL(a + RAW_MD4_VG(b, c, d) + w[x] + (t), s);
+#define RAW_MD4_VSTEP_H(a, b, c, d, x, t, s) a = RAW_VROL(a + RAW_MD4_VH(b, c, d) + w[x] + (t), s);
+
+#define RAW_SHA1_STEP(f, k)                            \
+    do                                                 \
+    {                                                  \
+        vec t = RAW_VROL(a, 5) + (f) + e + (k) + w[i]; \
+        e     = d;                                     \
+        d     = c;                                     \
+        c     = RAW_VROL(b, 30);                       \
+        b     = a;                                     \
+        a     = t;                                     \
+    } while (0)
+
+#define RAW_SHA256_ROUND(a, b, c, d, e, f, g, h, i)                                                             \
+    do                                                                                                          \
+    {                                                                                                           \
+        vec t1 = h + (RAW_VROR(e, 6) ^ RAW_VROR(e, 11) ^ RAW_VROR(e, 25)) + RAW_VF(e, f, g) + sha256_k[i] + w[i]; \
+        vec t2 = (RAW_VROR(a, 2) ^ RAW_VROR(a, 13) ^ RAW_VROR(a, 22)) + RAW_VMAJ(a, b, c);                     \
+        d += t1;                                                                                                \
+        h = t1 + t2;                                                                                            \
+    } while (0)
+
+__attribute__((target(RAW_TARGET))) int RAW_NAME(const hash_target *target, const raw_hash_batch *batch,
+                                                 const raw_prefix *prefix)
+{
+    typedef uint32_t vec __attribute__((vector_size(sizeof(uint32_t) * RAW_LANES)));
+
+    _Alignas(64) uint32_t out[8][RAW_LANES];
+    uint32_t              expect[8];
+    size_t                words;
+    vec                   w[80];
+
+    for (int i = 0; i < 16; i++)
+        memcpy(&w[i], batch->words[i], sizeof(vec));
+
+    if (target->scheme == HASH_SCHEME_NTLM || target->scheme == HASH_SCHEME_RAW_MD5)
+    {
+        bool md4 = target->scheme == HASH_SCHEME_NTLM;
+        vec  a   = (vec){0} + prefix->state[0];
+        vec  b   = (vec){0} + prefix->state[1];
+        vec  c   = (vec){0} + prefix->state[2];
+        vec  d   = (vec){0} + prefix->state[3];
+
+        for (size_t i = prefix->shared; i < 16; i++)
+        {
+            vec t = a + RAW_VF(b, c, d) + w[i];
+
+            if (md4)
+                t = RAW_VROL(t, raw_md4_shift[i & 3]);
+            else
+                t = b + RAW_VROL(t + raw_md5_k[i], raw_md5_shift[i & 3]);
+
+            a = d;
+            d = c;
+            c = b;
+            b = t;
+        }
+
+        if (md4)
+        {
+            MD4_STEPS(RAW_MD4_VSTEP)
+        }
+        else
+        {
+            MD5_STEPS(RAW_MD5_VSTEP)
+        }
+
+        a += md5_iv[0];
+        b += md5_iv[1];
+        c += md5_iv[2];
+        d += md5_iv[3];
+
+        memcpy(out[0], &a, sizeof(vec));
+        memcpy(out[1], &b, sizeof(vec));
+        memcpy(out[2], &c, sizeof(vec));
+        memcpy(out[3], &d, sizeof(vec));
+
+        words = 4;
+    }
+    else if (target->scheme == HASH_SCHEME_RAW_SHA1)
+    {
+        vec a = (vec){0} + prefix->state[0];
+        vec b = (vec){0} + prefix->state[1];
+        vec c = (vec){0} + prefix->state[2];
+        vec d = (vec){0} + prefix->state[3];
+        vec e = (vec){0} + prefix->state[4];
+
+        for (size_t t = 16; t < 80; t++)
+        {
+            vec x = (t - 16 < prefix->sched_len) ? (vec){0} + prefix->sched[t - 16] : w[t - 14] ^ w[t - 16];
+
+            x ^= w[t - 3] ^ w[t - 8];
+            w[t] = RAW_VROL(x, 1);
+        }
+
+        for (size_t i = prefix->shared; i < 20; i++)
+            RAW_SHA1_STEP(RAW_VF(b, c, d), sha1_k[0]);
+        for (size_t i = 20; i < 40; i++)
+            RAW_SHA1_STEP(b ^ c ^ d, sha1_k[1]);
+        for (size_t i = 40; i < 60; i++)
+            RAW_SHA1_STEP(RAW_VMAJ(b, c, d), sha1_k[2]);
+        for (size_t i = 60; i < 80; i++)
+            RAW_SHA1_STEP(b ^ c ^ d, sha1_k[3]);
+
+        a += sha1_iv[0];
+        b += sha1_iv[1];
+        c += sha1_iv[2];
+        d += sha1_iv[3];
+        e += sha1_iv[4];
+
+        memcpy(out[0], &a, sizeof(vec));
+        memcpy(out[1], &b, sizeof(vec));
+        memcpy(out[2], &c, sizeof(vec));
+        memcpy(out[3], &d, sizeof(vec));
+        memcpy(out[4], &e, sizeof(vec));
+
+        words = 5;
+    }
+    else
+    {
+        vec s[8];
+        vec a, b, c, d, e, f, g, h;
+
+        for (size_t t = 16; t < 64; t++)
+        {
+            vec x = (t - 16 < prefix->sched_len)
+                        ? (vec){0} + prefix->sched[t - 16]
+                        : w[t - 16] + (RAW_VROR(w[t - 15], 7) ^ RAW_VROR(w[t - 15], 18) ^ (w[t - 15] >> 3));
+
+            w[t] = x + w[t - 7] + (RAW_VROR(w[t - 2], 17) ^ RAW_VROR(w[t - 2], 19) ^ (w[t - 2] >> 10));
+        }
+
+        for (int i = 0; i < 8; i++)
+            s[i] = (vec){0} + prefix->state[i];
+
+        a = s[0];
+        b = s[1];
+        c = s[2];
+        d = s[3];
+        e = s[4];
+        f = s[5];
+        g = s[6];
+        h = s[7];
+
+        for (size_t i = prefix->shared; i < 16; i++)
+        {
+            vec t1 = h + (RAW_VROR(e, 6) ^ RAW_VROR(e, 11) ^ RAW_VROR(e, 25)) + RAW_VF(e, f, g) + sha256_k[i] + w[i];
+            vec t2 = (RAW_VROR(a, 2) ^ RAW_VROR(a, 13) ^ RAW_VROR(a, 22)) + RAW_VMAJ(a, b, c);
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        for (int i = 16; i < 64; i += 8)
+        {
+            RAW_SHA256_ROUND(a, b, c, d, e, f, g, h, i);
+            RAW_SHA256_ROUND(h, a, b, c, d, e, f, g, i + 1);
+            RAW_SHA256_ROUND(g, h, a, b, c, d, e, f, i + 2);
+            RAW_SHA256_ROUND(f, g, h, a, b, c, d, e, i + 3);
+            RAW_SHA256_ROUND(e, f, g, h, a, b, c, d, i + 4);
+            RAW_SHA256_ROUND(d, e, f, g, h, a, b, c, i + 5);
+            RAW_SHA256_ROUND(c, d, e, f, g, h, a, b, i + 6);
+            RAW_SHA256_ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
+
+        s[0] = a + sha256_iv[0];
+        s[1] = b + sha256_iv[1];
+        s[2] = c + sha256_iv[2];
+        s[3] = d + sha256_iv[3];
+        s[4] = e + sha256_iv[4];
+        s[5] = f + sha256_iv[5];
+        s[6] = g + sha256_iv[6];
+        s[7] = h + sha256_iv[7];
+
+        memcpy(out, s, sizeof(s));
+
+        words = 8;
+    }
+
+    // A salt group looks each lane's digest up in its table instead. Every
+    // lane's filter block is fetched before any is tested, and the filter
+    // turns a lane away on its first two words.
+    if (target->digests)
+    {
+        uint64_t h[RAW_LANES];
+
+        for (size_t l = 0; l < batch->n; l++)
+        {
+            uint64_t lo = (words == 4) ? out[0][l] : __builtin_bswap32(out[0][l]);
+            uint64_t hi = (words == 4) ? out[1][l] : __builtin_bswap32(out[1][l]);
+
+            h[l] = digest_index_mix(lo | hi << 32);
+            if (target->index)
+                __builtin_prefetch(digest_index_block(target->index, h[l]));
+        }
+
+        for (size_t l = 0; l < batch->n; l++)
+        {
+            uint8_t digest[32];
+
+            if (target->index && !digest_index_test(target->index, h[l]))
+                continue;
+
+            for (size_t i = 0; i < words; i++)
+            {
+                uint32_t v = (words == 4) ? out[i][l] : __builtin_bswap32(out[i][l]);
+
+                memcpy(&digest[i * 4], &v, sizeof(v));
+            }
+
+            if (hash_digest_find(target, digest) >= 0)
+                return (int)l;
+        }
+
+        return -1;
+    }
+
+    for (size_t i = 0; i < words; i++)
+    {
+        uint32_t le;
+
+        memcpy(&le, &target->digest[i * 4], sizeof(le));
+        expect[i] = (words == 4) ? le : __builtin_bswap32(le);
+    }
+
+    // The first word rules out all but one lane in four billion.
+    for (size_t l = 0; l < batch->n; l++)
+    {
+        if (out[0][l] != expect[0])
+            continue;
+
+        size_t i = 1;
+        while (i < words && out[i][l] == expect[i])
+            i++;
+        if (i == words)
+            return (int)l;
+    }
+
+    return -1;
+}
+
+#undef RAW_VROL
+#undef RAW_VROR
+#undef RAW_VF
+#undef RAW_VMAJ
+#undef RAW_MD5_VG
+#undef RAW_MD5_VH
+#undef RAW_MD5_VI
+#undef RAW_MD4_VG
+#undef RAW_MD4_VH
+#undef RAW_MD5_VSTEP
+#undef RAW_MD5_VSTEP_F
+#undef RAW_MD5_VSTEP_G
+#undef RAW_MD5_VSTEP_H
+#undef RAW_MD5_VSTEP_I
+#undef RAW_MD4_VSTEP
+#undef RAW_MD4_VSTEP_F
+#undef RAW_MD4_VSTEP_G
+#undef RAW_MD4_VSTEP_H
+#undef RAW_SHA1_STEP
+#undef RAW_SHA256_ROUND
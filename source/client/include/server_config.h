@@ -23,11 +23,14 @@ int       socket_bind(int sockfd, struct sockaddr_storage *addr, struct fsm_erro
 int       convert_address(const char *address, struct sockaddr_storage *addr,
                           in_port_t port, struct fsm_error *err);
 int       socket_connect(int sockfd, struct sockaddr_storage *addr, in_port_t port, struct fsm_error *err);
+int       handshake(int sockfd, worker_state *ws, struct fsm_error *err);
 int       receive_hash(int sockfd, worker_state *ws, struct fsm_error *err);
 int       wait_for_work(int sockfd, worker_state *ws, struct fsm_error *err);
 int       send_checkpoint(worker_state *ws, uint64_t idx);
-int       send_done(int sockfd, struct fsm_error *err);
-int       send_found(int sockfd, const char *password);
+int       send_done(worker_state *ws, struct fsm_error *err);
+int       send_next(worker_state *ws, struct fsm_error *err);
+int       send_chains(worker_state *ws, uint64_t first, const uint64_t *ends, size_t n);
+int       send_found(worker_state *ws, const char *hash, const char *password);
 socklen_t size_of_address(struct sockaddr_storage *addr);
 int       get_sockaddr_info(struct sockaddr_storage *addr, char **ip_address, char **port, struct fsm_error *err);
 
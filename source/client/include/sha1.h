@@ -0,0 +1,25 @@
+#ifndef CLIENT_SHA1_H
+#define CLIENT_SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_LEN 20
+
+typedef struct sha1_ctx
+{
+    uint32_t h[5];
+    uint64_t len;
+    size_t   used;
+    uint8_t  buf[64];
+} sha1_ctx;
+
+// Initial values and the four round constants, shared with the multi-buffer kernels.
+extern const uint32_t sha1_iv[5];
+extern const uint32_t sha1_k[4];
+
+void sha1_init(sha1_ctx *ctx);
+void sha1_update(sha1_ctx *ctx, const void *data, size_t len);
+void sha1_final(sha1_ctx *ctx, uint8_t out[SHA1_DIGEST_LEN]);
+
+#endif // CLIENT_SHA1_H
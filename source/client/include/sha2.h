@@ -0,0 +1,55 @@
+#ifndef CLIENT_SHA2_H
+#define CLIENT_SHA2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LEN 32
+#define SHA512_DIGEST_LEN 64
+
+typedef struct sha256_ctx
+{
+    uint32_t h[8];
+    uint64_t len;
+    size_t   used;
+    uint8_t  buf[64];
+} sha256_ctx;
+
+typedef struct sha512_ctx
+{
+    uint64_t h[8];
+    uint64_t len;
+    size_t   used;
+    uint8_t  buf[128];
+} sha512_ctx;
+
+typedef struct hmac_sha256_ctx
+{
+    sha256_ctx inner;
+    sha256_ctx outer;
+} hmac_sha256_ctx;
+
+// Initial values and round constants, shared with the multi-buffer kernels.
+extern const uint32_t sha256_iv[8];
+extern const uint64_t sha512_iv[8];
+extern const uint32_t sha256_k[64];
+extern const uint64_t sha512_k[80];
+
+void sha256_init(sha256_ctx *ctx);
+void sha256_update(sha256_ctx *ctx, const void *data, size_t len);
+void sha256_final(sha256_ctx *ctx, uint8_t out[SHA256_DIGEST_LEN]);
+
+// Between init and final, the message goes into ctx->inner with sha256_update().
+void hmac_sha256_init(hmac_sha256_ctx *ctx, const void *key, size_t key_len);
+void hmac_sha256_final(hmac_sha256_ctx *ctx, uint8_t out[SHA256_DIGEST_LEN]);
+void hmac_sha256(const void *key, size_t key_len, const void *msg, size_t msg_len, uint8_t out[SHA256_DIGEST_LEN]);
+
+// PBKDF2-HMAC-SHA256 with a single iteration, the only count scrypt and yescrypt use.
+void pbkdf2_sha256(const void *pass, size_t pass_len, const void *salt, size_t salt_len, uint8_t *out,
+                   size_t out_len);
+
+void sha512_init(sha512_ctx *ctx);
+void sha512_update(sha512_ctx *ctx, const void *data, size_t len);
+void sha512_final(sha512_ctx *ctx, uint8_t out[SHA512_DIGEST_LEN]);
+
+#endif // CLIENT_SHA2_H
@@ -0,0 +1,103 @@
+#ifndef CLIENT_SHA_CRYPT_H
+#define CLIENT_SHA_CRYPT_H
+
+#include "hash_engine.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SHA_CRYPT_MAX_KEY 255
+#define SHA_CRYPT_MAX_LANES 16 // widest SIMD engine: eight 64-bit or sixteen 32-bit lanes
+#define SHA_CRYPT_SIMD_MAX_KEY 63
+#define SHA_CRYPT_SIMD_MSG 256 // longest round message for a SIMD-sized key, padded
+
+// Everything SHA-crypt derives from a key before the rounds loop: the
+// initial A digest and the stretched key (P) and salt (S) bytes.
+typedef struct sha_crypt_state
+{
+    uint8_t a[64];
+    uint8_t p_bytes[SHA_CRYPT_MAX_KEY];
+    uint8_t s_bytes[HASH_MAX_SALT];
+    size_t  key_len;
+} sha_crypt_state;
+
+void sha_crypt_prepare(const hash_target *target, const char *key, size_t key_len, bool wide, sha_crypt_state *st);
+void sha_crypt_rounds(const hash_target *target, sha_crypt_state *st, bool wide);
+bool sha_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch, bool wide);
+
+// Runs n prepared states through the rounds loop at once, leaving each
+// final digest in its a and whether it matched the target in match.
+typedef void (*sha_crypt_kernel)(const hash_target *target, sha_crypt_state *st, size_t n, bool *match);
+
+#define SHA_CRYPT_SIMD_KERNELS 4
+
+// A multi-buffer kernel and the engine built on it.
+typedef struct sha_crypt_simd
+{
+    const hash_engine *engine;
+    sha_crypt_kernel   kernel;
+    bool               wide; // SHA-512
+} sha_crypt_simd;
+
+// Picks the widest multi-buffer engine the CPU runs correctly, else the scalar one.
+const hash_engine *sha_crypt_select_engine(const hash_target *target);
+// Fills kernels with every multi-buffer kernel the CPU runs, unchecked, and
+// returns how many; sha_crypt_test compares each against crypt_r.
+size_t             sha_crypt_simd_kernels(const sha_crypt_simd *kernels[SHA_CRYPT_SIMD_KERNELS]);
+
+// Lays out one round's message, padded, in block-sized pieces and returns
+// how many blocks it spans. The order follows round % 2, % 3 and % 7.
+static inline size_t sha_crypt_round_message(uint8_t *msg, const sha_crypt_state *st, size_t dlen, size_t slen,
+                                             uint32_t round, size_t block, size_t len_bytes)
+{
+    size_t len = 0;
+
+    if (round & 1)
+    {
+        memcpy(msg, st->p_bytes, st->key_len);
+        len = st->key_len;
+    }
+    else
+    {
+        memcpy(msg, st->a, dlen);
+        len = dlen;
+    }
+
+    if (round % 3 != 0)
+    {
+        memcpy(msg + len, st->s_bytes, slen);
+        len += slen;
+    }
+
+    if (round % 7 != 0)
+    {
+        memcpy(msg + len, st->p_bytes, st->key_len);
+        len += st->key_len;
+    }
+
+    if (round & 1)
+    {
+        memcpy(msg + len, st->a, dlen);
+        len += dlen;
+    }
+    else
+    {
+        memcpy(msg + len, st->p_bytes, st->key_len);
+        len += st->key_len;
+    }
+
+    size_t   blocks = (len + 1 + len_bytes + block - 1) / block;
+    size_t   end    = blocks * block;
+    uint64_t bits   = (uint64_t)len * 8;
+
+    msg[len] = 0x80;
+    memset(msg + len + 1, 0, end - len - 1);
+
+    for (int i = 0; i < 8; i++)
+        msg[end - 1 - i] = (uint8_t)(bits >> (8 * i));
+
+    return blocks;
+}
+
+#endif // CLIENT_SHA_CRYPT_H
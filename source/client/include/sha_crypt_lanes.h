@@ -0,0 +1,160 @@
+// Multi-buffer SHA-crypt rounds loop, instantiated once per hash width and
+// instruction set by src/sha_crypt_simd.c. Before including, define:
+//
+//   SHA_LANES   candidates hashed in lockstep
+//   SHA_WIDE    1 for SHA-512, 0 for SHA-256
+//   SHA_TARGET  the target attribute for the instruction set, e.g. "avx2"
+//   SHA_NAME    the name of the kernel function to define
+//
+// Every lane carries its own message; lanes whose message spans fewer blocks
+// than the longest one keep their state through the extra compressions.
+
+#if SHA_WIDE
+    #define SHA_WORD uint64_t
+    #define SHA_BLOCK 128
+    #define SHA_DIGEST 64
+    #define SHA_ROUNDS 80
+    #define SHA_LEN_BYTES 16
+    #define SHA_K sha512_k
+    #define SHA_IV sha512_iv
+    #define SHA_BSWAP __builtin_bswap64
+    #define SHA_S0(x) (SHA_ROR(x, 28) ^ SHA_ROR(x, 34) ^ SHA_ROR(x, 39))
+    #define SHA_S1(x) (SHA_ROR(x, 14) ^ SHA_ROR(x, 18) ^ SHA_ROR(x, 41))
+    #define SHA_G0(x) (SHA_ROR(x, 1) ^ SHA_ROR(x, 8) ^ ((x) >> 7))
+    #define SHA_G1(x) (SHA_ROR(x, 19) ^ SHA_ROR(x, 61) ^ ((x) >> 6))
+#else
+    #define SHA_WORD uint32_t
+    #define SHA_BLOCK 64
+    #define SHA_DIGEST 32
+    #define SHA_ROUNDS 64
+    #define SHA_LEN_BYTES 8
+    #define SHA_K sha256_k
+    #define SHA_IV sha256_iv
+    #define SHA_BSWAP __builtin_bswap32
+    #define SHA_S0(x) (SHA_ROR(x, 2) ^ SHA_ROR(x, 13) ^ SHA_ROR(x, 22))
+    #define SHA_S1(x) (SHA_ROR(x, 6) ^ SHA_ROR(x, 11) ^ SHA_ROR(x, 25))
+    #define SHA_G0(x) (SHA_ROR(x, 7) ^ SHA_ROR(x, 18) ^ ((x) >> 3))
+    #define SHA_G1(x) (SHA_ROR(x, 17) ^ SHA_ROR(x, 19) ^ ((x) >> 10))
+#endif
+
+#define SHA_BITS (8 * (int)sizeof(SHA_WORD))
+#define SHA_ROR(x, n) (((x) >> (n)) | ((x) << (SHA_BITS - (n))))
+#define SHA_ROUND(a, b, c, d, e, f, g, h, i)                            \
+    do                                                                  \
+    {                                                                   \
+        vec t1 = h + SHA_S1(e) + (g ^ (e & (f ^ g))) + SHA_K[i] + w[i]; \
+        vec t2 = SHA_S0(a) + ((a & b) | (c & (a | b)));                 \
+        d += t1;                                                        \
+        h = t1 + t2;                                                    \
+    } while (0)
+
+__attribute__((target(SHA_TARGET))) void SHA_NAME(const hash_target *target, sha_crypt_state *st, size_t n,
+                                                  bool *match)
+{
+    typedef SHA_WORD vec __attribute__((vector_size(sizeof(SHA_WORD) * SHA_LANES)));
+
+    _Alignas(64) uint8_t msg[SHA_LANES][SHA_CRYPT_SIMD_MSG];
+    size_t               blocks[SHA_LANES];
+    const size_t         slen = target->salt_len;
+    vec                  state[8];
+    vec                  w[SHA_ROUNDS];
+
+    for (uint32_t round = 0; round < target->cost; round++)
+    {
+        size_t most = 0;
+
+        // Lanes past n repeat lane 0 so every lane does defined work.
+        for (size_t l = 0; l < SHA_LANES; l++)
+        {
+            blocks[l] = sha_crypt_round_message(msg[l], &st[l < n ? l : 0], SHA_DIGEST, slen, round, SHA_BLOCK,
+                                                SHA_LEN_BYTES);
+            most      = (blocks[l] > most) ? blocks[l] : most;
+        }
+
+        for (int i = 0; i < 8; i++)
+            state[i] = (vec){0} + SHA_IV[i];
+
+        for (size_t b = 0; b < most; b++)
+        {
+            vec keep = {0};
+            vec a, bb, c, d, e, f, g, h;
+
+            for (int i = 0; i < 16; i++)
+            {
+                for (size_t l = 0; l < SHA_LANES; l++)
+                {
+                    SHA_WORD word;
+
+                    memcpy(&word, &msg[l][b * SHA_BLOCK + (size_t)i * sizeof(SHA_WORD)], sizeof(word));
+                    w[i][l] = SHA_BSWAP(word);
+                }
+            }
+
+            for (size_t l = 0; l < SHA_LANES; l++)
+                keep[l] = (blocks[l] <= b) ? (SHA_WORD)-1 : 0;
+
+            for (int i = 16; i < SHA_ROUNDS; i++)
+                w[i] = w[i - 16] + SHA_G0(w[i - 15]) + w[i - 7] + SHA_G1(w[i - 2]);
+
+            a  = state[0];
+            bb = state[1];
+            c  = state[2];
+            d  = state[3];
+            e  = state[4];
+            f  = state[5];
+            g  = state[6];
+            h  = state[7];
+
+            for (int i = 0; i < SHA_ROUNDS; i += 8)
+            {
+                SHA_ROUND(a, bb, c, d, e, f, g, h, i);
+                SHA_ROUND(h, a, bb, c, d, e, f, g, i + 1);
+                SHA_ROUND(g, h, a, bb, c, d, e, f, i + 2);
+                SHA_ROUND(f, g, h, a, bb, c, d, e, i + 3);
+                SHA_ROUND(e, f, g, h, a, bb, c, d, i + 4);
+                SHA_ROUND(d, e, f, g, h, a, bb, c, i + 5);
+                SHA_ROUND(c, d, e, f, g, h, a, bb, i + 6);
+                SHA_ROUND(bb, c, d, e, f, g, h, a, i + 7);
+            }
+
+            // Lanes whose message already ended keep the state they had.
+            state[0] = (state[0] & keep) | ((state[0] + a) & ~keep);
+            state[1] = (state[1] & keep) | ((state[1] + bb) & ~keep);
+            state[2] = (state[2] & keep) | ((state[2] + c) & ~keep);
+            state[3] = (state[3] & keep) | ((state[3] + d) & ~keep);
+            state[4] = (state[4] & keep) | ((state[4] + e) & ~keep);
+            state[5] = (state[5] & keep) | ((state[5] + f) & ~keep);
+            state[6] = (state[6] & keep) | ((state[6] + g) & ~keep);
+            state[7] = (state[7] & keep) | ((state[7] + h) & ~keep);
+        }
+
+        for (size_t l = 0; l < n; l++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                SHA_WORD word = SHA_BSWAP(state[i][l]);
+
+                memcpy(&st[l].a[(size_t)i * sizeof(SHA_WORD)], &word, sizeof(word));
+            }
+        }
+    }
+
+    for (size_t l = 0; l < n; l++)
+        match[l] = hash_digest_match(target, st[l].a);
+}
+
+#undef SHA_WORD
+#undef SHA_BLOCK
+#undef SHA_DIGEST
+#undef SHA_ROUNDS
+#undef SHA_LEN_BYTES
+#undef SHA_K
+#undef SHA_IV
+#undef SHA_BSWAP
+#undef SHA_S0
+#undef SHA_S1
+#undef SHA_G0
+#undef SHA_G1
+#undef SHA_BITS
+#undef SHA_ROR
+#undef SHA_ROUND
@@ -0,0 +1,49 @@
+#ifndef CLIENT_WORDLIST_H
+#define CLIENT_WORDLIST_H
+
+#include "fsm.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A read-only, memory-mapped wordlist with a line-offset index built once at
+// load time. Offsets are 32-bit whenever the file is small enough, which
+// halves the index for typical lists. Line i spans offset(i) up to the byte
+// before offset(i + 1); a trailing '\r' is dropped.
+typedef struct wordlist
+{
+    char     *data;
+    size_t    size;
+    uint64_t  count;
+    uint32_t *offsets32;
+    uint64_t *offsets64;
+} wordlist;
+
+int  wordlist_open(wordlist *wl, const char *path, struct fsm_error *err);
+void wordlist_close(wordlist *wl);
+
+static inline const char *wordlist_line(const wordlist *wl, uint64_t line, size_t *len)
+{
+    uint64_t start, end;
+
+    if (wl->offsets32)
+    {
+        start = wl->offsets32[line];
+        end   = wl->offsets32[line + 1] - 1;
+    }
+    else
+    {
+        start = wl->offsets64[line];
+        end   = wl->offsets64[line + 1] - 1;
+    }
+
+    if (end > start && wl->data[end - 1] == '\r')
+        end--;
+
+    *len = (size_t)(end - start);
+    return wl->data + start;
+}
+
+#endif // CLIENT_WORDLIST_H
@@ -0,0 +1,38 @@
+#ifndef CLIENT_YESCRYPT_H
+#define CLIENT_YESCRYPT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define YESCRYPT_WORM 0x001
+#define YESCRYPT_RW 0x002
+#define YESCRYPT_DEFAULTS 0x0b6 // RW with 6 pwxform rounds, 4-way gather, 2-way simple, 12 KiB S-boxes
+#define YESCRYPT_HASH_LEN 32
+
+// Cost parameters from a $y$ or $7$ setting; flags 0 is classic scrypt.
+typedef struct yescrypt_params
+{
+    uint32_t flags;
+    uint64_t N;
+    uint32_t r;
+    uint32_t p;
+    uint32_t t;
+} yescrypt_params;
+
+// One thread's working memory, mapped on first use and reused for every
+// candidate after that; it only grows when a job needs more.
+typedef struct yescrypt_arena
+{
+    void  *base;
+    size_t size;
+    bool   huge_pages;
+} yescrypt_arena;
+
+bool   yescrypt_params_supported(const yescrypt_params *params);
+size_t yescrypt_memory(const yescrypt_params *params);
+int    yescrypt_kdf(const yescrypt_params *params, yescrypt_arena *arena, const uint8_t *passwd, size_t passwd_len,
+                    const uint8_t *salt, size_t salt_len, uint8_t out[YESCRYPT_HASH_LEN]);
+void   yescrypt_arena_free(yescrypt_arena *arena);
+
+#endif // CLIENT_YESCRYPT_H
@@ -0,0 +1,145 @@
+#include "blowfish.h"
+#include "hash_engine.h"
+#include <string.h>
+
+// bcrypt ($2a$, $2b$, $2y$) run natively. Each thread keeps BF_INTERLEAVE
+// Blowfish states in its hash_scratch and takes that many keys per batch.
+static bool bcrypt_key(const hash_target *target, const char *key, size_t key_len, bf_key *out);
+static void bcrypt_salt(const hash_target *target, uint32_t salt[4]);
+static bool bcrypt_matches(const hash_target *target, const uint32_t out[6]);
+static bool bcrypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int  bcrypt_check_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                               hash_scratch *scratch);
+
+const hash_engine bcrypt_engine = {"bcrypt/x4", BF_INTERLEAVE, bcrypt_check, bcrypt_check_batch, NULL};
+
+#define BF_LANES 1
+#define BF_NAME eksblowfish_x1
+#include "bcrypt_lanes.h"
+#undef BF_LANES
+#undef BF_NAME
+
+#define BF_LANES BF_INTERLEAVE
+#define BF_NAME eksblowfish_interleaved
+#include "bcrypt_lanes.h"
+#undef BF_LANES
+#undef BF_NAME
+
+// The key and its terminating NUL repeat through the 72 bytes the P-array
+// takes. $2a$ only differs from $2b$ for bytes with the high bit set, where
+// crypt_blowfish adds a safety tweak; those keys are left to crypt_r.
+static bool bcrypt_key(const hash_target *target, const char *key, size_t key_len, bf_key *out)
+{
+    size_t pos = 0;
+
+    if (target->setting[2] == 'a')
+    {
+        for (size_t i = 0; i < key_len; i++)
+        {
+            if ((unsigned char)key[i] & 0x80)
+                return false;
+        }
+    }
+
+    for (int i = 0; i < BF_ROUNDS + 2; i++)
+    {
+        uint32_t w = 0;
+
+        for (int b = 0; b < 4; b++)
+        {
+            w   = w << 8 | (uint8_t)((pos < key_len) ? key[pos] : '\0');
+            pos = (pos < key_len) ? pos + 1 : 0;
+        }
+
+        out->w[i] = w;
+    }
+
+    return true;
+}
+
+static void bcrypt_salt(const hash_target *target, uint32_t salt[4])
+{
+    const uint8_t *p = target->salt_bytes;
+
+    for (int i = 0; i < 4; i++)
+        salt[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+}
+
+// bcrypt keeps 23 of the 24 ciphertext bytes.
+static bool bcrypt_matches(const hash_target *target, const uint32_t out[6])
+{
+    uint8_t bytes[24];
+
+    for (int i = 0; i < 6; i++)
+    {
+        bytes[i * 4]     = (uint8_t)(out[i] >> 24);
+        bytes[i * 4 + 1] = (uint8_t)(out[i] >> 16);
+        bytes[i * 4 + 2] = (uint8_t)(out[i] >> 8);
+        bytes[i * 4 + 3] = (uint8_t)out[i];
+    }
+
+    return hash_digest_match(target, bytes);
+}
+
+static bool bcrypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    bf_key   schedule;
+    uint32_t salt[4];
+    uint32_t out[1][6];
+
+    if (!bcrypt_key(target, key, key_len, &schedule))
+        return crypt_engine.check(target, key, key_len, scratch);
+
+    bcrypt_salt(target, salt);
+    eksblowfish_x1(scratch->bf, &schedule, salt, target->cost, out);
+
+    return bcrypt_matches(target, out[0]);
+}
+
+static int bcrypt_check_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                              hash_scratch *scratch)
+{
+    bf_key   schedule[BF_INTERLEAVE];
+    size_t   index[BF_INTERLEAVE];
+    uint32_t out[BF_INTERLEAVE][6];
+    uint32_t salt[4];
+    size_t   m = 0;
+
+    for (size_t i = 0; i < n && i < BF_INTERLEAVE; i++)
+    {
+        if (!bcrypt_key(target, keys[i], key_lens[i], &schedule[m]))
+        {
+            if (crypt_engine.check(target, keys[i], key_lens[i], scratch))
+                return (int)i;
+            continue;
+        }
+
+        index[m++] = i;
+    }
+
+    if (m == 0)
+        return -1;
+
+    bcrypt_salt(target, salt);
+
+    // A lone key is not worth three copies of itself.
+    if (m == 1)
+    {
+        eksblowfish_x1(scratch->bf, schedule, salt, target->cost, out);
+    }
+    else
+    {
+        for (size_t i = m; i < BF_INTERLEAVE; i++)
+            schedule[i] = schedule[0];
+
+        eksblowfish_interleaved(scratch->bf, schedule, salt, target->cost, out);
+    }
+
+    for (size_t i = 0; i < m; i++)
+    {
+        if (bcrypt_matches(target, out[i]))
+            return (int)index[i];
+    }
+
+    return -1;
+}
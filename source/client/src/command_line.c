@@ -4,22 +4,30 @@
 int parse_arguments(int argc, char *argv[], arguments *args, struct fsm_error *err)
 {
     int opt;
-    int p_flag, s_flag, t_flag;
+    int p_flag, s_flag, t_flag, W_flag, M_flag, R_flag, P_flag;
 
     opterr = 0;
     p_flag = 0;
     s_flag = 0;
     t_flag = 0;
+    W_flag = 0;
+    M_flag = 0;
+    R_flag = 0;
+    P_flag = 0;
 
     static struct option long_opts[] = {
-        {"port",    required_argument, 0, 'p'},
-        {"server",  required_argument, 0, 's'},
-        {"threads", required_argument, 0, 't'},
-        {"help",    no_argument,       0, 'h'},
-        {0,         0,                 0, 0  },
+        {"port",     required_argument, 0, 'p'},
+        {"server",   required_argument, 0, 's'},
+        {"threads",  required_argument, 0, 't'},
+        {"wordlist", required_argument, 0, 'W'},
+        {"markov",   required_argument, 0, 'M'},
+        {"rainbow",  required_argument, 0, 'R'},
+        {"protocol", required_argument, 0, 'P'},
+        {"help",     no_argument,       0, 'h'},
+        {0,          0,                 0, 0  },
     };
 
-    while ((opt = getopt_long(argc, argv, "p:s:t:h", long_opts, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "p:s:t:W:M:R:P:h", long_opts, NULL)) != -1)
     {
         switch (opt)
         {
@@ -69,6 +77,70 @@ int parse_arguments(int argc, char *argv[], arguments *args, struct fsm_error *e
 
                 break;
             }
+            case 'W':
+            {
+                if (W_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-W' can only be passed in once.");
+
+                    return -1;
+                }
+
+                W_flag++;
+                args->wordlist_path = optarg;
+
+                break;
+            }
+            case 'M':
+            {
+                if (M_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-M' can only be passed in once.");
+
+                    return -1;
+                }
+
+                M_flag++;
+                args->markov_path = optarg;
+
+                break;
+            }
+            case 'R':
+            {
+                if (R_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-R' can only be passed in once.");
+
+                    return -1;
+                }
+
+                R_flag++;
+                args->rainbow_path = optarg;
+
+                break;
+            }
+            case 'P':
+            {
+                if (P_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-P' can only be passed in once.");
+
+                    return -1;
+                }
+
+                P_flag++;
+                args->protocol_str = optarg;
+
+                break;
+            }
             case 'h':
             {
                 usage(argv[0]);
@@ -115,6 +187,14 @@ void usage(const char *program_name)
             "Optional options:\n"
             "  -t, --threads <num>       Number of threads the worker will use\n"
             "                             (default: 4)\n"
+            "  -W, --wordlist <path>     Local copy of the server's wordlist\n"
+            "                             (default: the path the server uses)\n"
+            "  -M, --markov <path>       Local copy of the server's Markov statistics\n"
+            "                             (default: the path the server uses)\n"
+            "  -R, --rainbow <path>      Local copy of the server's rainbow table\n"
+            "                             (default: the path the server uses)\n"
+            "  -P, --protocol <mode>     Wire protocol: binary, or the same messages\n"
+            "                             as text lines (default: binary)\n"
             "  -h, --help                Display this help message and exit\n\n"
             "Examples:\n"
             "  %s --server 192.168.1.10 --port 5000\n"
@@ -124,6 +204,7 @@ void usage(const char *program_name)
     fputs("Notes:\n", stderr);
     fputs("  • Long and short forms may be used interchangeably (e.g. --port or -p).\n", stderr);
     fputs("  • If threads is omitted it defaults to 4.\n", stderr);
+    fputs("  • A local wordlist must be identical to the server's, line for line.\n", stderr);
     fputs("  • The program will validate numeric ranges (e.g. port must fit in uint16).\n", stderr);
 }
 
@@ -161,6 +242,26 @@ int handle_arguments(const char *binary_name, arguments *args, struct fsm_error
             return -1;
     }
 
+    if (args->protocol_str == NULL || strcmp(args->protocol_str, "binary") == 0)
+    {
+        args->ws->protocol = PROTOCOL_BINARY;
+    }
+    else if (strcmp(args->protocol_str, "text") == 0)
+    {
+        args->ws->protocol = PROTOCOL_TEXT;
+    }
+    else
+    {
+        SET_ERROR(err, "The protocol must be binary or text.");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    args->ws->wordlist_path = args->wordlist_path;
+    args->ws->markov_path   = args->markov_path;
+    args->ws->rainbow_path  = args->rainbow_path;
+
     return 0;
 }
 
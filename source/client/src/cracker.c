@@ -1,123 +1,726 @@
 #include "cracker.h"
 #include "fsm.h"
+#include "rainbow.h"
 #include "server_config.h"
 #include <stdatomic.h>
+#include <unistd.h>
 
-char *index_to_password(uint64_t index)
+static _Alignas(CACHE_LINE_SIZE) atomic_bool found;
+static _Alignas(CACHE_LINE_SIZE) char found_candidate[64];
+static pthread_mutex_t found_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Candidates queued for a multi-buffer engine, hashed together once a full
+// set of lanes is ready or the claimed batch runs out.
+typedef struct lane_batch
+{
+    char        keys[HASH_MAX_LANES][MAX_CANDIDATE_LEN + 1];
+    const char *ptrs[HASH_MAX_LANES];
+    size_t      lens[HASH_MAX_LANES];
+    size_t      count;
+} lane_batch;
+
+static bool     claim_batch(thread_range *range, uint64_t size, uint64_t *start, uint64_t *end);
+static bool     steal_range(worker_pool *pool, size_t thief);
+static void     report_checkpoint(worker_pool *pool);
+static void     crack_range(worker_pool *pool, size_t id, hash_scratch *scratch, candidate_gen *gen);
+static void     maybe_prefetch(worker_pool *pool);
+static size_t   group_of(const struct worker_state *ws, size_t target);
+static void     report_found(struct worker_state *ws, size_t target, const char *candidate);
+static void     report_group(struct worker_state *ws, size_t g, const char *key, size_t key_len, hash_scratch *scratch);
+static bool     flush_lanes(struct worker_state *ws, hash_scratch *scratch, lane_batch *lanes);
+static void     stream_targets(struct worker_state *ws, hash_scratch *scratch, candidate_gen *gen, uint64_t start,
+                               uint64_t end);
+static void     rainbow_range(struct worker_state *ws, candidate_gen *gen, uint64_t start, uint64_t end);
+static uint64_t available_memory(void);
+static size_t   memory_thread_cap(size_t requested, size_t per_thread);
+
+static bool claim_batch(thread_range *range, uint64_t size, uint64_t *start, uint64_t *end)
 {
-    size_t i     = 0;
-    size_t len   = 1;
-    size_t range = CHARSET_SIZE;
-    size_t total = range;
+    bool claimed = false;
 
-    while (index >= total)
+    pthread_mutex_lock(&range->lock);
+
+    if (range->next < range->end)
+    {
+        *start = range->next;
+        *end   = (range->end - range->next > size) ? range->next + size : range->end;
+
+        range->next    = *end;
+        range->pending = *start;
+        claimed        = true;
+    }
+    else
     {
-        len++;
-        range *= CHARSET_SIZE;
-        total += range;
+        range->pending = UINT64_MAX;
     }
 
-    char *buffer = malloc(len + 1);
-    char *temp   = malloc(len + 1);
-    if (!buffer || !temp)
-        return NULL;
+    pthread_mutex_unlock(&range->lock);
+
+    return claimed;
+}
+
+static bool steal_range(worker_pool *pool, size_t thief)
+{
+    thread_range *own    = &pool->ranges[thief];
+    thread_range *victim = NULL;
+    uint64_t      most   = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (size_t i = 1; i < pool->nthreads; i++)
+    {
+        thread_range *candidate = &pool->ranges[(thief + i) % pool->nthreads];
 
-    size_t start_index = total - range;
-    size_t local_index = index - start_index;
+        pthread_mutex_lock(&candidate->lock);
+        uint64_t remaining = candidate->end - candidate->next;
+        pthread_mutex_unlock(&candidate->lock);
 
-    for (i = 0; i < len; i++)
+        if (remaining > most)
+        {
+            most   = remaining;
+            victim = candidate;
+        }
+    }
+
+    if (victim)
     {
-        temp[len - i - 1] = charset[local_index % CHARSET_SIZE];
-        local_index /= CHARSET_SIZE;
+        // Lock in address order so two thieves can never deadlock on each other.
+        thread_range *first  = (victim < own) ? victim : own;
+        thread_range *second = (victim < own) ? own : victim;
+
+        pthread_mutex_lock(&first->lock);
+        pthread_mutex_lock(&second->lock);
+
+        uint64_t remaining = victim->end - victim->next;
+        if (remaining > 0)
+        {
+            uint64_t mid = victim->next + remaining / 2;
+
+            own->next   = mid;
+            own->end    = victim->end;
+            victim->end = mid;
+        }
+        else
+        {
+            victim = NULL;
+        }
+
+        pthread_mutex_unlock(&second->lock);
+        pthread_mutex_unlock(&first->lock);
     }
 
-    temp[len] = '\0';
-    strcpy(buffer, temp);
-    free(temp);
-    return buffer;
+    pthread_mutex_unlock(&pool->lock);
+
+    return victim != NULL;
 }
 
-void *worker(void *arg)
+static void report_checkpoint(worker_pool *pool)
 {
-    struct worker_state *ws = (struct worker_state *)arg;
+    struct worker_state *ws        = pool->ws;
+    uint64_t             watermark = UINT64_MAX;
 
-    struct crypt_data cdata;
-    cdata.initialized = 0;
+    pthread_mutex_lock(&pool->lock);
 
-    while (!atomic_load(&found))
+    for (size_t i = 0; i < pool->nthreads; i++)
     {
-        uint64_t idx = (uint64_t)atomic_fetch_add(&task_counter, 1);
+        thread_range *range = &pool->ranges[i];
+
+        pthread_mutex_lock(&range->lock);
+        if (range->pending < watermark)
+            watermark = range->pending;
+        if (range->next < range->end && range->next < watermark)
+            watermark = range->next;
+        pthread_mutex_unlock(&range->lock);
+    }
+
+    // Every offset below the watermark is finished, so that is what the server may skip on reclaim.
+    if (watermark < ws->work_size && watermark > pool->last_checkpoint)
+    {
+        pool->last_checkpoint = watermark;
+        if (send_checkpoint(ws, ws->start_index + watermark) == -1)
+            atomic_store(&found, true);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Groups hold contiguous targets in order, so the last group starting at or
+// before target is its own.
+static size_t group_of(const struct worker_state *ws, size_t target)
+{
+    size_t lo = 0;
+    size_t hi = ws->num_groups;
+
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (ws->groups[mid].first <= target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+bool mark_cracked(struct worker_state *ws, size_t target)
+{
+    if (atomic_exchange(&ws->cracked[target], true))
+        return false;
+
+    atomic_fetch_sub(&ws->groups[group_of(ws, target)].remaining, 1);
+
+    // The last target down ends the job for every thread.
+    if (atomic_fetch_sub(&ws->remaining, 1) == 1)
+        atomic_store(&found, true);
+
+    return true;
+}
+
+static void report_found(struct worker_state *ws, size_t target, const char *candidate)
+{
+    // Another thread may have hit the same target in the same chunk.
+    if (!mark_cracked(ws, target))
+        return;
+
+    pthread_mutex_lock(&found_mutex);
+    strncpy(found_candidate, candidate, sizeof(found_candidate) - 1);
+    found_candidate[sizeof(found_candidate) - 1] = '\0';
+    printf("Password found!\nPassword for %s is: %s\n", ws->hashes[target], candidate);
+    send_found(ws, ws->hashes[target], candidate);
+    pthread_mutex_unlock(&found_mutex);
+}
+
+// A group only says some member matched. Halving its digest table with the
+// scalar check finds which in log2(members) hash computations, and members
+// with the same digest (hex in either case) all go down together.
+static void report_group(struct worker_state *ws, size_t g, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    const hash_group *group = &ws->groups[g];
+    hash_target       probe = group->target;
+    size_t            len   = probe.digest_len;
+    size_t            lo    = 0;
+    size_t            hi    = group->num_members;
+
+    if (group->num_members == 1)
+    {
+        report_found(ws, group->first, key);
+        return;
+    }
+
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        probe.digests     = group->digests + lo * len;
+        probe.num_digests = mid - lo;
+        probe.index       = NULL;
 
-        if (idx > ws->work_size - 1)
+        if (hash_check(&probe, key, key_len, scratch))
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    for (size_t i = lo; i < group->num_members && memcmp(group->digests + i * len, group->digests + lo * len, len) == 0;
+         i++)
+        report_found(ws, group->members[i], key);
+}
+
+// Runs the queued keys past every group still standing, each in slices of
+// its own engine's lanes. A hit resumes with the key after it, since others
+// in the slice may crack other members. Returns true once nothing is left.
+static bool flush_lanes(struct worker_state *ws, hash_scratch *scratch, lane_batch *lanes)
+{
+    size_t count = lanes->count;
+
+    lanes->count = 0;
+    if (count == 0)
+        return false;
+
+    for (size_t i = 0; i < count; i++)
+        lanes->ptrs[i] = lanes->keys[i];
+
+    for (size_t g = 0; g < ws->num_groups; g++)
+    {
+        const hash_target *target = &ws->groups[g].target;
+        size_t             width  = target->engine->lanes;
+
+        for (size_t off = 0; off < count;)
         {
-            break;
+            size_t n   = (count - off < width) ? count - off : width;
+            int    hit = -1;
+
+            if (atomic_load_explicit(&ws->groups[g].remaining, memory_order_relaxed) == 0)
+                break;
+
+            if (width > 1)
+                hit = hash_check_batch(target, lanes->ptrs + off, lanes->lens + off, n, scratch);
+            else if (hash_check(target, lanes->ptrs[off], lanes->lens[off], scratch))
+                hit = 0;
+
+            if (hit < 0)
+            {
+                off += n;
+                continue;
+            }
+
+            off += (size_t)hit;
+            report_group(ws, g, lanes->keys[off], lanes->lens[off], scratch);
+            off++;
         }
+    }
+
+    return atomic_load_explicit(&found, memory_order_relaxed);
+}
+
+// Generator-driven engines take the claimed range once per group, seeking
+// back to its start each time; a match is found again by seeking to it, and
+// the search goes on from the candidate after.
+static void stream_targets(struct worker_state *ws, hash_scratch *scratch, candidate_gen *gen, uint64_t start,
+                           uint64_t end)
+{
+    for (size_t g = 0; g < ws->num_groups && !atomic_load_explicit(&found, memory_order_relaxed); g++)
+    {
+        const hash_target *target = &ws->groups[g].target;
 
-        if (idx % ws->checkpoint_interval == 0)
+        for (uint64_t next = start; next < end;)
         {
-            if (send_checkpoint(ws, ws->start_index + idx) == -1)
-            {
-                atomic_store(&found, true);
+            int hit;
+
+            if (atomic_load_explicit(&ws->groups[g].remaining, memory_order_relaxed) == 0)
                 break;
+
+            if (candidate_gen_seek(gen, ws->keyspace, ws->start_index + next) == -1)
+                return;
+
+            hit = target->engine->check_gen(target, gen, end - next, scratch);
+            if (hit < 0)
+                break;
+
+            next += (uint64_t)hit;
+            if (candidate_gen_seek(gen, ws->keyspace, ws->start_index + next) == 0)
+                report_group(ws, g, gen->buf, gen->len, scratch);
+            next++;
+        }
+    }
+}
+
+// Building, each index is a chain, and a claimed batch goes back to the
+// server as one CHAIN line. Looking up, each index is a column, cheapest
+// (nearest the end) first, tried for every standing hash of the table's scheme.
+static void rainbow_range(struct worker_state *ws, candidate_gen *gen, uint64_t start, uint64_t end)
+{
+    const rainbow_table *table = ws->rainbow;
+
+    if (table->build)
+    {
+        uint64_t ends[RAINBOW_CHAINS_PER_LINE];
+
+        for (uint64_t i = start; i < end; i++)
+            ends[i - start] = rainbow_chain_end(table, gen, ws->keyspace, ws->start_index + i);
+
+        if (send_chains(ws, ws->start_index + start, ends, (size_t)(end - start)) == -1)
+            atomic_store(&found, true);
+
+        return;
+    }
+
+    for (uint64_t i = start; i < end && !atomic_load_explicit(&found, memory_order_relaxed); i++)
+    {
+        uint64_t column = table->chain_len - 1 - (ws->start_index + i);
+
+        for (size_t g = 0; g < ws->num_groups; g++)
+        {
+            const hash_group *group = &ws->groups[g];
+
+            if (group->target.scheme != table->probe.scheme ||
+                atomic_load_explicit(&group->remaining, memory_order_relaxed) == 0)
+                continue;
+
+            for (size_t m = 0; m < group->num_members; m++)
+            {
+                size_t         target = (group->num_members == 1) ? group->first : group->members[m];
+                const uint8_t *digest =
+                    (group->num_members == 1) ? group->target.digest : group->digests + m * group->target.digest_len;
+
+                if (!atomic_load_explicit(&ws->cracked[target], memory_order_relaxed) &&
+                    rainbow_lookup(table, gen, ws->keyspace, digest, column))
+                    report_found(ws, target, gen->buf);
             }
         }
+    }
+}
+
+static void crack_range(worker_pool *pool, size_t id, hash_scratch *scratch, candidate_gen *gen)
+{
+    struct worker_state *ws  = pool->ws;
+    thread_range        *own = &pool->ranges[id];
+    lane_batch           lanes;
+
+    uint64_t start, end;
+    uint64_t since_checkpoint = 0;
+    uint64_t checkpoint_step  = ws->checkpoint_interval / pool->nthreads;
+
+    // Wide engines claim at least a full set of lanes so no batch runs half empty.
+    // Generator-driven engines hash so fast that a bigger claim keeps the
+    // range lock and the found flag out of the profile.
+    uint64_t batch_size = (ws->max_lanes > GEN_BATCH_SIZE) ? ws->max_lanes : GEN_BATCH_SIZE;
 
-        char *pass = index_to_password(ws->start_index + idx);
+    if (ws->stream)
+        batch_size = GEN_STREAM_BATCH_SIZE;
+
+    // A rainbow index costs a whole chain (or, looking up, up to one per hash).
+    if (ws->rainbow)
+        batch_size = ws->rainbow->build ? RAINBOW_CHAINS_PER_LINE : 1;
+
+    if (checkpoint_step == 0)
+        checkpoint_step = 1;
+
+    while (!atomic_load_explicit(&found, memory_order_relaxed))
+    {
+        if (!claim_batch(own, batch_size, &start, &end))
+        {
+            if (!steal_range(pool, id) || !claim_batch(own, batch_size, &start, &end))
+                break;
+        }
 
-        char *result = crypt_r(pass, ws->hash, &cdata);
-        if (result != NULL)
+        if (ws->rainbow)
         {
-            if (strcmp(ws->hash, result) == 0)
+            rainbow_range(ws, gen, start, end);
+        }
+        else if (ws->stream)
+        {
+            stream_targets(ws, scratch, gen, start, end);
+        }
+        else
+        {
+            if (candidate_gen_seek(gen, ws->keyspace, ws->start_index + start) == -1)
+                break;
+
+            lanes.count = 0;
+
+            for (uint64_t idx = start; idx < end && !atomic_load_explicit(&found, memory_order_relaxed); idx++)
             {
-                if (!atomic_exchange(&found, true))
+                if (!gen->skip)
                 {
-                    pthread_mutex_lock(&found_mutex);
-                    strncpy(found_candidate, pass, sizeof(found_candidate) - 1);
-                    found_candidate[sizeof(found_candidate) - 1] = '\0';
-                    pthread_mutex_unlock(&found_mutex);
+                    memcpy(lanes.keys[lanes.count], gen->buf, gen->len + 1);
+                    lanes.lens[lanes.count++] = gen->len;
+
+                    if (lanes.count == ws->max_lanes && flush_lanes(ws, scratch, &lanes))
+                        break;
                 }
-                printf("Password found!\nPassword is: %s\n", pass);
-                send_found(ws->sockfd, pass);
 
-                free(pass);
-                break;
+                if (candidate_gen_next(gen) == -1)
+                    break;
             }
+
+            // The tail of the batch goes through with fewer lanes filled.
+            if (!atomic_load_explicit(&found, memory_order_relaxed))
+                flush_lanes(ws, scratch, &lanes);
+        }
+
+        since_checkpoint += end - start;
+        if (since_checkpoint >= checkpoint_step)
+        {
+            since_checkpoint = 0;
+            report_checkpoint(pool);
+        }
+    }
+
+    pthread_mutex_lock(&own->lock);
+    own->pending = UINT64_MAX;
+    pthread_mutex_unlock(&own->lock);
+}
+
+void *worker(void *arg)
+{
+    struct worker_arg *wa   = (struct worker_arg *)arg;
+    worker_pool       *pool = wa->pool;
+    uint64_t           seen = 0;
+
+    // Lives as long as the thread, so the engines keep their scratch state across chunks.
+    hash_scratch scratch;
+    hash_scratch_init(&scratch);
+
+    candidate_gen gen;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->state_lock);
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->work_ready, &pool->state_lock);
+
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->state_lock);
+            break;
         }
-        free(pass);
+
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->state_lock);
+
+        crack_range(pool, wa->id, &scratch, &gen);
+
+        pthread_mutex_lock(&pool->state_lock);
+        if (--pool->active == 0)
+            pthread_cond_signal(&pool->work_done);
+        pthread_mutex_unlock(&pool->state_lock);
     }
 
+    hash_scratch_free(&scratch);
+
     return NULL;
 }
 
-int create_threads(size_t number_of_threads, struct worker_state *ws)
+// MemAvailable counts the page cache the kernel can drop; free pages alone
+// would cap the threads far too early on a machine that has been up a while.
+static uint64_t available_memory(void)
 {
-    pthread_t *threads = malloc(number_of_threads * sizeof(pthread_t));
-    if (!threads)
-        return -1;
+    FILE    *meminfo = fopen("/proc/meminfo", "r");
+    char     line[128];
+    uint64_t kib = 0;
 
-    atomic_store(&task_counter, 0);
-    atomic_store(&found, false);
-    found_candidate[0] = '\0';
+    if (meminfo)
+    {
+        while (fgets(line, sizeof(line), meminfo))
+        {
+            if (sscanf(line, "MemAvailable: %" SCNu64 " kB", &kib) == 1)
+                break;
+        }
+        fclose(meminfo);
+    }
+
+    if (kib > 0)
+        return kib * 1024;
+
+#ifdef _SC_AVPHYS_PAGES
+    long pages     = sysconf(_SC_AVPHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if (pages > 0 && page_size > 0)
+        return (uint64_t)pages * (uint64_t)page_size;
+#endif
+
+    return 0;
+}
+
+// Memory-hard hashes get no more threads than the available RAM holds with
+// an eighth to spare; past that they would only swap each other out.
+static size_t memory_thread_cap(size_t requested, size_t per_thread)
+{
+    uint64_t available = available_memory();
+    uint64_t fit;
+
+    if (available == 0)
+        return requested;
+
+    fit = available / 8 * 7 / per_thread;
+    if (fit == 0)
+        fit = 1;
+
+    if (fit >= requested)
+        return requested;
+
+    printf("[WORKER] Capping threads at %" PRIu64 " of %zu: each needs %zu MiB, %" PRIu64 " MiB available\n", fit,
+           requested, per_thread >> 20, available >> 20);
+
+    return (size_t)fit;
+}
+
+worker_pool *pool_create(size_t number_of_threads, struct worker_state *ws, struct fsm_error *err)
+{
+    if (number_of_threads == 0)
+    {
+        SET_ERROR(err, "Thread count must be at least 1");
+        return NULL;
+    }
+
+    size_t per_thread = 0;
+    for (size_t g = 0; g < ws->num_groups; g++)
+    {
+        size_t need = hash_memory_per_thread(&ws->groups[g].target);
+        if (need > per_thread)
+            per_thread = need;
+    }
+
+    if (per_thread > 0)
+        number_of_threads = memory_thread_cap(number_of_threads, per_thread);
+
+    worker_pool *pool = calloc(1, sizeof(worker_pool));
+    if (!pool)
+    {
+        SET_ERROR(err, "calloc failed (pool_create)");
+        return NULL;
+    }
+
+    pool->ws       = ws;
+    pool->threads  = malloc(number_of_threads * sizeof(pthread_t));
+    pool->args     = malloc(number_of_threads * sizeof(worker_arg));
+    pool->ranges   = aligned_alloc(CACHE_LINE_SIZE, number_of_threads * sizeof(thread_range));
+    pool->nthreads = 0;
+
+    if (!pool->threads || !pool->args || !pool->ranges)
+    {
+        SET_ERROR(err, "malloc failed (pool_create)");
+        pool_destroy(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->state_lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (size_t i = 0; i < number_of_threads; i++)
+    {
+        pthread_mutex_init(&pool->ranges[i].lock, NULL);
+        pool->args[i].pool = pool;
+        pool->args[i].id   = i;
+    }
 
     for (size_t i = 0; i < number_of_threads; i++)
     {
-        int rc = pthread_create(&threads[i], NULL, worker, (void *)ws);
+        int rc = pthread_create(&pool->threads[i], NULL, worker, (void *)&pool->args[i]);
 
         if (rc != 0)
         {
+            // Run with however many threads did start.
             fprintf(stderr, "pthread_create failed: %d\n", rc);
-            for (size_t j = 0; j < i; ++j)
-                pthread_join(threads[j], NULL);
+            break;
+        }
+
+        pool->nthreads++;
+    }
+
+    if (pool->nthreads == 0)
+    {
+        SET_ERROR(err, "Failed to start any worker threads");
+        pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int pool_run(worker_pool *pool)
+{
+    struct worker_state *ws = pool->ws;
+
+    // Split the WORK range into contiguous per-thread blocks; stealing evens out the tail.
+    uint64_t block = ws->work_size / pool->nthreads;
+    uint64_t extra = ws->work_size % pool->nthreads;
+    uint64_t next  = 0;
+
+    for (size_t i = 0; i < pool->nthreads; i++)
+    {
+        uint64_t len = block + (i < extra ? 1 : 0);
+
+        pthread_mutex_lock(&pool->ranges[i].lock);
+        pool->ranges[i].next    = next;
+        pool->ranges[i].end     = next + len;
+        pool->ranges[i].pending = UINT64_MAX;
+        pthread_mutex_unlock(&pool->ranges[i].lock);
+        next += len;
+    }
+
+    pool->last_checkpoint = 0;
+    pool->prefetched      = false;
+    atomic_store(&found, false);
+    found_candidate[0] = '\0';
 
-            free(threads);
-            return -1;
+    pthread_mutex_lock(&pool->state_lock);
+    pool->active = pool->nthreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    while (pool->active > 0)
+    {
+        struct timespec deadline;
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        long nsec        = deadline.tv_nsec + PREFETCH_POLL_MS * 1000000L;
+        deadline.tv_sec += nsec / 1000000000L;
+        deadline.tv_nsec = nsec % 1000000000L;
+
+        pthread_cond_timedwait(&pool->work_done, &pool->state_lock, &deadline);
+
+        if (pool->active > 0)
+        {
+            pthread_mutex_unlock(&pool->state_lock);
+            maybe_prefetch(pool);
+            pthread_mutex_lock(&pool->state_lock);
         }
     }
+    pthread_mutex_unlock(&pool->state_lock);
+
+    // Chunks too small to be caught mid-flight still ask for their successor before DONE.
+    if (!pool->prefetched && !atomic_load(&found))
+    {
+        pool->prefetched = true;
+        if (send_next(ws, NULL) == -1)
+            atomic_store(&found, true);
+    }
+
+    return atomic_load(&found) ? 0 : -1;
+}
+
+static void maybe_prefetch(worker_pool *pool)
+{
+    struct worker_state *ws        = pool->ws;
+    uint64_t             unclaimed = 0;
+
+    if (pool->prefetched || atomic_load_explicit(&found, memory_order_relaxed))
+        return;
+
+    for (size_t i = 0; i < pool->nthreads; i++)
+    {
+        thread_range *range = &pool->ranges[i];
 
-    for (size_t i = 0; i < number_of_threads; ++i)
-        pthread_join(threads[i], NULL);
+        pthread_mutex_lock(&range->lock);
+        unclaimed += range->end - range->next;
+        pthread_mutex_unlock(&range->lock);
+    }
+
+    // Ask for the next chunk while this one finishes so the threads never sit idle on a round trip.
+    if (unclaimed * 100 <= ws->work_size * (100 - PREFETCH_PERCENT))
+    {
+        pool->prefetched = true;
+        if (send_next(ws, NULL) == -1)
+            atomic_store(&found, true);
+    }
+}
+
+void pool_destroy(worker_pool *pool)
+{
+    if (!pool)
+        return;
+
+    if (pool->nthreads > 0)
+    {
+        pthread_mutex_lock(&pool->state_lock);
+        pool->shutdown = true;
+        pthread_cond_broadcast(&pool->work_ready);
+        pthread_mutex_unlock(&pool->state_lock);
+
+        for (size_t i = 0; i < pool->nthreads; i++)
+            pthread_join(pool->threads[i], NULL);
+    }
+
+    if (pool->threads && pool->args && pool->ranges)
+    {
+        for (size_t i = 0; i < pool->nthreads; i++)
+            pthread_mutex_destroy(&pool->ranges[i].lock);
+
+        pthread_mutex_destroy(&pool->lock);
+        pthread_mutex_destroy(&pool->state_lock);
+        pthread_cond_destroy(&pool->work_ready);
+        pthread_cond_destroy(&pool->work_done);
+    }
 
-    bool got = atomic_load(&found);
-    free(threads);
-    return (got) ? 0 : -1;
+    free(pool->threads);
+    free(pool->args);
+    free(pool->ranges);
+    free(pool);
 }
@@ -0,0 +1,157 @@
+#include "des.h"
+
+// Traditional crypt(3) DES, bitsliced: every candidate is one bit position,
+// so a pass over 64-bit words runs 64 keys through the 25 encryptions.
+static bool des_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int  des_check_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                            hash_scratch *scratch);
+
+const hash_engine des_engine = {"des-bitslice/x64", 64, des_check, des_check_batch, NULL};
+
+#define DES_WORDS 1
+#define DES_NAME des_x64
+#include "des_lanes.h"
+#undef DES_WORDS
+#undef DES_NAME
+
+const uint8_t des_expansion[48] = {
+    31, 0, 1, 2, 3, 4, 3, 4, 5, 6, 7, 8,
+    7, 8, 9, 10, 11, 12, 11, 12, 13, 14, 15, 16,
+    15, 16, 17, 18, 19, 20, 19, 20, 21, 22, 23, 24,
+    23, 24, 25, 26, 27, 28, 27, 28, 29, 30, 31, 0,
+};
+
+const uint8_t des_round_keys[16][48] = {
+    {8, 44, 29, 52, 42, 14, 28, 49, 1, 7, 16, 36, 2, 30, 22, 21, 38, 50, 51, 0, 31, 23, 15, 35,
+     19, 24, 34, 47, 32, 3, 41, 26, 4, 46, 20, 25, 53, 18, 33, 55, 13, 17, 39, 12, 11, 54, 48, 27},
+    {1, 37, 22, 45, 35, 7, 21, 42, 51, 0, 9, 29, 52, 23, 15, 14, 31, 43, 44, 50, 49, 16, 8, 28,
+     12, 17, 27, 40, 25, 55, 34, 19, 24, 39, 13, 18, 46, 11, 26, 48, 6, 10, 32, 5, 4, 47, 41, 20},
+    {44, 23, 8, 31, 21, 50, 7, 28, 37, 43, 52, 15, 38, 9, 1, 0, 42, 29, 30, 36, 35, 2, 51, 14,
+     53, 3, 13, 26, 11, 41, 20, 5, 10, 25, 54, 4, 32, 24, 12, 34, 47, 55, 18, 46, 17, 33, 27, 6},
+    {30, 9, 51, 42, 7, 36, 50, 14, 23, 29, 38, 1, 49, 52, 44, 43, 28, 15, 16, 22, 21, 45, 37, 0,
+     39, 48, 54, 12, 24, 27, 6, 46, 55, 11, 40, 17, 18, 10, 53, 20, 33, 41, 4, 32, 3, 19, 13, 47},
+    {16, 52, 37, 28, 50, 22, 36, 0, 9, 15, 49, 44, 35, 38, 30, 29, 14, 1, 2, 8, 7, 31, 23, 43,
+     25, 34, 40, 53, 10, 13, 47, 32, 41, 24, 26, 3, 4, 55, 39, 6, 19, 27, 17, 18, 48, 5, 54, 33},
+    {2, 38, 23, 14, 36, 8, 22, 43, 52, 1, 35, 30, 21, 49, 16, 15, 0, 44, 45, 51, 50, 42, 9, 29,
+     11, 20, 26, 39, 55, 54, 33, 18, 27, 10, 12, 48, 17, 41, 25, 47, 5, 13, 3, 4, 34, 46, 40, 19},
+    {45, 49, 9, 0, 22, 51, 8, 29, 38, 44, 21, 16, 7, 35, 2, 1, 43, 30, 31, 37, 36, 28, 52, 15,
+     24, 6, 12, 25, 41, 40, 19, 4, 13, 55, 53, 34, 3, 27, 11, 33, 46, 54, 48, 17, 20, 32, 26, 5},
+    {31, 35, 52, 43, 8, 37, 51, 15, 49, 30, 7, 2, 50, 21, 45, 44, 29, 16, 42, 23, 22, 14, 38, 1,
+     10, 47, 53, 11, 27, 26, 5, 17, 54, 41, 39, 20, 48, 13, 24, 19, 32, 40, 34, 3, 6, 18, 12, 46},
+    {49, 28, 45, 36, 1, 30, 44, 8, 42, 23, 0, 52, 43, 14, 38, 37, 22, 9, 35, 16, 15, 7, 31, 51,
+     3, 40, 46, 4, 20, 19, 53, 10, 47, 34, 32, 13, 41, 6, 17, 12, 25, 33, 27, 55, 54, 11, 5, 39},
+    {35, 14, 31, 22, 44, 16, 30, 51, 28, 9, 43, 38, 29, 0, 49, 23, 8, 52, 21, 2, 1, 50, 42, 37,
+     48, 26, 32, 17, 6, 5, 39, 55, 33, 20, 18, 54, 27, 47, 3, 53, 11, 19, 13, 41, 40, 24, 46, 25},
+    {21, 0, 42, 8, 30, 2, 16, 37, 14, 52, 29, 49, 15, 43, 35, 9, 51, 38, 7, 45, 44, 36, 28, 23,
+     34, 12, 18, 3, 47, 46, 25, 41, 19, 6, 4, 40, 13, 33, 48, 39, 24, 5, 54, 27, 26, 10, 32, 11},
+    {7, 43, 28, 51, 16, 45, 2, 23, 0, 38, 15, 35, 1, 29, 21, 52, 37, 49, 50, 31, 30, 22, 14, 9,
+     20, 53, 4, 48, 33, 32, 11, 27, 5, 47, 17, 26, 54, 19, 34, 25, 10, 46, 40, 13, 12, 55, 18, 24},
+    {50, 29, 14, 37, 2, 31, 45, 9, 43, 49, 1, 21, 44, 15, 7, 38, 23, 35, 36, 42, 16, 8, 0, 52,
+     6, 39, 17, 34, 19, 18, 24, 13, 46, 33, 3, 12, 40, 5, 20, 11, 55, 32, 26, 54, 53, 41, 4, 10},
+    {36, 15, 0, 23, 45, 42, 31, 52, 29, 35, 44, 7, 30, 1, 50, 49, 9, 21, 22, 28, 2, 51, 43, 38,
+     47, 25, 3, 20, 5, 4, 10, 54, 32, 19, 48, 53, 26, 46, 6, 24, 41, 18, 12, 40, 39, 27, 17, 55},
+    {22, 1, 43, 9, 31, 28, 42, 38, 15, 21, 30, 50, 16, 44, 36, 35, 52, 7, 8, 14, 45, 37, 29, 49,
+     33, 11, 48, 6, 46, 17, 55, 40, 18, 5, 34, 39, 12, 32, 47, 10, 27, 4, 53, 26, 25, 13, 3, 41},
+    {15, 51, 36, 2, 49, 21, 35, 31, 8, 14, 23, 43, 9, 37, 29, 28, 45, 0, 1, 7, 38, 30, 22, 42,
+     26, 4, 41, 54, 39, 10, 48, 33, 11, 53, 27, 32, 5, 25, 40, 3, 20, 24, 46, 19, 18, 6, 55, 34},
+};
+
+const uint8_t des_sbox_out[8][4] = {
+    {8, 16, 22, 30},
+    {12, 27, 1, 17},
+    {23, 15, 29, 5},
+    {25, 19, 9, 0},
+    {7, 13, 24, 2},
+    {3, 28, 10, 18},
+    {31, 11, 21, 6},
+    {4, 26, 14, 20},
+};
+
+const uint8_t des_output[64] = {
+    39, 7, 47, 15, 55, 23, 63, 31, 38, 6, 46, 14, 54, 22, 62, 30,
+    37, 5, 45, 13, 53, 21, 61, 29, 36, 4, 44, 12, 52, 20, 60, 28,
+    35, 3, 43, 11, 51, 19, 59, 27, 34, 2, 42, 10, 50, 18, 58, 26,
+    33, 1, 41, 9, 49, 17, 57, 25, 32, 0, 40, 8, 48, 16, 56, 24,
+};
+
+// The salt's twelve bits each swap one pair of E-box outputs between the
+// two halves of the 48-bit block. Done once here, the kernels never see the salt.
+void des_prepare(hash_target *target)
+{
+    memcpy(target->ebox, des_expansion, sizeof(target->ebox));
+
+    for (int i = 0; i < 2; i++)
+    {
+        int v = target->salt_bytes[i];
+
+        for (int j = 0; j < 6; j++)
+        {
+            if ((v >> j) & 1)
+            {
+                uint8_t t                    = target->ebox[6 * i + j];
+                target->ebox[6 * i + j]      = target->ebox[6 * i + j + 24];
+                target->ebox[6 * i + j + 24] = t;
+            }
+        }
+    }
+}
+
+// Transposes up to lanes keys into key planes and runs them through the
+// kernel. Only the low seven bits of the first eight characters count, as in crypt(3).
+int des_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+              des_kernel kernel, size_t lanes)
+{
+    uint64_t planes[DES_KEY_BITS * HASH_MAX_LANES / 64] = {0};
+    uint64_t miss[HASH_MAX_LANES / 64];
+    size_t   words = lanes / 64;
+
+    if (n > lanes)
+        n = lanes;
+
+    for (size_t j = 0; j < n; j++)
+    {
+        size_t   len  = (key_lens[j] < DES_KEY_CHARS) ? key_lens[j] : DES_KEY_CHARS;
+        uint64_t mask = (uint64_t)1 << (j % 64);
+
+        for (size_t c = 0; c < len; c++)
+        {
+            unsigned v = (unsigned char)keys[j][c];
+
+            for (size_t b = 0; b < 7; b++)
+            {
+                if ((v >> (6 - b)) & 1)
+                    planes[(7 * c + b) * words + j / 64] |= mask;
+            }
+        }
+    }
+
+    if (target->digests)
+        kernel(target->ebox, planes, target->digests, target->num_digests, miss);
+    else
+        kernel(target->ebox, planes, target->digest, 1, miss);
+
+    for (size_t w = 0; w * 64 < n; w++)
+    {
+        uint64_t hits = ~miss[w];
+
+        if (n - w * 64 < 64)
+            hits &= ((uint64_t)1 << (n - w * 64)) - 1;
+        if (hits)
+            return (int)(w * 64 + (size_t)__builtin_ctzll(hits));
+    }
+
+    return -1;
+}
+
+static bool des_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    (void)scratch;
+    return des_batch(target, &key, &key_len, 1, des_x64, 64) == 0;
+}
+
+static int des_check_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                           hash_scratch *scratch)
+{
+    (void)scratch;
+    return des_batch(target, keys, key_lens, n, des_x64, 64);
+}
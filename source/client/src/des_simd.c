@@ -0,0 +1,171 @@
+#include "des.h"
+#include <stdio.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+// The bitsliced kernel at each register width. SSE2 is part of x86-64, so
+// the 128-bit one needs no attribute; the AVX ones carry theirs so the rest
+// of the program still runs on CPUs without them.
+void des_x128_sse2(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests,
+                   uint64_t *miss);
+void des_x256_avx2(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests,
+                   uint64_t *miss);
+void des_x512_avx512(const uint8_t ebox[48], const uint64_t *key, const uint8_t *digests, size_t num_digests,
+                     uint64_t *miss);
+
+    #define DES_WORDS 2
+    #define DES_NAME des_x128_sse2
+    #include "des_lanes.h"
+    #undef DES_WORDS
+    #undef DES_NAME
+
+    #define DES_WORDS 4
+    #define DES_TARGET "avx2"
+    #define DES_NAME des_x256_avx2
+    #include "des_lanes.h"
+    #undef DES_WORDS
+    #undef DES_TARGET
+    #undef DES_NAME
+
+    #define DES_WORDS 8
+    #define DES_TARGET "avx512f"
+    #define DES_NAME des_x512_avx512
+    #include "des_lanes.h"
+    #undef DES_WORDS
+    #undef DES_TARGET
+    #undef DES_NAME
+
+static bool des_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int  sse2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch);
+static int  avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch);
+static int  avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                         hash_scratch *scratch);
+static bool self_test(const hash_engine *engine);
+
+static const hash_engine des_sse2_engine   = {"des-bitslice/sse2x128", 128, des_check, sse2_batch, NULL};
+static const hash_engine des_avx2_engine   = {"des-bitslice/avx2x256", 256, des_check, avx2_batch, NULL};
+static const hash_engine des_avx512_engine = {"des-bitslice/avx512x512", 512, des_check, avx512_batch, NULL};
+
+// A lone key gains nothing from the wider registers.
+static bool des_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return des_engine.check(target, key, key_len, scratch);
+}
+
+static int sse2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch)
+{
+    (void)scratch;
+    return des_batch(target, keys, key_lens, n, des_x128_sse2, 128);
+}
+
+static int avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch)
+{
+    (void)scratch;
+    return des_batch(target, keys, key_lens, n, des_x256_avx2, 256);
+}
+
+static int avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                        hash_scratch *scratch)
+{
+    (void)scratch;
+    return des_batch(target, keys, key_lens, n, des_x512_avx512, 512);
+}
+
+// Known crypt(3) results (salts "k." and "Q7"), each placed in the last lane of the last word
+// behind a full set of decoys, so every word of the kernel has to be right.
+static bool self_test(const hash_engine *engine)
+{
+    static const struct
+    {
+        const char *key;
+        uint8_t     salt[2]; // decoded salt characters
+        uint8_t     digest[8];
+    } known[] = {
+        {"", {48, 0}, {0xb2, 0x3a, 0xe5, 0x5b, 0x8c, 0xe7, 0x9d, 0x39}},
+        {"password", {28, 9}, {0xf1, 0xd2, 0x0f, 0x45, 0xf7, 0x71, 0xe8, 0xf8}},
+        {"abcdefghXYZ", {28, 9}, {0x96, 0x17, 0xf5, 0x03, 0x5e, 0xe2, 0x79, 0x3a}},
+    };
+
+    const char *keys[HASH_MAX_LANES];
+    size_t      key_lens[HASH_MAX_LANES];
+    size_t      lanes = engine->lanes;
+
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+    {
+        hash_target probe;
+
+        memset(&probe, 0, sizeof(probe));
+        memcpy(probe.salt_bytes, known[i].salt, 2);
+        memcpy(probe.digest, known[i].digest, 8);
+        des_prepare(&probe);
+
+        for (size_t l = 0; l < lanes; l++)
+        {
+            keys[l]     = "decoy";
+            key_lens[l] = 5;
+        }
+        keys[lanes - 1 - i]     = known[i].key;
+        key_lens[lanes - 1 - i] = strlen(known[i].key);
+
+        if (engine->check_batch(&probe, keys, key_lens, lanes, NULL) != (int)(lanes - 1 - i))
+            return false;
+    }
+
+    return true;
+}
+
+const hash_engine *des_select_engine(void)
+{
+    const hash_engine *engine = &des_sse2_engine;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        engine = &des_avx512_engine;
+    else if (__builtin_cpu_supports("avx2"))
+        engine = &des_avx2_engine;
+
+    if (self_test(engine))
+        return engine;
+
+    fprintf(stderr, "[WORKER] %s failed its self-test, using the 64-bit engine\n", engine->name);
+
+    return &des_engine;
+}
+
+size_t des_engines(const hash_engine *engines[DES_ENGINES])
+{
+    size_t n = 0;
+
+    __builtin_cpu_init();
+
+    engines[n++] = &des_engine;
+    engines[n++] = &des_sse2_engine;
+
+    if (__builtin_cpu_supports("avx2"))
+        engines[n++] = &des_avx2_engine;
+
+    if (__builtin_cpu_supports("avx512f"))
+        engines[n++] = &des_avx512_engine;
+
+    return n;
+}
+
+#else
+
+const hash_engine *des_select_engine(void)
+{
+    return &des_engine;
+}
+
+size_t des_engines(const hash_engine *engines[DES_ENGINES])
+{
+    engines[0] = &des_engine;
+    return 1;
+}
+
+#endif
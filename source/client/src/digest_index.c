@@ -0,0 +1,107 @@
+#include "digest_index.h"
+#include <stdlib.h>
+
+static uint64_t leading_bits(const uint8_t *digest);
+static size_t   power_of_two(size_t n, size_t max);
+
+static uint64_t leading_bits(const uint8_t *digest)
+{
+    return (uint64_t)digest[0] << 24 | (uint64_t)digest[1] << 16 | (uint64_t)digest[2] << 8 | digest[3];
+}
+
+static size_t power_of_two(size_t n, size_t max)
+{
+    size_t p = 1;
+
+    while (p < n && p < max)
+        p *= 2;
+
+    return p;
+}
+
+int digest_index_build(digest_index *index, const uint8_t *digests, size_t count, size_t digest_len,
+                       struct fsm_error *err)
+{
+    size_t blocks  = power_of_two(count * DIGEST_INDEX_KEY_BITS / 512 + 1, (size_t)1 << 24);
+    size_t buckets = power_of_two(count / DIGEST_INDEX_PER_BUCKET + 1, (size_t)1 << 24);
+
+    memset(index, 0, sizeof(*index));
+    index->digests    = digests;
+    index->count      = count;
+    index->digest_len = digest_len;
+    index->block_mask = blocks - 1;
+
+    index->bucket_shift = 32;
+    while (((size_t)1 << (32 - index->bucket_shift)) < buckets)
+        index->bucket_shift--;
+
+    // Blocks start on cache lines, so a probe touches exactly one.
+    index->filter  = aligned_alloc(64, blocks * 64);
+    index->buckets = calloc(buckets + 1, sizeof(*index->buckets));
+    if (!index->filter || !index->buckets)
+    {
+        digest_index_free(index);
+        SET_ERROR(err, "malloc failed (digest_index_build)");
+        return -1;
+    }
+
+    memset(index->filter, 0, blocks * 64);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *digest = digests + i * digest_len;
+        uint64_t       h      = digest_index_hash(digest);
+        uint64_t      *block  = index->filter + ((h >> 40) & index->block_mask) * 8;
+
+        for (int p = 0; p < DIGEST_INDEX_PROBES; p++)
+        {
+            unsigned bit = (unsigned)(h >> (p * 9)) & 511;
+
+            block[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+
+        index->buckets[(leading_bits(digest) >> index->bucket_shift) + 1]++;
+    }
+
+    // Counts to starts: the digests are sorted, so each bucket is a run.
+    for (size_t b = 1; b <= buckets; b++)
+        index->buckets[b] += index->buckets[b - 1];
+
+    return 0;
+}
+
+void digest_index_free(digest_index *index)
+{
+    free(index->filter);
+    free(index->buckets);
+    index->filter  = NULL;
+    index->buckets = NULL;
+}
+
+ptrdiff_t digest_index_find(const digest_index *index, const uint8_t *digest)
+{
+    size_t bucket = (size_t)(leading_bits(digest) >> index->bucket_shift);
+    size_t lo;
+    size_t hi;
+
+    if (!digest_index_maybe(index, digest))
+        return -1;
+
+    lo = index->buckets[bucket];
+    hi = index->buckets[bucket + 1];
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int    cmp = memcmp(digest, index->digests + mid * index->digest_len, index->digest_len);
+
+        if (cmp == 0)
+            return (ptrdiff_t)mid;
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return -1;
+}
@@ -0,0 +1,768 @@
+#include "des.h"
+#include "hash_engine.h"
+#include "md5_crypt.h"
+#include "raw_hash.h"
+#include "sha_crypt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool        crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int         itoa64_value(char c);
+static int         bcrypt64_value(char c);
+static int         hex_value(char c);
+static bool        decode_crypt_groups(const char *in, size_t in_len, const int8_t (*groups)[4], size_t num_groups,
+                                       uint8_t *out);
+static bool        decode_des(const char *in, uint8_t out[8]);
+static bool        decode_bcrypt(const char *in, uint8_t *out, size_t out_len);
+static bool        decode_yescrypt(const char *in, size_t in_len, uint8_t *out, size_t out_len);
+static bool        decode_hex(const char *in, size_t in_len, uint8_t *out);
+static const char *decode_yescrypt_uint32(const char *in, uint32_t min, uint32_t *out);
+static const char *decode_scrypt_uint30(const char *in, uint32_t *out);
+static const char *parse_yescrypt_params(hash_target *target, const char *p);
+static bool        parse_md5_sha(hash_target *target, const char *encoded);
+static bool        parse_bcrypt(hash_target *target, const char *encoded);
+static bool        parse_yescrypt(hash_target *target, const char *encoded);
+static bool        parse_des(hash_target *target, const char *encoded);
+static bool        parse_raw(hash_target *target, const char *encoded);
+static bool        decode_target(hash_target *target, const char *encoded);
+
+const hash_engine crypt_engine = {"crypt_r", 1, crypt_check, NULL, NULL};
+
+static const char itoa64[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+static const char bcrypt64[] = "./ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+static const char hex_digits[] = "0123456789abcdef0123456789ABCDEF";
+
+// Byte order of the MD5- and SHA-crypt encodings: each row is (B2, B1, B0,
+// chars) for one b64_from_24bit() call, -1 standing for a zero byte.
+static const int8_t md5_groups[][4] = {
+    {0, 6, 12, 4},
+    {1, 7, 13, 4},
+    {2, 8, 14, 4},
+    {3, 9, 15, 4},
+    {4, 10, 5, 4},
+    {-1, -1, 11, 2},
+};
+
+static const int8_t sha256_groups[][4] = {
+    {0, 10, 20, 4},
+    {21, 1, 11, 4},
+    {12, 22, 2, 4},
+    {3, 13, 23, 4},
+    {24, 4, 14, 4},
+    {15, 25, 5, 4},
+    {6, 16, 26, 4},
+    {27, 7, 17, 4},
+    {18, 28, 8, 4},
+    {9, 19, 29, 4},
+    {-1, 31, 30, 3},
+};
+
+static const int8_t sha512_groups[][4] = {
+    {0, 21, 42, 4},
+    {22, 43, 1, 4},
+    {44, 2, 23, 4},
+    {3, 24, 45, 4},
+    {25, 46, 4, 4},
+    {47, 5, 26, 4},
+    {6, 27, 48, 4},
+    {28, 49, 7, 4},
+    {50, 8, 29, 4},
+    {9, 30, 51, 4},
+    {31, 52, 10, 4},
+    {53, 11, 32, 4},
+    {12, 33, 54, 4},
+    {34, 55, 13, 4},
+    {56, 14, 35, 4},
+    {15, 36, 57, 4},
+    {37, 58, 16, 4},
+    {59, 17, 38, 4},
+    {18, 39, 60, 4},
+    {40, 61, 19, 4},
+    {62, 20, 41, 4},
+    {-1, -1, 63, 2},
+};
+
+static bool crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    (void)key_len;
+
+    const char *result = crypt_r(key, target->encoded, &scratch->cdata);
+    hash_target parsed;
+
+    if (result == NULL)
+        return false;
+    if (target->digests == NULL)
+        return strcmp(result, target->encoded) == 0;
+
+    // Native engines fall back here; for a salt group the digest is looked up.
+    return decode_target(&parsed, result) && parsed.digest_len == target->digest_len &&
+           hash_digest_match(target, parsed.digest);
+}
+
+static int itoa64_value(char c)
+{
+    const char *p = (c != '\0') ? strchr(itoa64, c) : NULL;
+
+    return p ? (int)(p - itoa64) : -1;
+}
+
+static int bcrypt64_value(char c)
+{
+    const char *p = (c != '\0') ? strchr(bcrypt64, c) : NULL;
+
+    return p ? (int)(p - bcrypt64) : -1;
+}
+
+// Either case; the upper-case digits sit sixteen places on.
+static int hex_value(char c)
+{
+    const char *p = (c != '\0') ? strchr(hex_digits, c) : NULL;
+
+    return p ? (int)(p - hex_digits) % 16 : -1;
+}
+
+// Inverse of b64_from_24bit(). Rejects encodings with stray bits set, which
+// crypt() never produces and so could never match anyway.
+static bool decode_crypt_groups(const char *in, size_t in_len, const int8_t (*groups)[4], size_t num_groups,
+                                uint8_t *out)
+{
+    size_t expected = 0;
+
+    for (size_t g = 0; g < num_groups; g++)
+        expected += (size_t)groups[g][3];
+
+    if (in_len != expected)
+        return false;
+
+    for (size_t g = 0; g < num_groups; g++)
+    {
+        uint32_t w     = 0;
+        int      bytes = 0;
+
+        for (int c = 0; c < groups[g][3]; c++)
+        {
+            int v = itoa64_value(*in++);
+            if (v < 0)
+                return false;
+            w |= (uint32_t)v << (6 * c);
+        }
+
+        for (int b = 2; b >= 0; b--)
+        {
+            int8_t index = groups[g][b];
+
+            if (index >= 0)
+            {
+                out[index] = (uint8_t)(w >> (8 * (2 - b)));
+                bytes      = 3 - b;
+            }
+        }
+
+        if ((w >> (8 * bytes)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// Traditional DES: 64 output bits, big-endian, six per character, two zero pad bits.
+static bool decode_des(const char *in, uint8_t out[8])
+{
+    uint64_t bits = 0;
+
+    for (int i = 0; i < 10; i++)
+    {
+        int v = itoa64_value(in[i]);
+        if (v < 0)
+            return false;
+        bits = bits << 6 | (uint64_t)v;
+    }
+
+    // The eleventh character carries the last four bits; 66 would not fit.
+    int last = itoa64_value(in[10]);
+    if (last < 0 || (last & 3) != 0)
+        return false;
+
+    bits = bits << 4 | (uint64_t)(last >> 2);
+    for (int i = 7; i >= 0; i--)
+    {
+        out[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+
+    return true;
+}
+
+// bcrypt's own base64: big-endian, four characters per three bytes, the last
+// group cut short (22 characters for the 16-byte salt, 31 for the 23-byte hash).
+static bool decode_bcrypt(const char *in, uint8_t *out, size_t out_len)
+{
+    size_t o = 0;
+
+    while (o < out_len)
+    {
+        size_t   bytes = (out_len - o < 3) ? out_len - o : 3;
+        size_t   spare = (bytes + 1) * 6 - bytes * 8;
+        uint32_t w     = 0;
+
+        for (size_t c = 0; c < bytes + 1; c++)
+        {
+            int v = bcrypt64_value(*in++);
+            if (v < 0)
+                return false;
+            w = w << 6 | (uint32_t)v;
+        }
+
+        // A short group pads with zero bits.
+        if ((w & ((1u << spare) - 1)) != 0)
+            return false;
+        w >>= spare;
+
+        for (size_t b = bytes; b-- > 0;)
+            out[o++] = (uint8_t)(w >> (8 * b));
+    }
+
+    return true;
+}
+
+// yescrypt's encode64: little-endian groups of three bytes, low six bits
+// first, the last group cut short. Used for the yescrypt salt and hash.
+static bool decode_yescrypt(const char *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+    size_t o = 0;
+
+    if (in_len != out_len / 3 * 4 + ((out_len % 3) ? out_len % 3 + 1 : 0))
+        return false;
+
+    while (o < out_len)
+    {
+        size_t   bytes = (out_len - o < 3) ? out_len - o : 3;
+        size_t   chars = bytes + 1;
+        uint32_t w     = 0;
+
+        for (size_t c = 0; c < chars; c++)
+        {
+            int v = itoa64_value(*in++);
+            if (v < 0)
+                return false;
+            w |= (uint32_t)v << (6 * c);
+        }
+
+        if ((w >> (8 * bytes)) != 0)
+            return false;
+
+        for (size_t b = 0; b < bytes; b++)
+            out[o++] = (uint8_t)(w >> (8 * b));
+    }
+
+    return true;
+}
+
+static bool decode_hex(const char *in, size_t in_len, uint8_t *out)
+{
+    for (size_t i = 0; i < in_len; i += 2)
+    {
+        int hi = hex_value(in[i]);
+        int lo = hex_value(in[i + 1]);
+
+        if (hi < 0 || lo < 0)
+            return false;
+
+        out[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+
+    return true;
+}
+
+// yescrypt's variable-length parameters: a first character past 47 says
+// more follow, each range of first characters covering a larger span.
+static const char *decode_yescrypt_uint32(const char *in, uint32_t min, uint32_t *out)
+{
+    uint32_t start = 0;
+    uint32_t end   = 47;
+    uint32_t chars = 1;
+    uint32_t bits  = 0;
+    int      c     = itoa64_value(*in++);
+
+    if (c < 0)
+        return NULL;
+
+    *out = min;
+    while ((uint32_t)c > end)
+    {
+        *out += (end + 1 - start) << bits;
+        start = end + 1;
+        end   = start + (62 - end) / 2;
+        chars++;
+        bits += 6;
+    }
+
+    *out += ((uint32_t)c - start) << bits;
+
+    while (--chars)
+    {
+        c = itoa64_value(*in++);
+        if (c < 0)
+            return NULL;
+        bits -= 6;
+        *out += (uint32_t)c << bits;
+    }
+
+    return in;
+}
+
+// scrypt's $7$ fields: 30 bits in five characters, low bits first.
+static const char *decode_scrypt_uint30(const char *in, uint32_t *out)
+{
+    *out = 0;
+
+    for (int bits = 0; bits < 30; bits += 6)
+    {
+        int c = itoa64_value(*in++);
+        if (c < 0)
+            return NULL;
+        *out |= (uint32_t)c << bits;
+    }
+
+    return in;
+}
+
+static bool parse_md5_sha(hash_target *target, const char *encoded)
+{
+    const char *p = encoded + 3;
+    size_t      max_salt;
+
+    switch (encoded[1])
+    {
+        case '1':
+            target->scheme = HASH_SCHEME_MD5;
+            max_salt       = 8;
+            break;
+        case 'a':
+            if (strncmp(encoded, "$apr1$", 6) != 0)
+                return false;
+            target->scheme = HASH_SCHEME_APR1;
+            max_salt       = 8;
+            p              = encoded + 6;
+            break;
+        case '5':
+            target->scheme = HASH_SCHEME_SHA256;
+            max_salt       = 16;
+            break;
+        case '6':
+            target->scheme = HASH_SCHEME_SHA512;
+            max_salt       = 16;
+            break;
+        default:
+            return false;
+    }
+
+    // MD5-crypt always runs 1000 rounds; SHA-crypt defaults to 5000 and may say otherwise.
+    target->cost = 1000;
+
+    if (target->scheme == HASH_SCHEME_SHA256 || target->scheme == HASH_SCHEME_SHA512)
+    {
+        target->cost = 5000;
+
+        if (strncmp(p, "rounds=", 7) == 0)
+        {
+            char         *end;
+            unsigned long rounds = strtoul(p + 7, &end, 10);
+
+            if (*end != '$' || end == p + 7)
+                return false;
+
+            // Out-of-range counts are clamped, exactly as crypt() does.
+            target->cost        = (rounds < 1000) ? 1000 : (rounds > 999999999) ? 999999999 : (uint32_t)rounds;
+            target->custom_cost = true;
+            p                   = end + 1;
+        }
+    }
+
+    const char *dollar = strchr(p, '$');
+    if (!dollar)
+        return false;
+
+    target->salt_len = (size_t)(dollar - p);
+    if (target->salt_len > max_salt)
+        return false;
+
+    memcpy(target->salt, p, target->salt_len);
+    target->salt[target->salt_len] = '\0';
+
+    if ((size_t)(dollar - encoded) >= sizeof(target->setting))
+        return false;
+
+    memcpy(target->setting, encoded, (size_t)(dollar - encoded));
+    target->setting[dollar - encoded] = '\0';
+
+    const char *digest = dollar + 1;
+    size_t      len    = strlen(digest);
+
+    switch (target->scheme)
+    {
+        case HASH_SCHEME_MD5:
+        case HASH_SCHEME_APR1:
+            target->digest_len = 16;
+            return decode_crypt_groups(digest, len, md5_groups, sizeof(md5_groups) / sizeof(md5_groups[0]),
+                                       target->digest);
+        case HASH_SCHEME_SHA256:
+            target->digest_len = 32;
+            return decode_crypt_groups(digest, len, sha256_groups, sizeof(sha256_groups) / sizeof(sha256_groups[0]),
+                                       target->digest);
+        case HASH_SCHEME_SHA512:
+            target->digest_len = 64;
+            return decode_crypt_groups(digest, len, sha512_groups, sizeof(sha512_groups) / sizeof(sha512_groups[0]),
+                                       target->digest);
+        case HASH_SCHEME_UNKNOWN:
+        case HASH_SCHEME_DES:
+        case HASH_SCHEME_BCRYPT:
+        case HASH_SCHEME_YESCRYPT:
+        case HASH_SCHEME_SCRYPT:
+        case HASH_SCHEME_RAW_MD5:
+        case HASH_SCHEME_RAW_SHA1:
+        case HASH_SCHEME_RAW_SHA256:
+        case HASH_SCHEME_NTLM:
+        default:
+            return false;
+    }
+}
+
+// $2a$, $2b$, $2x$ or $2y$, a two-digit cost, 22 salt characters, 31 hash characters.
+static bool parse_bcrypt(hash_target *target, const char *encoded)
+{
+    if (strlen(encoded) != 60 || strchr("abxy", encoded[2]) == NULL || encoded[3] != '$' || encoded[6] != '$')
+        return false;
+
+    if (encoded[4] < '0' || encoded[4] > '3' || encoded[5] < '0' || encoded[5] > '9')
+        return false;
+
+    target->scheme      = HASH_SCHEME_BCRYPT;
+    target->cost        = (uint32_t)((encoded[4] - '0') * 10 + (encoded[5] - '0'));
+    target->custom_cost = true;
+
+    if (target->cost < 4 || target->cost > 31)
+        return false;
+
+    memcpy(target->salt, encoded + 7, 22);
+    target->salt[22] = '\0';
+    target->salt_len = 22;
+
+    memcpy(target->setting, encoded, 29);
+    target->setting[29] = '\0';
+
+    if (!decode_bcrypt(encoded + 7, target->salt_bytes, 16))
+        return false;
+
+    target->digest_len = 23;
+    return decode_bcrypt(encoded + 29, target->digest, 23);
+}
+
+// $y$<flavor><N><r>[<optional params>]$: the flavor packs the mode and
+// pwxform settings, N is stored as its log2. The ROM and upgrade options
+// need a shared table we never have, so those hashes stay with crypt_r.
+static const char *parse_yescrypt_params(hash_target *target, const char *p)
+{
+    yescrypt_params *params = &target->yescrypt;
+    uint32_t         flavor;
+    uint32_t         n_log2;
+    uint32_t         have;
+
+    params->p = 1;
+    params->t = 0;
+
+    if (!(p = decode_yescrypt_uint32(p, 0, &flavor)) || !(p = decode_yescrypt_uint32(p, 1, &n_log2)) ||
+        !(p = decode_yescrypt_uint32(p, 1, &params->r)))
+        return NULL;
+
+    if (flavor < YESCRYPT_RW)
+        params->flags = flavor;
+    else
+        params->flags = YESCRYPT_RW + ((flavor - YESCRYPT_RW) << 2);
+
+    if (n_log2 > 63)
+        return NULL;
+    params->N = (uint64_t)1 << n_log2;
+
+    if (*p != '$')
+    {
+        if (!(p = decode_yescrypt_uint32(p, 1, &have)) || (have & ~3u) != 0)
+            return NULL;
+        if ((have & 1) && !(p = decode_yescrypt_uint32(p, 2, &params->p)))
+            return NULL;
+        if ((have & 2) && !(p = decode_yescrypt_uint32(p, 1, &params->t)))
+            return NULL;
+    }
+
+    return (*p == '$') ? p + 1 : NULL;
+}
+
+// $y$<params>$<salt>$<hash> or scrypt's $7$<N><r><p><salt>$<hash>. yescrypt
+// decodes its salt first; scrypt hashes the salt characters as they are.
+static bool parse_yescrypt(hash_target *target, const char *encoded)
+{
+    const char *hash = strrchr(encoded, '$');
+    const char *salt;
+
+    if (!hash || hash < encoded + 3 || (size_t)(hash - encoded) >= sizeof(target->setting))
+        return false;
+
+    if (encoded[1] == '7')
+    {
+        int n_log2 = itoa64_value(encoded[3]);
+
+        target->scheme = HASH_SCHEME_SCRYPT;
+
+        if (n_log2 < 1 || !(salt = decode_scrypt_uint30(encoded + 4, &target->yescrypt.r)) ||
+            !(salt = decode_scrypt_uint30(salt, &target->yescrypt.p)))
+            return false;
+
+        target->yescrypt.N = (uint64_t)1 << n_log2;
+    }
+    else
+    {
+        target->scheme = HASH_SCHEME_YESCRYPT;
+
+        if (!(salt = parse_yescrypt_params(target, encoded + 3)))
+            return false;
+    }
+
+    if (salt > hash || (size_t)(hash - salt) > HASH_MAX_SALT)
+        return false;
+
+    target->salt_len = (size_t)(hash - salt);
+    memcpy(target->salt, salt, target->salt_len);
+    target->salt[target->salt_len] = '\0';
+
+    if (target->scheme == HASH_SCHEME_SCRYPT)
+    {
+        memcpy(target->salt_bytes, salt, target->salt_len);
+        target->salt_bytes_len = target->salt_len;
+    }
+    else
+    {
+        size_t len = target->salt_len;
+
+        target->salt_bytes_len = len / 4 * 3 + ((len % 4) ? len % 4 - 1 : 0);
+        if (len % 4 == 1 || !decode_yescrypt(salt, len, target->salt_bytes, target->salt_bytes_len))
+            return false;
+    }
+
+    memcpy(target->setting, encoded, (size_t)(hash - encoded));
+    target->setting[hash - encoded] = '\0';
+
+    target->digest_len = YESCRYPT_HASH_LEN;
+    return decode_yescrypt(hash + 1, strlen(hash + 1), target->digest, YESCRYPT_HASH_LEN);
+}
+
+static bool parse_des(hash_target *target, const char *encoded)
+{
+    if (strlen(encoded) != 13 || itoa64_value(encoded[0]) < 0 || itoa64_value(encoded[1]) < 0)
+        return false;
+
+    target->scheme   = HASH_SCHEME_DES;
+    target->salt_len = 2;
+    memcpy(target->salt, encoded, 2);
+    target->salt[2]       = '\0';
+    target->salt_bytes[0] = (uint8_t)itoa64_value(encoded[0]);
+    target->salt_bytes[1] = (uint8_t)itoa64_value(encoded[1]);
+
+    memcpy(target->setting, encoded, 2);
+    target->setting[2] = '\0';
+
+    target->digest_len = 8;
+    return decode_des(encoded + 2, target->digest);
+}
+
+// Unsalted digests in hex: 32 digits are MD5, 40 SHA-1 and 64 SHA-256.
+// NTLM is MD4 of the UTF-16LE key and, being the same length as MD5, is told
+// apart by John the Ripper's $NT$ prefix.
+static bool parse_raw(hash_target *target, const char *encoded)
+{
+    const char *hex = encoded;
+    size_t      len;
+
+    if (strncmp(encoded, "$NT$", 4) == 0)
+    {
+        hex            = encoded + 4;
+        target->scheme = HASH_SCHEME_NTLM;
+    }
+
+    len = strlen(hex);
+
+    if (target->scheme == HASH_SCHEME_NTLM)
+    {
+        if (len != 32)
+            return false;
+    }
+    else if (len == 32)
+    {
+        target->scheme = HASH_SCHEME_RAW_MD5;
+    }
+    else if (len == 40)
+    {
+        target->scheme = HASH_SCHEME_RAW_SHA1;
+    }
+    else if (len == 64)
+    {
+        target->scheme = HASH_SCHEME_RAW_SHA256;
+    }
+    else
+    {
+        return false;
+    }
+
+    target->digest_len = len / 2;
+    return decode_hex(hex, len, target->digest);
+}
+
+// Takes encoded apart without picking an engine; false when the format is
+// not one we know.
+static bool decode_target(hash_target *target, const char *encoded)
+{
+    bool parsed = false;
+
+    memset(target, 0, sizeof(*target));
+    target->encoded = encoded;
+    target->engine  = &crypt_engine;
+
+    if (encoded[0] == '$' && encoded[1] != '\0' && encoded[2] == '$')
+    {
+        if (encoded[1] == 'y' || encoded[1] == '7')
+            parsed = parse_yescrypt(target, encoded);
+        else
+            parsed = parse_md5_sha(target, encoded);
+    }
+    else if (strncmp(encoded, "$apr1$", 6) == 0)
+    {
+        parsed = parse_md5_sha(target, encoded);
+    }
+    else if (strncmp(encoded, "$2", 2) == 0)
+    {
+        parsed = parse_bcrypt(target, encoded);
+    }
+    else if (strncmp(encoded, "$NT$", 4) == 0)
+    {
+        parsed = parse_raw(target, encoded);
+    }
+    else if (encoded[0] != '$')
+    {
+        parsed = (strlen(encoded) == 13) ? parse_des(target, encoded) : parse_raw(target, encoded);
+    }
+
+    return parsed;
+}
+
+int hash_target_parse(hash_target *target, const char *encoded, struct fsm_error *err)
+{
+    // The SIMD engines' self-tests depend on the CPU, not the hash, so a
+    // list of a million hashes runs each scheme's once.
+    static const hash_engine *selected[HASH_SCHEME_NTLM + 1];
+
+    if (encoded == NULL || encoded[0] == '\0')
+    {
+        SET_ERROR(err, "Empty hash");
+        return -1;
+    }
+
+    // Anything we cannot take apart is still handed to crypt_r whole.
+    if (!decode_target(target, encoded))
+    {
+        target->scheme     = HASH_SCHEME_UNKNOWN;
+        target->digest_len = 0;
+        return 0;
+    }
+
+    switch (target->scheme)
+    {
+        case HASH_SCHEME_MD5:
+        case HASH_SCHEME_APR1:
+            if (!selected[target->scheme])
+                selected[target->scheme] = md5_crypt_select_engine(target);
+            target->engine = selected[target->scheme];
+            break;
+        case HASH_SCHEME_SHA256:
+        case HASH_SCHEME_SHA512:
+            if (!selected[target->scheme])
+                selected[target->scheme] = sha_crypt_select_engine(target);
+            target->engine = selected[target->scheme];
+            break;
+        case HASH_SCHEME_BCRYPT:
+            // $2x$ reproduces an old sign-extension bug that only crypt_r knows.
+            target->engine = (target->setting[2] == 'x') ? &crypt_engine : &bcrypt_engine;
+            break;
+        case HASH_SCHEME_DES:
+            des_prepare(target);
+            target->engine = des_select_engine();
+            break;
+        case HASH_SCHEME_YESCRYPT:
+        case HASH_SCHEME_SCRYPT:
+            target->engine = yescrypt_params_supported(&target->yescrypt) ? &yescrypt_engine : &crypt_engine;
+            break;
+        case HASH_SCHEME_RAW_MD5:
+        case HASH_SCHEME_RAW_SHA1:
+        case HASH_SCHEME_RAW_SHA256:
+        case HASH_SCHEME_NTLM:
+            // crypt_r knows none of these, so there is no fallback to hand them to.
+            if (!selected[target->scheme])
+                selected[target->scheme] = raw_hash_select_engine(target);
+            target->engine = selected[target->scheme];
+            break;
+        case HASH_SCHEME_UNKNOWN:
+        default:
+            target->engine = &crypt_engine;
+            break;
+    }
+
+    return 0;
+}
+
+void hash_scratch_init(hash_scratch *scratch)
+{
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+void hash_scratch_free(hash_scratch *scratch)
+{
+    yescrypt_arena_free(&scratch->arena);
+}
+
+size_t hash_memory_per_thread(const hash_target *target)
+{
+    if (target->scheme != HASH_SCHEME_YESCRYPT && target->scheme != HASH_SCHEME_SCRYPT)
+        return 0;
+
+    return yescrypt_params_supported(&target->yescrypt) ? yescrypt_memory(&target->yescrypt) : 0;
+}
+
+// Hashes crypt_r checks whole carry no digest to share.
+bool hash_target_same_setting(const hash_target *a, const hash_target *b)
+{
+    return a->engine == b->engine && a->engine != &crypt_engine && a->scheme == b->scheme && a->digest_len > 0 &&
+           a->digest_len == b->digest_len && strcmp(a->setting, b->setting) == 0;
+}
+
+ptrdiff_t hash_digest_find(const hash_target *target, const uint8_t *digest)
+{
+    size_t lo = 0;
+    size_t hi = target->num_digests;
+
+    if (target->index)
+        return digest_index_find(target->index, digest);
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int    cmp = memcmp(digest, target->digests + mid * target->digest_len, target->digest_len);
+
+        if (cmp == 0)
+            return (ptrdiff_t)mid;
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return -1;
+}
@@ -0,0 +1,578 @@
+#include "keyspace.h"
+#include "fsm.h"
+#include <stdio.h>
+
+static int brute_force_seek(candidate_gen *gen, uint64_t index);
+static int mask_seek(candidate_gen *gen, uint64_t index);
+static int wordlist_load_line(candidate_gen *gen);
+static int wordlist_apply_rule(candidate_gen *gen);
+static int hybrid_seek(candidate_gen *gen, uint64_t index);
+static int hybrid_next(candidate_gen *gen);
+static void hybrid_load_word(candidate_gen *gen, bool write_mask);
+static bool odometer_step(candidate_gen *gen, char *out);
+static int  markov_build(keyspace *ks, struct fsm_error *err);
+static int  compare_keys(const void *a, const void *b);
+
+static inline char position_char(const keyspace *ks, size_t i, char prev, uint8_t digit)
+{
+    if (!ks->markov)
+        return ks->charsets[i][digit];
+
+    size_t table = (i < ks->markov_tables) ? i : ks->markov_tables - 1;
+
+    return ks->markov[(table * 256 + (unsigned char)prev) * ks->markov_stride + digit];
+}
+
+void keyspace_init(keyspace *ks)
+{
+    memset(ks, 0, sizeof(*ks));
+    ks->mode = KEYSPACE_BRUTE_FORCE;
+
+    for (size_t i = 0; i < MAX_CANDIDATE_LEN; i++)
+    {
+        ks->charsets[i] = charset;
+        ks->radix[i]    = CHARSET_SIZE;
+    }
+}
+
+int keyspace_add_position(keyspace *ks, const char *chars, struct fsm_error *err)
+{
+    size_t n = strlen(chars);
+
+    if (ks->mode == KEYSPACE_WORDLIST)
+    {
+        SET_ERROR(err, "Mask cannot be combined with a wordlist");
+        return -1;
+    }
+
+    if (ks->length == MAX_CANDIDATE_LEN)
+    {
+        SET_ERROR(err, "Mask has too many positions");
+        return -1;
+    }
+
+    if (n == 0 || n > MAX_POSITION_CHARSET)
+    {
+        SET_ERROR(err, "Mask position charset must hold 1-255 characters");
+        return -1;
+    }
+
+    memcpy(ks->storage[ks->length], chars, n + 1);
+    ks->charsets[ks->length] = ks->storage[ks->length];
+    ks->radix[ks->length]    = (uint8_t)n;
+    ks->length++;
+
+    if (ks->mode != KEYSPACE_HYBRID)
+        ks->mode = KEYSPACE_MASK;
+
+    return 0;
+}
+
+int keyspace_load_wordlist(keyspace *ks, const char *path, uint64_t expected_lines, struct fsm_error *err)
+{
+    if (ks->mode != KEYSPACE_BRUTE_FORCE && ks->mode != KEYSPACE_HYBRID)
+    {
+        SET_ERROR(err, "Wordlist cannot be combined with a mask");
+        return -1;
+    }
+
+    if (ks->words.data)
+    {
+        SET_ERROR(err, "Only one wordlist can be loaded");
+        return -1;
+    }
+
+    if (wordlist_open(&ks->words, path, err) == -1)
+        return -1;
+
+    // Indices are line numbers, so both sides must agree on the file exactly.
+    if (ks->words.count != expected_lines)
+    {
+        char message[160];
+        snprintf(message, sizeof(message),
+                 "Local wordlist has %" PRIu64 " lines but the server's has %" PRIu64,
+                 ks->words.count, expected_lines);
+        SET_ERROR(err, message);
+        wordlist_close(&ks->words);
+        return -1;
+    }
+
+    if (ks->mode != KEYSPACE_HYBRID)
+        ks->mode = KEYSPACE_WORDLIST;
+
+    return 0;
+}
+
+// Must come before the mask positions and the wordlist in the job header.
+int keyspace_set_hybrid(keyspace *ks, bool prepend, bool mask_major, struct fsm_error *err)
+{
+    if (ks->mode != KEYSPACE_BRUTE_FORCE)
+    {
+        SET_ERROR(err, "Hybrid mode must be set before the mask or wordlist");
+        return -1;
+    }
+
+    ks->mode       = KEYSPACE_HYBRID;
+    ks->prepend    = prepend;
+    ks->mask_major = mask_major;
+
+    return 0;
+}
+
+int keyspace_load_markov(keyspace *ks, const char *path, size_t threshold, struct fsm_error *err)
+{
+    if (ks->markov_counts || ks->markov)
+    {
+        SET_ERROR(err, "Only one Markov statistics file can be loaded");
+        return -1;
+    }
+
+    if (markov_load(path, &ks->markov_counts, err) == -1)
+        return -1;
+
+    ks->markov_threshold = threshold;
+
+    return 0;
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Sorts every position's charset by how often each character followed the
+// previous one in training, ties in charset order. Only previous characters
+// the position before can produce get a row.
+static int markov_build(keyspace *ks, struct fsm_error *err)
+{
+    size_t positions = (ks->mode == KEYSPACE_MASK) ? ks->length : MARKOV_POSITIONS;
+    size_t stride    = 0;
+
+    if (ks->mode != KEYSPACE_BRUTE_FORCE && ks->mode != KEYSPACE_MASK)
+    {
+        SET_ERROR(err, "Markov ordering needs brute force or a mask");
+        return -1;
+    }
+
+    for (size_t i = 0; i < positions; i++)
+        stride = (ks->radix[i] > stride) ? ks->radix[i] : stride;
+
+    ks->markov = malloc(positions * 256 * stride);
+    if (!ks->markov)
+    {
+        SET_ERROR(err, "malloc failed (markov_build)");
+        return -1;
+    }
+
+    ks->markov_tables = positions;
+    ks->markov_stride = stride;
+
+    for (size_t i = 0; i < positions; i++)
+    {
+        const char *prevs = (i == 0) ? "" : ks->charsets[i - 1];
+        size_t      nprev = (i == 0) ? 1 : ks->radix[i - 1];
+
+        for (size_t p = 0; p < nprev; p++)
+        {
+            unsigned char prev = (unsigned char)prevs[p];
+            char         *row  = ks->markov + (i * 256 + prev) * stride;
+            uint64_t      keys[MAX_POSITION_CHARSET];
+
+            // Most frequent first: sort on (UINT32_MAX - count, charset index).
+            for (size_t d = 0; d < ks->radix[i]; d++)
+            {
+                uint32_t count = markov_count(ks->markov_counts, i, prev, (unsigned char)ks->charsets[i][d]);
+                keys[d]        = (uint64_t)(UINT32_MAX - count) << 8 | d;
+            }
+
+            qsort(keys, ks->radix[i], sizeof(keys[0]), compare_keys);
+
+            for (size_t d = 0; d < ks->radix[i]; d++)
+                row[d] = ks->charsets[i][keys[d] & 0xff];
+        }
+    }
+
+    free(ks->markov_counts);
+    ks->markov_counts = NULL;
+
+    // Pruning keeps only the most likely characters of every ordering.
+    if (ks->markov_threshold > 0)
+    {
+        size_t limit = (ks->mode == KEYSPACE_MASK) ? ks->length : MAX_CANDIDATE_LEN;
+
+        for (size_t i = 0; i < limit; i++)
+        {
+            if (ks->radix[i] > ks->markov_threshold)
+                ks->radix[i] = (uint8_t)ks->markov_threshold;
+        }
+    }
+
+    return 0;
+}
+
+int keyspace_finalize(keyspace *ks, struct fsm_error *err)
+{
+    if (ks->markov_counts && markov_build(ks, err) == -1)
+        return -1;
+
+    if (ks->mode == KEYSPACE_BRUTE_FORCE)
+    {
+        ks->size = UINT64_MAX;
+        return 0;
+    }
+
+    if (ks->rules.count > 0 && ks->mode != KEYSPACE_WORDLIST)
+    {
+        SET_ERROR(err, "Rules need a wordlist");
+        return -1;
+    }
+
+    if (ks->mode == KEYSPACE_WORDLIST)
+    {
+        if (ks->rules.count > 0 && ks->words.count > UINT64_MAX / ks->rules.count)
+        {
+            SET_ERROR(err, "Wordlist x rules keyspace does not fit in 64 bits");
+            return -1;
+        }
+
+        ks->size = ks->words.count * ((ks->rules.count > 0) ? ks->rules.count : 1);
+        return 0;
+    }
+
+    if (ks->mode == KEYSPACE_HYBRID && (ks->length == 0 || !ks->words.data))
+    {
+        SET_ERROR(err, "Hybrid mode needs both a mask and a wordlist");
+        return -1;
+    }
+
+    // Mixed-radix place values, rightmost position fastest.
+    uint64_t weight = 1;
+
+    for (size_t i = ks->length; i > 0; i--)
+    {
+        ks->place[i - 1] = weight;
+
+        if (weight > UINT64_MAX / ks->radix[i - 1])
+        {
+            SET_ERROR(err, "Mask keyspace does not fit in 64 bits");
+            return -1;
+        }
+
+        weight *= ks->radix[i - 1];
+    }
+
+    ks->mask_size = weight;
+    ks->size      = weight;
+
+    if (ks->mode == KEYSPACE_HYBRID)
+    {
+        if (ks->words.count > UINT64_MAX / weight)
+        {
+            SET_ERROR(err, "Wordlist x mask keyspace does not fit in 64 bits");
+            return -1;
+        }
+
+        ks->size = ks->words.count * weight;
+    }
+
+    return 0;
+}
+
+int keyspace_add_rule(keyspace *ks, const char *text, struct fsm_error *err)
+{
+    return rule_set_add(&ks->rules, text, err);
+}
+
+void keyspace_free(keyspace *ks)
+{
+    if (ks->words.data)
+        wordlist_close(&ks->words);
+
+    rule_set_free(&ks->rules);
+    free(ks->markov_counts);
+    free(ks->markov);
+}
+
+static int brute_force_seek(candidate_gen *gen, uint64_t index)
+{
+    const keyspace *ks    = gen->ks;
+    uint64_t        radix = ks->radix[0];
+    size_t          len   = 1;
+    uint64_t        range = radix;
+    uint64_t        total = range;
+
+    while (index >= total)
+    {
+        if (range > UINT64_MAX / radix || len == MAX_CANDIDATE_LEN)
+            return -1;
+
+        len++;
+        range *= radix;
+        total += range;
+    }
+
+    uint64_t local_index = index - (total - range);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        gen->digits[len - i - 1] = (uint8_t)(local_index % radix);
+        local_index /= radix;
+    }
+
+    for (size_t i = 0; i < len; i++)
+        gen->buf[i] = position_char(ks, i, (i > 0) ? gen->buf[i - 1] : '\0', gen->digits[i]);
+
+    gen->len      = len;
+    gen->buf[len] = '\0';
+
+    return 0;
+}
+
+static int mask_seek(candidate_gen *gen, uint64_t index)
+{
+    const keyspace *ks = gen->ks;
+
+    if (index >= ks->size)
+        return -1;
+
+    for (size_t i = 0; i < ks->length; i++)
+    {
+        uint8_t digit = (uint8_t)((index / ks->place[i]) % ks->radix[i]);
+
+        gen->digits[i] = digit;
+        gen->buf[i]    = position_char(ks, i, (i > 0) ? gen->buf[i - 1] : '\0', digit);
+    }
+
+    gen->len             = ks->length;
+    gen->buf[ks->length] = '\0';
+
+    return 0;
+}
+
+static int wordlist_load_line(candidate_gen *gen)
+{
+    const keyspace *ks = gen->ks;
+    size_t          len;
+    const char     *line     = wordlist_line(&ks->words, gen->line, &len);
+    bool            overlong = len > MAX_CANDIDATE_LEN;
+
+    if (overlong)
+        len = 0;
+
+    if (ks->rules.count == 0)
+    {
+        memcpy(gen->buf, line, len);
+        gen->buf[len] = '\0';
+        gen->len      = len;
+        gen->skip     = overlong;
+
+        return 0;
+    }
+
+    // Keep the unmangled word so every rule starts from it.
+    memcpy(gen->word, line, len);
+    gen->word_len  = len;
+    gen->word_skip = overlong;
+
+    return wordlist_apply_rule(gen);
+}
+
+static int wordlist_apply_rule(candidate_gen *gen)
+{
+    size_t len = gen->word_len;
+
+    memcpy(gen->buf, gen->word, len);
+    gen->skip = gen->word_skip || rule_apply(&gen->ks->rules, gen->rule, gen->buf, &len, MAX_CANDIDATE_LEN) == -1;
+
+    gen->buf[len] = '\0';
+    gen->len      = len;
+
+    return 0;
+}
+
+// Steps digits[] like an odometer over the first ks->length positions and
+// writes the changed characters to out. Returns false once every position wrapped.
+static bool odometer_step(candidate_gen *gen, char *out)
+{
+    const keyspace *ks = gen->ks;
+    size_t          n  = (ks->mode == KEYSPACE_HYBRID) ? ks->length : gen->len;
+    size_t          i  = n;
+    bool            stepped = false;
+
+    while (i > 0)
+    {
+        i--;
+
+        if (++gen->digits[i] < ks->radix[i])
+        {
+            stepped = true;
+            break;
+        }
+
+        gen->digits[i] = 0;
+    }
+
+    // A Markov ordering depends on the previous character, so everything
+    // right of the changed position is rewritten, not just the wrapped digits.
+    for (size_t j = i; j < n; j++)
+        out[j] = position_char(ks, j, (j > 0) ? out[j - 1] : '\0', gen->digits[j]);
+
+    return stepped;
+}
+
+// Places the current line next to the mask characters in digits[]. A word
+// too long to fit beside the mask marks the candidate as skipped.
+static void hybrid_load_word(candidate_gen *gen, bool write_mask)
+{
+    const keyspace *ks = gen->ks;
+    size_t          len;
+    const char     *line = wordlist_line(&ks->words, gen->line, &len);
+    size_t          word_off;
+    size_t          mask_off;
+
+    gen->skip = len > MAX_CANDIDATE_LEN - ks->length;
+    if (gen->skip)
+        len = 0;
+
+    word_off      = ks->prepend ? ks->length : 0;
+    mask_off      = ks->prepend ? 0 : len;
+    gen->word_len = len;
+
+    memcpy(gen->buf + word_off, line, len);
+
+    // Appended masks move with the word; a prepended mask stays put.
+    if (write_mask || !ks->prepend)
+    {
+        for (size_t i = 0; i < ks->length; i++)
+            gen->buf[mask_off + i] = ks->charsets[i][gen->digits[i]];
+    }
+
+    gen->len           = len + ks->length;
+    gen->buf[gen->len] = '\0';
+}
+
+static int hybrid_seek(candidate_gen *gen, uint64_t index)
+{
+    const keyspace *ks = gen->ks;
+    uint64_t        mask_index;
+
+    if (index >= ks->size)
+        return -1;
+
+    if (ks->mask_major)
+    {
+        mask_index = index / ks->words.count;
+        gen->line  = index % ks->words.count;
+    }
+    else
+    {
+        gen->line  = index / ks->mask_size;
+        mask_index = index % ks->mask_size;
+    }
+
+    for (size_t i = 0; i < ks->length; i++)
+        gen->digits[i] = (uint8_t)((mask_index / ks->place[i]) % ks->radix[i]);
+
+    hybrid_load_word(gen, true);
+
+    return 0;
+}
+
+static int hybrid_next(candidate_gen *gen)
+{
+    const keyspace *ks = gen->ks;
+
+    if (!ks->mask_major)
+    {
+        // The word is already in place, only the mask characters change.
+        if (odometer_step(gen, gen->buf + (ks->prepend ? 0 : gen->word_len)))
+            return 0;
+
+        if (++gen->line >= ks->words.count)
+            return -1;
+
+        hybrid_load_word(gen, false);
+
+        return 0;
+    }
+
+    if (++gen->line < ks->words.count)
+    {
+        hybrid_load_word(gen, false);
+        return 0;
+    }
+
+    gen->line = 0;
+
+    for (size_t i = ks->length; i > 0; i--)
+    {
+        if (++gen->digits[i - 1] < ks->radix[i - 1])
+        {
+            hybrid_load_word(gen, true);
+            return 0;
+        }
+        gen->digits[i - 1] = 0;
+    }
+
+    return -1;
+}
+
+int candidate_gen_seek(candidate_gen *gen, const keyspace *ks, uint64_t index)
+{
+    gen->ks   = ks;
+    gen->skip = false;
+
+    switch (ks->mode)
+    {
+        case KEYSPACE_MASK:
+            return mask_seek(gen, index);
+        case KEYSPACE_WORDLIST:
+            if (index >= ks->size)
+                return -1;
+            gen->line = (ks->rules.count > 0) ? index / ks->rules.count : index;
+            gen->rule = (ks->rules.count > 0) ? index % ks->rules.count : 0;
+            return wordlist_load_line(gen);
+        case KEYSPACE_HYBRID:
+            return hybrid_seek(gen, index);
+        case KEYSPACE_BRUTE_FORCE:
+        default:
+            return brute_force_seek(gen, index);
+    }
+}
+
+int candidate_gen_next(candidate_gen *gen)
+{
+    const keyspace *ks = gen->ks;
+
+    if (ks->mode == KEYSPACE_HYBRID)
+        return hybrid_next(gen);
+
+    if (ks->mode == KEYSPACE_WORDLIST)
+    {
+        if (++gen->rule < ks->rules.count)
+            return wordlist_apply_rule(gen);
+
+        gen->rule = 0;
+        if (++gen->line >= ks->words.count)
+            return -1;
+        return wordlist_load_line(gen);
+    }
+
+    if (odometer_step(gen, gen->buf))
+        return 0;
+
+    // Every position wrapped. A mask is exhausted; brute force rolls over to
+    // the first candidate one character longer.
+    if (ks->mode == KEYSPACE_MASK || gen->len == MAX_CANDIDATE_LEN)
+        return -1;
+
+    gen->digits[gen->len] = 0;
+    gen->buf[gen->len]    = position_char(ks, gen->len, gen->buf[gen->len - 1], 0);
+    gen->len++;
+    gen->buf[gen->len] = '\0';
+
+    return 0;
+}
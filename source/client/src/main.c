@@ -1,6 +1,7 @@
 #include "command_line.h"
 #include "cracker.h"
 #include "fsm.h"
+#include "rainbow.h"
 #include "server_config.h"
 #include <bits/time.h>
 #include <pthread.h>
@@ -16,7 +17,9 @@ enum main_application_states
     STATE_CONVERT_ADDRESS,
     STATE_CREATE_SOCKET,
     STATE_CONNECT_SOCKET,
+    STATE_HANDSHAKE,
     STATE_WAIT_HASH,
+    STATE_CREATE_POOL,
     STATE_WAIT_WORK,
     STATE_START_TIMER,
     STATE_START_CRACKING,
@@ -31,7 +34,9 @@ static int handle_arguments_handler(struct fsm_context *context, struct fsm_erro
 static int convert_address_handler(struct fsm_context *context, struct fsm_error *err);
 static int create_socket_handler(struct fsm_context *context, struct fsm_error *err);
 static int connect_socket_handler(struct fsm_context *context, struct fsm_error *err);
+static int handshake_handler(struct fsm_context *context, struct fsm_error *err);
 static int wait_hash_handler(struct fsm_context *context, struct fsm_error *err);
+static int create_pool_handler(struct fsm_context *context, struct fsm_error *err);
 static int wait_work_handler(struct fsm_context *context, struct fsm_error *err);
 static int start_timer_handler(struct fsm_context *context, struct fsm_error *err);
 static int start_cracking_handler(struct fsm_context *context, struct fsm_error *err);
@@ -53,6 +58,7 @@ int main(int argc, char **argv)
         .threads       = 0,
         .timer_started = 0,
         .ws            = NULL,
+        .pool          = NULL,
     };
     struct fsm_context context = {
         .argc = argc,
@@ -67,8 +73,10 @@ int main(int argc, char **argv)
         {STATE_HANDLE_ARGUMENTS, STATE_CONVERT_ADDRESS,  convert_address_handler },
         {STATE_CONVERT_ADDRESS,  STATE_CREATE_SOCKET,    create_socket_handler   },
         {STATE_CREATE_SOCKET,    STATE_CONNECT_SOCKET,   connect_socket_handler  },
-        {STATE_CONNECT_SOCKET,   STATE_WAIT_HASH,        wait_hash_handler       },
-        {STATE_WAIT_HASH,        STATE_WAIT_WORK,        wait_work_handler       },
+        {STATE_CONNECT_SOCKET,   STATE_HANDSHAKE,        handshake_handler       },
+        {STATE_HANDSHAKE,        STATE_WAIT_HASH,        wait_hash_handler       },
+        {STATE_WAIT_HASH,        STATE_CREATE_POOL,      create_pool_handler     },
+        {STATE_CREATE_POOL,      STATE_WAIT_WORK,        wait_work_handler       },
         {STATE_WAIT_WORK,        STATE_START_TIMER,      start_timer_handler     },
         {STATE_WAIT_WORK,        STATE_START_CRACKING,   start_cracking_handler  },
         {STATE_WAIT_WORK,        STATE_CLEANUP,          cleanup_handler         },
@@ -83,7 +91,9 @@ int main(int argc, char **argv)
         {STATE_CONVERT_ADDRESS,  STATE_ERROR,            error_handler           },
         {STATE_CREATE_SOCKET,    STATE_ERROR,            error_handler           },
         {STATE_CONNECT_SOCKET,   STATE_ERROR,            error_handler           },
+        {STATE_HANDSHAKE,        STATE_ERROR,            error_handler           },
         {STATE_WAIT_HASH,        STATE_ERROR,            error_handler           },
+        {STATE_CREATE_POOL,      STATE_ERROR,            error_handler           },
         {STATE_WAIT_WORK,        STATE_ERROR,            error_handler           },
         {STATE_START_TIMER,      STATE_ERROR,            error_handler           },
         {STATE_START_CRACKING,   STATE_ERROR,            error_handler           },
@@ -92,6 +102,7 @@ int main(int argc, char **argv)
         {STATE_CLEANUP,          FSM_EXIT,               NULL                    },
     };
     ignore_sigpipe();
+    fsm_error_init(&err);
     fsm_run(&context, &err, transitions);
 
     return 0;
@@ -159,6 +170,19 @@ static int connect_socket_handler(struct fsm_context *context, struct fsm_error
         return STATE_ERROR;
     }
 
+    return STATE_HANDSHAKE;
+}
+
+static int handshake_handler(struct fsm_context *context, struct fsm_error *err)
+{
+    struct fsm_context *ctx;
+    ctx = context;
+    SET_TRACE(context, "in handshake", "STATE_HANDSHAKE");
+    if (handshake(ctx->args->ws->sockfd, ctx->args->ws, err) == -1)
+    {
+        return STATE_ERROR;
+    }
+
     return STATE_WAIT_HASH;
 }
 
@@ -172,6 +196,20 @@ static int wait_hash_handler(struct fsm_context *context, struct fsm_error *err)
         return STATE_ERROR;
     }
 
+    return STATE_CREATE_POOL;
+}
+
+static int create_pool_handler(struct fsm_context *context, struct fsm_error *err)
+{
+    struct fsm_context *ctx;
+    ctx = context;
+    SET_TRACE(context, "in create pool", "STATE_CREATE_POOL");
+    ctx->args->pool = pool_create(ctx->args->threads, ctx->args->ws, err);
+    if (ctx->args->pool == NULL)
+    {
+        return STATE_ERROR;
+    }
+
     return STATE_WAIT_WORK;
 }
 
@@ -212,7 +250,7 @@ static int start_cracking_handler(struct fsm_context *context, struct fsm_error
     struct fsm_context *ctx;
     ctx = context;
     SET_TRACE(context, "in start cracking", "STATE_START_CRACKING");
-    if (create_threads(ctx->args->threads, ctx->args->ws) == -1)
+    if (pool_run(ctx->args->pool) == -1)
     {
         return STATE_SEND_DONE;
     }
@@ -225,7 +263,7 @@ static int send_done_handler(struct fsm_context *context, struct fsm_error *err)
     struct fsm_context *ctx;
     ctx = context;
     SET_TRACE(context, "in send done", "STATE_SEND_DONE");
-    if (send_done(ctx->args->ws->sockfd, err) == -1)
+    if (send_done(ctx->args->ws, err) == -1)
     {
         return STATE_ERROR;
     }
@@ -267,9 +305,28 @@ static int cleanup_handler(struct fsm_context *context, struct fsm_error *err)
 
     fsm_error_clear(err);
 
+    pool_destroy(ctx->args->pool);
+
     if (ctx->args->ws)
-        if (ctx->args->ws->hash)
-            free(ctx->args->ws->hash);
+    {
+        for (size_t i = 0; i < ctx->args->ws->num_targets; i++)
+            free(ctx->args->ws->hashes[i]);
+        for (size_t i = 0; i < ctx->args->ws->num_groups; i++)
+        {
+            free(ctx->args->ws->groups[i].digests);
+            free(ctx->args->ws->groups[i].members);
+            digest_index_free(&ctx->args->ws->groups[i].index);
+        }
+        free(ctx->args->ws->groups);
+        free(ctx->args->ws->hashes);
+        free(ctx->args->ws->cracked);
+        if (ctx->args->ws->keyspace)
+            keyspace_free(ctx->args->ws->keyspace);
+        free(ctx->args->ws->keyspace);
+        if (ctx->args->ws->rainbow)
+            rainbow_close(ctx->args->ws->rainbow);
+        free(ctx->args->ws->rainbow);
+    }
 
     free(ctx->args->ws);
 
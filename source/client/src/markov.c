@@ -0,0 +1,62 @@
+#include "markov.h"
+#include "fsm.h"
+#include <errno.h>
+#include <stdio.h>
+
+int markov_load(const char *path, uint32_t **counts, struct fsm_error *err)
+{
+    FILE          *file;
+    char           magic[MARKOV_MAGIC_LEN];
+    unsigned char *raw;
+
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, MARKOV_MAGIC, MARKOV_MAGIC_LEN) != 0)
+    {
+        SET_ERROR(err, "Not a Markov statistics file");
+        fclose(file);
+        return -1;
+    }
+
+    raw     = malloc(MARKOV_COUNTS * 4);
+    *counts = malloc(MARKOV_COUNTS * sizeof(uint32_t));
+    if (!raw || !*counts)
+    {
+        SET_ERROR(err, "malloc failed (markov_load)");
+        free(raw);
+        free(*counts);
+        *counts = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    if (fread(raw, 4, MARKOV_COUNTS, file) != MARKOV_COUNTS)
+    {
+        SET_ERROR(err, "Markov statistics file is truncated");
+        free(raw);
+        free(*counts);
+        *counts = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+
+    for (size_t i = 0; i < MARKOV_COUNTS; i++)
+    {
+        const unsigned char *b = raw + i * 4;
+
+        (*counts)[i] = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+    }
+
+    free(raw);
+
+    printf("[WORKER] Loaded Markov statistics %s\n", path);
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "md5.h"
+#include <string.h>
+
+static void md5_compress(uint32_t h[4], const uint8_t block[64]);
+
+const uint32_t md5_iv[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+static inline uint32_t rol32(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_STEP(fn, a, b, c, d, x, t, s) a = b + rol32(a + MD5_##fn(b, c, d) + w[x] + (t), s);
+
+static void md5_compress(uint32_t h[4], const uint8_t block[64])
+{
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = load_le32(block + i * 4);
+
+    MD5_STEPS(MD5_STEP)
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+void md5_init(md5_ctx *ctx)
+{
+    memcpy(ctx->h, md5_iv, sizeof(md5_iv));
+    ctx->len  = 0;
+    ctx->used = 0;
+}
+
+void md5_update(md5_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    ctx->len += len;
+
+    if (ctx->used > 0)
+    {
+        size_t take = (len < 64 - ctx->used) ? len : 64 - ctx->used;
+
+        memcpy(ctx->buf + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+
+        if (ctx->used < 64)
+            return;
+
+        md5_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    for (; len >= 64; p += 64, len -= 64)
+        md5_compress(ctx->h, p);
+
+    memcpy(ctx->buf, p, len);
+    ctx->used = len;
+}
+
+void md5_final(md5_ctx *ctx, uint8_t out[MD5_DIGEST_LEN])
+{
+    uint64_t bits = ctx->len * 8;
+
+    ctx->buf[ctx->used++] = 0x80;
+
+    if (ctx->used > 56)
+    {
+        memset(ctx->buf + ctx->used, 0, 64 - ctx->used);
+        md5_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    memset(ctx->buf + ctx->used, 0, 56 - ctx->used);
+    store_le32(ctx->buf + 56, (uint32_t)bits);
+    store_le32(ctx->buf + 60, (uint32_t)(bits >> 32));
+    md5_compress(ctx->h, ctx->buf);
+
+    for (int i = 0; i < 4; i++)
+        store_le32(out + i * 4, ctx->h[i]);
+}
@@ -0,0 +1,78 @@
+#include "md5_crypt.h"
+#include <string.h>
+
+// MD5-crypt (Kamp's scheme) and its Apache variant, computed directly on raw
+// digests. crypt_r() only knows $1$, so this is also the only way $apr1$
+// hashes get checked at all.
+const hash_engine md5_crypt_engine = {"md5-crypt", 1, md5_crypt_check, NULL, NULL};
+
+void md5_crypt_prepare(const hash_target *target, const char *key, size_t key_len, uint8_t a[MD5_DIGEST_LEN])
+{
+    static const uint8_t zero  = 0;
+    const char          *magic = (target->scheme == HASH_SCHEME_APR1) ? "$apr1$" : "$1$";
+    md5_ctx              ctx;
+    uint8_t              b[MD5_DIGEST_LEN];
+    size_t               cnt;
+
+    // B = MD5(key salt key)
+    md5_init(&ctx);
+    md5_update(&ctx, key, key_len);
+    md5_update(&ctx, target->salt, target->salt_len);
+    md5_update(&ctx, key, key_len);
+    md5_final(&ctx, b);
+
+    // A = MD5(key magic salt, B stretched to the key length, one byte per bit of the length)
+    md5_init(&ctx);
+    md5_update(&ctx, key, key_len);
+    md5_update(&ctx, magic, strlen(magic));
+    md5_update(&ctx, target->salt, target->salt_len);
+
+    for (cnt = key_len; cnt > MD5_DIGEST_LEN; cnt -= MD5_DIGEST_LEN)
+        md5_update(&ctx, b, MD5_DIGEST_LEN);
+    md5_update(&ctx, b, cnt);
+
+    for (cnt = key_len; cnt > 0; cnt >>= 1)
+        md5_update(&ctx, (cnt & 1) ? (const void *)&zero : (const void *)key, 1);
+
+    md5_final(&ctx, a);
+}
+
+void md5_crypt_rounds(const hash_target *target, const char *key, size_t key_len, uint8_t a[MD5_DIGEST_LEN])
+{
+    md5_ctx ctx;
+
+    for (uint32_t round = 0; round < target->cost; round++)
+    {
+        md5_init(&ctx);
+
+        if (round & 1)
+            md5_update(&ctx, key, key_len);
+        else
+            md5_update(&ctx, a, MD5_DIGEST_LEN);
+
+        if (round % 3 != 0)
+            md5_update(&ctx, target->salt, target->salt_len);
+
+        if (round % 7 != 0)
+            md5_update(&ctx, key, key_len);
+
+        if (round & 1)
+            md5_update(&ctx, a, MD5_DIGEST_LEN);
+        else
+            md5_update(&ctx, key, key_len);
+
+        md5_final(&ctx, a);
+    }
+}
+
+bool md5_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    uint8_t a[MD5_DIGEST_LEN];
+
+    (void)scratch;
+
+    md5_crypt_prepare(target, key, key_len, a);
+    md5_crypt_rounds(target, key, key_len, a);
+
+    return hash_digest_match(target, a);
+}
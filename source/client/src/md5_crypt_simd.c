@@ -0,0 +1,165 @@
+#include "md5_crypt.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+typedef void (*md5_crypt_kernel)(const hash_target *target, md5_crypt_state *st, size_t n, bool *match);
+
+// The same kernel source built for each instruction set; the function
+// attributes keep the rest of the program free of AVX.
+void md5_crypt_x8_avx2(const hash_target *target, md5_crypt_state *st, size_t n, bool *match);
+void md5_crypt_x16_avx512(const hash_target *target, md5_crypt_state *st, size_t n, bool *match);
+
+    #define MD5_LANES 8
+    #define MD5_TARGET "avx2"
+    #define MD5_NAME md5_crypt_x8_avx2
+    #include "md5_crypt_lanes.h"
+    #undef MD5_LANES
+    #undef MD5_TARGET
+    #undef MD5_NAME
+
+    #define MD5_LANES 16
+    #define MD5_TARGET "avx512f"
+    #define MD5_NAME md5_crypt_x16_avx512
+    #include "md5_crypt_lanes.h"
+    #undef MD5_LANES
+    #undef MD5_TARGET
+    #undef MD5_NAME
+
+static int  simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch, md5_crypt_kernel kernel, size_t lanes);
+static int  avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch);
+static int  avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                         hash_scratch *scratch);
+static bool self_test(const hash_target *target, md5_crypt_kernel kernel, size_t lanes);
+
+static const hash_engine md5_avx2_engine   = {"md5-crypt/avx2x8", 8, md5_crypt_check, avx2_batch, NULL};
+static const hash_engine md5_avx512_engine = {"md5-crypt/avx512x16", 16, md5_crypt_check, avx512_batch, NULL};
+
+static int simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch, md5_crypt_kernel kernel, size_t lanes)
+{
+    md5_crypt_state st[MD5_CRYPT_MAX_LANES];
+    size_t          index[MD5_CRYPT_MAX_LANES];
+    bool            match[MD5_CRYPT_MAX_LANES];
+    size_t          m = 0;
+
+    for (size_t i = 0; i < n && i < lanes; i++)
+    {
+        // Keys too long for the fixed message buffers take the scalar path.
+        if (key_lens[i] > MD5_CRYPT_SIMD_MAX_KEY)
+        {
+            if (md5_crypt_check(target, keys[i], key_lens[i], scratch))
+                return (int)i;
+            continue;
+        }
+
+        memcpy(st[m].key, keys[i], key_lens[i]);
+        st[m].key_len = key_lens[i];
+        md5_crypt_prepare(target, keys[i], key_lens[i], st[m].a);
+        index[m++] = i;
+    }
+
+    if (m == 0)
+        return -1;
+
+    kernel(target, st, m, match);
+
+    for (size_t i = 0; i < m; i++)
+    {
+        if (match[i])
+            return (int)index[i];
+    }
+
+    return -1;
+}
+
+static int avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, md5_crypt_x8_avx2, 8);
+}
+
+static int avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                        hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, md5_crypt_x16_avx512, 16);
+}
+
+// A short round count with the job's salt and magic, on key lengths that
+// cover one- to three-block messages; every lane has to match the scalar code.
+static bool self_test(const hash_target *target, md5_crypt_kernel kernel, size_t lanes)
+{
+    hash_target     probe = *target;
+    md5_crypt_state simd[MD5_CRYPT_MAX_LANES];
+    uint8_t         scalar[MD5_DIGEST_LEN];
+    bool            match[MD5_CRYPT_MAX_LANES];
+
+    probe.cost = 42;
+
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        for (size_t l = 0; l < lanes; l++)
+        {
+            md5_crypt_state *st = &simd[l];
+
+            st->key_len = (pass * lanes + l) * 29 % (MD5_CRYPT_SIMD_MAX_KEY + 1);
+            for (size_t i = 0; i < st->key_len; i++)
+                st->key[i] = (uint8_t)('!' + (l * 7 + i * 13) % 94);
+
+            md5_crypt_prepare(&probe, (const char *)st->key, st->key_len, st->a);
+        }
+
+        kernel(&probe, simd, lanes, match);
+
+        for (size_t l = 0; l < lanes; l++)
+        {
+            md5_crypt_prepare(&probe, (const char *)simd[l].key, simd[l].key_len, scalar);
+            md5_crypt_rounds(&probe, (const char *)simd[l].key, simd[l].key_len, scalar);
+
+            if (memcmp(scalar, simd[l].a, MD5_DIGEST_LEN) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+const hash_engine *md5_crypt_select_engine(const hash_target *target)
+{
+    const hash_engine *engine = NULL;
+    md5_crypt_kernel   kernel = NULL;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        engine = &md5_avx512_engine;
+        kernel = md5_crypt_x16_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        engine = &md5_avx2_engine;
+        kernel = md5_crypt_x8_avx2;
+    }
+
+    if (engine && self_test(target, kernel, engine->lanes))
+        return engine;
+
+    if (engine)
+        fprintf(stderr, "[WORKER] %s failed its self-test, using the scalar engine\n", engine->name);
+
+    return &md5_crypt_engine;
+}
+
+#else
+
+const hash_engine *md5_crypt_select_engine(const hash_target *target)
+{
+    (void)target;
+    return &md5_crypt_engine;
+}
+
+#endif
@@ -0,0 +1,275 @@
+#include "rainbow.h"
+#include "raw_hash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct rainbow_scheme
+{
+    const char *name;
+    hash_scheme scheme;
+    size_t      digest_len;
+} rainbow_scheme;
+
+static const rainbow_scheme rainbow_schemes[] = {
+    {"md5",    HASH_SCHEME_RAW_MD5,    16},
+    {"sha1",   HASH_SCHEME_RAW_SHA1,   20},
+    {"sha256", HASH_SCHEME_RAW_SHA256, 32},
+    {"ntlm",   HASH_SCHEME_NTLM,       16},
+};
+
+static int      set_scheme(rainbow_table *table, const char *name, struct fsm_error *err);
+static bool     header_line(const char **p, const char *end, const char *key, char *value, size_t cap);
+static int      parse_header(rainbow_table *table, keyspace *ks, struct fsm_error *err);
+static uint64_t reduce(const uint8_t *digest, uint64_t column, uint64_t size);
+static uint64_t walk(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, uint64_t index,
+                     uint64_t from, uint64_t to);
+
+static int set_scheme(rainbow_table *table, const char *name, struct fsm_error *err)
+{
+    for (size_t i = 0; i < sizeof(rainbow_schemes) / sizeof(rainbow_schemes[0]); i++)
+    {
+        if (strcmp(name, rainbow_schemes[i].name) == 0)
+        {
+            table->probe.scheme     = rainbow_schemes[i].scheme;
+            table->probe.digest_len = rainbow_schemes[i].digest_len;
+            return 0;
+        }
+    }
+
+    SET_ERROR(err, "Unknown rainbow table scheme");
+    return -1;
+}
+
+// Copies the rest of the next header line into value if it starts with key.
+static bool header_line(const char **p, const char *end, const char *key, char *value, size_t cap)
+{
+    size_t      key_len = strlen(key);
+    const char *newline = memchr(*p, '\n', (size_t)(end - *p));
+    size_t      len;
+
+    if (!newline || (size_t)(newline - *p) < key_len || memcmp(*p, key, key_len) != 0)
+        return false;
+
+    len = (size_t)(newline - *p) - key_len;
+    if (len >= cap)
+        return false;
+
+    memcpy(value, *p + key_len, len);
+    value[len] = '\0';
+    *p         = newline + 1;
+
+    return true;
+}
+
+static int parse_header(rainbow_table *table, keyspace *ks, struct fsm_error *err)
+{
+    const char *p   = table->map;
+    const char *end = table->map + table->map_len;
+    char        value[MAX_POSITION_CHARSET + 1];
+    size_t      offset;
+
+    if (table->map_len < strlen(RAINBOW_MAGIC) || memcmp(p, RAINBOW_MAGIC, strlen(RAINBOW_MAGIC)) != 0)
+    {
+        SET_ERROR(err, "Not a rainbow table");
+        return -1;
+    }
+
+    p += strlen(RAINBOW_MAGIC);
+
+    if (!header_line(&p, end, "SCHEME ", value, sizeof(value)) || set_scheme(table, value, err) == -1)
+    {
+        SET_ERROR(err, "Rainbow table has no valid SCHEME line");
+        return -1;
+    }
+
+    if (!header_line(&p, end, "CHAIN_LEN ", value, sizeof(value)) ||
+        (table->chain_len = strtoull(value, NULL, 10)) == 0 || !header_line(&p, end, "CHAINS ", value, sizeof(value)))
+    {
+        SET_ERROR(err, "Rainbow table has no valid chain sizes");
+        return -1;
+    }
+
+    table->num_chains = strtoull(value, NULL, 10);
+
+    while (header_line(&p, end, "POS ", value, sizeof(value)))
+    {
+        if (keyspace_add_position(ks, value, err) == -1)
+            return -1;
+        table->positions++;
+    }
+
+    if (!header_line(&p, end, "END", value, sizeof(value)) || value[0] != '\0' || table->positions == 0)
+    {
+        SET_ERROR(err, "Rainbow table header is malformed");
+        return -1;
+    }
+
+    offset = (size_t)(p - table->map);
+    offset = (offset + RAINBOW_ALIGN - 1) / RAINBOW_ALIGN * RAINBOW_ALIGN;
+
+    if (offset > table->map_len || (table->map_len - offset) / sizeof(rainbow_entry) < table->num_chains)
+    {
+        SET_ERROR(err, "Rainbow table is truncated");
+        return -1;
+    }
+
+    table->entries = (const rainbow_entry *)(const void *)(table->map + offset);
+
+    return 0;
+}
+
+int rainbow_build_init(rainbow_table *table, const char *scheme, uint64_t chain_len, struct fsm_error *err)
+{
+    memset(table, 0, sizeof(*table));
+    table->build     = true;
+    table->chain_len = chain_len;
+
+    if (chain_len == 0)
+    {
+        SET_ERROR(err, "Rainbow chains need at least one link");
+        return -1;
+    }
+
+    return set_scheme(table, scheme, err);
+}
+
+int rainbow_open(rainbow_table *table, keyspace *ks, const char *path, uint64_t expected_chains,
+                 struct fsm_error *err)
+{
+    struct stat st;
+    int         fd;
+
+    memset(table, 0, sizeof(*table));
+
+    if (ks->length > 0)
+    {
+        SET_ERROR(err, "A rainbow table cannot be combined with a mask");
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    table->map_len = (size_t)st.st_size;
+    table->map     = (table->map_len > 0) ? mmap(NULL, table->map_len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (table->map == MAP_FAILED)
+    {
+        table->map = NULL;
+        SET_ERROR(err, (table->map_len > 0) ? strerror(errno) : "Rainbow table is empty");
+        return -1;
+    }
+
+    if (parse_header(table, ks, err) == -1)
+    {
+        rainbow_close(table);
+        return -1;
+    }
+
+    if (table->num_chains != expected_chains)
+    {
+        SET_ERROR(err, "Rainbow table differs from the server's");
+        rainbow_close(table);
+        return -1;
+    }
+
+    // Every lookup binary-searches the entries, so read-ahead would only
+    // pull in pages nobody asked for.
+    madvise(table->map, table->map_len, MADV_RANDOM);
+
+    printf("[WORKER] Loaded rainbow table %s: %" PRIu64 " chains of length %" PRIu64 "\n", path, table->num_chains,
+           table->chain_len);
+
+    return 0;
+}
+
+void rainbow_close(rainbow_table *table)
+{
+    if (table->map)
+        munmap(table->map, table->map_len);
+
+    memset(table, 0, sizeof(*table));
+}
+
+// The leading eight bytes, loaded little-endian, plus the column: the same
+// digest reduces to a different index in every column, which keeps chains
+// that collide in different columns from merging.
+static uint64_t reduce(const uint8_t *digest, uint64_t column, uint64_t size)
+{
+    uint64_t h;
+
+    memcpy(&h, digest, sizeof(h));
+
+    return (h + column) % size;
+}
+
+// Follows a chain through columns [from, to) from index, returning the index it reaches.
+static uint64_t walk(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, uint64_t index,
+                     uint64_t from, uint64_t to)
+{
+    uint8_t digest[HASH_MAX_DIGEST];
+
+    for (uint64_t column = from; column < to; column++)
+    {
+        candidate_gen_seek(gen, ks, index);
+        raw_hash_digest(&table->probe, gen->buf, gen->len, digest);
+        index = reduce(digest, column, ks->size);
+    }
+
+    return index;
+}
+
+uint64_t rainbow_chain_end(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, uint64_t start)
+{
+    return walk(table, gen, ks, start, 0, table->chain_len);
+}
+
+bool rainbow_lookup(const rainbow_table *table, candidate_gen *gen, const keyspace *ks, const uint8_t *digest,
+                    uint64_t column)
+{
+    uint64_t end = walk(table, gen, ks, reduce(digest, column, ks->size), column + 1, table->chain_len);
+    size_t   lo  = 0;
+    size_t   hi  = table->num_chains;
+    uint8_t  computed[HASH_MAX_DIGEST];
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (table->entries[mid].end < end)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // Most chains that end here only merged with the digest's path later
+    // on; regenerating the column tells a real hit from a false alarm.
+    for (; lo < table->num_chains && table->entries[lo].end == end; lo++)
+    {
+        uint64_t index = walk(table, gen, ks, table->entries[lo].start, 0, column);
+
+        candidate_gen_seek(gen, ks, index);
+        raw_hash_digest(&table->probe, gen->buf, gen->len, computed);
+
+        if (memcmp(computed, digest, table->probe.digest_len) == 0)
+            return true;
+    }
+
+    return false;
+}
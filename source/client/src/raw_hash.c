@@ -0,0 +1,395 @@
+#include "md4.h"
+#include "md5.h"
+#include "raw_hash.h"
+#include "sha1.h"
+#include "sha2.h"
+#include <string.h>
+
+#define RAW_MD5_K(fn, a, b, c, d, x, t, s) t,
+
+static size_t ntlm_utf16(const char *key, size_t key_len, uint8_t *out);
+static void   prefix_md4(raw_prefix *prefix);
+static void   prefix_md5(raw_prefix *prefix);
+static void   prefix_sha1(raw_prefix *prefix);
+static void   prefix_sha256(raw_prefix *prefix);
+
+const hash_engine raw_hash_engine = {"raw-hash", 1, raw_hash_check, NULL, NULL};
+
+const uint32_t raw_md5_k[64] = {MD5_STEPS(RAW_MD5_K)};
+
+static inline uint32_t rol32(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t ror32(uint32_t x, unsigned n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+// NTLM hashes the password as UTF-16LE. Candidates are taken as UTF-8, and
+// bytes that do not form a valid sequence as Latin-1, so every key still
+// hashes to something. The output is at most twice key_len.
+static size_t ntlm_utf16(const char *key, size_t key_len, uint8_t *out)
+{
+    const uint8_t *in  = (const uint8_t *)key;
+    size_t         len = 0;
+
+    for (size_t i = 0; i < key_len;)
+    {
+        uint32_t cp    = in[i];
+        size_t   extra = (cp >= 0xc2 && cp < 0xe0)   ? 1
+                         : (cp >= 0xe0 && cp < 0xf0) ? 2
+                         : (cp >= 0xf0 && cp < 0xf5) ? 3
+                                                     : 0;
+
+        if (i + extra >= key_len)
+            extra = 0;
+
+        if (extra > 0)
+        {
+            uint32_t decoded = cp & (0x3fu >> extra);
+
+            for (size_t k = 1; k <= extra; k++)
+            {
+                if ((in[i + k] & 0xc0) != 0x80)
+                {
+                    extra = 0;
+                    break;
+                }
+                decoded = decoded << 6 | (in[i + k] & 0x3fu);
+            }
+
+            // Overlong three-byte forms and surrogates are not characters either.
+            if (extra == 2 && (decoded < 0x800 || (decoded >= 0xd800 && decoded < 0xe000)))
+                extra = 0;
+            if (extra == 3 && (decoded < 0x10000 || decoded > 0x10ffff))
+                extra = 0;
+            if (extra > 0)
+                cp = decoded;
+        }
+
+        if (cp >= 0x10000)
+        {
+            uint32_t high = 0xd800 + ((cp - 0x10000) >> 10);
+            uint32_t low  = 0xdc00 + ((cp - 0x10000) & 0x3ff);
+
+            out[len++] = (uint8_t)high;
+            out[len++] = (uint8_t)(high >> 8);
+            out[len++] = (uint8_t)low;
+            out[len++] = (uint8_t)(low >> 8);
+        }
+        else
+        {
+            out[len++] = (uint8_t)cp;
+            out[len++] = (uint8_t)(cp >> 8);
+        }
+
+        i += extra + 1;
+    }
+
+    return len;
+}
+
+void raw_hash_digest(const hash_target *target, const char *key, size_t key_len, uint8_t *digest)
+{
+    switch (target->scheme)
+    {
+        case HASH_SCHEME_RAW_MD5:
+        {
+            md5_ctx ctx;
+
+            md5_init(&ctx);
+            md5_update(&ctx, key, key_len);
+            md5_final(&ctx, digest);
+            break;
+        }
+        case HASH_SCHEME_RAW_SHA1:
+        {
+            sha1_ctx ctx;
+
+            sha1_init(&ctx);
+            sha1_update(&ctx, key, key_len);
+            sha1_final(&ctx, digest);
+            break;
+        }
+        case HASH_SCHEME_RAW_SHA256:
+        {
+            sha256_ctx ctx;
+
+            sha256_init(&ctx);
+            sha256_update(&ctx, key, key_len);
+            sha256_final(&ctx, digest);
+            break;
+        }
+        case HASH_SCHEME_NTLM:
+        {
+            md4_ctx ctx;
+            uint8_t utf16[MAX_CANDIDATE_LEN * 2];
+
+            md4_init(&ctx);
+            md4_update(&ctx, utf16, ntlm_utf16(key, key_len, utf16));
+            md4_final(&ctx, digest);
+            break;
+        }
+        case HASH_SCHEME_UNKNOWN:
+        case HASH_SCHEME_DES:
+        case HASH_SCHEME_MD5:
+        case HASH_SCHEME_APR1:
+        case HASH_SCHEME_SHA256:
+        case HASH_SCHEME_SHA512:
+        case HASH_SCHEME_BCRYPT:
+        case HASH_SCHEME_YESCRYPT:
+        case HASH_SCHEME_SCRYPT:
+        default:
+            memset(digest, 0, target->digest_len);
+            break;
+    }
+}
+
+bool raw_hash_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    uint8_t digest[SHA256_DIGEST_LEN];
+
+    (void)scratch;
+
+    raw_hash_digest(target, key, key_len, digest);
+
+    return hash_digest_match(target, digest);
+}
+
+bool raw_hash_load(const hash_target *target, const char *key, size_t key_len, raw_hash_batch *batch, size_t lane)
+{
+    const uint8_t *msg = (const uint8_t *)key;
+    uint8_t        utf16[MAX_CANDIDATE_LEN * 2];
+    size_t         len = key_len;
+    size_t         full, used;
+    bool           md  = target->scheme == HASH_SCHEME_NTLM || target->scheme == HASH_SCHEME_RAW_MD5;
+    bool           wide = false;
+
+    if (target->scheme == HASH_SCHEME_NTLM)
+    {
+        wide = true;
+        for (size_t i = 0; wide && i < key_len; i++)
+            wide = msg[i] < 0x80;
+
+        // ASCII widens in place below; anything else goes through UTF-16 first.
+        if (wide)
+        {
+            len = key_len * 2;
+        }
+        else
+        {
+            len = ntlm_utf16(key, key_len, utf16);
+            msg = utf16;
+        }
+    }
+
+    if (len > RAW_HASH_BLOCK_MSG)
+        return false;
+
+    // Words are assembled straight from the key, and only as many as it
+    // reaches; whatever the lane's previous key left beyond them is cleared
+    // rather than the whole block. MD4 and MD5 are little-endian with the bit
+    // count in word 14; the SHA family is big-endian with it in word 15.
+    full = len / 4;
+    used = full + 1;
+
+    for (size_t i = 0; i < full; i++)
+    {
+        if (wide)
+            batch->words[i][lane] = (uint32_t)msg[i * 2] | (uint32_t)msg[i * 2 + 1] << 16;
+        else
+            batch->words[i][lane] = md ? load_le32(msg + i * 4) : load_be32(msg + i * 4);
+    }
+
+    if (wide)
+    {
+        batch->words[full][lane] = (len % 4) ? (uint32_t)msg[full * 2] | 0x800000u : 0x80u;
+    }
+    else
+    {
+        uint32_t last = 0x80;
+
+        for (size_t k = len % 4; k-- > 0;)
+            last = last << 8 | msg[full * 4 + k];
+        batch->words[full][lane] = md ? last : __builtin_bswap32(last);
+    }
+
+    for (size_t i = used; i < batch->used[lane]; i++)
+        batch->words[i][lane] = 0;
+
+    batch->words[14][lane] = md ? (uint32_t)(len * 8) : 0;
+    batch->words[15][lane] = md ? 0 : (uint32_t)(len * 8);
+    batch->used[lane]      = (uint8_t)used;
+
+    return true;
+}
+
+// Each prefix function replays exactly the step loop the kernels run over
+// the first sixteen steps, so a lane can pick up from the cached state.
+static void prefix_md4(raw_prefix *prefix)
+{
+    uint32_t a = md4_iv[0], b = md4_iv[1], c = md4_iv[2], d = md4_iv[3];
+
+    for (size_t i = 0; i < prefix->shared; i++)
+    {
+        uint32_t t = rol32(a + (d ^ (b & (c ^ d))) + prefix->words[i], raw_md4_shift[i & 3]);
+
+        a = d;
+        d = c;
+        c = b;
+        b = t;
+    }
+
+    prefix->state[0] = a;
+    prefix->state[1] = b;
+    prefix->state[2] = c;
+    prefix->state[3] = d;
+}
+
+static void prefix_md5(raw_prefix *prefix)
+{
+    uint32_t a = md5_iv[0], b = md5_iv[1], c = md5_iv[2], d = md5_iv[3];
+
+    for (size_t i = 0; i < prefix->shared; i++)
+    {
+        uint32_t t = b + rol32(a + (d ^ (b & (c ^ d))) + prefix->words[i] + raw_md5_k[i], raw_md5_shift[i & 3]);
+
+        a = d;
+        d = c;
+        c = b;
+        b = t;
+    }
+
+    prefix->state[0] = a;
+    prefix->state[1] = b;
+    prefix->state[2] = c;
+    prefix->state[3] = d;
+}
+
+// W[t] = rol(W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]): the last two terms come
+// from the prefix for every t with t - 14 inside it.
+static void prefix_sha1(raw_prefix *prefix)
+{
+    const uint32_t *w = prefix->words;
+    uint32_t        a = sha1_iv[0], b = sha1_iv[1], c = sha1_iv[2], d = sha1_iv[3], e = sha1_iv[4];
+
+    for (size_t i = 0; i < prefix->shared; i++)
+    {
+        uint32_t t = rol32(a, 5) + (d ^ (b & (c ^ d))) + e + sha1_k[0] + w[i];
+
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    prefix->state[0] = a;
+    prefix->state[1] = b;
+    prefix->state[2] = c;
+    prefix->state[3] = d;
+    prefix->state[4] = e;
+
+    prefix->sched_len = (prefix->shared > 2) ? prefix->shared - 2 : 0;
+    for (size_t j = 0; j < prefix->sched_len; j++)
+        prefix->sched[j] = w[j + 2] ^ w[j];
+}
+
+// W[t] = s1(W[t-2]) + W[t-7] + s0(W[t-15]) + W[t-16]: the last two terms
+// come from the prefix for every t with t - 15 inside it.
+static void prefix_sha256(raw_prefix *prefix)
+{
+    const uint32_t *w = prefix->words;
+    uint32_t        s[8];
+
+    memcpy(s, sha256_iv, sizeof(s));
+
+    for (size_t i = 0; i < prefix->shared; i++)
+    {
+        uint32_t t1 = s[7] + (ror32(s[4], 6) ^ ror32(s[4], 11) ^ ror32(s[4], 25)) + (s[6] ^ (s[4] & (s[5] ^ s[6]))) +
+                      sha256_k[i] + w[i];
+        uint32_t t2 = (ror32(s[0], 2) ^ ror32(s[0], 13) ^ ror32(s[0], 22)) + ((s[0] & s[1]) | (s[2] & (s[0] | s[1])));
+
+        memmove(&s[1], &s[0], 7 * sizeof(s[0]));
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+
+    memcpy(prefix->state, s, sizeof(s));
+
+    prefix->sched_len = (prefix->shared > 1) ? prefix->shared - 1 : 0;
+    for (size_t j = 0; j < prefix->sched_len; j++)
+        prefix->sched[j] = w[j] + (ror32(w[j + 1], 7) ^ ror32(w[j + 1], 18) ^ (w[j + 1] >> 3));
+}
+
+const raw_prefix *raw_hash_prefix(const hash_target *target, const raw_hash_batch *batch, raw_prefix *cache)
+{
+    size_t shared = 0;
+    bool   same;
+
+    for (; shared < 16; shared++)
+    {
+        uint32_t word = batch->words[shared][0];
+        size_t   l    = 1;
+
+        while (l < batch->n && batch->words[shared][l] == word)
+            l++;
+        if (l < batch->n)
+            break;
+    }
+
+    same = cache->scheme == target->scheme && cache->shared == shared;
+    for (size_t i = 0; same && i < shared; i++)
+        same = cache->words[i] == batch->words[i][0];
+
+    if (same)
+        return cache;
+
+    cache->scheme    = target->scheme;
+    cache->shared    = shared;
+    cache->sched_len = 0;
+    for (size_t i = 0; i < shared; i++)
+        cache->words[i] = batch->words[i][0];
+
+    switch (target->scheme)
+    {
+        case HASH_SCHEME_NTLM:
+            prefix_md4(cache);
+            break;
+        case HASH_SCHEME_RAW_MD5:
+            prefix_md5(cache);
+            break;
+        case HASH_SCHEME_RAW_SHA1:
+            prefix_sha1(cache);
+            break;
+        case HASH_SCHEME_RAW_SHA256:
+            prefix_sha256(cache);
+            break;
+        case HASH_SCHEME_UNKNOWN:
+        case HASH_SCHEME_DES:
+        case HASH_SCHEME_MD5:
+        case HASH_SCHEME_APR1:
+        case HASH_SCHEME_SHA256:
+        case HASH_SCHEME_SHA512:
+        case HASH_SCHEME_BCRYPT:
+        case HASH_SCHEME_YESCRYPT:
+        case HASH_SCHEME_SCRYPT:
+        default:
+            cache->scheme = HASH_SCHEME_UNKNOWN;
+            break;
+    }
+
+    return cache;
+}
@@ -0,0 +1,244 @@
+#include "md4.h"
+#include "md5.h"
+#include "raw_hash.h"
+#include "sha1.h"
+#include "sha2.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+typedef int (*raw_hash_kernel)(const hash_target *target, const raw_hash_batch *batch, const raw_prefix *prefix);
+
+// The same kernel source built for each instruction set; the function
+// attributes keep the rest of the program free of AVX.
+int raw_hash_x8_avx2(const hash_target *target, const raw_hash_batch *batch, const raw_prefix *prefix);
+int raw_hash_x16_avx512(const hash_target *target, const raw_hash_batch *batch, const raw_prefix *prefix);
+
+    #define RAW_LANES 8
+    #define RAW_TARGET "avx2"
+    #define RAW_NAME raw_hash_x8_avx2
+    #include "raw_hash_lanes.h"
+    #undef RAW_LANES
+    #undef RAW_TARGET
+    #undef RAW_NAME
+
+    #define RAW_LANES 16
+    #define RAW_TARGET "avx512f"
+    #define RAW_NAME raw_hash_x16_avx512
+    #include "raw_hash_lanes.h"
+    #undef RAW_LANES
+    #undef RAW_TARGET
+    #undef RAW_NAME
+
+static int  run_batch(const hash_target *target, raw_hash_batch *batch, raw_prefix *cache, raw_hash_kernel kernel,
+                      size_t lanes);
+static int  simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch, raw_hash_kernel kernel, size_t lanes);
+static int  simd_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch,
+                     raw_hash_kernel kernel, size_t lanes);
+static int  avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch);
+static int  avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                         hash_scratch *scratch);
+static int  avx2_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch);
+static int  avx512_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch);
+static bool self_test(const hash_target *target, raw_hash_kernel kernel, size_t lanes);
+
+static const hash_engine raw_avx2_engine   = {"raw-hash/avx2x8", 8, raw_hash_check, avx2_batch, avx2_gen};
+static const hash_engine raw_avx512_engine = {"raw-hash/avx512x16", 16, raw_hash_check, avx512_batch, avx512_gen};
+
+// Lanes past n repeat lane 0, so every lane hashes a defined message.
+static int run_batch(const hash_target *target, raw_hash_batch *batch, raw_prefix *cache, raw_hash_kernel kernel,
+                     size_t lanes)
+{
+    for (size_t l = batch->n; l < lanes; l++)
+    {
+        for (int i = 0; i < 16; i++)
+            batch->words[i][l] = batch->words[i][0];
+        batch->used[l] = batch->used[0];
+    }
+
+    return kernel(target, batch, raw_hash_prefix(target, batch, cache));
+}
+
+static int simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch, raw_hash_kernel kernel, size_t lanes)
+{
+    raw_hash_batch batch;
+    size_t         index[RAW_HASH_MAX_LANES];
+    int            hit;
+
+    memset(&batch, 0, sizeof(batch));
+
+    for (size_t i = 0; i < n && i < lanes; i++)
+    {
+        // Keys too long for one block take the scalar path.
+        if (!raw_hash_load(target, keys[i], key_lens[i], &batch, batch.n))
+        {
+            if (raw_hash_check(target, keys[i], key_lens[i], scratch))
+                return (int)i;
+            continue;
+        }
+
+        index[batch.n++] = i;
+    }
+
+    if (batch.n == 0)
+        return -1;
+
+    hit = run_batch(target, &batch, &scratch->prefix, kernel, lanes);
+
+    return (hit < 0) ? -1 : (int)index[hit];
+}
+
+// Lays each candidate straight into its lane as the generator steps, so
+// nothing between the odometer and the kernel copies or checks per key.
+// Successive candidates mostly differ in their last few characters, and
+// raw_hash_load() only rewrites the words a key covers.
+static int simd_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch,
+                    raw_hash_kernel kernel, size_t lanes)
+{
+    raw_hash_batch batch;
+    uint64_t       offset[RAW_HASH_MAX_LANES];
+    int            hit;
+
+    memset(&batch, 0, sizeof(batch));
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (i > 0 && candidate_gen_next(gen) == -1)
+            break;
+
+        if (gen->skip)
+            continue;
+
+        if (!raw_hash_load(target, gen->buf, gen->len, &batch, batch.n))
+        {
+            if (raw_hash_check(target, gen->buf, gen->len, scratch))
+                return (int)i;
+            continue;
+        }
+
+        offset[batch.n++] = i;
+        if (batch.n < lanes)
+            continue;
+
+        hit = run_batch(target, &batch, &scratch->prefix, kernel, lanes);
+        if (hit >= 0)
+            return (int)offset[hit];
+
+        batch.n = 0;
+    }
+
+    // The tail of the range goes through with fewer lanes filled.
+    if (batch.n > 0 && (hit = run_batch(target, &batch, &scratch->prefix, kernel, lanes)) >= 0)
+        return (int)offset[hit];
+
+    return -1;
+}
+
+static int avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, raw_hash_x8_avx2, 8);
+}
+
+static int avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                        hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, raw_hash_x16_avx512, 16);
+}
+
+static int avx2_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch)
+{
+    return simd_gen(target, gen, count, scratch, raw_hash_x8_avx2, 8);
+}
+
+static int avx512_gen(const hash_target *target, candidate_gen *gen, uint64_t count, hash_scratch *scratch)
+{
+    return simd_gen(target, gen, count, scratch, raw_hash_x16_avx512, 16);
+}
+
+// Aims a probe at one lane of a batch whose keys share a prefix of 0 to 18
+// characters, so the kernel starts from every kind of cached state, then
+// runs a single-lane batch where all sixteen words are shared. Keys stay
+// short enough for one NTLM block. The kernel
+// has to find exactly the lane the scalar digest came from, twice: once
+// with a fresh prefix and once from the cache.
+static bool self_test(const hash_target *target, raw_hash_kernel kernel, size_t lanes)
+{
+    hash_target    probe = *target;
+    raw_hash_batch batch;
+    raw_prefix     cache;
+    char           key[MAX_CANDIDATE_LEN + 1];
+
+    memset(&batch, 0, sizeof(batch));
+    memset(&cache, 0, sizeof(cache));
+
+    for (size_t pass = 0; pass < 5; pass++)
+    {
+        size_t want = (pass < 4) ? (pass * 5 + 3) % lanes : 0;
+
+        batch.n = (pass < 4) ? lanes : 1;
+
+        for (size_t l = 0; l < batch.n; l++)
+        {
+            size_t shared = pass * 6;
+            size_t len    = shared + 1 + l % 3;
+
+            for (size_t i = 0; i < len; i++)
+                key[i] = (i < shared) ? (char)('a' + i % 26) : (char)('!' + (l * 7 + i * 13) % 94);
+
+            if (!raw_hash_load(&probe, key, len, &batch, l))
+                return false;
+            if (l == want)
+                raw_hash_digest(target, key, len, probe.digest);
+        }
+
+        for (int round = 0; round < 2; round++)
+        {
+            if (run_batch(&probe, &batch, &cache, kernel, lanes) != (int)want)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+const hash_engine *raw_hash_select_engine(const hash_target *target)
+{
+    const hash_engine *engine = NULL;
+    raw_hash_kernel    kernel = NULL;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        engine = &raw_avx512_engine;
+        kernel = raw_hash_x16_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        engine = &raw_avx2_engine;
+        kernel = raw_hash_x8_avx2;
+    }
+
+    if (engine && self_test(target, kernel, engine->lanes))
+        return engine;
+
+    if (engine)
+        fprintf(stderr, "[WORKER] %s failed its self-test, using the scalar engine\n", engine->name);
+
+    return &raw_hash_engine;
+}
+
+#else
+
+const hash_engine *raw_hash_select_engine(const hash_target *target)
+{
+    (void)target;
+    return &raw_hash_engine;
+}
+
+#endif
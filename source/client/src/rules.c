@@ -0,0 +1,392 @@
+#include "rules.h"
+#include "fsm.h"
+#include <ctype.h>
+#include <stdio.h>
+
+static int  rule_position(char c);
+static int  rule_arity(char op, int *positions);
+static void reverse(char *buf, size_t len);
+
+// Positions are 0-9 then A-Z for 10-35, as in hashcat.
+static int rule_position(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Number of argument bytes an op takes, and how many of those are positions
+// (positions always come first).
+static int rule_arity(char op, int *positions)
+{
+    *positions = 0;
+
+    switch (op)
+    {
+        case ':':
+        case 'l':
+        case 'u':
+        case 'c':
+        case 'C':
+        case 't':
+        case 'r':
+        case 'd':
+        case 'f':
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case 'q':
+        case 'k':
+        case 'K':
+        case 'E':
+            return 0;
+        case 'T':
+        case 'p':
+        case 'D':
+        case '\'':
+        case 'z':
+        case 'Z':
+            *positions = 1;
+            return 1;
+        case '$':
+        case '^':
+        case '@':
+            return 1;
+        case 'x':
+        case 'O':
+        case '*':
+            *positions = 2;
+            return 2;
+        case 'i':
+        case 'o':
+            *positions = 1;
+            return 2;
+        case 's':
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+int rule_set_add(rule_set *rules, const char *text, struct fsm_error *err)
+{
+    size_t first = rules->num_insns;
+
+    if (rules->count + 2 > rules->cap_rules)
+    {
+        size_t    cap = rules->cap_rules ? rules->cap_rules * 2 : 64;
+        uint32_t *tmp = realloc(rules->starts, cap * sizeof(uint32_t));
+        if (!tmp)
+        {
+            SET_ERROR(err, "realloc failed (rule_set_add)");
+            return -1;
+        }
+        rules->starts    = tmp;
+        rules->cap_rules = cap;
+    }
+
+    for (const char *p = text; *p; p++)
+    {
+        int positions;
+        int arity;
+
+        // Spaces only separate steps.
+        if (*p == ' ')
+            continue;
+
+        arity = rule_arity(*p, &positions);
+        if (arity < 0 || strnlen(p + 1, (size_t)arity) < (size_t)arity)
+        {
+            char message[MAX_RULE_LEN + 64];
+            snprintf(message, sizeof(message), "Invalid rule '%.255s' at '%c'", text, *p);
+            SET_ERROR(err, message);
+            rules->num_insns = first;
+            return -1;
+        }
+
+        rule_insn insn = {.op = (uint8_t)*p};
+        uint8_t  *args[2] = {&insn.a, &insn.b};
+
+        for (int i = 0; i < arity; i++)
+        {
+            char c = p[1 + i];
+
+            if (i < positions)
+            {
+                int pos = rule_position(c);
+                if (pos < 0)
+                {
+                    char message[MAX_RULE_LEN + 64];
+                    snprintf(message, sizeof(message), "Invalid position '%c' in rule '%.255s'", c, text);
+                    SET_ERROR(err, message);
+                    rules->num_insns = first;
+                    return -1;
+                }
+                *args[i] = (uint8_t)pos;
+            }
+            else
+            {
+                *args[i] = (uint8_t)c;
+            }
+        }
+
+        p += arity;
+
+        if (insn.op == ':')
+            continue;
+
+        if (rules->num_insns == rules->cap_insns)
+        {
+            size_t     cap = rules->cap_insns ? rules->cap_insns * 2 : 256;
+            rule_insn *tmp = realloc(rules->insns, cap * sizeof(rule_insn));
+            if (!tmp)
+            {
+                SET_ERROR(err, "realloc failed (rule_set_add)");
+                rules->num_insns = first;
+                return -1;
+            }
+            rules->insns     = tmp;
+            rules->cap_insns = cap;
+        }
+
+        rules->insns[rules->num_insns++] = insn;
+    }
+
+    rules->starts[rules->count]     = (uint32_t)first;
+    rules->starts[rules->count + 1] = (uint32_t)rules->num_insns;
+    rules->count++;
+
+    return 0;
+}
+
+void rule_set_free(rule_set *rules)
+{
+    free(rules->insns);
+    free(rules->starts);
+    memset(rules, 0, sizeof(*rules));
+}
+
+static void reverse(char *buf, size_t len)
+{
+    for (size_t i = 0, j = len; i + 1 < j; i++, j--)
+    {
+        char tmp   = buf[i];
+        buf[i]     = buf[j - 1];
+        buf[j - 1] = tmp;
+    }
+}
+
+// Runs one compiled rule over buf in place. Steps whose position falls outside
+// the word leave it unchanged; returns -1 when the result would exceed max_len.
+int rule_apply(const rule_set *rules, size_t rule, char *buf, size_t *len, size_t max_len)
+{
+    size_t n = *len;
+
+    for (uint32_t k = rules->starts[rule]; k < rules->starts[rule + 1]; k++)
+    {
+        const rule_insn *insn = &rules->insns[k];
+        size_t           a    = insn->a;
+        size_t           b    = insn->b;
+
+        switch (insn->op)
+        {
+            case 'l':
+                for (size_t i = 0; i < n; i++)
+                    buf[i] = (char)tolower((unsigned char)buf[i]);
+                break;
+            case 'u':
+                for (size_t i = 0; i < n; i++)
+                    buf[i] = (char)toupper((unsigned char)buf[i]);
+                break;
+            case 'c':
+            case 'C':
+                for (size_t i = 0; i < n; i++)
+                {
+                    bool upper = (i == 0) == (insn->op == 'c');
+                    buf[i]     = (char)(upper ? toupper((unsigned char)buf[i]) : tolower((unsigned char)buf[i]));
+                }
+                break;
+            case 'E':
+                for (size_t i = 0; i < n; i++)
+                {
+                    bool upper = (i == 0 || buf[i - 1] == ' ');
+                    buf[i]     = (char)(upper ? toupper((unsigned char)buf[i]) : tolower((unsigned char)buf[i]));
+                }
+                break;
+            case 't':
+                for (size_t i = 0; i < n; i++)
+                    buf[i] = (char)(isupper((unsigned char)buf[i]) ? tolower((unsigned char)buf[i]) : toupper((unsigned char)buf[i]));
+                break;
+            case 'T':
+                if (a < n)
+                    buf[a] = (char)(isupper((unsigned char)buf[a]) ? tolower((unsigned char)buf[a]) : toupper((unsigned char)buf[a]));
+                break;
+            case 'r':
+                reverse(buf, n);
+                break;
+            case 'd':
+                if (n * 2 > max_len)
+                    return -1;
+                memcpy(buf + n, buf, n);
+                n *= 2;
+                break;
+            case 'p':
+                if (n * (a + 1) > max_len)
+                    return -1;
+                for (size_t i = 1; i <= a; i++)
+                    memcpy(buf + n * i, buf, n);
+                n *= a + 1;
+                break;
+            case 'f':
+                if (n * 2 > max_len)
+                    return -1;
+                memcpy(buf + n, buf, n);
+                reverse(buf + n, n);
+                n *= 2;
+                break;
+            case '{':
+                if (n > 1)
+                {
+                    char first = buf[0];
+                    memmove(buf, buf + 1, n - 1);
+                    buf[n - 1] = first;
+                }
+                break;
+            case '}':
+                if (n > 1)
+                {
+                    char last = buf[n - 1];
+                    memmove(buf + 1, buf, n - 1);
+                    buf[0] = last;
+                }
+                break;
+            case '$':
+                if (n + 1 > max_len)
+                    return -1;
+                buf[n++] = (char)a;
+                break;
+            case '^':
+                if (n + 1 > max_len)
+                    return -1;
+                memmove(buf + 1, buf, n++);
+                buf[0] = (char)a;
+                break;
+            case '[':
+                if (n > 0)
+                    memmove(buf, buf + 1, --n);
+                break;
+            case ']':
+                if (n > 0)
+                    n--;
+                break;
+            case 'D':
+                if (a < n)
+                {
+                    memmove(buf + a, buf + a + 1, n - a - 1);
+                    n--;
+                }
+                break;
+            case 'x':
+                if (a < n)
+                {
+                    size_t count = (a + b > n) ? n - a : b;
+                    memmove(buf, buf + a, count);
+                    n = count;
+                }
+                break;
+            case 'O':
+                if (a < n)
+                {
+                    size_t count = (a + b > n) ? n - a : b;
+                    memmove(buf + a, buf + a + count, n - a - count);
+                    n -= count;
+                }
+                break;
+            case 'i':
+                if (a <= n)
+                {
+                    if (n + 1 > max_len)
+                        return -1;
+                    memmove(buf + a + 1, buf + a, n - a);
+                    buf[a] = (char)b;
+                    n++;
+                }
+                break;
+            case 'o':
+                if (a < n)
+                    buf[a] = (char)b;
+                break;
+            case '\'':
+                if (a < n)
+                    n = a;
+                break;
+            case 's':
+                for (size_t i = 0; i < n; i++)
+                    if (buf[i] == (char)a)
+                        buf[i] = (char)b;
+                break;
+            case '@':
+            {
+                size_t out = 0;
+                for (size_t i = 0; i < n; i++)
+                    if (buf[i] != (char)a)
+                        buf[out++] = buf[i];
+                n = out;
+                break;
+            }
+            case 'z':
+                if (n > 0)
+                {
+                    if (n + a > max_len)
+                        return -1;
+                    memmove(buf + a, buf, n);
+                    memset(buf, buf[a], a);
+                    n += a;
+                }
+                break;
+            case 'Z':
+                if (n > 0)
+                {
+                    if (n + a > max_len)
+                        return -1;
+                    memset(buf + n, buf[n - 1], a);
+                    n += a;
+                }
+                break;
+            case 'q':
+                if (n * 2 > max_len)
+                    return -1;
+                for (size_t i = n; i > 0; i--)
+                {
+                    buf[2 * i - 1] = buf[i - 1];
+                    buf[2 * i - 2] = buf[i - 1];
+                }
+                n *= 2;
+                break;
+            case 'k':
+            case 'K':
+            case '*':
+            {
+                size_t x = (insn->op == 'k') ? 0 : (insn->op == 'K') ? n - 2 : a;
+                size_t y = (insn->op == 'k') ? 1 : (insn->op == 'K') ? n - 1 : b;
+
+                if (n >= 2 && x < n && y < n)
+                {
+                    char tmp = buf[x];
+                    buf[x]   = buf[y];
+                    buf[y]   = tmp;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    *len = n;
+
+    return 0;
+}
@@ -1,7 +1,20 @@
 #include "server_config.h"
+#include "cracker.h"
 #include "fsm.h"
+#include "hash_engine.h"
+#include "keyspace.h"
+#include "protocol.h"
+#include "rainbow.h"
 #include "utils.h"
 
+// Checkpoints, FOUND, CHAIN and NEXT go out from whichever thread has
+// them; each message is written whole before the next one starts.
+static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int recv_message(int sockfd, worker_state *ws, protocol_message *msg, char *buffer, struct fsm_error *err);
+static int send_message(worker_state *ws, message_type type, const uint64_t *values, size_t num_values,
+                        const char *text, struct fsm_error *err);
+
 int socket_create(int domain, int type, int protocol, struct fsm_error *err)
 {
     int sockfd;
@@ -63,120 +76,614 @@ int socket_connect(int sockfd, struct sockaddr_storage *addr, in_port_t port, st
     return 0;
 }
 
-int receive_hash(int sockfd, worker_state *ws, struct fsm_error *err)
+// Reads the next message into buffer, which holds RECV_BUF_SIZE + 1
+// bytes, and decodes it there; its string, if any, ends in a NUL. One
+// recv() may bring part of a message or several, so whatever follows the
+// message waits in recv_buf for the next call.
+static int recv_message(int sockfd, worker_state *ws, protocol_message *msg, char *buffer, struct fsm_error *err)
 {
-    char    buffer[512];
-    ssize_t n = recv(sockfd, buffer, sizeof(buffer) - 1, 0);
-
-    if (n <= 0)
+    for (;;)
     {
-        SET_ERROR(err, "recv() failed (receive_hash)");
+        size_t len  = 0; // of the message, without a line's newline
+        size_t used = 0; // of recv_buf
 
+        if (ws->protocol == PROTOCOL_BINARY)
+        {
+            if (ws->recv_len >= PROTOCOL_FRAME_HEADER)
+            {
+                size_t frame = protocol_frame_length((const unsigned char *)ws->recv_buf);
+
+                if (frame > RECV_BUF_SIZE)
+                {
+                    SET_ERROR(err, "Frame from server too long");
+                    return -1;
+                }
+
+                if (frame <= ws->recv_len)
+                    len = used = frame;
+            }
+        }
+        else
+        {
+            char *newline = memchr(ws->recv_buf, '\n', ws->recv_len);
+
+            if (newline)
+            {
+                len  = (size_t)(newline - ws->recv_buf);
+                used = len + 1;
+            }
+        }
+
+        if (used > 0)
+        {
+            memcpy(buffer, ws->recv_buf, len);
+            buffer[len] = '\0';
+
+            ws->recv_len -= used;
+            memmove(ws->recv_buf, ws->recv_buf + used, ws->recv_len);
+
+            return protocol_decode(ws->protocol, buffer, len, msg, err);
+        }
+
+        if (ws->recv_len == RECV_BUF_SIZE)
+        {
+            SET_ERROR(err, "Server recv buffer overflow");
+            return -1;
+        }
+
+        ssize_t n = recv(sockfd, ws->recv_buf + ws->recv_len, RECV_BUF_SIZE - ws->recv_len, 0);
+        if (n <= 0)
+        {
+            SET_ERROR(err, "recv() failed");
+            return -1;
+        }
+
+        ws->recv_len += (size_t)n;
+    }
+}
+
+static int send_message(worker_state *ws, message_type type, const uint64_t *values, size_t num_values,
+                        const char *text, struct fsm_error *err)
+{
+    protocol_message msg = {.type = type, .num_values = num_values, .text = text, .text_len = text ? strlen(text) : 0};
+    char             buffer[PROTOCOL_MAX_MESSAGE];
+    ssize_t          len;
+    size_t           sent = 0;
+
+    if (num_values > 0)
+        memcpy(msg.values, values, num_values * sizeof(*values));
+
+    len = protocol_encode(ws->protocol, &msg, buffer, sizeof(buffer));
+    if (len < 0)
+    {
+        SET_ERROR(err, "Message to server does not fit in a frame");
         return -1;
     }
 
-    buffer[n] = '\0';
+    pthread_mutex_lock(&send_mutex);
+    while (sent < (size_t)len)
+    {
+        ssize_t n = send(ws->sockfd, buffer + sent, (size_t)len - sent, 0);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            break;
 
-    if (strncmp(buffer, "HASH ", 5) != 0)
+        sent += (size_t)n;
+    }
+    pthread_mutex_unlock(&send_mutex);
+
+    if (sent < (size_t)len)
     {
-        char message[256];
-        snprintf(message, sizeof(message), "Invalid HASH message from server: %s\n", buffer);
-        SET_ERROR(err, message);
+        char message[64];
 
+        snprintf(message, sizeof(message), "send(%s) failed", protocol_message_name(type));
+        SET_ERROR(err, message);
         return -1;
     }
 
-    const char *hash_start = buffer + 5;
+    return 0;
+}
 
-    char *newline = strchr(hash_start, '\n');
-    if (newline)
-        *newline = '\0';
+// HELLO goes out first, in the mode we were told to speak; the server's
+// answer carries the version and the capabilities both sides have.
+int handshake(int sockfd, worker_state *ws, struct fsm_error *err)
+{
+    uint64_t         hello[] = {PROTOCOL_VERSION, PROTOCOL_CAPS};
+    char             buffer[RECV_BUF_SIZE + 1];
+    protocol_message msg;
 
-    ws->hash = strdup(hash_start);
-    if (!ws->hash)
+    if (send_message(ws, MSG_HELLO, hello, 2, NULL, err) == -1 || recv_message(sockfd, ws, &msg, buffer, err) == -1)
+        return -1;
+
+    if (msg.type != MSG_HELLO)
     {
-        SET_ERROR(err, "strdup failed");
+        SET_ERROR(err, "Server did not answer HELLO");
+        return -1;
+    }
 
+    if (msg.values[0] < PROTOCOL_MIN_VERSION || msg.values[0] > PROTOCOL_VERSION)
+    {
+        SET_ERROR(err, "Server protocol version not supported");
         return -1;
     }
 
-    printf("[WORKER] Received hash: %s\n", ws->hash);
+    ws->caps = (uint32_t)(msg.values[1] & PROTOCOL_CAPS);
+
+    printf("[WORKER] Speaking %s protocol version %" PRIu64 "\n", (ws->protocol == PROTOCOL_BINARY) ? "binary" : "text",
+           msg.values[0]);
+
+    return 0;
+}
 
-    const char *msg = "READY\n";
-    if (send(sockfd, msg, strlen(msg), 0) < 0)
+// Where receive_hash() stands in the job's HASH messages.
+typedef struct hash_header
+{
+    size_t target_cap;
+    size_t group_cap;
+    size_t group_left; // hashes still to come in the group a GROUP announced
+    bool   joining;    // the next hash joins the last group
+} hash_header;
+
+// A group's digests, in arrival order until prepare_group() sorts them. The
+// first member's is copied in once a second one joins.
+static int append_digest(hash_group *group, const hash_target *parsed, struct fsm_error *err)
+{
+    size_t len = parsed->digest_len;
+
+    if (group->num_members + 1 > group->digests_cap)
     {
-        SET_ERROR(err, "send(READY) failed");
+        size_t   new_cap = group->digests_cap ? group->digests_cap * 2 : 4;
+        uint8_t *digests = realloc(group->digests, new_cap * len);
 
-        return -1;
+        if (!digests)
+        {
+            SET_ERROR(err, "realloc failed (append_digest)");
+            return -1;
+        }
+
+        if (group->digests_cap == 0)
+            memcpy(digests, group->target.digest, len);
+
+        group->digests     = digests;
+        group->digests_cap = new_cap;
     }
 
+    memcpy(group->digests + group->num_members * len, parsed->digest, len);
+    group->num_members++;
+
     return 0;
 }
 
-int send_done(int sockfd, struct fsm_error *err)
+// Hashes join the salt group in progress as long as they really share its
+// setting, keeping only their digest; any other starts a group of its own.
+static int add_group_member(worker_state *ws, const hash_target *parsed, hash_header *header, struct fsm_error *err)
 {
+    hash_group *group = (ws->num_groups > 0) ? &ws->groups[ws->num_groups - 1] : NULL;
 
-    const char *msg = "DONE\n";
-    if (send(sockfd, msg, strlen(msg), 0) < 0)
+    if (header->joining && group && hash_target_same_setting(&group->target, parsed))
+    {
+        if (append_digest(group, parsed, err) == -1)
+            return -1;
+    }
+    else
     {
-        SET_ERROR(err, "send(DONE) failed");
+        if (ws->num_groups == header->group_cap)
+        {
+            size_t new_cap = header->group_cap ? header->group_cap * 2 : 16;
+
+            group = realloc(ws->groups, new_cap * sizeof(*group));
+            if (!group)
+            {
+                SET_ERROR(err, "realloc failed (add_group_member)");
+                return -1;
+            }
+            ws->groups        = group;
+            header->group_cap = new_cap;
+        }
 
+        group = &ws->groups[ws->num_groups++];
+        memset(group, 0, sizeof(*group));
+        group->target      = *parsed;
+        group->first       = ws->num_targets - 1;
+        group->num_members = 1;
+    }
+
+    if (header->group_left > 0)
+        header->group_left--;
+    header->joining = header->group_left > 0;
+
+    return 0;
+}
+
+static int add_target(worker_state *ws, const char *hash, hash_header *header, struct fsm_error *err)
+{
+    hash_target parsed;
+
+    if (ws->num_targets == header->target_cap)
+    {
+        size_t new_cap = header->target_cap ? header->target_cap * 2 : 16;
+        char **hashes  = realloc(ws->hashes, new_cap * sizeof(*hashes));
+
+        if (!hashes)
+        {
+            SET_ERROR(err, "realloc failed (add_target)");
+            return -1;
+        }
+        ws->hashes         = hashes;
+        header->target_cap = new_cap;
+    }
+
+    ws->hashes[ws->num_targets] = strdup(hash);
+    if (!ws->hashes[ws->num_targets])
+    {
+        SET_ERROR(err, "strdup failed (add_target)");
         return -1;
     }
 
+    if (hash_target_parse(&parsed, ws->hashes[ws->num_targets], err) == -1)
+    {
+        free(ws->hashes[ws->num_targets]);
+        return -1;
+    }
+
+    ws->num_targets++;
+
+    return add_group_member(ws, &parsed, header, err);
+}
+
+static int compare_members(const void *a, const void *b, void *arg)
+{
+    const hash_group *group = arg;
+    size_t            len   = group->target.digest_len;
+
+    return memcmp(group->digests + *(const size_t *)a * len, group->digests + *(const size_t *)b * len, len);
+}
+
+// Sorts a group's digests into the table its target searches and indexes it.
+static int prepare_group(hash_group *group, struct fsm_error *err)
+{
+    size_t   len = group->target.digest_len;
+    size_t   n   = group->num_members;
+    uint8_t *sorted;
+
+    atomic_init(&group->remaining, n);
+
+    if (n == 1)
+        return 0;
+
+    sorted         = malloc(n * len);
+    group->members = malloc(n * sizeof(*group->members));
+    if (!sorted || !group->members)
+    {
+        free(sorted);
+        SET_ERROR(err, "malloc failed (prepare_group)");
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        group->members[i] = i;
+
+    qsort_r(group->members, n, sizeof(*group->members), compare_members, group);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy(sorted + i * len, group->digests + group->members[i] * len, len);
+        group->members[i] += group->first;
+    }
+
+    free(group->digests);
+    group->digests     = sorted;
+    group->digests_cap = n;
+
+    if (digest_index_build(&group->index, group->digests, n, len, err) == -1)
+        return -1;
+
+    group->target.digests     = group->digests;
+    group->target.num_digests = n;
+    group->target.index       = &group->index;
+
     return 0;
 }
 
-int wait_for_work(int sockfd, worker_state *ws, struct fsm_error *err)
+// Every group is checked against every candidate. Batches are sized for the
+// widest engine, and the generator-driven path is only taken when all of
+// them can run it.
+static int prepare_targets(worker_state *ws, struct fsm_error *err)
 {
-    char    buffer[512];
-    ssize_t n = recv(sockfd, buffer, sizeof(buffer) - 1, 0);
+    ws->cracked = malloc(ws->num_targets * sizeof(*ws->cracked));
+    if (!ws->cracked)
+    {
+        SET_ERROR(err, "malloc failed (prepare_targets)");
+        return -1;
+    }
+
+    if (ws->num_targets == 1)
+        printf("[WORKER] Received hash: %s\n", ws->hashes[0]);
+    else
+        printf("[WORKER] Received %zu hashes in %zu salt groups\n", ws->num_targets, ws->num_groups);
+
+    for (size_t i = 0; i < ws->num_targets; i++)
+        atomic_init(&ws->cracked[i], false);
 
-    if (n <= 0)
+    atomic_init(&ws->remaining, ws->num_targets);
+    ws->max_lanes = 1;
+    ws->stream    = true;
+
+    for (size_t g = 0; g < ws->num_groups; g++)
     {
-        SET_ERROR(err, "[WORKER] recv() failed waiting for WORK");
+        const hash_engine *engine = ws->groups[g].target.engine;
+        size_t             first  = 0;
+
+        if (prepare_group(&ws->groups[g], err) == -1)
+            return -1;
+
+        if (engine->lanes > ws->max_lanes)
+            ws->max_lanes = engine->lanes;
+        if (!engine->check_gen)
+            ws->stream = false;
+
+        while (ws->groups[first].target.engine != engine)
+            first++;
+        if (first == g)
+            printf("[WORKER] Hash engine: %s\n", engine->name);
+    }
 
+    return 0;
+}
+
+// RAINBOW build (chain length; scheme) makes each WORK index a chain to
+// build over the mask. RAINBOW lookup (chains; path) makes it a column of
+// the table at path, which brings its own mask, to look every hash up in.
+static int add_rainbow(worker_state *ws, const protocol_message *msg, struct fsm_error *err)
+{
+    char scheme[16];
+
+    if (ws->rainbow)
+    {
+        SET_ERROR(err, "More than one RAINBOW message from server");
         return -1;
     }
 
-    buffer[n] = '\0';
+    ws->rainbow = calloc(1, sizeof(*ws->rainbow));
+    if (!ws->rainbow)
+    {
+        SET_ERROR(err, "calloc failed (add_rainbow)");
+        return -1;
+    }
 
-    if (strncmp(buffer, "STOP", 4) == 0)
+    if (msg->type == MSG_RAINBOW_LOOKUP)
     {
-        printf("[WORKER] Received STOP from server\n");
-        return 1;
+        const char *path = ws->rainbow_path ? ws->rainbow_path : msg->text;
+
+        return rainbow_open(ws->rainbow, ws->keyspace, path, msg->values[0], err);
     }
 
-    if (strncmp(buffer, "WORK ", 5) != 0)
+    // In text mode the scheme is followed by the chain length, not a NUL.
+    if (msg->text_len >= sizeof(scheme))
     {
-        char message[256];
-        snprintf(message, sizeof(message), "[WORKER] Invalid WORK message: %s\n", buffer);
+        SET_ERROR(err, "Invalid RAINBOW build scheme from server");
+        return -1;
+    }
+
+    memcpy(scheme, msg->text, msg->text_len);
+    scheme[msg->text_len] = '\0';
+
+    return rainbow_build_init(ws->rainbow, scheme, msg->values[0], err);
+}
+
+// One message of the job header: a hash, a part of the keyspace, or the rainbow table.
+static int add_header_message(worker_state *ws, const protocol_message *msg, hash_header *header,
+                              struct fsm_error *err)
+{
+    if (msg->type == MSG_GROUP)
+    {
+        // The next values[0] hashes share a salt.
+        if (msg->values[0] == 0)
+        {
+            SET_ERROR(err, "Empty GROUP from server");
+            return -1;
+        }
+
+        header->group_left = (size_t)msg->values[0];
+        header->joining    = false;
+    }
+    else if (msg->type == MSG_HASH)
+    {
+        if (add_target(ws, msg->text, header, err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_HYBRID)
+    {
+        if (keyspace_set_hybrid(ws->keyspace, msg->values[0] != 0, msg->values[1] != 0, err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_POS)
+    {
+        if (keyspace_add_position(ws->keyspace, msg->text, err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_RULE)
+    {
+        if (keyspace_add_rule(ws->keyspace, msg->text, err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_WORDLIST)
+    {
+        // A path given on our own command line wins over the server's.
+        const char *path = ws->wordlist_path ? ws->wordlist_path : msg->text;
+
+        if (keyspace_load_wordlist(ws->keyspace, path, msg->values[0], err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_MARKOV)
+    {
+        const char *path = ws->markov_path ? ws->markov_path : msg->text;
+
+        if (keyspace_load_markov(ws->keyspace, path, (size_t)msg->values[0], err) == -1)
+            return -1;
+    }
+    else if (msg->type == MSG_RAINBOW_BUILD || msg->type == MSG_RAINBOW_LOOKUP)
+    {
+        if (add_rainbow(ws, msg, err) == -1)
+            return -1;
+    }
+    else
+    {
+        char message[64];
+        snprintf(message, sizeof(message), "Unexpected %s in job header from server", protocol_message_name(msg->type));
         SET_ERROR(err, message);
 
         return -1;
     }
 
-    uint64_t start = 0, len = 0;
-    uint32_t checkpoint = 0, timeout = 0;
+    return 0;
+}
+
+// Building a rainbow table is the one job without hashes; its chains only
+// need the mask.
+static int prepare_rainbow(worker_state *ws, struct fsm_error *err)
+{
+    const rainbow_table *table = ws->rainbow;
+    size_t               other = 0;
+
+    if (ws->keyspace->mode != KEYSPACE_MASK || ws->keyspace->markov)
+    {
+        SET_ERROR(err, "Rainbow tables need a plain mask");
+        return -1;
+    }
+
+    if (table->build)
+    {
+        atomic_init(&ws->remaining, 0);
+        ws->max_lanes = 1;
+        ws->stream    = false;
+
+        printf("[WORKER] Rainbow build: chains of length %" PRIu64 "\n", table->chain_len);
+        return 0;
+    }
+
+    for (size_t g = 0; g < ws->num_groups; g++)
+    {
+        if (ws->groups[g].target.scheme != table->probe.scheme)
+            other += ws->groups[g].num_members;
+    }
+
+    if (other > 0)
+        printf("[WORKER] %zu hashes are not of the rainbow table's scheme and are skipped\n", other);
+
+    return 0;
+}
+
+int receive_hash(int sockfd, worker_state *ws, struct fsm_error *err)
+{
+    char             buffer[RECV_BUF_SIZE + 1];
+    protocol_message msg;
+    hash_header      header = {0};
+
+    ws->keyspace = malloc(sizeof(keyspace));
+    if (!ws->keyspace)
+    {
+        SET_ERROR(err, "malloc failed (receive_hash)");
+
+        return -1;
+    }
+
+    keyspace_init(ws->keyspace);
+
+    // The job header: the hashes, then the keyspace, one message each, up to END.
+    for (;;)
+    {
+        if (recv_message(sockfd, ws, &msg, buffer, err) == -1)
+            return -1;
 
-    int parsed = sscanf(buffer + 5,
-                        "%" SCNu64 " %" SCNu64 " %" SCNu32 " %" SCNu32,
-                        &start, &len, &checkpoint, &timeout);
+        if (msg.type == MSG_END)
+            break;
 
-    if (parsed != 4)
+        if (add_header_message(ws, &msg, &header, err) == -1)
+            return -1;
+    }
+
+    if ((ws->num_targets == 0) != (ws->rainbow && ws->rainbow->build))
+    {
+        SET_ERROR(err, ws->num_targets == 0 ? "Job from server has no hashes" : "Rainbow build job with hashes");
+        return -1;
+    }
+
+    if (keyspace_finalize(ws->keyspace, err) == -1 || (ws->num_targets > 0 && prepare_targets(ws, err) == -1) ||
+        (ws->rainbow && prepare_rainbow(ws, err) == -1))
+        return -1;
+
+    if (ws->keyspace->markov)
+        printf("[WORKER] Markov ordering, threshold %zu\n", ws->keyspace->markov_threshold);
+
+    if (ws->keyspace->mode == KEYSPACE_MASK)
+        printf("[WORKER] Mask mode: %zu positions, keyspace=%" PRIu64 "\n", ws->keyspace->length, ws->keyspace->size);
+    else if (ws->keyspace->mode == KEYSPACE_HYBRID)
+        printf("[WORKER] Hybrid mode: %s %zu positions, %s-major, keyspace=%" PRIu64 "\n",
+               ws->keyspace->prepend ? "prepend" : "append", ws->keyspace->length,
+               ws->keyspace->mask_major ? "mask" : "word", ws->keyspace->size);
+    else if (ws->keyspace->mode == KEYSPACE_WORDLIST)
+        printf("[WORKER] Wordlist mode: %zu rules, keyspace=%" PRIu64 "\n", ws->keyspace->rules.count,
+               ws->keyspace->size);
+
+    return send_message(ws, MSG_READY, NULL, 0, NULL, err);
+}
+
+int send_done(worker_state *ws, struct fsm_error *err)
+{
+    return send_message(ws, MSG_DONE, NULL, 0, NULL, err);
+}
+
+int send_next(worker_state *ws, struct fsm_error *err)
+{
+    return send_message(ws, MSG_NEXT, NULL, 0, NULL, err);
+}
+
+int wait_for_work(int sockfd, worker_state *ws, struct fsm_error *err)
+{
+    char             buffer[RECV_BUF_SIZE + 1];
+    protocol_message msg;
+
+    // Hashes other workers cracked since our last chunk come first.
+    for (;;)
+    {
+        if (recv_message(sockfd, ws, &msg, buffer, err) == -1)
+            return -1;
+
+        if (msg.type != MSG_CRACKED)
+            break;
+
+        for (size_t i = 0; i < ws->num_targets; i++)
+        {
+            if (strcmp(ws->hashes[i], msg.text) == 0 && mark_cracked(ws, i))
+                printf("[WORKER] %s was cracked by another worker\n", ws->hashes[i]);
+        }
+    }
+
+    if (msg.type == MSG_STOP)
+    {
+        printf("[WORKER] Received STOP from server\n");
+        return 1;
+    }
+
+    if (msg.type != MSG_WORK || msg.values[1] == 0 || msg.values[3] > UINT32_MAX)
     {
         char message[256];
-        snprintf(message, sizeof(message), "[WORKER] Failed to parse WORK message: %s\n", buffer);
+        snprintf(message, sizeof(message), "[WORKER] Invalid %s while waiting for WORK\n",
+                 protocol_message_name(msg.type));
         SET_ERROR(err, message);
 
         return -1;
     }
 
-    ws->start_index         = start;
-    ws->work_size           = len;
-    ws->end_index           = start + len - 1;
-    ws->checkpoint_interval = checkpoint;
-    ws->timeout_seconds     = timeout;
+    ws->start_index         = msg.values[0];
+    ws->work_size           = msg.values[1];
+    ws->end_index           = ws->start_index + ws->work_size - 1;
+    ws->checkpoint_interval = msg.values[2];
+    ws->timeout_seconds     = (uint32_t)msg.values[3];
 
     printf("[WORKER] Received WORK: start=%" PRIu64
            ", len=%" PRIu64 ", checkpoint=%" PRIu64 ", timeout=%u, end index: %" PRIu64 "\n",
@@ -194,50 +701,42 @@ int send_checkpoint(worker_state *ws, uint64_t idx)
     if (!ws || ws->sockfd <= 0)
         return -1;
 
-    char buffer[128];
-    int  n = snprintf(buffer, sizeof(buffer), "CHECKPOINT %" PRIu64 "\n", idx);
-
-    if (n <= 0 || n >= (int)sizeof(buffer))
-    {
-        fprintf(stderr, "send_checkpoint(): snprintf failed\n");
+    if (send_message(ws, MSG_CHECKPOINT, &idx, 1, NULL, NULL) == -1)
         return -1;
-    }
 
-    ssize_t sent = send(ws->sockfd, buffer, n, 0);
-    if (sent != n)
-    {
-        return -1;
-    }
     printf("Sent checkpoint %" PRIu64 "\n", idx);
 
     return 0;
 }
 
-int send_found(int sockfd, const char *password)
+// CHAIN: first, then the ends of consecutive chains from first on.
+int send_chains(worker_state *ws, uint64_t first, const uint64_t *ends, size_t n)
 {
-    if (!password)
-    {
-        // SET_ERROR(err, "send_found(): password is NULL");
-        return -1;
-    }
+    uint64_t values[RAINBOW_CHAINS_PER_LINE + 1];
 
-    char buffer[256];
+    if (n > RAINBOW_CHAINS_PER_LINE)
+        n = RAINBOW_CHAINS_PER_LINE;
 
-    int n = snprintf(buffer, sizeof(buffer), "FOUND %s\n", password);
-    if (n <= 0 || n >= (int)sizeof(buffer))
-    {
-        // SET_ERROR(err, "send_found(): snprintf failed or message too long");
+    values[0] = first;
+    memcpy(values + 1, ends, n * sizeof(*ends));
+
+    return send_message(ws, MSG_CHAIN, values, n + 1, NULL, NULL);
+}
+
+// FOUND: the hash's length, then the hash and the password with a space between.
+int send_found(worker_state *ws, const char *hash, const char *password)
+{
+    char     text[512];
+    uint64_t hash_len = strlen(hash);
+
+    if (!password)
         return -1;
-    }
 
-    ssize_t sent = send(sockfd, buffer, n, 0);
-    if (sent != n)
-    {
-        // SET_ERROR(err, "send_found(): send() failed");
+    int n = snprintf(text, sizeof(text), "%s %s", hash, password);
+    if (n <= 0 || n >= (int)sizeof(text))
         return -1;
-    }
 
-    return 0;
+    return send_message(ws, MSG_FOUND, &hash_len, 1, text, NULL);
 }
 
 int start_listening(int sockfd, int backlog, struct fsm_error *err)
@@ -0,0 +1,121 @@
+#include "sha1.h"
+#include <string.h>
+
+static void sha1_compress(uint32_t h[5], const uint8_t block[64]);
+
+const uint32_t sha1_iv[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+const uint32_t sha1_k[4]  = {0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6};
+
+static inline uint32_t rol32(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void sha1_compress(uint32_t h[5], const uint8_t block[64])
+{
+    uint32_t w[80];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = load_be32(block + i * 4);
+
+    for (int i = 16; i < 80; i++)
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    for (int i = 0; i < 80; i++)
+    {
+        uint32_t f;
+
+        if (i < 20)
+            f = d ^ (b & (c ^ d));
+        else if (i < 40 || i >= 60)
+            f = b ^ c ^ d;
+        else
+            f = (b & c) | (d & (b | c));
+
+        uint32_t t = rol32(a, 5) + f + e + sha1_k[i / 20] + w[i];
+
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void sha1_init(sha1_ctx *ctx)
+{
+    memcpy(ctx->h, sha1_iv, sizeof(sha1_iv));
+    ctx->len  = 0;
+    ctx->used = 0;
+}
+
+void sha1_update(sha1_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    ctx->len += len;
+
+    if (ctx->used > 0)
+    {
+        size_t take = (len < 64 - ctx->used) ? len : 64 - ctx->used;
+
+        memcpy(ctx->buf + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+
+        if (ctx->used < 64)
+            return;
+
+        sha1_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    for (; len >= 64; p += 64, len -= 64)
+        sha1_compress(ctx->h, p);
+
+    memcpy(ctx->buf, p, len);
+    ctx->used = len;
+}
+
+void sha1_final(sha1_ctx *ctx, uint8_t out[SHA1_DIGEST_LEN])
+{
+    uint64_t bits = ctx->len * 8;
+
+    ctx->buf[ctx->used++] = 0x80;
+
+    if (ctx->used > 56)
+    {
+        memset(ctx->buf + ctx->used, 0, 64 - ctx->used);
+        sha1_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    memset(ctx->buf + ctx->used, 0, 56 - ctx->used);
+    store_be32(ctx->buf + 56, (uint32_t)(bits >> 32));
+    store_be32(ctx->buf + 60, (uint32_t)bits);
+    sha1_compress(ctx->h, ctx->buf);
+
+    for (int i = 0; i < 5; i++)
+        store_be32(out + i * 4, ctx->h[i]);
+}
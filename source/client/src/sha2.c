@@ -0,0 +1,357 @@
+#include "sha2.h"
+#include <string.h>
+
+static void sha256_compress(uint32_t h[8], const uint8_t block[64]);
+static void sha512_compress(uint64_t h[8], const uint8_t block[128]);
+
+const uint32_t sha256_iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+const uint64_t sha512_iv[8] = {0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+                               0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179};
+
+const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const uint64_t sha512_k[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+static inline uint32_t ror32(uint32_t x, unsigned n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint64_t ror64(uint64_t x, unsigned n)
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+    return (uint64_t)load_be32(p) << 32 | load_be32(p + 4);
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline void store_be64(uint8_t *p, uint64_t v)
+{
+    store_be32(p, (uint32_t)(v >> 32));
+    store_be32(p + 4, (uint32_t)v);
+}
+
+// One round of either hash. The eight working variables rotate through the
+// macro arguments instead of being shuffled, so an unrolled group of eight
+// rounds leaves every variable back in its own register.
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                                                                 \
+    do                                                                                                          \
+    {                                                                                                           \
+        uint32_t t1 = h + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) + (g ^ (e & (f ^ g))) + sha256_k[i] + w[i]; \
+        uint32_t t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) + ((a & b) | (c & (a | b)));                 \
+        d += t1;                                                                                                \
+        h = t1 + t2;                                                                                            \
+    } while (0)
+
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i)                                                                    \
+    do                                                                                                             \
+    {                                                                                                              \
+        uint64_t t1 = h + (ror64(e, 14) ^ ror64(e, 18) ^ ror64(e, 41)) + (g ^ (e & (f ^ g))) + sha512_k[i] + w[i];    \
+        uint64_t t2 = (ror64(a, 28) ^ ror64(a, 34) ^ ror64(a, 39)) + ((a & b) | (c & (a | b)));                    \
+        d += t1;                                                                                                   \
+        h = t1 + t2;                                                                                               \
+    } while (0)
+
+static void sha256_compress(uint32_t h[8], const uint8_t block[64])
+{
+    uint32_t w[64];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = load_be32(block + i * 4);
+
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ror32(w[i - 15], 7) ^ ror32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror32(w[i - 2], 17) ^ ror32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for (int i = 0; i < 64; i += 8)
+    {
+        SHA256_ROUND(a, b, c, d, e, f, g, hh, i);
+        SHA256_ROUND(hh, a, b, c, d, e, f, g, i + 1);
+        SHA256_ROUND(g, hh, a, b, c, d, e, f, i + 2);
+        SHA256_ROUND(f, g, hh, a, b, c, d, e, i + 3);
+        SHA256_ROUND(e, f, g, hh, a, b, c, d, i + 4);
+        SHA256_ROUND(d, e, f, g, hh, a, b, c, i + 5);
+        SHA256_ROUND(c, d, e, f, g, hh, a, b, i + 6);
+        SHA256_ROUND(b, c, d, e, f, g, hh, a, i + 7);
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+}
+
+static void sha512_compress(uint64_t h[8], const uint8_t block[128])
+{
+    uint64_t w[80];
+    uint64_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = load_be64(block + i * 8);
+
+    for (int i = 16; i < 80; i++)
+    {
+        uint64_t s0 = ror64(w[i - 15], 1) ^ ror64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+        uint64_t s1 = ror64(w[i - 2], 19) ^ ror64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+        w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for (int i = 0; i < 80; i += 8)
+    {
+        SHA512_ROUND(a, b, c, d, e, f, g, hh, i);
+        SHA512_ROUND(hh, a, b, c, d, e, f, g, i + 1);
+        SHA512_ROUND(g, hh, a, b, c, d, e, f, i + 2);
+        SHA512_ROUND(f, g, hh, a, b, c, d, e, i + 3);
+        SHA512_ROUND(e, f, g, hh, a, b, c, d, i + 4);
+        SHA512_ROUND(d, e, f, g, hh, a, b, c, i + 5);
+        SHA512_ROUND(c, d, e, f, g, hh, a, b, i + 6);
+        SHA512_ROUND(b, c, d, e, f, g, hh, a, i + 7);
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+}
+
+void sha256_init(sha256_ctx *ctx)
+{
+    memcpy(ctx->h, sha256_iv, sizeof(sha256_iv));
+    ctx->len  = 0;
+    ctx->used = 0;
+}
+
+void sha256_update(sha256_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    ctx->len += len;
+
+    if (ctx->used > 0)
+    {
+        size_t take = (len < 64 - ctx->used) ? len : 64 - ctx->used;
+
+        memcpy(ctx->buf + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+
+        if (ctx->used < 64)
+            return;
+
+        sha256_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    for (; len >= 64; p += 64, len -= 64)
+        sha256_compress(ctx->h, p);
+
+    memcpy(ctx->buf, p, len);
+    ctx->used = len;
+}
+
+void sha256_final(sha256_ctx *ctx, uint8_t out[SHA256_DIGEST_LEN])
+{
+    uint64_t bits = ctx->len * 8;
+
+    ctx->buf[ctx->used++] = 0x80;
+
+    if (ctx->used > 56)
+    {
+        memset(ctx->buf + ctx->used, 0, 64 - ctx->used);
+        sha256_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    memset(ctx->buf + ctx->used, 0, 56 - ctx->used);
+    store_be64(ctx->buf + 56, bits);
+    sha256_compress(ctx->h, ctx->buf);
+
+    for (int i = 0; i < 8; i++)
+        store_be32(out + i * 4, ctx->h[i]);
+}
+
+void hmac_sha256_init(hmac_sha256_ctx *ctx, const void *key, size_t key_len)
+{
+    uint8_t pad[64];
+    uint8_t hashed[SHA256_DIGEST_LEN];
+
+    if (key_len > sizeof(pad))
+    {
+        sha256_init(&ctx->inner);
+        sha256_update(&ctx->inner, key, key_len);
+        sha256_final(&ctx->inner, hashed);
+        key     = hashed;
+        key_len = sizeof(hashed);
+    }
+
+    memset(pad, 0x36, sizeof(pad));
+    for (size_t i = 0; i < key_len; i++)
+        pad[i] ^= ((const uint8_t *)key)[i];
+
+    sha256_init(&ctx->inner);
+    sha256_update(&ctx->inner, pad, sizeof(pad));
+
+    for (size_t i = 0; i < sizeof(pad); i++)
+        pad[i] ^= 0x36 ^ 0x5c;
+
+    sha256_init(&ctx->outer);
+    sha256_update(&ctx->outer, pad, sizeof(pad));
+}
+
+void hmac_sha256_final(hmac_sha256_ctx *ctx, uint8_t out[SHA256_DIGEST_LEN])
+{
+    uint8_t inner[SHA256_DIGEST_LEN];
+
+    sha256_final(&ctx->inner, inner);
+    sha256_update(&ctx->outer, inner, sizeof(inner));
+    sha256_final(&ctx->outer, out);
+}
+
+void hmac_sha256(const void *key, size_t key_len, const void *msg, size_t msg_len, uint8_t out[SHA256_DIGEST_LEN])
+{
+    hmac_sha256_ctx ctx;
+
+    hmac_sha256_init(&ctx, key, key_len);
+    sha256_update(&ctx.inner, msg, msg_len);
+    hmac_sha256_final(&ctx, out);
+}
+
+// The keyed state and the salt are hashed once and copied for every block.
+void pbkdf2_sha256(const void *pass, size_t pass_len, const void *salt, size_t salt_len, uint8_t *out,
+                   size_t out_len)
+{
+    hmac_sha256_ctx keyed;
+
+    hmac_sha256_init(&keyed, pass, pass_len);
+    sha256_update(&keyed.inner, salt, salt_len);
+
+    for (uint32_t block = 1; out_len > 0; block++)
+    {
+        hmac_sha256_ctx ctx = keyed;
+        uint8_t         index[4];
+        uint8_t         t[SHA256_DIGEST_LEN];
+        size_t          n = (out_len < sizeof(t)) ? out_len : sizeof(t);
+
+        store_be32(index, block);
+        sha256_update(&ctx.inner, index, sizeof(index));
+        hmac_sha256_final(&ctx, t);
+
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
+void sha512_init(sha512_ctx *ctx)
+{
+    memcpy(ctx->h, sha512_iv, sizeof(sha512_iv));
+    ctx->len  = 0;
+    ctx->used = 0;
+}
+
+void sha512_update(sha512_ctx *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    ctx->len += len;
+
+    if (ctx->used > 0)
+    {
+        size_t take = (len < 128 - ctx->used) ? len : 128 - ctx->used;
+
+        memcpy(ctx->buf + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+
+        if (ctx->used < 128)
+            return;
+
+        sha512_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    for (; len >= 128; p += 128, len -= 128)
+        sha512_compress(ctx->h, p);
+
+    memcpy(ctx->buf, p, len);
+    ctx->used = len;
+}
+
+void sha512_final(sha512_ctx *ctx, uint8_t out[SHA512_DIGEST_LEN])
+{
+    uint64_t bits = ctx->len * 8;
+
+    ctx->buf[ctx->used++] = 0x80;
+
+    if (ctx->used > 112)
+    {
+        memset(ctx->buf + ctx->used, 0, 128 - ctx->used);
+        sha512_compress(ctx->h, ctx->buf);
+        ctx->used = 0;
+    }
+
+    // Messages here never reach 2^64 bits, so the high half of the length is zero.
+    memset(ctx->buf + ctx->used, 0, 120 - ctx->used);
+    store_be64(ctx->buf + 120, bits);
+    sha512_compress(ctx->h, ctx->buf);
+
+    for (int i = 0; i < 8; i++)
+        store_be64(out + i * 8, ctx->h[i]);
+}
@@ -0,0 +1,151 @@
+#include "sha_crypt.h"
+#include "sha2.h"
+#include <string.h>
+
+// SHA-256- and SHA-512-crypt (Drepper's scheme) computed directly on raw
+// digests. The two differ only in the underlying hash, so one routine serves
+// both and picks the hash per call.
+typedef union sha_ctx
+{
+    sha256_ctx s256;
+    sha512_ctx s512;
+} sha_ctx;
+
+static bool sha256_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static bool sha512_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+
+const hash_engine sha256_crypt_engine = {"sha256-crypt", 1, sha256_crypt_check, NULL, NULL};
+const hash_engine sha512_crypt_engine = {"sha512-crypt", 1, sha512_crypt_check, NULL, NULL};
+
+static inline void ctx_init(sha_ctx *ctx, bool wide)
+{
+    if (wide)
+        sha512_init(&ctx->s512);
+    else
+        sha256_init(&ctx->s256);
+}
+
+static inline void ctx_update(sha_ctx *ctx, bool wide, const void *data, size_t len)
+{
+    if (wide)
+        sha512_update(&ctx->s512, data, len);
+    else
+        sha256_update(&ctx->s256, data, len);
+}
+
+static inline void ctx_final(sha_ctx *ctx, bool wide, uint8_t *out)
+{
+    if (wide)
+        sha512_final(&ctx->s512, out);
+    else
+        sha256_final(&ctx->s256, out);
+}
+
+void sha_crypt_prepare(const hash_target *target, const char *key, size_t key_len, bool wide, sha_crypt_state *st)
+{
+    const size_t dlen = wide ? SHA512_DIGEST_LEN : SHA256_DIGEST_LEN;
+    const char  *salt = target->salt;
+    const size_t slen = target->salt_len;
+    sha_ctx      ctx;
+    uint8_t      b[SHA512_DIGEST_LEN];
+    size_t       cnt;
+
+    st->key_len = key_len;
+
+    // B = H(key salt key)
+    ctx_init(&ctx, wide);
+    ctx_update(&ctx, wide, key, key_len);
+    ctx_update(&ctx, wide, salt, slen);
+    ctx_update(&ctx, wide, key, key_len);
+    ctx_final(&ctx, wide, b);
+
+    // A = H(key salt B-repeated-to-key-length, then B or key per bit of the key length)
+    ctx_init(&ctx, wide);
+    ctx_update(&ctx, wide, key, key_len);
+    ctx_update(&ctx, wide, salt, slen);
+
+    for (cnt = key_len; cnt > dlen; cnt -= dlen)
+        ctx_update(&ctx, wide, b, dlen);
+    ctx_update(&ctx, wide, b, cnt);
+
+    for (cnt = key_len; cnt > 0; cnt >>= 1)
+    {
+        if (cnt & 1)
+            ctx_update(&ctx, wide, b, dlen);
+        else
+            ctx_update(&ctx, wide, key, key_len);
+    }
+
+    ctx_final(&ctx, wide, st->a);
+
+    // P = H(key repeated key-length times), stretched to the key length.
+    ctx_init(&ctx, wide);
+    for (cnt = 0; cnt < key_len; cnt++)
+        ctx_update(&ctx, wide, key, key_len);
+    ctx_final(&ctx, wide, b);
+
+    for (cnt = 0; cnt + dlen <= key_len; cnt += dlen)
+        memcpy(st->p_bytes + cnt, b, dlen);
+    memcpy(st->p_bytes + cnt, b, key_len - cnt);
+
+    // S = H(salt repeated 16 + A[0] times), cut to the salt length.
+    ctx_init(&ctx, wide);
+    for (cnt = 0; cnt < 16u + st->a[0]; cnt++)
+        ctx_update(&ctx, wide, salt, slen);
+    ctx_final(&ctx, wide, b);
+
+    memcpy(st->s_bytes, b, slen);
+}
+
+void sha_crypt_rounds(const hash_target *target, sha_crypt_state *st, bool wide)
+{
+    const size_t dlen = wide ? SHA512_DIGEST_LEN : SHA256_DIGEST_LEN;
+    const size_t slen = target->salt_len;
+    sha_ctx      ctx;
+
+    for (uint32_t round = 0; round < target->cost; round++)
+    {
+        ctx_init(&ctx, wide);
+
+        if (round & 1)
+            ctx_update(&ctx, wide, st->p_bytes, st->key_len);
+        else
+            ctx_update(&ctx, wide, st->a, dlen);
+
+        if (round % 3 != 0)
+            ctx_update(&ctx, wide, st->s_bytes, slen);
+
+        if (round % 7 != 0)
+            ctx_update(&ctx, wide, st->p_bytes, st->key_len);
+
+        if (round & 1)
+            ctx_update(&ctx, wide, st->a, dlen);
+        else
+            ctx_update(&ctx, wide, st->p_bytes, st->key_len);
+
+        ctx_final(&ctx, wide, st->a);
+    }
+}
+
+bool sha_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch, bool wide)
+{
+    sha_crypt_state st;
+
+    if (key_len > SHA_CRYPT_MAX_KEY)
+        return crypt_engine.check(target, key, key_len, scratch);
+
+    sha_crypt_prepare(target, key, key_len, wide, &st);
+    sha_crypt_rounds(target, &st, wide);
+
+    return hash_digest_match(target, st.a);
+}
+
+static bool sha256_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return sha_crypt_check(target, key, key_len, scratch, false);
+}
+
+static bool sha512_crypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return sha_crypt_check(target, key, key_len, scratch, true);
+}
@@ -0,0 +1,263 @@
+#include "sha2.h"
+#include "sha_crypt.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+// Each kernel is the same source compiled for a different width and
+// instruction set; the function attributes keep the rest of the program
+// free of AVX so it still runs on CPUs without it.
+void sha256_crypt_x8_avx2(const hash_target *target, sha_crypt_state *st, size_t n, bool *match);
+void sha512_crypt_x4_avx2(const hash_target *target, sha_crypt_state *st, size_t n, bool *match);
+void sha256_crypt_x16_avx512(const hash_target *target, sha_crypt_state *st, size_t n, bool *match);
+void sha512_crypt_x8_avx512(const hash_target *target, sha_crypt_state *st, size_t n, bool *match);
+
+    #define SHA_LANES 8
+    #define SHA_WIDE 0
+    #define SHA_TARGET "avx2"
+    #define SHA_NAME sha256_crypt_x8_avx2
+    #include "sha_crypt_lanes.h"
+    #undef SHA_LANES
+    #undef SHA_WIDE
+    #undef SHA_TARGET
+    #undef SHA_NAME
+
+    #define SHA_LANES 4
+    #define SHA_WIDE 1
+    #define SHA_TARGET "avx2"
+    #define SHA_NAME sha512_crypt_x4_avx2
+    #include "sha_crypt_lanes.h"
+    #undef SHA_LANES
+    #undef SHA_WIDE
+    #undef SHA_TARGET
+    #undef SHA_NAME
+
+    #define SHA_LANES 16
+    #define SHA_WIDE 0
+    #define SHA_TARGET "avx512f"
+    #define SHA_NAME sha256_crypt_x16_avx512
+    #include "sha_crypt_lanes.h"
+    #undef SHA_LANES
+    #undef SHA_WIDE
+    #undef SHA_TARGET
+    #undef SHA_NAME
+
+    #define SHA_LANES 8
+    #define SHA_WIDE 1
+    #define SHA_TARGET "avx512f"
+    #define SHA_NAME sha512_crypt_x8_avx512
+    #include "sha_crypt_lanes.h"
+    #undef SHA_LANES
+    #undef SHA_WIDE
+    #undef SHA_TARGET
+    #undef SHA_NAME
+
+static bool sha256_simd_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static bool sha512_simd_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int  simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                       hash_scratch *scratch, bool wide, sha_crypt_kernel kernel, size_t lanes);
+static int  sha256_avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                              hash_scratch *scratch);
+static int  sha512_avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                              hash_scratch *scratch);
+static int  sha256_avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens,
+                                size_t n, hash_scratch *scratch);
+static int  sha512_avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens,
+                                size_t n, hash_scratch *scratch);
+static bool self_test(const hash_target *target, bool wide, sha_crypt_kernel kernel, size_t lanes);
+
+static const hash_engine sha256_avx2_engine   = {"sha256-crypt/avx2x8", 8, sha256_simd_check, sha256_avx2_batch, NULL};
+static const hash_engine sha512_avx2_engine   = {"sha512-crypt/avx2x4", 4, sha512_simd_check, sha512_avx2_batch, NULL};
+static const hash_engine sha256_avx512_engine = {"sha256-crypt/avx512x16", 16, sha256_simd_check,
+                                                 sha256_avx512_batch, NULL};
+static const hash_engine sha512_avx512_engine = {"sha512-crypt/avx512x8", 8, sha512_simd_check,
+                                                 sha512_avx512_batch, NULL};
+
+static const sha_crypt_simd avx2_kernels[]   = {
+    {&sha256_avx2_engine, sha256_crypt_x8_avx2, false},
+    {&sha512_avx2_engine, sha512_crypt_x4_avx2, true },
+};
+static const sha_crypt_simd avx512_kernels[] = {
+    {&sha256_avx512_engine, sha256_crypt_x16_avx512, false},
+    {&sha512_avx512_engine, sha512_crypt_x8_avx512,  true },
+};
+
+static bool sha256_simd_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return sha_crypt_check(target, key, key_len, scratch, false);
+}
+
+static bool sha512_simd_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    return sha_crypt_check(target, key, key_len, scratch, true);
+}
+
+static int simd_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                      hash_scratch *scratch, bool wide, sha_crypt_kernel kernel, size_t lanes)
+{
+    sha_crypt_state st[SHA_CRYPT_MAX_LANES];
+    size_t          index[SHA_CRYPT_MAX_LANES];
+    bool            match[SHA_CRYPT_MAX_LANES];
+    size_t          m = 0;
+
+    for (size_t i = 0; i < n && i < lanes; i++)
+    {
+        // Keys too long for the fixed message buffers take the scalar path.
+        if (key_lens[i] > SHA_CRYPT_SIMD_MAX_KEY)
+        {
+            if (sha_crypt_check(target, keys[i], key_lens[i], scratch, wide))
+                return (int)i;
+            continue;
+        }
+
+        sha_crypt_prepare(target, keys[i], key_lens[i], wide, &st[m]);
+        index[m++] = i;
+    }
+
+    if (m == 0)
+        return -1;
+
+    kernel(target, st, m, match);
+
+    for (size_t i = 0; i < m; i++)
+    {
+        if (match[i])
+            return (int)index[i];
+    }
+
+    return -1;
+}
+
+static int sha256_avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                             hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, false, sha256_crypt_x8_avx2, 8);
+}
+
+static int sha512_avx2_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                             hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, true, sha512_crypt_x4_avx2, 4);
+}
+
+static int sha256_avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                               hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, false, sha256_crypt_x16_avx512, 16);
+}
+
+static int sha512_avx512_batch(const hash_target *target, const char *const *keys, const size_t *key_lens, size_t n,
+                               hash_scratch *scratch)
+{
+    return simd_batch(target, keys, key_lens, n, scratch, true, sha512_crypt_x8_avx512, 8);
+}
+
+// Runs a short round count through the kernel and the scalar code with the
+// job's salt, on key lengths that cover one- to three-block messages, and
+// only trusts the kernel if every lane agrees bit for bit.
+static bool self_test(const hash_target *target, bool wide, sha_crypt_kernel kernel, size_t lanes)
+{
+    hash_target     probe = *target;
+    sha_crypt_state simd[SHA_CRYPT_MAX_LANES];
+    sha_crypt_state scalar;
+    bool            match[SHA_CRYPT_MAX_LANES];
+    char            key[SHA_CRYPT_SIMD_MAX_KEY + 1];
+
+    probe.cost = 42;
+
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        for (size_t l = 0; l < lanes; l++)
+        {
+            size_t len = (pass * lanes + l) * 29 % (SHA_CRYPT_SIMD_MAX_KEY + 1);
+
+            for (size_t i = 0; i < len; i++)
+                key[i] = (char)('!' + (l * 7 + i * 13) % 94);
+
+            sha_crypt_prepare(&probe, key, len, wide, &simd[l]);
+        }
+
+        kernel(&probe, simd, lanes, match);
+
+        for (size_t l = 0; l < lanes; l++)
+        {
+            size_t len = (pass * lanes + l) * 29 % (SHA_CRYPT_SIMD_MAX_KEY + 1);
+
+            for (size_t i = 0; i < len; i++)
+                key[i] = (char)('!' + (l * 7 + i * 13) % 94);
+
+            sha_crypt_prepare(&probe, key, len, wide, &scalar);
+            sha_crypt_rounds(&probe, &scalar, wide);
+
+            if (memcmp(scalar.a, simd[l].a, wide ? SHA512_DIGEST_LEN : SHA256_DIGEST_LEN) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+const hash_engine *sha_crypt_select_engine(const hash_target *target)
+{
+    bool               wide   = target->scheme == HASH_SCHEME_SHA512;
+    const hash_engine *engine = NULL;
+    sha_crypt_kernel   kernel = NULL;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        engine = wide ? &sha512_avx512_engine : &sha256_avx512_engine;
+        kernel = wide ? sha512_crypt_x8_avx512 : sha256_crypt_x16_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        engine = wide ? &sha512_avx2_engine : &sha256_avx2_engine;
+        kernel = wide ? sha512_crypt_x4_avx2 : sha256_crypt_x8_avx2;
+    }
+
+    if (engine && self_test(target, wide, kernel, engine->lanes))
+        return engine;
+
+    if (engine)
+        fprintf(stderr, "[WORKER] %s failed its self-test, using the scalar engine\n", engine->name);
+
+    return wide ? &sha512_crypt_engine : &sha256_crypt_engine;
+}
+
+size_t sha_crypt_simd_kernels(const sha_crypt_simd *kernels[SHA_CRYPT_SIMD_KERNELS])
+{
+    size_t n = 0;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        for (size_t i = 0; i < sizeof(avx2_kernels) / sizeof(avx2_kernels[0]); i++)
+            kernels[n++] = &avx2_kernels[i];
+    }
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        for (size_t i = 0; i < sizeof(avx512_kernels) / sizeof(avx512_kernels[0]); i++)
+            kernels[n++] = &avx512_kernels[i];
+    }
+
+    return n;
+}
+
+#else
+
+const hash_engine *sha_crypt_select_engine(const hash_target *target)
+{
+    return (target->scheme == HASH_SCHEME_SHA512) ? &sha512_crypt_engine : &sha256_crypt_engine;
+}
+
+size_t sha_crypt_simd_kernels(const sha_crypt_simd *kernels[SHA_CRYPT_SIMD_KERNELS])
+{
+    (void)kernels;
+    return 0;
+}
+
+#endif
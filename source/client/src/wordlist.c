@@ -0,0 +1,124 @@
+#include "wordlist.h"
+#include "fsm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int wordlist_open(wordlist *wl, const char *path, struct fsm_error *err)
+{
+    struct stat st;
+    int         fd;
+
+    memset(wl, 0, sizeof(*wl));
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size == 0)
+    {
+        SET_ERROR(err, "Wordlist is empty");
+        close(fd);
+        return -1;
+    }
+
+    wl->size = (size_t)st.st_size;
+    wl->data = mmap(NULL, wl->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (wl->data == MAP_FAILED)
+    {
+        wl->data = NULL;
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    madvise(wl->data, wl->size, MADV_SEQUENTIAL);
+
+    // Every '\n' ends a line, plus one more if the last line is unterminated.
+    const char *p   = wl->data;
+    const char *end = wl->data + wl->size;
+
+    while ((p = memchr(p, '\n', (size_t)(end - p))) != NULL)
+    {
+        wl->count++;
+        p++;
+    }
+
+    if (wl->data[wl->size - 1] != '\n')
+        wl->count++;
+
+    // offset(count) points one past the final line's terminator, real or implied.
+    bool   small = wl->size < UINT32_MAX;
+    size_t width = small ? sizeof(uint32_t) : sizeof(uint64_t);
+    void  *index = malloc((wl->count + 1) * width);
+
+    if (!index)
+    {
+        SET_ERROR(err, "malloc failed (wordlist_open)");
+        wordlist_close(wl);
+        return -1;
+    }
+
+    if (small)
+        wl->offsets32 = index;
+    else
+        wl->offsets64 = index;
+
+    uint64_t line  = 0;
+    uint64_t start = 0;
+
+    for (p = wl->data; (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++)
+    {
+        if (small)
+            wl->offsets32[line] = (uint32_t)start;
+        else
+            wl->offsets64[line] = start;
+
+        line++;
+        start = (uint64_t)(p - wl->data) + 1;
+    }
+
+    if (line < wl->count)
+    {
+        if (small)
+            wl->offsets32[line] = (uint32_t)start;
+        else
+            wl->offsets64[line] = start;
+        line++;
+    }
+
+    if (small)
+        wl->offsets32[line] = (uint32_t)(wl->data[wl->size - 1] == '\n' ? wl->size : wl->size + 1);
+    else
+        wl->offsets64[line] = (wl->data[wl->size - 1] == '\n') ? wl->size : wl->size + 1;
+
+    madvise(wl->data, wl->size, MADV_NORMAL);
+
+    printf("[WORKER] Loaded wordlist %s: %" PRIu64 " lines\n", path, wl->count);
+
+    return 0;
+}
+
+void wordlist_close(wordlist *wl)
+{
+    if (wl->data)
+        munmap(wl->data, wl->size);
+
+    free(wl->offsets32);
+    free(wl->offsets64);
+    memset(wl, 0, sizeof(*wl));
+}
@@ -0,0 +1,739 @@
+#include "hash_engine.h"
+#include "sha2.h"
+#include "yescrypt.h"
+#include <string.h>
+#include <sys/mman.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// yescrypt and classic scrypt run natively. Everything a hash needs (V, the
+// pwxform S-boxes, B and the block-mix scratch) lives in the thread's arena,
+// so after the first candidate nothing is allocated, faulted in or freed.
+// Blocks are held as 32-bit words in the order Salsa20's SIMD form uses
+// (word i of a 64-byte block at position i * 5 % 16 of the natural order),
+// which is also the order pwxform reads them in.
+#define PWX_SIMPLE 2
+#define PWX_GATHER 4
+#define PWX_ROUNDS 6
+#define PWX_LANES (PWX_GATHER * PWX_SIMPLE)
+#define PWX_WORDS (PWX_LANES * 2)
+#define S_WIDTH 8
+#define S_PAIRS ((1 << S_WIDTH) * PWX_SIMPLE)      // 64-bit entries per S-box
+#define S_BYTES (3 * S_PAIRS * 8)                   // all three S-boxes
+#define S_MASK (((1 << S_WIDTH) - 1) * PWX_SIMPLE * 8) // byte offset of a gather within an S-box
+#define YESCRYPT_PREHASH 0x10000000
+#define ARENA_ALIGN ((size_t)2 << 20)
+
+typedef struct pwxform_ctx
+{
+    uint64_t *s0;
+    uint64_t *s1;
+    uint64_t *s2;
+    size_t    w;
+} pwxform_ctx;
+
+// Where each part of one hash sits inside the arena.
+typedef struct yescrypt_layout
+{
+    uint32_t    *v;
+    uint32_t    *xy;
+    uint32_t    *s;
+    uint8_t     *b;
+    pwxform_ctx *ctx;
+} yescrypt_layout;
+
+static bool     yescrypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch);
+static int      arena_reserve(yescrypt_arena *arena, size_t size);
+static void     salsa20(uint32_t b[16], int rounds);
+static void     blockmix_salsa8(uint32_t *b, uint32_t *y, size_t r);
+static void     blockmix_pwxform(uint32_t *b, size_t r, pwxform_ctx *ctx);
+static uint64_t integerify(const uint32_t *b, size_t r);
+static void     smix1(uint8_t *b, size_t r, uint32_t n, uint32_t flags, uint32_t *v, uint32_t *xy, pwxform_ctx *ctx);
+static void     smix2(uint8_t *b, size_t r, uint32_t n, uint64_t nloop, uint32_t flags, uint32_t *v, uint32_t *xy,
+                      pwxform_ctx *ctx);
+static void     smix(uint8_t *b, size_t r, uint32_t n, uint32_t p, uint32_t t, uint32_t flags,
+                     const yescrypt_layout *mem, uint8_t passwd[SHA256_DIGEST_LEN]);
+static void     kdf_body(const yescrypt_params *params, uint32_t flags, uint32_t n, uint32_t t,
+                         const yescrypt_layout *mem, const uint8_t *passwd, size_t passwd_len, const uint8_t *salt,
+                         size_t salt_len, uint8_t out[YESCRYPT_HASH_LEN]);
+
+const hash_engine yescrypt_engine = {"yescrypt/arena", 1, yescrypt_check, NULL, NULL};
+
+static inline uint32_t rotl32(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// The largest power of two not above x.
+static inline uint32_t p2floor(uint32_t x)
+{
+    while (x & (x - 1))
+        x &= x - 1;
+    return x;
+}
+
+static inline uint32_t wrap(uint64_t x, uint32_t i)
+{
+    uint32_t n = p2floor(i);
+    return (uint32_t)(x & (n - 1)) + (i - n);
+}
+
+// yescrypt refuses the ROM, upgrade and non-default pwxform options; those
+// go to crypt_r. The limits keep every index in 32 bits and the arena in size_t.
+bool yescrypt_params_supported(const yescrypt_params *params)
+{
+    if (params->flags != 0 && params->flags != YESCRYPT_WORM && params->flags != YESCRYPT_DEFAULTS)
+        return false;
+    if (params->flags == 0 && params->t != 0)
+        return false;
+    if (params->N < 2 || params->N > UINT32_MAX || params->r == 0 || params->p == 0)
+        return false;
+    if ((uint64_t)params->r * params->p >= (1u << 30))
+        return false;
+    if ((params->flags & YESCRYPT_RW) && params->N / params->p < 4)
+        return false;
+
+    return params->N <= SIZE_MAX / 4 / 128 / params->r;
+}
+
+size_t yescrypt_memory(const yescrypt_params *params)
+{
+    size_t r    = params->r;
+    size_t p    = params->p;
+    size_t size = 128 * r * (size_t)params->N + 256 * r + 128 * r * p;
+
+    if (params->flags & YESCRYPT_RW)
+        size += (S_BYTES + sizeof(pwxform_ctx)) * p;
+
+    return size;
+}
+
+void yescrypt_arena_free(yescrypt_arena *arena)
+{
+    if (arena->base)
+        munmap(arena->base, arena->size);
+
+    arena->base = NULL;
+    arena->size = 0;
+}
+
+// Explicit huge pages when the system has some reserved, otherwise ordinary
+// pages with a hint for transparent ones; either way V is touched at random,
+// so fewer TLB misses pay off directly.
+static int arena_reserve(yescrypt_arena *arena, size_t size)
+{
+    void *base = MAP_FAILED;
+
+    if (arena->size >= size)
+        return 0;
+
+    yescrypt_arena_free(arena);
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+#ifdef MAP_HUGETLB
+    base              = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    arena->huge_pages = base != MAP_FAILED;
+#endif
+
+    if (base == MAP_FAILED)
+    {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return -1;
+#ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    arena->base = base;
+    arena->size = size;
+
+    return 0;
+}
+
+// Salsa20 with the input and output in SIMD order. That order puts each of
+// the four diagonals in one row, so with SSE2 a column or row step is a
+// single operation on four words and the switch between them is a shuffle.
+#if defined(__SSE2__)
+
+    #define SALSA_STEP(out, a, b, n)                                                                            \
+        do                                                                                                     \
+        {                                                                                                      \
+            __m128i sum = _mm_add_epi32(a, b);                                                                 \
+            out         = _mm_xor_si128(out, _mm_xor_si128(_mm_slli_epi32(sum, n), _mm_srli_epi32(sum, 32 - n))); \
+        } while (0)
+
+static void salsa20(uint32_t b[16], int rounds)
+{
+    __m128i in0 = _mm_loadu_si128((const __m128i *)(const void *)&b[0]);
+    __m128i in1 = _mm_loadu_si128((const __m128i *)(const void *)&b[4]);
+    __m128i in2 = _mm_loadu_si128((const __m128i *)(const void *)&b[8]);
+    __m128i in3 = _mm_loadu_si128((const __m128i *)(const void *)&b[12]);
+    __m128i x0  = in0;
+    __m128i x1  = in1;
+    __m128i x2  = in2;
+    __m128i x3  = in3;
+
+    for (int i = 0; i < rounds; i += 2)
+    {
+        SALSA_STEP(x1, x0, x3, 7);
+        SALSA_STEP(x2, x1, x0, 9);
+        SALSA_STEP(x3, x2, x1, 13);
+        SALSA_STEP(x0, x3, x2, 18);
+
+        x1 = _mm_shuffle_epi32(x1, 0x93);
+        x2 = _mm_shuffle_epi32(x2, 0x4e);
+        x3 = _mm_shuffle_epi32(x3, 0x39);
+
+        SALSA_STEP(x3, x0, x1, 7);
+        SALSA_STEP(x2, x3, x0, 9);
+        SALSA_STEP(x1, x2, x3, 13);
+        SALSA_STEP(x0, x1, x2, 18);
+
+        x1 = _mm_shuffle_epi32(x1, 0x39);
+        x2 = _mm_shuffle_epi32(x2, 0x4e);
+        x3 = _mm_shuffle_epi32(x3, 0x93);
+    }
+
+    _mm_storeu_si128((__m128i *)(void *)&b[0], _mm_add_epi32(in0, x0));
+    _mm_storeu_si128((__m128i *)(void *)&b[4], _mm_add_epi32(in1, x1));
+    _mm_storeu_si128((__m128i *)(void *)&b[8], _mm_add_epi32(in2, x2));
+    _mm_storeu_si128((__m128i *)(void *)&b[12], _mm_add_epi32(in3, x3));
+}
+
+    #undef SALSA_STEP
+
+#else
+
+static void salsa20(uint32_t b[16], int rounds)
+{
+    uint32_t x[16];
+
+    for (int i = 0; i < 16; i++)
+        x[i * 5 % 16] = b[i];
+
+    for (int i = 0; i < rounds; i += 2)
+    {
+        x[4] ^= rotl32(x[0] + x[12], 7);
+        x[8] ^= rotl32(x[4] + x[0], 9);
+        x[12] ^= rotl32(x[8] + x[4], 13);
+        x[0] ^= rotl32(x[12] + x[8], 18);
+        x[9] ^= rotl32(x[5] + x[1], 7);
+        x[13] ^= rotl32(x[9] + x[5], 9);
+        x[1] ^= rotl32(x[13] + x[9], 13);
+        x[5] ^= rotl32(x[1] + x[13], 18);
+        x[14] ^= rotl32(x[10] + x[6], 7);
+        x[2] ^= rotl32(x[14] + x[10], 9);
+        x[6] ^= rotl32(x[2] + x[14], 13);
+        x[10] ^= rotl32(x[6] + x[2], 18);
+        x[3] ^= rotl32(x[15] + x[11], 7);
+        x[7] ^= rotl32(x[3] + x[15], 9);
+        x[11] ^= rotl32(x[7] + x[3], 13);
+        x[15] ^= rotl32(x[11] + x[7], 18);
+
+        x[1] ^= rotl32(x[0] + x[3], 7);
+        x[2] ^= rotl32(x[1] + x[0], 9);
+        x[3] ^= rotl32(x[2] + x[1], 13);
+        x[0] ^= rotl32(x[3] + x[2], 18);
+        x[6] ^= rotl32(x[5] + x[4], 7);
+        x[7] ^= rotl32(x[6] + x[5], 9);
+        x[4] ^= rotl32(x[7] + x[6], 13);
+        x[5] ^= rotl32(x[4] + x[7], 18);
+        x[11] ^= rotl32(x[10] + x[9], 7);
+        x[8] ^= rotl32(x[11] + x[10], 9);
+        x[9] ^= rotl32(x[8] + x[11], 13);
+        x[10] ^= rotl32(x[9] + x[8], 18);
+        x[12] ^= rotl32(x[15] + x[14], 7);
+        x[13] ^= rotl32(x[12] + x[15], 9);
+        x[14] ^= rotl32(x[13] + x[12], 13);
+        x[15] ^= rotl32(x[14] + x[13], 18);
+    }
+
+    for (int i = 0; i < 16; i++)
+        b[i] += x[i * 5 % 16];
+}
+
+#endif
+
+// scrypt's BlockMix: y is 2r blocks of scratch.
+static void blockmix_salsa8(uint32_t *b, uint32_t *y, size_t r)
+{
+    uint32_t x[16];
+
+    memcpy(x, &b[(2 * r - 1) * 16], sizeof(x));
+
+    for (size_t i = 0; i < 2 * r; i++)
+    {
+        for (int k = 0; k < 16; k++)
+            x[k] ^= b[i * 16 + k];
+        salsa20(x, 8);
+        memcpy(&y[i * 16], x, sizeof(x));
+    }
+
+    // Even blocks of y make the first half of b, odd ones the second. Copied
+    // word by word: UBSan's nonnull check on memcpy adds a path with b null,
+    // and -O3 then warns about a write through it.
+    for (size_t i = 0; i < r; i++)
+    {
+        const uint32_t *even = &y[i * 2 * 16];
+        const uint32_t *odd  = even + 16;
+        uint32_t       *lo   = &b[i * 16];
+        uint32_t       *hi   = &b[(i + r) * 16];
+
+        for (int k = 0; k < 16; k++)
+        {
+            lo[k] = even[k];
+            hi[k] = odd[k];
+        }
+    }
+}
+
+// yescrypt's BlockMix: pwxform over the 64-byte sub-blocks in a chain, then
+// Salsa20/2 on the last one. pwxform works on the word pairs as 64-bit lanes:
+// each becomes hi * lo, plus an S0 entry, xor an S1 entry, both picked by the
+// low and high halves of the first lane of its gather. The middle rounds also
+// write into S2, which becomes S0 for the next sub-block. With SSE2 a gather
+// is one register and hi * lo is a single 32x32 multiply.
+#if defined(__SSE2__)
+
+static inline __m128i pwxform_gather(__m128i x, const uint64_t *s0, const uint64_t *s1)
+{
+    uint32_t lo = (uint32_t)_mm_cvtsi128_si32(x);
+    uint32_t hi = (uint32_t)_mm_cvtsi128_si32(_mm_srli_epi64(x, 32));
+    __m128i  p0 = _mm_loadu_si128((const __m128i *)(const void *)(s0 + (lo & S_MASK) / 8));
+    __m128i  p1 = _mm_loadu_si128((const __m128i *)(const void *)(s1 + (hi & S_MASK) / 8));
+
+    x = _mm_mul_epu32(_mm_srli_epi64(x, 32), x);
+
+    return _mm_xor_si128(_mm_add_epi64(x, p0), p1);
+}
+
+    #define PWXFORM_ROUND()                     \
+        do                                      \
+        {                                       \
+            x0 = pwxform_gather(x0, s0, s1);    \
+            x1 = pwxform_gather(x1, s0, s1);    \
+            x2 = pwxform_gather(x2, s0, s1);    \
+            x3 = pwxform_gather(x3, s0, s1);    \
+        } while (0)
+
+    #define PWXFORM_ROUND_WRITE()                                      \
+        do                                                             \
+        {                                                              \
+            PWXFORM_ROUND();                                           \
+            _mm_storeu_si128((__m128i *)(void *)&s2[w], x0);           \
+            _mm_storeu_si128((__m128i *)(void *)&s2[w + 2], x1);       \
+            _mm_storeu_si128((__m128i *)(void *)&s2[w + 4], x2);       \
+            _mm_storeu_si128((__m128i *)(void *)&s2[w + 6], x3);       \
+            w += PWX_LANES;                                            \
+        } while (0)
+
+// The word pairs of a sub-block are already the little-endian 64-bit lanes,
+// so the whole chain runs in four registers.
+static void blockmix_pwxform(uint32_t *b, size_t r, pwxform_ctx *ctx)
+{
+    _Static_assert(PWX_ROUNDS == 6, "the SSE2 block mix unrolls six pwxform rounds");
+
+    size_t    r1  = 2 * r;
+    __m128i  *blk = (__m128i *)(void *)b;
+    uint64_t *s0  = ctx->s0;
+    uint64_t *s1  = ctx->s1;
+    uint64_t *s2  = ctx->s2;
+    size_t    w   = ctx->w;
+    __m128i   x0  = _mm_loadu_si128(&blk[(r1 - 1) * 4]);
+    __m128i   x1  = _mm_loadu_si128(&blk[(r1 - 1) * 4 + 1]);
+    __m128i   x2  = _mm_loadu_si128(&blk[(r1 - 1) * 4 + 2]);
+    __m128i   x3  = _mm_loadu_si128(&blk[(r1 - 1) * 4 + 3]);
+
+    for (size_t i = 0; i < r1; i++)
+    {
+        uint64_t *next = s1;
+
+        x0 = _mm_xor_si128(x0, _mm_loadu_si128(&blk[i * 4]));
+        x1 = _mm_xor_si128(x1, _mm_loadu_si128(&blk[i * 4 + 1]));
+        x2 = _mm_xor_si128(x2, _mm_loadu_si128(&blk[i * 4 + 2]));
+        x3 = _mm_xor_si128(x3, _mm_loadu_si128(&blk[i * 4 + 3]));
+
+        PWXFORM_ROUND();
+        PWXFORM_ROUND_WRITE();
+        PWXFORM_ROUND_WRITE();
+        PWXFORM_ROUND_WRITE();
+        PWXFORM_ROUND_WRITE();
+        PWXFORM_ROUND();
+
+        _mm_storeu_si128(&blk[i * 4], x0);
+        _mm_storeu_si128(&blk[i * 4 + 1], x1);
+        _mm_storeu_si128(&blk[i * 4 + 2], x2);
+        _mm_storeu_si128(&blk[i * 4 + 3], x3);
+
+        s1 = s0;
+        s0 = s2;
+        s2 = next;
+        w &= S_PAIRS - 1;
+    }
+
+    ctx->s0 = s0;
+    ctx->s1 = s1;
+    ctx->s2 = s2;
+    ctx->w  = w;
+
+    salsa20(&b[(r1 - 1) * PWX_WORDS], 2);
+}
+
+    #undef PWXFORM_ROUND
+    #undef PWXFORM_ROUND_WRITE
+
+#else
+
+static inline void pwxform_round(uint64_t *restrict x, const uint64_t *restrict s0, const uint64_t *restrict s1,
+                                 uint64_t *restrict s2, size_t *w)
+{
+    for (int j = 0; j < PWX_GATHER; j++)
+    {
+        uint64_t       *lane = &x[j * PWX_SIMPLE];
+        const uint64_t *p0   = s0 + ((uint32_t)lane[0] & S_MASK) / 8;
+        const uint64_t *p1   = s1 + ((uint32_t)(lane[0] >> 32) & S_MASK) / 8;
+
+        for (int k = 0; k < PWX_SIMPLE; k++)
+        {
+            lane[k] = ((lane[k] >> 32) * (uint32_t)lane[k] + p0[k]) ^ p1[k];
+
+            if (s2)
+                s2[*w + (size_t)(j * PWX_SIMPLE + k)] = lane[k];
+        }
+    }
+
+    if (s2)
+        *w += PWX_LANES;
+}
+
+// The lanes stay in a local array so the S2 stores cannot alias them.
+static void pwxform(uint64_t x[PWX_LANES], pwxform_ctx *ctx)
+{
+    const uint64_t *s0 = ctx->s0;
+    const uint64_t *s1 = ctx->s1;
+    uint64_t       *s2 = ctx->s2;
+    uint64_t        lanes[PWX_LANES];
+    size_t          w = ctx->w;
+
+    memcpy(lanes, x, sizeof(lanes));
+
+    pwxform_round(lanes, s0, s1, NULL, &w);
+    for (int i = 1; i < PWX_ROUNDS - 1; i++)
+        pwxform_round(lanes, s0, s1, s2, &w);
+    pwxform_round(lanes, s0, s1, NULL, &w);
+
+    memcpy(x, lanes, sizeof(lanes));
+
+    ctx->s2 = ctx->s1;
+    ctx->s1 = ctx->s0;
+    ctx->s0 = s2;
+    ctx->w  = w & (S_PAIRS - 1);
+}
+
+static void blockmix_pwxform(uint32_t *b, size_t r, pwxform_ctx *ctx)
+{
+    size_t          r1   = 2 * r;
+    const uint32_t *last = &b[(r1 - 1) * PWX_WORDS];
+    uint64_t        x[PWX_LANES];
+
+    for (int k = 0; k < PWX_LANES; k++)
+        x[k] = (uint64_t)last[k * 2 + 1] << 32 | last[k * 2];
+
+    for (size_t i = 0; i < r1; i++)
+    {
+        uint32_t *sub = &b[i * PWX_WORDS];
+
+        for (int k = 0; k < PWX_LANES; k++)
+            x[k] ^= (uint64_t)sub[k * 2 + 1] << 32 | sub[k * 2];
+
+        pwxform(x, ctx);
+
+        for (int k = 0; k < PWX_LANES; k++)
+        {
+            sub[k * 2]     = (uint32_t)x[k];
+            sub[k * 2 + 1] = (uint32_t)(x[k] >> 32);
+        }
+    }
+
+    salsa20(&b[(r1 - 1) * PWX_WORDS], 2);
+}
+
+#endif
+
+// The first 64 bits of the last sub-block, words 0 and 1 in natural order.
+static uint64_t integerify(const uint32_t *b, size_t r)
+{
+    const uint32_t *x = &b[(2 * r - 1) * 16];
+
+    return (uint64_t)x[13] << 32 | x[0];
+}
+
+static void load_block(uint32_t *x, const uint8_t *b, size_t r)
+{
+    for (size_t k = 0; k < 2 * r; k++)
+    {
+        for (int i = 0; i < 16; i++)
+            x[k * 16 + i] = load_le32(&b[(k * 16 + (size_t)(i * 5 % 16)) * 4]);
+    }
+}
+
+static void store_block(uint8_t *b, const uint32_t *x, size_t r)
+{
+    for (size_t k = 0; k < 2 * r; k++)
+    {
+        for (int i = 0; i < 16; i++)
+            store_le32(&b[(k * 16 + (size_t)(i * 5 % 16)) * 4], x[k * 16 + i]);
+    }
+}
+
+// Fills V sequentially; with YESCRYPT_RW each step also mixes in an earlier,
+// data-dependent block.
+static void smix1(uint8_t *b, size_t r, uint32_t n, uint32_t flags, uint32_t *v, uint32_t *xy, pwxform_ctx *ctx)
+{
+    size_t    s = 32 * r;
+    uint32_t *x = xy;
+    uint32_t *y = &xy[s];
+
+    load_block(x, b, r);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        memcpy(&v[i * s], x, s * sizeof(*x));
+
+        if ((flags & YESCRYPT_RW) && i > 1)
+        {
+            uint32_t j = wrap(integerify(x, r), i);
+
+            for (size_t k = 0; k < s; k++)
+                x[k] ^= v[j * s + k];
+        }
+
+        if (ctx)
+            blockmix_pwxform(x, r, ctx);
+        else
+            blockmix_salsa8(x, y, r);
+    }
+
+    store_block(b, x, r);
+}
+
+// Reads V at data-dependent positions; with YESCRYPT_RW it writes back too.
+static void smix2(uint8_t *b, size_t r, uint32_t n, uint64_t nloop, uint32_t flags, uint32_t *v, uint32_t *xy,
+                  pwxform_ctx *ctx)
+{
+    size_t    s = 32 * r;
+    uint32_t *x = xy;
+    uint32_t *y = &xy[s];
+
+    if (nloop == 0)
+        return;
+
+    load_block(x, b, r);
+
+    for (uint64_t i = 0; i < nloop; i++)
+    {
+        uint32_t  j  = (uint32_t)(integerify(x, r) & (n - 1));
+        uint32_t *vj = &v[j * s];
+
+        // yescrypt writes the mixed block back over V_j in the same pass.
+        if (flags & YESCRYPT_RW)
+        {
+            for (size_t k = 0; k < s; k++)
+                vj[k] = x[k] ^= vj[k];
+        }
+        else
+        {
+            for (size_t k = 0; k < s; k++)
+                x[k] ^= vj[k];
+        }
+
+        if (ctx)
+            blockmix_pwxform(x, r, ctx);
+        else
+            blockmix_salsa8(x, y, r);
+    }
+
+    store_block(b, x, r);
+}
+
+static void smix(uint8_t *b, size_t r, uint32_t n, uint32_t p, uint32_t t, uint32_t flags,
+                 const yescrypt_layout *mem, uint8_t passwd[SHA256_DIGEST_LEN])
+{
+    size_t   s         = 32 * r;
+    uint32_t nchunk    = n / p;
+    uint64_t nloop_all = nchunk;
+    uint64_t nloop_rw  = 0;
+
+    if (flags & YESCRYPT_RW)
+    {
+        if (t <= 1)
+        {
+            if (t)
+                nloop_all *= 2;
+            nloop_all = (nloop_all + 2) / 3;
+        }
+        else
+        {
+            nloop_all *= t - 1;
+        }
+
+        nloop_rw = nloop_all / p;
+    }
+    else if (t)
+    {
+        if (t == 1)
+            nloop_all += (nloop_all + 1) / 2;
+        nloop_all *= t;
+    }
+
+    nchunk &= ~(uint32_t)1;
+    nloop_all = (nloop_all + 1) & ~(uint64_t)1;
+    nloop_rw  = (nloop_rw + 1) & ~(uint64_t)1;
+
+    for (uint32_t i = 0; i < p; i++)
+    {
+        uint32_t     vchunk = i * nchunk;
+        uint32_t     np     = (i < p - 1) ? nchunk : n - vchunk;
+        uint8_t     *bp     = &b[128 * r * i];
+        uint32_t    *vp     = &mem->v[vchunk * s];
+        pwxform_ctx *ctx    = NULL;
+
+        if (flags & YESCRYPT_RW)
+        {
+            uint32_t *si = &mem->s[i * (S_BYTES / 4)];
+            uint64_t *sbox = (uint64_t *)(void *)si;
+
+            // The S-boxes are the V of a small scrypt run on the start of B_i,
+            // its word pairs then joined into the 64-bit entries pwxform reads.
+            ctx = &mem->ctx[i];
+            smix1(bp, 1, S_BYTES / 128, 0, si, mem->xy, NULL);
+            for (size_t k = 0; k < S_BYTES / 8; k++)
+            {
+                uint64_t entry = (uint64_t)si[k * 2 + 1] << 32 | si[k * 2];
+                memcpy(&sbox[k], &entry, sizeof(entry));
+            }
+
+            ctx->s2 = sbox;
+            ctx->s1 = sbox + S_PAIRS;
+            ctx->s0 = sbox + S_PAIRS * 2;
+            ctx->w  = 0;
+
+            if (i == 0)
+                hmac_sha256(bp + 128 * r - 64, 64, passwd, SHA256_DIGEST_LEN, passwd);
+        }
+
+        smix1(bp, r, np, flags, vp, mem->xy, ctx);
+        smix2(bp, r, p2floor(np), nloop_rw, flags, vp, mem->xy, ctx);
+    }
+
+    for (uint32_t i = 0; i < p; i++)
+    {
+        pwxform_ctx *ctx = (flags & YESCRYPT_RW) ? &mem->ctx[i] : NULL;
+
+        smix2(&b[128 * r * i], r, n, nloop_all - nloop_rw, flags & ~(uint32_t)YESCRYPT_RW, mem->v, mem->xy, ctx);
+    }
+}
+
+static void kdf_body(const yescrypt_params *params, uint32_t flags, uint32_t n, uint32_t t,
+                     const yescrypt_layout *mem, const uint8_t *passwd, size_t passwd_len, const uint8_t *salt,
+                     size_t salt_len, uint8_t out[YESCRYPT_HASH_LEN])
+{
+    size_t  r      = params->r;
+    size_t  p      = params->p;
+    size_t  b_size = 128 * r * p;
+    uint8_t sha256[SHA256_DIGEST_LEN];
+
+    if (flags)
+    {
+        hmac_sha256((flags & YESCRYPT_PREHASH) ? "yescrypt-prehash" : "yescrypt",
+                    (flags & YESCRYPT_PREHASH) ? 16 : 8, passwd, passwd_len, sha256);
+        passwd     = sha256;
+        passwd_len = sizeof(sha256);
+    }
+
+    pbkdf2_sha256(passwd, passwd_len, salt, salt_len, mem->b, b_size);
+
+    // From here on passwd is sha256 itself, which smix updates in RW mode.
+    if (flags)
+        memcpy(sha256, mem->b, sizeof(sha256));
+
+    if (p == 1 || (flags & YESCRYPT_RW))
+    {
+        smix(mem->b, r, n, (uint32_t)p, t, flags, mem, sha256);
+    }
+    else
+    {
+        for (size_t i = 0; i < p; i++)
+            smix(&mem->b[128 * r * i], r, n, 1, t, flags, mem, NULL);
+    }
+
+    pbkdf2_sha256(passwd, passwd_len, mem->b, b_size, out, YESCRYPT_HASH_LEN);
+
+    // yescrypt proper ends like SCRAM: the stored key is SHA-256(HMAC(out, "Client Key")).
+    if (flags && !(flags & YESCRYPT_PREHASH))
+    {
+        hmac_sha256(out, YESCRYPT_HASH_LEN, "Client Key", 10, sha256);
+
+        sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, sha256, sizeof(sha256));
+        sha256_final(&ctx, out);
+    }
+}
+
+int yescrypt_kdf(const yescrypt_params *params, yescrypt_arena *arena, const uint8_t *passwd, size_t passwd_len,
+                 const uint8_t *salt, size_t salt_len, uint8_t out[YESCRYPT_HASH_LEN])
+{
+    uint32_t        n = (uint32_t)params->N;
+    uint8_t         dk[YESCRYPT_HASH_LEN];
+    yescrypt_layout mem;
+
+    if (arena_reserve(arena, yescrypt_memory(params)) == -1)
+        return -1;
+
+    mem.v   = arena->base;
+    mem.xy  = mem.v + 32 * params->r * (size_t)n;
+    mem.s   = mem.xy + 64 * params->r;
+    mem.b   = (uint8_t *)(mem.s + ((params->flags & YESCRYPT_RW) ? (S_BYTES / 4) * params->p : 0));
+    mem.ctx = (pwxform_ctx *)(void *)(mem.b + 128 * params->r * params->p);
+
+    // Large RW hashes first run a 64 times cheaper pass whose output replaces the password.
+    if ((params->flags & YESCRYPT_RW) && n / params->p >= 0x100 && (uint64_t)n / params->p * params->r >= 0x20000)
+    {
+        kdf_body(params, params->flags | YESCRYPT_PREHASH, n >> 6, 0, &mem, passwd, passwd_len, salt, salt_len, dk);
+        passwd     = dk;
+        passwd_len = sizeof(dk);
+    }
+
+    kdf_body(params, params->flags, n, params->t, &mem, passwd, passwd_len, salt, salt_len, out);
+
+    return 0;
+}
+
+static bool yescrypt_check(const hash_target *target, const char *key, size_t key_len, hash_scratch *scratch)
+{
+    uint8_t out[YESCRYPT_HASH_LEN];
+
+    // Without the memory there is nothing to do natively; crypt_r gets its own try.
+    if (yescrypt_kdf(&target->yescrypt, &scratch->arena, (const uint8_t *)key, key_len, target->salt_bytes,
+                     target->salt_bytes_len, out) == -1)
+        return crypt_engine.check(target, key, key_len, scratch);
+
+    return hash_digest_match(target, out);
+}
@@ -0,0 +1,270 @@
+// Checks the bitsliced DES engines against crypt_r across all 4096 salts:
+// random keys of 0-11 bytes, high-bit bytes among them, in a full set of
+// lanes and in a partial one, looked up against a few of their own digests
+// at once. Keys that genuinely collide with a looked-up one (crypt(3) only
+// reads seven bits of the first eight characters) count as hits, since
+// crypt_r gives them the same result. Exits non-zero if any engine the CPU
+// runs disagrees.
+//
+// Usage: des_test [seed]
+
+#include "des.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_MAX_KEY 11
+#define TEST_MAX_DIGESTS 4 // looked up per batch
+#define TEST_DIGEST 8
+
+static const char salt_chars[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// One salt, a full set of random keys and crypt_r's digest for each.
+typedef struct test_job
+{
+    char        setting[3];
+    char        keys[HASH_MAX_LANES][TEST_MAX_KEY + 1];
+    const char *key_ptrs[HASH_MAX_LANES];
+    size_t      key_lens[HASH_MAX_LANES];
+    uint8_t     digests[HASH_MAX_LANES][TEST_DIGEST];
+    hash_target target;
+} test_job;
+
+static uint64_t next_random(uint64_t *state);
+static int      compare_digests(const void *a, const void *b);
+static void     decode_digest(const char *in, uint8_t digest[TEST_DIGEST]);
+static int      make_job(test_job *job, size_t num_keys, uint64_t *rng, struct crypt_data *cdata);
+static void     report(const char *engine, const test_job *job, size_t lane, size_t n, int found, int expected);
+static size_t   test_batch(const hash_engine *engine, const test_job *job, size_t num_keys, size_t n, uint64_t *rng);
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static int compare_digests(const void *a, const void *b)
+{
+    return memcmp(a, b, TEST_DIGEST);
+}
+
+// crypt_r's eleven characters after the salt hold the 64-bit block, six
+// bits each, most significant first, and two zero bits at the end.
+static void decode_digest(const char *in, uint8_t digest[TEST_DIGEST])
+{
+    uint64_t bits = 0;
+
+    for (size_t i = 0; i < 10; i++)
+        bits = bits << 6 | (uint64_t)(strchr(salt_chars, in[i]) - salt_chars);
+    bits = bits << 4 | (uint64_t)(strchr(salt_chars, in[10]) - salt_chars) >> 2;
+    for (size_t i = 0; i < TEST_DIGEST; i++)
+        digest[i] = (uint8_t)(bits >> (56 - 8 * i));
+}
+
+// Every sixteenth key repeats an earlier one with its high bits flipped and
+// a different tail past the eighth character, so collisions are sure to turn up.
+static int make_job(test_job *job, size_t num_keys, uint64_t *rng, struct crypt_data *cdata)
+{
+    for (size_t l = 0; l < num_keys; l++)
+    {
+        const char *out;
+
+        if (l > 0 && next_random(rng) % 16 == 0)
+        {
+            size_t from = next_random(rng) % l;
+
+            memcpy(job->keys[l], job->keys[from], sizeof(job->keys[l]));
+            job->key_lens[l] = job->key_lens[from];
+            for (size_t i = 0; i < job->key_lens[l] && i < DES_KEY_CHARS; i++)
+            {
+                if (job->keys[l][i] & 0x7f) // 0x80 would become the terminator
+                    job->keys[l][i] = (char)((unsigned char)job->keys[l][i] ^ 0x80);
+            }
+            if (job->key_lens[l] >= DES_KEY_CHARS)
+            {
+                job->key_lens[l] = DES_KEY_CHARS + next_random(rng) % (TEST_MAX_KEY - DES_KEY_CHARS + 1);
+                for (size_t i = DES_KEY_CHARS; i < job->key_lens[l]; i++)
+                    job->keys[l][i] = (char)(1 + next_random(rng) % 255);
+            }
+        }
+        else
+        {
+            job->key_lens[l] = next_random(rng) % (TEST_MAX_KEY + 1);
+            for (size_t i = 0; i < job->key_lens[l]; i++)
+                job->keys[l][i] = (char)(1 + next_random(rng) % 255);
+        }
+        job->keys[l][job->key_lens[l]] = '\0';
+        job->key_ptrs[l]               = job->keys[l];
+
+        out = crypt_r(job->keys[l], job->setting, cdata);
+        if (!out || out[0] == '*')
+        {
+            fprintf(stderr, "crypt_r rejected salt %s\n", job->setting);
+            return -1;
+        }
+        decode_digest(out + 2, job->digests[l]);
+
+        // Parsing picks and self-tests an engine every time, so only the first.
+        if (l == 0)
+        {
+            struct fsm_error err;
+
+            fsm_error_init(&err);
+            if (hash_target_parse(&job->target, out, &err) == -1)
+            {
+                fprintf(stderr, "%s: %s\n", out, err.err_msg);
+                fsm_error_clear(&err);
+                return -1;
+            }
+
+            if (memcmp(job->target.digest, job->digests[0], TEST_DIGEST) != 0)
+            {
+                fprintf(stderr, "%s: parsed digest differs\n", out);
+                return -1;
+            }
+            job->target.encoded = NULL; // out is crypt_r's, overwritten by the next key
+        }
+    }
+
+    return 0;
+}
+
+static void report(const char *engine, const test_job *job, size_t lane, size_t n, int found, int expected)
+{
+    fprintf(stderr, "MISMATCH %s, salt %s, batch of %zu: found lane %d, crypt_r says %d\n", engine, job->setting,
+            n, found, expected);
+    if (lane < n)
+    {
+        fprintf(stderr, "  key");
+        for (size_t i = 0; i < job->key_lens[lane]; i++)
+            fprintf(stderr, " %02x", (unsigned char)job->keys[lane][i]);
+        fputc('\n', stderr);
+    }
+}
+
+// Looks the first n keys up against the digests of a few random keys, some
+// of them beyond n, and after each hit again from the lane after it, so
+// every lane's answer is checked, not just the first hit's.
+static size_t test_batch(const hash_engine *engine, const test_job *job, size_t num_keys, size_t n, uint64_t *rng)
+{
+    uint8_t     set[TEST_MAX_DIGESTS][TEST_DIGEST];
+    size_t      num_set = 1 + next_random(rng) % TEST_MAX_DIGESTS;
+    hash_target target  = job->target;
+    size_t      start   = 0;
+
+    for (size_t i = 0; i < num_set; i++)
+        memcpy(set[i], job->digests[next_random(rng) % num_keys], TEST_DIGEST);
+    qsort(set, num_set, TEST_DIGEST, compare_digests);
+
+    if (num_set == 1)
+        memcpy(target.digest, set[0], TEST_DIGEST);
+    else
+    {
+        target.digests     = &set[0][0];
+        target.num_digests = num_set;
+    }
+
+    while (start < n)
+    {
+        int expected = -1;
+        int found;
+
+        for (size_t l = start; l < n && expected == -1; l++)
+        {
+            if (bsearch(job->digests[l], set, num_set, TEST_DIGEST, compare_digests))
+                expected = (int)(l - start);
+        }
+
+        found = engine->check_batch(&target, job->key_ptrs + start, job->key_lens + start, n - start, NULL);
+        if (found != expected)
+        {
+            report(engine->name, job, start + (size_t)((found == -1) ? expected : found), n, found, expected);
+            return 1;
+        }
+
+        if (found == -1)
+            break;
+        start += (size_t)found + 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const hash_engine *engines[DES_ENGINES];
+    size_t             num_engines = des_engines(engines);
+    size_t             num_keys    = 0;
+    uint64_t           seed        = (argc > 1) ? strtoull(argv[1], NULL, 0) : (uint64_t)time(NULL);
+    uint64_t           rng         = seed ? seed : 1;
+    struct crypt_data *cdata       = calloc(1, sizeof(*cdata));
+    test_job          *job         = calloc(1, sizeof(*job));
+    size_t             failures    = 0;
+
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!cdata || !job)
+    {
+        fprintf(stderr, "calloc failed\n");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t e = 0; e < num_engines; e++)
+        num_keys = (engines[e]->lanes > num_keys) ? engines[e]->lanes : num_keys;
+
+    printf("seed %" PRIu64 "\n", seed);
+
+    for (size_t s = 0; s < 64 * 64; s++)
+    {
+        job->setting[0] = salt_chars[s / 64];
+        job->setting[1] = salt_chars[s % 64];
+
+        if (make_job(job, num_keys, &rng, cdata) == -1)
+        {
+            failures++;
+            continue;
+        }
+
+        memcpy(job->target.digest, job->digests[0], TEST_DIGEST);
+
+        for (size_t e = 0; e < num_engines; e++)
+        {
+            size_t lanes = engines[e]->lanes;
+
+            failures += test_batch(engines[e], job, num_keys, lanes, &rng);
+            failures += test_batch(engines[e], job, num_keys, 1 + next_random(&rng) % lanes, &rng);
+
+            if (!engines[e]->check(&job->target, job->keys[0], job->key_lens[0], NULL) ||
+                engines[e]->check(&job->target, job->keys[1], job->key_lens[1], NULL) !=
+                    (memcmp(job->digests[0], job->digests[1], TEST_DIGEST) == 0))
+            {
+                report(engines[e]->name, job, 0, 1, -1, 0);
+                failures++;
+            }
+        }
+    }
+
+    for (size_t e = 0; e < num_engines; e++)
+        printf("%s checked over 4096 salts, batches of 1-%zu\n", engines[e]->name, engines[e]->lanes);
+
+    free(cdata);
+    free(job);
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%zu mismatches (seed %" PRIu64 ")\n", failures, seed);
+        return EXIT_FAILURE;
+    }
+
+    printf("all match crypt_r\n");
+
+    return EXIT_SUCCESS;
+}
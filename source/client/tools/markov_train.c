@@ -0,0 +1,90 @@
+// Builds the Markov statistics file the client uses to order brute force and
+// mask candidates. Reads one password per line from a corpus.
+//
+// Usage: markov_train <corpus> <output>
+
+#include "markov.h"
+#include <errno.h>
+#include <stdio.h>
+
+int main(int argc, char *argv[])
+{
+    FILE     *in;
+    FILE     *out;
+    uint32_t *counts;
+    char      line[4096];
+    uint64_t  words = 0;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <corpus> <output>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(argv[1], "r");
+    if (!in)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    counts = calloc(MARKOV_COUNTS, sizeof(uint32_t));
+    if (!counts)
+    {
+        fprintf(stderr, "calloc failed\n");
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        size_t        len  = strcspn(line, "\r\n");
+        unsigned char prev = 0;
+
+        for (size_t i = 0; i < len; i++)
+        {
+            size_t    position = (i < MARKOV_POSITIONS) ? i : MARKOV_POSITIONS - 1;
+            uint32_t *count    = &counts[(position * 256 + prev) * 256 + (unsigned char)line[i]];
+
+            if (*count < UINT32_MAX)
+                (*count)++;
+
+            prev = (unsigned char)line[i];
+        }
+
+        if (len > 0)
+            words++;
+    }
+
+    fclose(in);
+
+    out = fopen(argv[2], "wb");
+    if (!out)
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+        free(counts);
+        return EXIT_FAILURE;
+    }
+
+    fwrite(MARKOV_MAGIC, 1, MARKOV_MAGIC_LEN, out);
+
+    for (size_t i = 0; i < MARKOV_COUNTS; i++)
+    {
+        unsigned char b[4] = {(unsigned char)counts[i], (unsigned char)(counts[i] >> 8),
+                              (unsigned char)(counts[i] >> 16), (unsigned char)(counts[i] >> 24)};
+
+        fwrite(b, 1, sizeof(b), out);
+    }
+
+    free(counts);
+
+    if (fclose(out) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    printf("Trained on %" PRIu64 " passwords, wrote %s\n", words, argv[2]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+// Checks the SHA-crypt engines bit for bit against crypt_r: random keys of
+// 0-79 bytes, salts of 0-16 characters and rounds= values, the default
+// among them, through the scalar code and every multi-buffer kernel the CPU
+// runs, in batches of every size from one key to a full set of lanes.
+// Exits non-zero if any result differs.
+//
+// Usage: sha_crypt_test [seed]
+
+#include "hash_engine.h"
+#include "sha_crypt.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TEST_SETTINGS 12 // salt and rounds combinations per scheme
+#define TEST_MAX_KEY 79
+#define TEST_MAX_SALT 16
+#define TEST_MIN_ROUNDS 1000 // crypt_r rejects fewer
+#define TEST_MAX_ROUNDS 4000
+
+static const char salt_chars[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// One setting, a full set of random keys and what crypt_r makes of each.
+typedef struct test_job
+{
+    char        setting[HASH_MAX_SETTING];
+    char        keys[SHA_CRYPT_MAX_LANES][TEST_MAX_KEY + 1];
+    const char *key_ptrs[SHA_CRYPT_MAX_LANES];
+    size_t      key_lens[SHA_CRYPT_MAX_LANES];
+    char        encoded[SHA_CRYPT_MAX_LANES][CRYPT_OUTPUT_SIZE];
+    hash_target targets[SHA_CRYPT_MAX_LANES];
+} test_job;
+
+static uint64_t next_random(uint64_t *state);
+static int      make_job(test_job *job, bool wide, uint64_t *rng, struct crypt_data *cdata);
+static size_t   first_equal(const test_job *job, size_t pick);
+static void     report(const char *engine, const test_job *job, size_t lane, size_t n, const char *what);
+static size_t   test_scalar(const hash_engine *engine, const test_job *job, bool wide, hash_scratch *scratch);
+static size_t   test_kernel(const sha_crypt_simd *simd, const test_job *job, uint64_t *rng, hash_scratch *scratch);
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static int make_job(test_job *job, bool wide, uint64_t *rng, struct crypt_data *cdata)
+{
+    size_t salt_len = next_random(rng) % (TEST_MAX_SALT + 1);
+    int    len      = snprintf(job->setting, sizeof(job->setting), "%s", wide ? "$6$" : "$5$");
+
+    // A quarter of the settings leave the rounds at crypt's default.
+    if (next_random(rng) % 4 != 0)
+        len += snprintf(job->setting + len, sizeof(job->setting) - (size_t)len, "rounds=%" PRIu64 "$",
+                        TEST_MIN_ROUNDS + next_random(rng) % (TEST_MAX_ROUNDS - TEST_MIN_ROUNDS + 1));
+
+    for (size_t i = 0; i < salt_len; i++)
+        job->setting[len++] = salt_chars[next_random(rng) % (sizeof(salt_chars) - 1)];
+    job->setting[len] = '\0';
+
+    for (size_t l = 0; l < SHA_CRYPT_MAX_LANES; l++)
+    {
+        struct fsm_error err;
+        const char      *out;
+
+        job->key_lens[l] = next_random(rng) % (TEST_MAX_KEY + 1);
+        for (size_t i = 0; i < job->key_lens[l]; i++)
+            job->keys[l][i] = (char)(1 + next_random(rng) % 255);
+        job->keys[l][job->key_lens[l]] = '\0';
+        job->key_ptrs[l]               = job->keys[l];
+
+        out = crypt_r(job->keys[l], job->setting, cdata);
+        if (!out || out[0] == '*')
+        {
+            fprintf(stderr, "crypt_r rejected setting %s\n", job->setting);
+            return -1;
+        }
+        snprintf(job->encoded[l], sizeof(job->encoded[l]), "%s", out);
+
+        fsm_error_init(&err);
+        if (hash_target_parse(&job->targets[l], job->encoded[l], &err) == -1)
+        {
+            fprintf(stderr, "%s: %s\n", job->encoded[l], err.err_msg);
+            fsm_error_clear(&err);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// The lane a batch should report for pick's hash: the first with the same
+// crypt_r result, in case two random keys really do collide.
+static size_t first_equal(const test_job *job, size_t pick)
+{
+    size_t lane = 0;
+
+    while (strcmp(job->encoded[lane], job->encoded[pick]) != 0)
+        lane++;
+
+    return lane;
+}
+
+static void report(const char *engine, const test_job *job, size_t lane, size_t n, const char *what)
+{
+    fprintf(stderr, "MISMATCH %s, batch of %zu, lane %zu: %s\n  setting %s, key length %zu, crypt_r %s\n  key",
+            engine, n, lane, what, job->setting, job->key_lens[lane], job->encoded[lane]);
+    for (size_t i = 0; i < job->key_lens[lane]; i++)
+        fprintf(stderr, " %02x", (unsigned char)job->keys[lane][i]);
+    fputc('\n', stderr);
+}
+
+static size_t test_scalar(const hash_engine *engine, const test_job *job, bool wide, hash_scratch *scratch)
+{
+    size_t dlen     = job->targets[0].digest_len;
+    size_t failures = 0;
+
+    for (size_t l = 0; l < SHA_CRYPT_MAX_LANES; l++)
+    {
+        sha_crypt_state st;
+        size_t          other = (l + 1) % SHA_CRYPT_MAX_LANES;
+
+        sha_crypt_prepare(&job->targets[l], job->keys[l], job->key_lens[l], wide, &st);
+        sha_crypt_rounds(&job->targets[l], &st, wide);
+
+        if (memcmp(st.a, job->targets[l].digest, dlen) != 0)
+        {
+            report(engine->name, job, l, 1, "digest differs");
+            failures++;
+        }
+
+        if (!engine->check(&job->targets[l], job->keys[l], job->key_lens[l], scratch) ||
+            engine->check(&job->targets[other], job->keys[l], job->key_lens[l], scratch) !=
+                (strcmp(job->encoded[l], job->encoded[other]) == 0))
+        {
+            report(engine->name, job, l, 1, "check() gives the wrong answer");
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+// Every batch size from one to a full set of lanes, through the kernel on
+// its own, where each lane's digest is compared, and through the engine,
+// which also takes the keys too long for the kernel.
+static size_t test_kernel(const sha_crypt_simd *simd, const test_job *job, uint64_t *rng, hash_scratch *scratch)
+{
+    size_t lanes    = simd->engine->lanes;
+    size_t dlen     = job->targets[0].digest_len;
+    size_t failures = 0;
+
+    for (size_t n = 1; n <= lanes; n++)
+    {
+        sha_crypt_state st[SHA_CRYPT_MAX_LANES];
+        size_t          lane_of[SHA_CRYPT_MAX_LANES];
+        bool            match[SHA_CRYPT_MAX_LANES];
+        size_t          m      = 0;
+        size_t          pick   = next_random(rng) % n;
+        const char     *reason = NULL;
+        int             found;
+
+        for (size_t l = 0; l < n; l++)
+        {
+            if (job->key_lens[l] > SHA_CRYPT_SIMD_MAX_KEY)
+                continue;
+
+            sha_crypt_prepare(&job->targets[pick], job->keys[l], job->key_lens[l], simd->wide, &st[m]);
+            lane_of[m++] = l;
+        }
+
+        if (m > 0)
+            simd->kernel(&job->targets[pick], st, m, match);
+
+        for (size_t k = 0; k < m; k++)
+        {
+            size_t l = lane_of[k];
+
+            if (memcmp(st[k].a, job->targets[l].digest, dlen) != 0)
+                reason = "digest differs";
+            else if (match[k] != (strcmp(job->encoded[l], job->encoded[pick]) == 0))
+                reason = "match flag is wrong";
+
+            if (reason)
+            {
+                report(simd->engine->name, job, l, n, reason);
+                failures++;
+                reason = NULL;
+            }
+        }
+
+        found = simd->engine->check_batch(&job->targets[pick], job->key_ptrs, job->key_lens, n, scratch);
+        if (found != (int)first_equal(job, pick))
+        {
+            report(simd->engine->name, job, pick, n, "check_batch() picks the wrong lane");
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    const sha_crypt_simd *kernels[SHA_CRYPT_SIMD_KERNELS];
+    size_t                num_kernels = sha_crypt_simd_kernels(kernels);
+    uint64_t              seed        = (argc > 1) ? strtoull(argv[1], NULL, 0) : (uint64_t)time(NULL);
+    uint64_t              rng         = seed ? seed : 1;
+    struct crypt_data    *cdata       = calloc(1, sizeof(*cdata));
+    hash_scratch         *scratch     = calloc(1, sizeof(*scratch));
+    test_job             *job         = calloc(1, sizeof(*job));
+    size_t                failures    = 0;
+
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!cdata || !scratch || !job)
+    {
+        fprintf(stderr, "calloc failed\n");
+        return EXIT_FAILURE;
+    }
+
+    hash_scratch_init(scratch);
+    printf("seed %" PRIu64 "\n", seed);
+
+    for (int w = 0; w < 2; w++)
+    {
+        bool               wide   = w == 1;
+        const hash_engine *scalar = wide ? &sha512_crypt_engine : &sha256_crypt_engine;
+
+        for (int s = 0; s < TEST_SETTINGS; s++)
+        {
+            if (make_job(job, wide, &rng, cdata) == -1)
+            {
+                failures++;
+                continue;
+            }
+
+            failures += test_scalar(scalar, job, wide, scratch);
+
+            for (size_t k = 0; k < num_kernels; k++)
+            {
+                if (kernels[k]->wide == wide)
+                    failures += test_kernel(kernels[k], job, &rng, scratch);
+            }
+        }
+
+        printf("%s checked over %d settings\n", scalar->name, TEST_SETTINGS);
+        for (size_t k = 0; k < num_kernels; k++)
+        {
+            if (kernels[k]->wide == wide)
+                printf("%s checked over %d settings, batches of 1-%zu\n", kernels[k]->engine->name, TEST_SETTINGS,
+                       kernels[k]->engine->lanes);
+        }
+    }
+
+    hash_scratch_free(scratch);
+    free(scratch);
+    free(cdata);
+    free(job);
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%zu mismatches (seed %" PRIu64 ")\n", failures, seed);
+        return EXIT_FAILURE;
+    }
+
+    printf("all match crypt_r\n");
+
+    return EXIT_SUCCESS;
+}
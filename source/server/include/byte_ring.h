@@ -0,0 +1,34 @@
+#ifndef SERVER_BYTE_RING_H
+#define SERVER_BYTE_RING_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+// Byte queue over a power-of-two buffer. head and tail only ever grow and
+// are masked on access; both drop back to 0 whenever the queue empties, so
+// most of the time the queued bytes sit in one piece at the start.
+typedef struct byte_ring
+{
+    char  *data;
+    size_t cap;
+    size_t head; // next byte to take
+    size_t tail; // next byte to fill
+} byte_ring;
+
+static inline size_t byte_ring_len(const byte_ring *ring)
+{
+    return ring->tail - ring->head;
+}
+
+// Makes room for len more bytes, allocating or doubling the buffer as
+// needed. Returns -1 when that allocation fails.
+int  byte_ring_reserve(byte_ring *ring, size_t len);
+int  byte_ring_append(byte_ring *ring, const void *src, size_t len);
+// Queued bytes, or free space, as at most two pieces; returns how many.
+int  byte_ring_data(const byte_ring *ring, struct iovec iov[2]);
+int  byte_ring_space(const byte_ring *ring, struct iovec iov[2]);
+void byte_ring_produce(byte_ring *ring, size_t len);
+void byte_ring_consume(byte_ring *ring, size_t len);
+void byte_ring_free(byte_ring *ring);
+
+#endif // SERVER_BYTE_RING_H
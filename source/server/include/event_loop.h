@@ -0,0 +1,66 @@
+#ifndef SERVER_EVENT_LOOP_H
+#define SERVER_EVENT_LOOP_H
+
+#include "fsm.h"
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVENT_LOOP_MAX_EVENTS 64 // readiness reports handled per wait
+
+typedef enum
+{
+    EVENT_BACKEND_EPOLL,
+    EVENT_BACKEND_IO_URING,
+    EVENT_BACKEND_POLL
+} event_backend;
+
+// Per-descriptor registration, indexed by fd, for the backends that cannot
+// hand the owner's pointer back themselves. generation tells a stale
+// io_uring completion, for a descriptor since removed or reused, from a live one.
+typedef struct event_slot
+{
+    void    *data;
+    uint32_t generation;
+    size_t   position; // poll: index into the pollfd array
+    bool     registered;
+    bool     output;   // also reported when it can take more output
+    bool     reported; // already in the batch being gathered
+} event_slot;
+
+struct event_ring;
+
+// Sockets are registered once, for input, and stay registered until
+// removed. A wait only reports the ones that became ready, edge-triggered:
+// the owner reads until EAGAIN, since the next report only comes with new
+// input. Writability is watched only while the owner has output the socket
+// would not take. epoll is the default; io_uring uses multishot polls; poll
+// keeps one persistent array, for systems with neither.
+typedef struct event_loop
+{
+    event_backend      backend;
+    int                fd; // epoll instance or ring
+    event_slot        *slots;
+    size_t             num_slots;
+    struct pollfd     *pollfds;
+    size_t             num_pollfds;
+    size_t             pollfds_cap;
+    struct event_ring *ring;
+} event_loop;
+
+// name is epoll, io_uring or poll; NULL picks the platform default.
+int  event_loop_open(event_loop *loop, const char *name, struct fsm_error *err);
+void event_loop_close(event_loop *loop);
+int  event_loop_add(event_loop *loop, int fd, void *data, struct fsm_error *err);
+// Must come before the descriptor is closed.
+void event_loop_remove(event_loop *loop, int fd);
+// Starts or stops reporting fd when it can be written to; cheap when unchanged.
+int  event_loop_watch_output(event_loop *loop, int fd, bool on, struct fsm_error *err);
+// Fills ready with the data of up to max ready descriptors, each at most
+// once. Returns how many, 0 on timeout or signal, -1 on error.
+int  event_loop_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err);
+
+const char *event_loop_name(const event_loop *loop);
+
+#endif // SERVER_EVENT_LOOP_H
@@ -1,6 +1,9 @@
 #ifndef CLIENT_FSM_H
 #define CLIENT_FSM_H
 
+#include "byte_ring.h"
+#include "protocol.h"
+#include "timer_wheel.h"
 #include <glob.h>
 #include <netinet/in.h>
 #include <poll.h>
@@ -19,28 +22,74 @@ typedef enum
     FSM_USER_START
 } fsm_state;
 
-#define RECV_BUF_SIZE 2048
+#define RECV_BUF_SIZE 2048 // input ring: the longest message a worker may send
+#define MAX_LEASES 4
 
-typedef struct worker_state
+typedef struct work_lease
 {
-    int sockfd;
-
     uint64_t start_index;
     uint64_t work_size;
     uint64_t end_index;
     uint64_t last_checkpoint_index;
     time_t   started_at;
-    time_t   duration_secs;
-    time_t   last_heard;
-    uint64_t checkpoint_interval;
-    uint32_t timeout_seconds;
-
-    int    assigned;
-    int    alive;
-    char   recv_buf[RECV_BUF_SIZE];
-    size_t recv_len;
+} work_lease;
+
+// Connection buffers, touched only when the worker's socket is. Input is
+// parsed where it lies; output waits here until the socket takes it.
+typedef struct worker_io
+{
+    byte_ring     in;
+    byte_ring     out;
+    protocol_mode protocol; // as the worker's HELLO was written
+    uint32_t      caps;     // capabilities both sides have
+    bool          greeted;  // HELLO answered and the job sent
+} worker_io;
+
+// What scheduling reads, kept apart from the buffers so
+// a scan over every worker stays within the registry's hot slabs.
+typedef struct worker_state
+{
+    uint32_t id; // slot in the registry, fixed for as long as the worker is connected
+    int      sockfd;
+    int      alive;
+
+    // Outstanding chunks in the order the worker will run them; leases[0] is in progress.
+    work_lease  leases[MAX_LEASES];
+    size_t      num_leases;
+    bool        parked; // asked for work when there was none; waits for a reclaimed chunk
+    time_t      duration_secs;
+    time_t      last_heard;
+    uint64_t    checkpoint_interval;
+    uint32_t    timeout_seconds;
+    timer_entry timer; // fires timeout_seconds after the worker was last heard from
+
+    // The lease in progress has its own deadline, which only a CHECKPOINT or
+    // DONE pushes back; other input keeps the worker, not its lease, alive.
+    // Prefetched leases have none until they come up, as the worker runs
+    // them only after the one ahead.
+    timer_entry lease_timer;
+    bool        lease_moved; // a lease started or reported progress since lease_timer was armed
+
+    size_t     cracked_sent; // entries of the crack log this worker has been told about
+    worker_io *io;
 } worker_state;
 
+#define WORKER_SLAB_SIZE 64 // workers per slab
+
+// Workers live in fixed slabs that never move, so a worker_state pointer
+// and its id stay valid until the worker is removed. Released ids are
+// reused first; slots from next_id on have never been handed out.
+typedef struct worker_registry
+{
+    worker_state **hot_slabs;
+    worker_io    **io_slabs;
+    size_t         num_slabs;
+    uint32_t      *free_ids;
+    size_t         num_free;
+    uint32_t       next_id;
+    size_t         count; // workers connected
+} worker_registry;
+
 typedef struct work_chunk
 {
     size_t start;
@@ -50,28 +99,63 @@ typedef struct work_chunk
 typedef struct cracking_context
 {
     char       *hash;
+    char       *hash_file;
+    char      **hashes;    // sorted, without duplicates
+    char      **passwords; // per hash, NULL until cracked
+    size_t      num_hashes;
+    size_t     *cracked; // crack log: hash indices in the order they fell
+    size_t      num_cracked;
+    char       *mask;
+    char       *wordlist;
+    char       *wordlist_path; // absolute form of wordlist sent to workers
+    char       *rules_file;
+    char       *markov;
+    char       *markov_path; // absolute form of markov sent to workers
+    char       *markov_threshold_str;
+    uint64_t    markov_threshold;
+    char      **rules;
+    size_t      num_rules;
+    char       *custom_charsets[4];
+    char      **mask_positions;
+    size_t      mask_len;
+    uint64_t    wordlist_lines;
+    int         hybrid_prepend;    // hybrid: mask goes before the word
+    int         hybrid_mask_major; // hybrid: the word changes fastest
+    char       *rainbow_build;  // table to build from the mask
+    char       *rainbow;        // table to look the hashes up in
+    char       *rainbow_path;   // absolute form of rainbow sent to workers
+    const char *rainbow_scheme; // build: md5, sha1, sha256 or ntlm
+    char       *chain_len_str;
+    char       *chains_str;
+    uint64_t    chain_len;
+    uint64_t    num_chains;
+    uint64_t    chain_space; // build: candidates in the mask, the range every chain link falls in
+    uint64_t   *chain_ends;  // build: per chain, UINT64_MAX until a worker reports it
+    uint64_t    keyspace_size; // 0 when the keyspace is unbounded
     uint64_t    index;
     uint64_t    work_size;
     uint64_t    checkpoint;
     uint64_t    timeout;
-    int         found;
-    char        password[255];
+    int         found; // every hash is cracked
+    int         exhausted;
     work_chunk *queue;
     size_t      queue_len;
     time_t      total_secs;
+    uint64_t    now_ms; // monotonic clock, read once per polling pass
 } cracking_context;
 
 typedef struct arguments
 {
-    int                     sockfd, *client_sockets, num_ready;
+    int                     sockfd, num_ready;
     cracking_context        crack_ctx;
     char                   *work_size_str, *checkpoint_str, *timeout_str;
     char                   *server_addr, *server_port_str;
+    char                   *event_loop_str;
     in_port_t               server_port;
     struct sockaddr_storage server_addr_struct;
-    nfds_t                  max_clients;
-    worker_state          **client_states;
-    struct pollfd          *file_descriptors;
+    worker_registry         workers;
+    timer_wheel             timers;
+    struct event_loop      *loop;
     struct timespec         start_wall, end_wall;
 } arguments;
 
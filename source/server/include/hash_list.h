@@ -0,0 +1,17 @@
+#ifndef SERVER_HASH_LIST_H
+#define SERVER_HASH_LIST_H
+
+#include "fsm.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_HASH_LEN 255
+
+int  hash_list_load(struct cracking_context *crack_ctx, struct fsm_error *err);
+// Whether two hashes share scheme, cost and salt, so a worker needs one hash
+// computation per candidate for both.
+bool hash_list_same_group(const char *a, const char *b);
+bool hash_list_find(const struct cracking_context *crack_ctx, const char *hash, size_t *index);
+void hash_list_free(struct cracking_context *crack_ctx);
+
+#endif // SERVER_HASH_LIST_H
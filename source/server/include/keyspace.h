@@ -0,0 +1,23 @@
+#ifndef SERVER_KEYSPACE_H
+#define SERVER_KEYSPACE_H
+
+#include "fsm.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MASK_POSITIONS 63
+#define MAX_POSITION_CHARSET 255
+#define NUM_CUSTOM_CHARSETS 4
+
+int  mask_parse(struct cracking_context *crack_ctx, struct fsm_error *err);
+void mask_free(struct cracking_context *crack_ctx);
+int  wordlist_prepare(struct cracking_context *crack_ctx, struct fsm_error *err);
+int  hybrid_prepare(struct cracking_context *crack_ctx, struct fsm_error *err);
+int  markov_prepare(struct cracking_context *crack_ctx, struct fsm_error *err);
+int  rules_load(struct cracking_context *crack_ctx, struct fsm_error *err);
+void rules_free(struct cracking_context *crack_ctx);
+
+#endif // SERVER_KEYSPACE_H
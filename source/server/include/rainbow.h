@@ -0,0 +1,27 @@
+#ifndef SERVER_RAINBOW_H
+#define SERVER_RAINBOW_H
+
+#include "fsm.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rainbow table file: a text header (the magic, SCHEME, CHAIN_LEN, CHAINS,
+// one POS line per mask position, END), zero padding to a multiple of 16
+// bytes, then CHAINS entries of two native-order uint64s, end then start,
+// sorted by end with no end repeated. Workers map it and search it in place.
+#define RAINBOW_MAGIC "RAINBOW1"
+#define RAINBOW_ALIGN 16
+#define RAINBOW_DEFAULT_CHAIN_LEN 1000
+
+// Build: validates the scheme and sizes, and makes each chain one unit of the keyspace.
+int  rainbow_build_prepare(struct cracking_context *crack_ctx, struct fsm_error *err);
+// Lookup: reads the table's header; each column of its chains is one unit of the keyspace.
+int  rainbow_lookup_prepare(struct cracking_context *crack_ctx, struct fsm_error *err);
+// CHAIN: records the ends a worker computed of the chains from values[0]
+// on. Returns -1 when they do not fit the table.
+int  rainbow_record(struct cracking_context *crack_ctx, const uint64_t *values, size_t num_values);
+// Sorts the chains by end, drops all but one of each set that merged, and writes the table.
+int  rainbow_write(const struct cracking_context *crack_ctx, struct fsm_error *err);
+void rainbow_free(struct cracking_context *crack_ctx);
+
+#endif // SERVER_RAINBOW_H
@@ -0,0 +1,38 @@
+#ifndef SERVER_RULES_H
+#define SERVER_RULES_H
+
+#include "fsm.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RULE_LEN 255
+
+// One compiled rule step. op is the hashcat/John rule character itself;
+// a and b hold its already-decoded position or character arguments.
+typedef struct rule_insn
+{
+    uint8_t op;
+    uint8_t a;
+    uint8_t b;
+} rule_insn;
+
+// Every rule of a job compiled back to back into one instruction array;
+// rule i runs insns[starts[i]] up to insns[starts[i + 1]].
+typedef struct rule_set
+{
+    rule_insn *insns;
+    uint32_t  *starts;
+    size_t     count;
+    size_t     num_insns;
+    size_t     cap_insns;
+    size_t     cap_rules;
+} rule_set;
+
+int  rule_set_add(rule_set *rules, const char *text, struct fsm_error *err);
+void rule_set_free(rule_set *rules);
+int  rule_apply(const rule_set *rules, size_t rule, char *buf, size_t *len, size_t max_len);
+
+#endif // SERVER_RULES_H
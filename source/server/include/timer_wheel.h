@@ -0,0 +1,46 @@
+#ifndef SERVER_TIMER_WHEEL_H
+#define SERVER_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_TICK_MS 10
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4 // 64^4 ticks of 10 ms, about 46 hours, before a deadline is re-filed
+
+// Embedded in whatever it times; the wheel never allocates. Level 0 holds
+// the next 64 ticks one tick per slot, each level above 64 times coarser;
+// a slot is moved down a level when the wheel reaches it, so only entries
+// that are due, or about to be, are ever looked at.
+typedef struct timer_entry
+{
+    struct timer_entry  *next;
+    struct timer_entry **pprev;
+    uint64_t             expires; // tick
+    void                *data;
+    uint8_t              level;
+    uint8_t              slot;
+    bool                 pending;
+} timer_entry;
+
+typedef struct timer_wheel
+{
+    timer_entry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t     occupied[TIMER_WHEEL_LEVELS]; // bit per non-empty slot
+    uint64_t     current;                      // next tick to run
+    size_t       count;
+} timer_wheel;
+
+void timer_wheel_init(timer_wheel *wheel, uint64_t now_ms);
+// (Re)arms entry to fire at deadline_ms, never earlier.
+void timer_wheel_schedule(timer_wheel *wheel, timer_entry *entry, uint64_t deadline_ms);
+void timer_wheel_cancel(timer_wheel *wheel, timer_entry *entry);
+// Runs the wheel up to now_ms and returns the entries that fell due,
+// linked through next and no longer pending.
+timer_entry *timer_wheel_expire(timer_wheel *wheel, uint64_t now_ms);
+// Milliseconds from now_ms until the wheel next has work, -1 when empty.
+int64_t      timer_wheel_next_timeout(const timer_wheel *wheel, uint64_t now_ms);
+
+#endif // SERVER_TIMER_WHEEL_H
@@ -13,5 +13,7 @@
 int   string_to_int(const char *str, int *out, struct fsm_error *err);
 int   string_to_uint64(const char *str, uint64_t *out, struct fsm_error *err);
 void *safe_malloc(uint32_t size, struct fsm_error *err);
+// Milliseconds on a clock that only moves forward; for deadlines, not dates.
+uint64_t monotonic_ms(void);
 
 #endif // UTILS_H
@@ -0,0 +1,22 @@
+#ifndef SERVER_WORKER_REGISTRY_H
+#define SERVER_WORKER_REGISTRY_H
+
+#include "fsm.h"
+#include <stdint.h>
+
+// Takes a free slot for a newly connected socket, growing by one slab when
+// none is left. Returns NULL when that allocation fails.
+worker_state *worker_registry_add(worker_registry *reg, int sockfd, struct fsm_error *err);
+// Releases the worker's slot for reuse; the caller has closed its socket.
+void          worker_registry_remove(worker_registry *reg, worker_state *ws);
+// Closes every connected worker's socket and frees the slabs.
+void          worker_registry_free(worker_registry *reg);
+
+// Slot id, which is connected when its alive flag is set. Ids below
+// reg->next_id are the only ones backed by memory.
+static inline worker_state *worker_registry_slot(const worker_registry *reg, uint32_t id)
+{
+    return &reg->hot_slabs[id / WORKER_SLAB_SIZE][id % WORKER_SLAB_SIZE];
+}
+
+#endif // SERVER_WORKER_REGISTRY_H
@@ -0,0 +1,121 @@
+#include "byte_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTE_RING_MIN_CAP 256
+
+static int pieces(const byte_ring *ring, size_t from, size_t len, struct iovec iov[2]);
+
+// Splits the len bytes starting at position from where they wrap.
+static int pieces(const byte_ring *ring, size_t from, size_t len, struct iovec iov[2])
+{
+    size_t offset = from & (ring->cap - 1);
+    size_t first  = ring->cap - offset;
+
+    if (len == 0)
+        return 0;
+
+    iov[0].iov_base = ring->data + offset;
+    if (len <= first)
+    {
+        iov[0].iov_len = len;
+        return 1;
+    }
+
+    iov[0].iov_len  = first;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len  = len - first;
+
+    return 2;
+}
+
+int byte_ring_reserve(byte_ring *ring, size_t len)
+{
+    size_t       used = byte_ring_len(ring);
+    size_t       cap  = ring->cap ? ring->cap : BYTE_RING_MIN_CAP;
+    char        *data;
+    struct iovec iov[2];
+    int          n;
+
+    if (ring->cap - used >= len)
+        return 0;
+
+    while (cap - used < len)
+    {
+        if (cap > ((size_t)-1) / 2)
+            return -1;
+        cap *= 2;
+    }
+
+    data = malloc(cap);
+    if (!data)
+        return -1;
+
+    // The queued bytes move to the start of the new buffer in one piece.
+    n = pieces(ring, ring->head, used, iov);
+    if (n > 0)
+        memcpy(data, iov[0].iov_base, iov[0].iov_len);
+    if (n == 2)
+        memcpy(data + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+
+    free(ring->data);
+    ring->data = data;
+    ring->cap  = cap;
+    ring->head = 0;
+    ring->tail = used;
+
+    return 0;
+}
+
+int byte_ring_append(byte_ring *ring, const void *src, size_t len)
+{
+    struct iovec iov[2];
+    int          n;
+
+    if (len == 0)
+        return 0;
+
+    if (byte_ring_reserve(ring, len) == -1)
+        return -1;
+
+    n = pieces(ring, ring->tail, len, iov);
+    memcpy(iov[0].iov_base, src, iov[0].iov_len);
+    if (n == 2)
+        memcpy(iov[1].iov_base, (const char *)src + iov[0].iov_len, iov[1].iov_len);
+
+    ring->tail += len;
+
+    return 0;
+}
+
+int byte_ring_data(const byte_ring *ring, struct iovec iov[2])
+{
+    return pieces(ring, ring->head, byte_ring_len(ring), iov);
+}
+
+int byte_ring_space(const byte_ring *ring, struct iovec iov[2])
+{
+    return pieces(ring, ring->tail, ring->cap - byte_ring_len(ring), iov);
+}
+
+void byte_ring_produce(byte_ring *ring, size_t len)
+{
+    ring->tail += len;
+}
+
+void byte_ring_consume(byte_ring *ring, size_t len)
+{
+    ring->head += len;
+
+    if (ring->head == ring->tail)
+    {
+        ring->head = 0;
+        ring->tail = 0;
+    }
+}
+
+void byte_ring_free(byte_ring *ring)
+{
+    free(ring->data);
+    memset(ring, 0, sizeof(*ring));
+}
@@ -1,31 +1,66 @@
 #include "command_line.h"
+#include "hash_list.h"
+#include "keyspace.h"
+#include "rainbow.h"
 #include "utils.h"
 
 int parse_arguments(int argc, char *argv[], arguments *args, struct fsm_error *err)
 {
     int opt;
-    int H_flag, c_flag, p_flag, s_flag, w_flag, t_flag;
+    int H_flag, F_flag, c_flag, p_flag, s_flag, w_flag, t_flag, m_flag, W_flag, r_flag, o_flag, M_flag, T_flag;
+    int B_flag, R_flag, S_flag, L_flag, N_flag, E_flag;
 
     opterr = 0;
     H_flag = 0;
+    F_flag = 0;
     c_flag = 0;
     p_flag = 0;
     s_flag = 0;
     w_flag = 0;
     t_flag = 0;
+    m_flag = 0;
+    W_flag = 0;
+    r_flag = 0;
+    o_flag = 0;
+    M_flag = 0;
+    T_flag = 0;
+    B_flag = 0;
+    R_flag = 0;
+    S_flag = 0;
+    L_flag = 0;
+    N_flag = 0;
+    E_flag = 0;
 
     static struct option long_opts[] = {
-        {"hash",       required_argument, 0, 'H'},
-        {"checkpoint", required_argument, 0, 'c'},
-        {"port",       required_argument, 0, 'p'},
-        {"server",     required_argument, 0, 's'},
-        {"work-size",  required_argument, 0, 'w'},
-        {"timeout",    required_argument, 0, 't'},
-        {"help",       no_argument,       0, 'h'},
-        {0,            0,                 0, 0  },
+        {"hash",             required_argument, 0, 'H'},
+        {"hash-file",        required_argument, 0, 'F'},
+        {"checkpoint",       required_argument, 0, 'c'},
+        {"port",             required_argument, 0, 'p'},
+        {"server",           required_argument, 0, 's'},
+        {"work-size",        required_argument, 0, 'w'},
+        {"timeout",          required_argument, 0, 't'},
+        {"mask",             required_argument, 0, 'm'},
+        {"wordlist",         required_argument, 0, 'W'},
+        {"rules",            required_argument, 0, 'r'},
+        {"prepend",          no_argument,       0, 'P'},
+        {"hybrid-order",     required_argument, 0, 'o'},
+        {"markov",           required_argument, 0, 'M'},
+        {"markov-threshold", required_argument, 0, 'T'},
+        {"rainbow-build",    required_argument, 0, 'B'},
+        {"rainbow",          required_argument, 0, 'R'},
+        {"rainbow-scheme",   required_argument, 0, 'S'},
+        {"chain-len",        required_argument, 0, 'L'},
+        {"chains",           required_argument, 0, 'N'},
+        {"event-loop",       required_argument, 0, 'E'},
+        {"custom-charset1",  required_argument, 0, '1'},
+        {"custom-charset2",  required_argument, 0, '2'},
+        {"custom-charset3",  required_argument, 0, '3'},
+        {"custom-charset4",  required_argument, 0, '4'},
+        {"help",             no_argument,       0, 'h'},
+        {0,                  0,                 0, 0  },
     };
 
-    while ((opt = getopt_long(argc, argv, "H:c:p:s:w:t:h", long_opts, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "H:F:c:p:s:w:t:m:W:r:Po:M:T:B:R:S:L:N:E:1:2:3:4:h", long_opts, NULL)) != -1)
     {
         switch (opt)
         {
@@ -44,6 +79,21 @@ int parse_arguments(int argc, char *argv[], arguments *args, struct fsm_error *e
                 args->crack_ctx.hash = optarg;
                 break;
             }
+            case 'F':
+            {
+                if (F_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-F' can only be passed in once.");
+
+                    return -1;
+                }
+
+                F_flag++;
+                args->crack_ctx.hash_file = optarg;
+                break;
+            }
             case 'c':
             {
                 if (c_flag)
@@ -119,6 +169,219 @@ int parse_arguments(int argc, char *argv[], arguments *args, struct fsm_error *e
                 args->work_size_str = optarg;
                 break;
             }
+            case 'm':
+            {
+                if (m_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-m' can only be passed in once.");
+
+                    return -1;
+                }
+
+                m_flag++;
+                args->crack_ctx.mask = optarg;
+                break;
+            }
+            case 'W':
+            {
+                if (W_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-W' can only be passed in once.");
+
+                    return -1;
+                }
+
+                W_flag++;
+                args->crack_ctx.wordlist = optarg;
+                break;
+            }
+            case 'r':
+            {
+                if (r_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-r' can only be passed in once.");
+
+                    return -1;
+                }
+
+                r_flag++;
+                args->crack_ctx.rules_file = optarg;
+                break;
+            }
+            case 'P':
+            {
+                args->crack_ctx.hybrid_prepend = 1;
+                break;
+            }
+            case 'o':
+            {
+                if (o_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-o' can only be passed in once.");
+
+                    return -1;
+                }
+
+                if (strcmp(optarg, "word") != 0 && strcmp(optarg, "mask") != 0)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-o' must be 'word' or 'mask'.");
+
+                    return -1;
+                }
+
+                o_flag++;
+                args->crack_ctx.hybrid_mask_major = strcmp(optarg, "mask") == 0;
+                break;
+            }
+            case 'M':
+            {
+                if (M_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-M' can only be passed in once.");
+
+                    return -1;
+                }
+
+                M_flag++;
+                args->crack_ctx.markov = optarg;
+                break;
+            }
+            case 'T':
+            {
+                if (T_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-T' can only be passed in once.");
+
+                    return -1;
+                }
+
+                T_flag++;
+                args->crack_ctx.markov_threshold_str = optarg;
+                break;
+            }
+            case 'B':
+            {
+                if (B_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-B' can only be passed in once.");
+
+                    return -1;
+                }
+
+                B_flag++;
+                args->crack_ctx.rainbow_build = optarg;
+                break;
+            }
+            case 'R':
+            {
+                if (R_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-R' can only be passed in once.");
+
+                    return -1;
+                }
+
+                R_flag++;
+                args->crack_ctx.rainbow = optarg;
+                break;
+            }
+            case 'S':
+            {
+                if (S_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-S' can only be passed in once.");
+
+                    return -1;
+                }
+
+                S_flag++;
+                args->crack_ctx.rainbow_scheme = optarg;
+                break;
+            }
+            case 'L':
+            {
+                if (L_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-L' can only be passed in once.");
+
+                    return -1;
+                }
+
+                L_flag++;
+                args->crack_ctx.chain_len_str = optarg;
+                break;
+            }
+            case 'N':
+            {
+                if (N_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-N' can only be passed in once.");
+
+                    return -1;
+                }
+
+                N_flag++;
+                args->crack_ctx.chains_str = optarg;
+                break;
+            }
+            case 'E':
+            {
+                if (E_flag)
+                {
+                    usage(argv[0]);
+
+                    SET_ERROR(err, "option '-E' can only be passed in once.");
+
+                    return -1;
+                }
+
+                E_flag++;
+                args->event_loop_str = optarg;
+                break;
+            }
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            {
+                if (args->crack_ctx.custom_charsets[opt - '1'])
+                {
+                    char message[48];
+
+                    snprintf(message, sizeof(message), "option '-%c' can only be passed in once.", opt);
+                    usage(argv[0]);
+                    SET_ERROR(err, message);
+
+                    return -1;
+                }
+
+                args->crack_ctx.custom_charsets[opt - '1'] = optarg;
+                break;
+            }
             case 'h':
             {
                 usage(argv[0]);
@@ -163,7 +426,11 @@ void usage(const char *program_name)
             "Required options:\n"
             "  -s, --server <addr>       Server IP address or hostname (required)\n"
             "  -p, --port <num>          Server listen port (required)\n"
-            "  -H, --hash <hash>         Hashed password to crack (required)\n\n"
+            "  -H, --hash <hash>         Hashed password to crack: a crypt(3) string,\n"
+            "                             hex MD5/SHA-1/SHA-256, or $NT$ and hex for NTLM\n"
+            "  -F, --hash-file <path>    Crack every hash in a file, one per line, in one pass\n"
+            "                             (with or instead of -H; at least one is required\n"
+            "                             unless building a rainbow table)\n\n"
             "Optional options:\n"
             "  -w, --work-size <num>     Number of passwords assigned per node request\n"
             "                             (default: 1000)\n"
@@ -171,16 +438,47 @@ void usage(const char *program_name)
             "                             (default: work-size / 4)\n"
             "  -t, --timeout <num>       Seconds to wait for a checkpoint from a client\n"
             "                             (default: 600)\n"
+            "  -m, --mask <mask>         Only try candidates matching a mask, e.g. ?u?l?l?l?d?d\n"
+            "                             (?l ?u ?d ?s ?a ?h ?H ?1-?4, ?? for a literal '?')\n"
+            "  -1, --custom-charset1 <cs> Charset for ?1 in the mask (also -2, -3, -4)\n"
+            "  -W, --wordlist <path>     Try each line of a wordlist; workers need the same file\n"
+            "                             (with -m, every line gets the mask appended)\n"
+            "  -P, --prepend             Hybrid: put the mask before the word instead\n"
+            "  -o, --hybrid-order <o>    Hybrid: 'word' steps the mask fastest (default),\n"
+            "                             'mask' steps the wordlist fastest\n"
+            "  -r, --rules <path>        Apply each rule in a file to every wordlist line\n"
+            "                             (hashcat-style, e.g. c $1, one rule per line)\n"
+            "  -M, --markov <path>       Try likely characters first, using statistics from\n"
+            "                             markov_train; workers need the same file\n"
+            "  -T, --markov-threshold <n> Only try the n most likely characters per position\n"
+            "  -B, --rainbow-build <path> Have the workers build a rainbow table over the mask\n"
+            "                             instead of cracking; takes no hashes\n"
+            "  -S, --rainbow-scheme <s>  Hash the table is built for: md5 (default), sha1,\n"
+            "                             sha256 or ntlm\n"
+            "  -L, --chain-len <n>       Links per rainbow chain (default: 1000)\n"
+            "  -N, --chains <n>          Rainbow chains to build (default: twice the mask's\n"
+            "                             keyspace over the chain length)\n"
+            "  -R, --rainbow <path>      Look the hashes up in a rainbow table instead of\n"
+            "                             searching the keyspace; workers need the same file\n"
+            "  -E, --event-loop <name>   How the server waits on its sockets: epoll (default\n"
+            "                             on Linux), io_uring or poll\n"
             "  -h, --help                Display this help message and exit\n\n"
             "Examples:\n"
             "  %s --server 192.168.1.10 --port 5000 --hash $6$... --work-size 1000\n"
-            "  %s -s example.com -p 5000 -H <hash> -c 500 -t 300\n\n",
-            program_name, program_name, program_name);
+            "  %s -s example.com -p 5000 -H <hash> -c 500 -t 300\n"
+            "  %s -s example.com -p 5000 -H <hash> -1 ?l?d -m ?u?1?1?1?1?d\n"
+            "  %s -s example.com -p 5000 -H <hash> -W words.txt -m ?d?d?d\n"
+            "  %s -s example.com -p 5000 -F hashes.txt -m ?l?l?l?l?l?l\n"
+            "  %s -s example.com -p 5000 -B lower6.rt -m ?l?l?l?l?l?l -L 2000\n"
+            "  %s -s example.com -p 5000 -F hashes.txt -R lower6.rt\n\n",
+            program_name, program_name, program_name, program_name, program_name, program_name, program_name,
+            program_name);
 
     fputs("Notes:\n", stderr);
     fputs("  • Long and short forms may be used interchangeably (e.g. --port or -p).\n", stderr);
     fputs("  • If work-size is omitted it defaults to 1000.\n", stderr);
     fputs("  • If checkpoint is omitted it defaults to work-size / 4.\n", stderr);
+    fputs("  • Without a mask every length of the built-in charset is tried in turn.\n", stderr);
     fputs("  • The program will validate numeric ranges (e.g. port must fit in uint16).\n", stderr);
 }
 
@@ -202,9 +500,9 @@ int handle_arguments(const char *binary_name, arguments *args, struct fsm_error
         return -1;
     }
 
-    if (args->crack_ctx.hash == NULL)
+    if (args->crack_ctx.rainbow_build == NULL && args->crack_ctx.hash == NULL && args->crack_ctx.hash_file == NULL)
     {
-        SET_ERROR(err, "The Hash is required!");
+        SET_ERROR(err, "A hash or a hash file is required!");
         usage(binary_name);
 
         return -1;
@@ -248,6 +546,137 @@ int handle_arguments(const char *binary_name, arguments *args, struct fsm_error
             return -1;
     }
 
+    if ((args->crack_ctx.hybrid_prepend || args->crack_ctx.hybrid_mask_major) &&
+        (args->crack_ctx.mask == NULL || args->crack_ctx.wordlist == NULL))
+    {
+        SET_ERROR(err, "Hybrid options require both a mask and a wordlist!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.markov_threshold_str != NULL)
+    {
+        if (args->crack_ctx.markov == NULL)
+        {
+            SET_ERROR(err, "A Markov threshold requires Markov statistics!");
+            usage(binary_name);
+
+            return -1;
+        }
+
+        if (string_to_uint64(args->crack_ctx.markov_threshold_str, &args->crack_ctx.markov_threshold, err) != 0)
+            return -1;
+
+        if (args->crack_ctx.markov_threshold == 0 || args->crack_ctx.markov_threshold > MAX_POSITION_CHARSET)
+        {
+            SET_ERROR(err, "Markov threshold must be between 1 and 255!");
+            usage(binary_name);
+
+            return -1;
+        }
+    }
+
+    if (args->crack_ctx.markov != NULL && args->crack_ctx.wordlist != NULL)
+    {
+        SET_ERROR(err, "Markov ordering cannot be combined with a wordlist!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.rules_file != NULL && args->crack_ctx.wordlist == NULL)
+    {
+        SET_ERROR(err, "Rules require a wordlist!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.rules_file != NULL && args->crack_ctx.mask != NULL)
+    {
+        SET_ERROR(err, "Rules cannot be combined with a hybrid mask!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.rainbow_build != NULL)
+    {
+        if (args->crack_ctx.hash != NULL || args->crack_ctx.hash_file != NULL || args->crack_ctx.rainbow != NULL)
+        {
+            SET_ERROR(err, "Building a rainbow table takes no hashes!");
+            usage(binary_name);
+
+            return -1;
+        }
+
+        if (args->crack_ctx.mask == NULL || args->crack_ctx.wordlist != NULL || args->crack_ctx.markov != NULL)
+        {
+            SET_ERROR(err, "A rainbow table covers a mask, without a wordlist or Markov ordering!");
+            usage(binary_name);
+
+            return -1;
+        }
+    }
+    else if (args->crack_ctx.rainbow_scheme != NULL || args->crack_ctx.chain_len_str != NULL ||
+             args->crack_ctx.chains_str != NULL)
+    {
+        SET_ERROR(err, "Rainbow scheme, chain length and chain count require a table to build!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.rainbow != NULL &&
+        (args->crack_ctx.mask != NULL || args->crack_ctx.wordlist != NULL || args->crack_ctx.markov != NULL))
+    {
+        SET_ERROR(err, "A rainbow table brings its own mask, so it takes no -m, -W or -M!");
+        usage(binary_name);
+
+        return -1;
+    }
+
+    if (args->crack_ctx.rainbow_build == NULL && hash_list_load(&args->crack_ctx, err) != 0)
+        return -1;
+
+    if (args->crack_ctx.wordlist != NULL && wordlist_prepare(&args->crack_ctx, err) != 0)
+        return -1;
+
+    if (args->crack_ctx.rules_file != NULL && rules_load(&args->crack_ctx, err) != 0)
+        return -1;
+
+    if (args->crack_ctx.mask == NULL)
+    {
+        for (int i = 0; i < NUM_CUSTOM_CHARSETS; i++)
+        {
+            if (args->crack_ctx.custom_charsets[i])
+            {
+                SET_ERROR(err, "Custom charsets require a mask!");
+                usage(binary_name);
+
+                return -1;
+            }
+        }
+    }
+    else if (mask_parse(&args->crack_ctx, err) != 0)
+    {
+        return -1;
+    }
+    else if (args->crack_ctx.wordlist != NULL && hybrid_prepare(&args->crack_ctx, err) != 0)
+    {
+        return -1;
+    }
+
+    if (args->crack_ctx.markov != NULL && markov_prepare(&args->crack_ctx, err) != 0)
+        return -1;
+
+    if (args->crack_ctx.rainbow_build != NULL && rainbow_build_prepare(&args->crack_ctx, err) != 0)
+        return -1;
+
+    if (args->crack_ctx.rainbow != NULL && rainbow_lookup_prepare(&args->crack_ctx, err) != 0)
+        return -1;
+
     return 0;
 }
 
@@ -0,0 +1,601 @@
+#include "event_loop.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+    #include <linux/io_uring.h>
+    #include <signal.h>
+    #include <sys/epoll.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+#define EVENT_RING_ENTRIES 256
+#define EVENT_RING_IGNORE UINT64_MAX // user_data of requests whose completion means nothing
+
+static event_slot *slot_for(event_loop *loop, int fd, struct fsm_error *err);
+static int         poll_add(event_loop *loop, int fd, struct fsm_error *err);
+static void        poll_remove(event_loop *loop, int fd);
+static int         poll_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err);
+
+#ifdef __linux__
+static int  epoll_open(event_loop *loop, struct fsm_error *err);
+static int  epoll_wait_ready(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err);
+static int  ring_open(event_loop *loop, struct fsm_error *err);
+static void ring_close(event_loop *loop);
+static int  ring_enter(event_loop *loop, unsigned min_complete, int timeout_ms);
+static void ring_push(event_loop *loop, uint8_t opcode, int fd, uint64_t addr, uint64_t user_data);
+static void ring_arm(event_loop *loop, int fd);
+static void ring_disarm(event_loop *loop, int fd);
+static int  ring_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err);
+#endif
+
+static event_slot *slot_for(event_loop *loop, int fd, struct fsm_error *err)
+{
+    if ((size_t)fd >= loop->num_slots)
+    {
+        size_t      new_num = loop->num_slots ? loop->num_slots : 64;
+        event_slot *slots;
+
+        while (new_num <= (size_t)fd)
+            new_num *= 2;
+
+        slots = realloc(loop->slots, new_num * sizeof(*slots));
+        if (!slots)
+        {
+            SET_ERROR(err, "realloc failed (slot_for)");
+            return NULL;
+        }
+
+        memset(slots + loop->num_slots, 0, (new_num - loop->num_slots) * sizeof(*slots));
+        loop->slots     = slots;
+        loop->num_slots = new_num;
+    }
+
+    return &loop->slots[fd];
+}
+
+// The poll backend keeps its array from one wait to the next; removal moves
+// the last entry into the hole.
+static int poll_add(event_loop *loop, int fd, struct fsm_error *err)
+{
+    if (loop->num_pollfds == loop->pollfds_cap)
+    {
+        size_t         new_cap = loop->pollfds_cap ? loop->pollfds_cap * 2 : 64;
+        struct pollfd *pollfds = realloc(loop->pollfds, new_cap * sizeof(*pollfds));
+
+        if (!pollfds)
+        {
+            SET_ERROR(err, "realloc failed (poll_add)");
+            return -1;
+        }
+
+        loop->pollfds     = pollfds;
+        loop->pollfds_cap = new_cap;
+    }
+
+    loop->slots[fd].position                 = loop->num_pollfds;
+    loop->pollfds[loop->num_pollfds].fd      = fd;
+    loop->pollfds[loop->num_pollfds].events  = POLLIN;
+    loop->pollfds[loop->num_pollfds].revents = 0;
+    loop->num_pollfds++;
+
+    return 0;
+}
+
+static void poll_remove(event_loop *loop, int fd)
+{
+    size_t position = loop->slots[fd].position;
+
+    loop->pollfds[position] = loop->pollfds[--loop->num_pollfds];
+    loop->slots[loop->pollfds[position].fd].position = position;
+}
+
+static int poll_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err)
+{
+    int count = 0;
+    int n     = poll(loop->pollfds, (nfds_t)loop->num_pollfds, timeout_ms);
+
+    if (n < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    for (size_t i = 0; i < loop->num_pollfds && count < n && count < max; i++)
+    {
+        if (loop->pollfds[i].revents)
+            ready[count++] = loop->slots[loop->pollfds[i].fd].data;
+    }
+
+    return count;
+}
+
+#ifdef __linux__
+
+static int epoll_open(event_loop *loop, struct fsm_error *err)
+{
+    loop->fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->fd == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int epoll_wait_ready(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err)
+{
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int                n;
+
+    if (max > EVENT_LOOP_MAX_EVENTS)
+        max = EVENT_LOOP_MAX_EVENTS;
+
+    n = epoll_wait(loop->fd, events, max, timeout_ms);
+    if (n < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+        ready[i] = events[i].data.ptr;
+
+    return n;
+}
+
+// The submission and completion rings shared with the kernel. Nothing
+// polls the submission ring on the kernel's side, so requests only go in
+// when ring_enter() is called.
+struct event_ring
+{
+    unsigned            *sq_head;
+    unsigned            *sq_tail;
+    unsigned            *sq_mask;
+    unsigned            *sq_array;
+    unsigned             sq_entries;
+    unsigned            *cq_head;
+    unsigned            *cq_tail;
+    unsigned            *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *map;
+    size_t               map_len;
+    size_t               sqes_len;
+};
+
+static int ring_open(event_loop *loop, struct fsm_error *err)
+{
+    struct io_uring_params params;
+    struct event_ring     *ring;
+    char                  *map;
+
+    memset(&params, 0, sizeof(params));
+
+    loop->fd = (int)syscall(__NR_io_uring_setup, EVENT_RING_ENTRIES, &params);
+    if (loop->fd == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    // Timed waits need the extended arguments, and everything from that
+    // kernel on maps both rings at once.
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        SET_ERROR(err, "io_uring event loop needs Linux 5.11 or later");
+        return -1;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+    {
+        SET_ERROR(err, "calloc failed (ring_open)");
+        return -1;
+    }
+
+    loop->ring     = ring;
+    ring->map_len  = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe) > ring->map_len)
+        ring->map_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    ring->map  = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, loop->fd,
+                      IORING_OFF_SQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, loop->fd,
+                      IORING_OFF_SQES);
+
+    if (ring->map == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    map              = ring->map;
+    ring->sq_head    = (unsigned *)(void *)(map + params.sq_off.head);
+    ring->sq_tail    = (unsigned *)(void *)(map + params.sq_off.tail);
+    ring->sq_mask    = (unsigned *)(void *)(map + params.sq_off.ring_mask);
+    ring->sq_array   = (unsigned *)(void *)(map + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head    = (unsigned *)(void *)(map + params.cq_off.head);
+    ring->cq_tail    = (unsigned *)(void *)(map + params.cq_off.tail);
+    ring->cq_mask    = (unsigned *)(void *)(map + params.cq_off.ring_mask);
+    ring->cqes       = (struct io_uring_cqe *)(void *)(map + params.cq_off.cqes);
+
+    return 0;
+}
+
+static void ring_close(event_loop *loop)
+{
+    struct event_ring *ring = loop->ring;
+
+    if (!ring)
+        return;
+
+    if (ring->map && ring->map != MAP_FAILED)
+        munmap(ring->map, ring->map_len);
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_len);
+
+    free(ring);
+    loop->ring = NULL;
+}
+
+// Submits everything queued and, with min_complete, waits up to timeout_ms
+// (forever when negative) for that many completions.
+static int ring_enter(event_loop *loop, unsigned min_complete, int timeout_ms)
+{
+    struct event_ring            *ring    = loop->ring;
+    unsigned                      pending = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec      ts;
+    unsigned                      flags = IORING_ENTER_EXT_ARG;
+
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+
+    if (min_complete > 0)
+        flags |= IORING_ENTER_GETEVENTS;
+
+    if (timeout_ms >= 0)
+    {
+        ts.tv_sec  = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts     = (uint64_t)(uintptr_t)&ts;
+    }
+
+    return (int)syscall(__NR_io_uring_enter, loop->fd, pending, min_complete, flags, &arg, sizeof(arg));
+}
+
+static void ring_push(event_loop *loop, uint8_t opcode, int fd, uint64_t addr, uint64_t user_data)
+{
+    struct event_ring   *ring = loop->ring;
+    unsigned             tail = *ring->sq_tail;
+    unsigned             index;
+    struct io_uring_sqe *sqe;
+
+    // A full ring goes in before anything more is queued.
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries)
+        ring_enter(loop, 0, -1);
+
+    index = tail & *ring->sq_mask;
+    sqe   = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->addr      = addr;
+    sqe->user_data = user_data;
+
+    if (opcode == IORING_OP_POLL_ADD)
+    {
+        sqe->poll32_events = POLLIN | POLLRDHUP | (loop->slots[fd].output ? POLLOUT : 0);
+        sqe->len           = IORING_POLL_ADD_MULTI;
+    }
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// One multishot poll per socket keeps reporting input until removed.
+static void ring_arm(event_loop *loop, int fd)
+{
+    ring_push(loop, IORING_OP_POLL_ADD, fd, 0, (uint64_t)loop->slots[fd].generation << 32 | (uint32_t)fd);
+}
+
+// The poll holds a reference to the socket, so its removal goes in at once
+// for a close that follows to really close it.
+static void ring_disarm(event_loop *loop, int fd)
+{
+    ring_push(loop, IORING_OP_POLL_REMOVE, -1, (uint64_t)loop->slots[fd].generation << 32 | (uint32_t)fd,
+              EVENT_RING_IGNORE);
+    ring_enter(loop, 0, -1);
+}
+
+// Completions for descriptors removed since, or removed and reused, carry
+// an old generation and are dropped. A poll the kernel ended (no MORE
+// flag) is armed again while its socket is still registered.
+static int ring_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err)
+{
+    struct event_ring *ring = loop->ring;
+    int                reported[EVENT_LOOP_MAX_EVENTS];
+    int                count = 0;
+    unsigned           head  = *ring->cq_head;
+
+    if (max > EVENT_LOOP_MAX_EVENTS)
+        max = EVENT_LOOP_MAX_EVENTS;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) && ring_enter(loop, 1, timeout_ms) < 0 &&
+        errno != ETIME && errno != EINTR)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    for (unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE); head != tail && count < max; head++)
+    {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        int                        fd  = (int)(uint32_t)cqe->user_data;
+        event_slot                *slot;
+
+        if (cqe->user_data == EVENT_RING_IGNORE || (size_t)fd >= loop->num_slots)
+            continue;
+
+        slot = &loop->slots[fd];
+        if (!slot->registered || slot->generation != (uint32_t)(cqe->user_data >> 32))
+            continue;
+
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            ring_arm(loop, fd);
+
+        if (cqe->res < 0 || slot->reported)
+            continue;
+
+        slot->reported    = true;
+        reported[count]   = fd;
+        ready[count++]    = slot->data;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < count; i++)
+        loop->slots[reported[i]].reported = false;
+
+    return count;
+}
+
+#endif
+
+int event_loop_open(event_loop *loop, const char *name, struct fsm_error *err)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->fd = -1;
+
+#ifdef __linux__
+    if (name == NULL || strcmp(name, "epoll") == 0)
+    {
+        loop->backend = EVENT_BACKEND_EPOLL;
+        return epoll_open(loop, err);
+    }
+
+    if (strcmp(name, "io_uring") == 0)
+    {
+        loop->backend = EVENT_BACKEND_IO_URING;
+        return ring_open(loop, err);
+    }
+#endif
+
+    if (name == NULL || strcmp(name, "poll") == 0)
+    {
+        loop->backend = EVENT_BACKEND_POLL;
+        return 0;
+    }
+
+    SET_ERROR(err, "Event loop backend not available on this system");
+    return -1;
+}
+
+void event_loop_close(event_loop *loop)
+{
+#ifdef __linux__
+    ring_close(loop);
+#endif
+
+    if (loop->fd != -1)
+        close(loop->fd);
+
+    free(loop->slots);
+    free(loop->pollfds);
+    memset(loop, 0, sizeof(*loop));
+    loop->fd = -1;
+}
+
+int event_loop_add(event_loop *loop, int fd, void *data, struct fsm_error *err)
+{
+    event_slot *slot = slot_for(loop, fd, err);
+
+    if (!slot)
+        return -1;
+
+    slot->data       = data;
+    slot->registered = true;
+    slot->output     = false;
+    slot->reported   = false;
+    slot->generation++;
+
+    switch (loop->backend)
+    {
+#ifdef __linux__
+        case EVENT_BACKEND_EPOLL:
+        {
+            struct epoll_event event;
+
+            memset(&event, 0, sizeof(event));
+            event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = data;
+
+            if (epoll_ctl(loop->fd, EPOLL_CTL_ADD, fd, &event) == -1)
+            {
+                slot->registered = false;
+                SET_ERROR(err, strerror(errno));
+                return -1;
+            }
+
+            return 0;
+        }
+        case EVENT_BACKEND_IO_URING:
+        {
+            ring_arm(loop, fd);
+            return 0;
+        }
+#else
+        case EVENT_BACKEND_EPOLL:
+        case EVENT_BACKEND_IO_URING:
+#endif
+        case EVENT_BACKEND_POLL:
+        default:
+        {
+            if (poll_add(loop, fd, err) == -1)
+            {
+                slot->registered = false;
+                return -1;
+            }
+
+            return 0;
+        }
+    }
+}
+
+void event_loop_remove(event_loop *loop, int fd)
+{
+    if ((size_t)fd >= loop->num_slots || !loop->slots[fd].registered)
+        return;
+
+    loop->slots[fd].registered = false;
+
+    switch (loop->backend)
+    {
+#ifdef __linux__
+        case EVENT_BACKEND_EPOLL:
+        {
+            epoll_ctl(loop->fd, EPOLL_CTL_DEL, fd, NULL);
+            break;
+        }
+        case EVENT_BACKEND_IO_URING:
+        {
+            ring_disarm(loop, fd);
+            break;
+        }
+#else
+        case EVENT_BACKEND_EPOLL:
+        case EVENT_BACKEND_IO_URING:
+#endif
+        case EVENT_BACKEND_POLL:
+        default:
+        {
+            poll_remove(loop, fd);
+            break;
+        }
+    }
+}
+
+int event_loop_watch_output(event_loop *loop, int fd, bool on, struct fsm_error *err)
+{
+    event_slot *slot;
+
+    if ((size_t)fd >= loop->num_slots || !loop->slots[fd].registered)
+    {
+        SET_ERROR(err, "event_loop_watch_output(): descriptor not registered");
+        return -1;
+    }
+
+    slot = &loop->slots[fd];
+    if (slot->output == on)
+        return 0;
+
+    slot->output = on;
+
+    switch (loop->backend)
+    {
+#ifdef __linux__
+        case EVENT_BACKEND_EPOLL:
+        {
+            struct epoll_event event;
+
+            memset(&event, 0, sizeof(event));
+            event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET | (on ? EPOLLOUT : 0);
+            event.data.ptr = slot->data;
+
+            if (epoll_ctl(loop->fd, EPOLL_CTL_MOD, fd, &event) == -1)
+            {
+                SET_ERROR(err, strerror(errno));
+                return -1;
+            }
+
+            return 0;
+        }
+        case EVENT_BACKEND_IO_URING:
+        {
+            // The old poll's late completions carry the old generation.
+            ring_disarm(loop, fd);
+            slot->generation++;
+            ring_arm(loop, fd);
+            return 0;
+        }
+#else
+        case EVENT_BACKEND_EPOLL:
+        case EVENT_BACKEND_IO_URING:
+#endif
+        case EVENT_BACKEND_POLL:
+        default:
+        {
+            loop->pollfds[slot->position].events = (short)(POLLIN | (on ? POLLOUT : 0));
+            return 0;
+        }
+    }
+}
+
+int event_loop_wait(event_loop *loop, void **ready, int max, int timeout_ms, struct fsm_error *err)
+{
+    switch (loop->backend)
+    {
+#ifdef __linux__
+        case EVENT_BACKEND_EPOLL:
+            return epoll_wait_ready(loop, ready, max, timeout_ms, err);
+        case EVENT_BACKEND_IO_URING:
+            return ring_wait(loop, ready, max, timeout_ms, err);
+#else
+        case EVENT_BACKEND_EPOLL:
+        case EVENT_BACKEND_IO_URING:
+#endif
+        case EVENT_BACKEND_POLL:
+        default:
+            return poll_wait(loop, ready, max, timeout_ms, err);
+    }
+}
+
+const char *event_loop_name(const event_loop *loop)
+{
+    switch (loop->backend)
+    {
+        case EVENT_BACKEND_EPOLL:
+            return "epoll";
+        case EVENT_BACKEND_IO_URING:
+            return "io_uring";
+        case EVENT_BACKEND_POLL:
+        default:
+            return "poll";
+    }
+}
@@ -0,0 +1,233 @@
+#include "hash_list.h"
+#include <errno.h>
+#include <stdio.h>
+
+static size_t setting_len(const char *hash);
+static int    compare_groups(const char *a, const char *b);
+static int    compare_hashes(const void *a, const void *b);
+static int    hash_list_add(struct cracking_context *crack_ctx, const char *hash, size_t *cap, struct fsm_error *err);
+static int    hash_file_load(struct cracking_context *crack_ctx, size_t *cap, struct fsm_error *err);
+static bool   hash_valid(const char *hash);
+
+// The leading part of an encoded hash that fixes what a worker computes per
+// candidate: scheme, cost and salt. Unsalted hex digests have none.
+static size_t setting_len(const char *hash)
+{
+    const char *dollar;
+    size_t      len = strlen(hash);
+
+    if (strncmp(hash, "$NT$", 4) == 0)
+        return 4;
+    if (strncmp(hash, "$2", 2) == 0 && len == 60)
+        return 29;
+    if (hash[0] != '$')
+        return (len == 13) ? 2 : 0;
+
+    dollar = strrchr(hash, '$');
+    return (size_t)(dollar - hash);
+}
+
+// Orders by setting, then by length so unsalted MD5, SHA-1 and SHA-256 keep
+// apart. Hashes that compare equal here form one salt group.
+static int compare_groups(const char *a, const char *b)
+{
+    size_t a_setting = setting_len(a);
+    size_t b_setting = setting_len(b);
+    size_t a_len     = strlen(a);
+    size_t b_len     = strlen(b);
+    int    cmp       = memcmp(a, b, (a_setting < b_setting) ? a_setting : b_setting);
+
+    if (cmp != 0)
+        return cmp;
+    if (a_setting != b_setting)
+        return (a_setting < b_setting) ? -1 : 1;
+    if (a_len != b_len)
+        return (a_len < b_len) ? -1 : 1;
+
+    return 0;
+}
+
+// Salt groups end up contiguous in the sorted list.
+static int compare_hashes(const void *a, const void *b)
+{
+    const char *x   = *(char *const *)a;
+    const char *y   = *(char *const *)b;
+    int         cmp = compare_groups(x, y);
+
+    return (cmp != 0) ? cmp : strcmp(x, y);
+}
+
+// Hashes travel to workers one per line and come back as the first word of
+// FOUND, so they cannot hold whitespace.
+static bool hash_valid(const char *hash)
+{
+    return hash[0] != '\0' && hash[strcspn(hash, " \t\r\n")] == '\0';
+}
+
+static int hash_list_add(struct cracking_context *crack_ctx, const char *hash, size_t *cap, struct fsm_error *err)
+{
+    if (!hash_valid(hash) || strlen(hash) > MAX_HASH_LEN)
+    {
+        char message[MAX_HASH_LEN + 64];
+        snprintf(message, sizeof(message), "Invalid hash: %.*s", MAX_HASH_LEN, hash);
+        SET_ERROR(err, message);
+        return -1;
+    }
+
+    if (crack_ctx->num_hashes == *cap)
+    {
+        size_t new_cap = *cap ? *cap * 2 : 64;
+        char **tmp     = realloc(crack_ctx->hashes, new_cap * sizeof(*tmp));
+        if (!tmp)
+        {
+            SET_ERROR(err, "realloc failed (hash_list_add)");
+            return -1;
+        }
+        crack_ctx->hashes = tmp;
+        *cap              = new_cap;
+    }
+
+    crack_ctx->hashes[crack_ctx->num_hashes] = strdup(hash);
+    if (!crack_ctx->hashes[crack_ctx->num_hashes])
+    {
+        SET_ERROR(err, "strdup failed (hash_list_add)");
+        return -1;
+    }
+    crack_ctx->num_hashes++;
+
+    return 0;
+}
+
+// One hash per line; blank lines and # comments are skipped.
+static int hash_file_load(struct cracking_context *crack_ctx, size_t *cap, struct fsm_error *err)
+{
+    FILE *file;
+    char  line[MAX_HASH_LEN + 2];
+
+    file = fopen(crack_ctx->hash_file, "r");
+    if (!file)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        size_t len = strcspn(line, "\r\n");
+
+        if (line[len] == '\0' && !feof(file))
+        {
+            SET_ERROR(err, "Hash is longer than 255 characters");
+            fclose(file);
+            return -1;
+        }
+
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        if (hash_list_add(crack_ctx, line, cap, err) != 0)
+        {
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+
+    return 0;
+}
+
+// Gathers -H and the hash file into one sorted list without duplicates, so
+// FOUND looks its hash up by binary search and hashes sharing a salt sit together.
+int hash_list_load(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    size_t cap = 0;
+    size_t unique;
+
+    if (crack_ctx->hash != NULL && hash_list_add(crack_ctx, crack_ctx->hash, &cap, err) != 0)
+        return -1;
+
+    if (crack_ctx->hash_file != NULL && hash_file_load(crack_ctx, &cap, err) != 0)
+        return -1;
+
+    if (crack_ctx->num_hashes == 0)
+    {
+        SET_ERROR(err, "Hash file has no hashes");
+        return -1;
+    }
+
+    qsort(crack_ctx->hashes, crack_ctx->num_hashes, sizeof(*crack_ctx->hashes), compare_hashes);
+
+    unique = 1;
+    for (size_t i = 1; i < crack_ctx->num_hashes; i++)
+    {
+        if (strcmp(crack_ctx->hashes[i], crack_ctx->hashes[unique - 1]) == 0)
+            free(crack_ctx->hashes[i]);
+        else
+            crack_ctx->hashes[unique++] = crack_ctx->hashes[i];
+    }
+
+    if (unique < crack_ctx->num_hashes)
+        printf("[SERVER] Dropped %zu duplicate hashes\n", crack_ctx->num_hashes - unique);
+
+    crack_ctx->num_hashes = unique;
+    crack_ctx->passwords  = calloc(unique, sizeof(*crack_ctx->passwords));
+    crack_ctx->cracked    = malloc(unique * sizeof(*crack_ctx->cracked));
+    if (!crack_ctx->passwords || !crack_ctx->cracked)
+    {
+        SET_ERROR(err, "malloc failed (hash_list_load)");
+        return -1;
+    }
+
+    if (crack_ctx->hash_file != NULL)
+    {
+        size_t groups = 1;
+
+        for (size_t i = 1; i < unique; i++)
+        {
+            if (!hash_list_same_group(crack_ctx->hashes[i - 1], crack_ctx->hashes[i]))
+                groups++;
+        }
+
+        printf("[SERVER] Hash list %s: %zu hashes in %zu salt groups\n", crack_ctx->hash_file, unique, groups);
+    }
+
+    return 0;
+}
+
+bool hash_list_same_group(const char *a, const char *b)
+{
+    return compare_groups(a, b) == 0;
+}
+
+bool hash_list_find(const struct cracking_context *crack_ctx, const char *hash, size_t *index)
+{
+    char *const *match = bsearch(&hash, crack_ctx->hashes, crack_ctx->num_hashes, sizeof(*crack_ctx->hashes),
+                                 compare_hashes);
+
+    if (!match)
+        return false;
+
+    *index = (size_t)(match - crack_ctx->hashes);
+    return true;
+}
+
+void hash_list_free(struct cracking_context *crack_ctx)
+{
+    for (size_t i = 0; i < crack_ctx->num_hashes; i++)
+    {
+        free(crack_ctx->hashes[i]);
+        if (crack_ctx->passwords)
+            free(crack_ctx->passwords[i]);
+    }
+
+    free(crack_ctx->hashes);
+    free(crack_ctx->passwords);
+    free(crack_ctx->cracked);
+    crack_ctx->hashes      = NULL;
+    crack_ctx->passwords   = NULL;
+    crack_ctx->cracked     = NULL;
+    crack_ctx->num_hashes  = 0;
+    crack_ctx->num_cracked = 0;
+}
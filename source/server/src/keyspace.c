@@ -0,0 +1,457 @@
+#include "keyspace.h"
+#include "fsm.h"
+#include "rules.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static const char *builtin_charset(char name);
+static int         expand_charset(const char *spec, char *const custom[NUM_CUSTOM_CHARSETS], char *out,
+                                  struct fsm_error *err);
+
+static const char *builtin_charset(char name)
+{
+    switch (name)
+    {
+        case 'l':
+            return "abcdefghijklmnopqrstuvwxyz";
+        case 'u':
+            return "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        case 'd':
+            return "0123456789";
+        case 'h':
+            return "0123456789abcdef";
+        case 'H':
+            return "0123456789ABCDEF";
+        case 's':
+            return " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+        case 'a':
+            return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+                   " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+        case '?':
+            return "?";
+        default:
+            return NULL;
+    }
+}
+
+// Expands a hashcat-style charset spec ("?l?d_", "abc", ...) into its distinct
+// characters, in first-seen order. custom is NULL when ?1-?4 are not allowed.
+static int expand_charset(const char *spec, char *const custom[NUM_CUSTOM_CHARSETS], char *out,
+                          struct fsm_error *err)
+{
+    bool   seen[256] = {false};
+    size_t n         = 0;
+
+    for (const char *p = spec; *p; p++)
+    {
+        const char *chars;
+        char        literal[2] = {*p, '\0'};
+
+        if (*p != '?')
+        {
+            chars = literal;
+        }
+        else
+        {
+            p++;
+
+            if (*p >= '1' && *p <= '0' + NUM_CUSTOM_CHARSETS)
+            {
+                if (!custom)
+                {
+                    SET_ERROR(err, "Custom charsets cannot reference ?1-?4");
+                    return -1;
+                }
+
+                chars = custom[*p - '1'];
+                if (!chars)
+                {
+                    char message[64];
+                    snprintf(message, sizeof(message), "Mask uses ?%c but no custom charset %c was given", *p, *p);
+                    SET_ERROR(err, message);
+                    return -1;
+                }
+            }
+            else
+            {
+                chars = builtin_charset(*p);
+                if (!chars)
+                {
+                    char message[64];
+                    snprintf(message, sizeof(message), "Unknown mask placeholder '?%c'", *p ? *p : ' ');
+                    SET_ERROR(err, message);
+                    return -1;
+                }
+            }
+        }
+
+        for (const char *c = chars; *c; c++)
+        {
+            unsigned char u = (unsigned char)*c;
+
+            if (seen[u])
+                continue;
+
+            if (n == MAX_POSITION_CHARSET)
+            {
+                SET_ERROR(err, "Mask position charset holds more than 255 characters");
+                return -1;
+            }
+
+            seen[u]  = true;
+            out[n++] = *c;
+        }
+    }
+
+    out[n] = '\0';
+
+    return 0;
+}
+
+int mask_parse(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    char     custom[NUM_CUSTOM_CHARSETS][MAX_POSITION_CHARSET + 1];
+    char    *resolved[NUM_CUSTOM_CHARSETS] = {NULL};
+    uint64_t size                          = 1;
+
+    for (int i = 0; i < NUM_CUSTOM_CHARSETS; i++)
+    {
+        if (!crack_ctx->custom_charsets[i])
+            continue;
+
+        if (expand_charset(crack_ctx->custom_charsets[i], NULL, custom[i], err) == -1)
+            return -1;
+
+        if (custom[i][0] == '\0')
+        {
+            SET_ERROR(err, "Custom charsets must not be empty");
+            return -1;
+        }
+
+        resolved[i] = custom[i];
+    }
+
+    crack_ctx->mask_positions = calloc(MAX_MASK_POSITIONS, sizeof(char *));
+    if (!crack_ctx->mask_positions)
+    {
+        SET_ERROR(err, "calloc failed (mask_parse)");
+        return -1;
+    }
+
+    for (const char *p = crack_ctx->mask; *p; p++)
+    {
+        char spec[3] = {*p, '\0', '\0'};
+        char chars[MAX_POSITION_CHARSET + 1];
+
+        if (*p == '?')
+        {
+            spec[1] = *++p;
+            if (*p == '\0')
+            {
+                SET_ERROR(err, "Mask ends with a lone '?'");
+                return -1;
+            }
+        }
+
+        if (crack_ctx->mask_len == MAX_MASK_POSITIONS)
+        {
+            SET_ERROR(err, "Mask has more than 63 positions");
+            return -1;
+        }
+
+        if (expand_charset(spec, resolved, chars, err) == -1)
+            return -1;
+
+        size_t radix = strlen(chars);
+        if (size > UINT64_MAX / radix)
+        {
+            SET_ERROR(err, "Mask keyspace does not fit in 64 bits");
+            return -1;
+        }
+        size *= radix;
+
+        crack_ctx->mask_positions[crack_ctx->mask_len] = strdup(chars);
+        if (!crack_ctx->mask_positions[crack_ctx->mask_len])
+        {
+            SET_ERROR(err, "strdup failed (mask_parse)");
+            return -1;
+        }
+        crack_ctx->mask_len++;
+    }
+
+    if (crack_ctx->mask_len == 0)
+    {
+        SET_ERROR(err, "Mask must not be empty");
+        return -1;
+    }
+
+    crack_ctx->keyspace_size = size;
+
+    printf("[SERVER] Mask %s: %zu positions, keyspace=%" PRIu64 "\n", crack_ctx->mask, crack_ctx->mask_len, size);
+
+    return 0;
+}
+
+void mask_free(struct cracking_context *crack_ctx)
+{
+    if (!crack_ctx->mask_positions)
+        return;
+
+    for (size_t i = 0; i < crack_ctx->mask_len; i++)
+        free(crack_ctx->mask_positions[i]);
+
+    free(crack_ctx->mask_positions);
+    crack_ctx->mask_positions = NULL;
+    crack_ctx->mask_len       = 0;
+}
+
+// Counts lines the same way the workers index them: every '\n' ends a line,
+// plus one more when the file does not end in a newline.
+int wordlist_prepare(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    char    buffer[65536];
+    char    last  = '\n';
+    size_t  total = 0;
+    ssize_t n;
+    int     fd;
+
+    fd = open(crack_ctx->wordlist, O_RDONLY);
+    if (fd == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    crack_ctx->keyspace_size = 0;
+
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        const char *p   = buffer;
+        const char *end = buffer + n;
+
+        while ((p = memchr(p, '\n', (size_t)(end - p))) != NULL)
+        {
+            crack_ctx->keyspace_size++;
+            p++;
+        }
+
+        last = buffer[n - 1];
+        total += (size_t)n;
+    }
+
+    close(fd);
+
+    if (n < 0)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (total == 0)
+    {
+        SET_ERROR(err, "Wordlist is empty");
+        return -1;
+    }
+
+    if (last != '\n')
+        crack_ctx->keyspace_size++;
+
+    crack_ctx->wordlist_lines = crack_ctx->keyspace_size;
+
+    char resolved[PATH_MAX];
+    if (realpath(crack_ctx->wordlist, resolved) != NULL)
+    {
+        crack_ctx->wordlist_path = strdup(resolved);
+        if (!crack_ctx->wordlist_path)
+        {
+            SET_ERROR(err, "strdup failed (wordlist_prepare)");
+            return -1;
+        }
+    }
+
+    printf("[SERVER] Wordlist %s: %" PRIu64 " lines\n", crack_ctx->wordlist, crack_ctx->keyspace_size);
+
+    return 0;
+}
+
+// Combines a parsed mask with a prepared wordlist: every line is paired
+// with every mask candidate.
+int hybrid_prepare(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    uint64_t mask_size = crack_ctx->keyspace_size;
+
+    if (crack_ctx->wordlist_lines > UINT64_MAX / mask_size)
+    {
+        SET_ERROR(err, "Wordlist x mask keyspace does not fit in 64 bits");
+        return -1;
+    }
+
+    crack_ctx->keyspace_size = crack_ctx->wordlist_lines * mask_size;
+
+    printf("[SERVER] Hybrid %s, %s-major: keyspace=%" PRIu64 "\n", crack_ctx->hybrid_prepend ? "mask+word" : "word+mask",
+           crack_ctx->hybrid_mask_major ? "mask" : "word", crack_ctx->keyspace_size);
+
+    return 0;
+}
+
+// Workers load the statistics themselves; the server only checks the file
+// is there and, with a threshold, shrinks each mask position's radix to match.
+int markov_prepare(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    char resolved[PATH_MAX];
+
+    if (access(crack_ctx->markov, R_OK) == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (realpath(crack_ctx->markov, resolved) != NULL)
+    {
+        crack_ctx->markov_path = strdup(resolved);
+        if (!crack_ctx->markov_path)
+        {
+            SET_ERROR(err, "strdup failed (markov_prepare)");
+            return -1;
+        }
+    }
+
+    if (crack_ctx->markov_threshold > 0 && crack_ctx->mask_len > 0)
+    {
+        uint64_t size = 1;
+
+        for (size_t i = 0; i < crack_ctx->mask_len; i++)
+        {
+            uint64_t radix = strlen(crack_ctx->mask_positions[i]);
+
+            if (radix > crack_ctx->markov_threshold)
+                radix = crack_ctx->markov_threshold;
+
+            size *= radix;
+        }
+
+        crack_ctx->keyspace_size = size;
+    }
+
+    printf("[SERVER] Markov %s: threshold %" PRIu64 ", keyspace=%" PRIu64 "\n", crack_ctx->markov,
+           crack_ctx->markov_threshold, crack_ctx->keyspace_size);
+
+    return 0;
+}
+
+// Reads one rule per line; blank lines and lines starting with '#' are
+// skipped. Workers compile the rules themselves, so they are kept as text,
+// but each is compiled here first with the same parser: a rule a worker
+// would reject fails the job at startup instead of every worker at load.
+int rules_load(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    FILE    *file;
+    char     line[MAX_RULE_LEN + 2];
+    char     message[MAX_RULE_LEN + PATH_MAX + 128];
+    size_t   cap     = 0;
+    size_t   line_no = 0;
+    rule_set compiled;
+
+    file = fopen(crack_ctx->rules_file, "r");
+    if (!file)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    memset(&compiled, 0, sizeof(compiled));
+
+    while (fgets(line, sizeof(line), file))
+    {
+        size_t           len = strcspn(line, "\r\n");
+        struct fsm_error rule_err;
+
+        line_no++;
+
+        if (line[len] == '\0' && !feof(file))
+        {
+            snprintf(message, sizeof(message), "%s line %zu: rule is longer than 255 characters",
+                     crack_ctx->rules_file, line_no);
+            SET_ERROR(err, message);
+            rule_set_free(&compiled);
+            fclose(file);
+            return -1;
+        }
+
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        fsm_error_init(&rule_err);
+        if (rule_set_add(&compiled, line, &rule_err) == -1)
+        {
+            snprintf(message, sizeof(message), "%s line %zu: %s", crack_ctx->rules_file, line_no,
+                     rule_err.err_msg ? rule_err.err_msg : "invalid rule");
+            SET_ERROR(err, message);
+            fsm_error_clear(&rule_err);
+            rule_set_free(&compiled);
+            fclose(file);
+            return -1;
+        }
+
+        if (crack_ctx->num_rules == cap)
+        {
+            size_t new_cap = cap ? cap * 2 : 64;
+            char **tmp     = realloc(crack_ctx->rules, new_cap * sizeof(*tmp));
+            if (!tmp)
+            {
+                SET_ERROR(err, "realloc failed (rules_load)");
+                rule_set_free(&compiled);
+                fclose(file);
+                return -1;
+            }
+            crack_ctx->rules = tmp;
+            cap              = new_cap;
+        }
+
+        crack_ctx->rules[crack_ctx->num_rules] = strdup(line);
+        if (!crack_ctx->rules[crack_ctx->num_rules])
+        {
+            SET_ERROR(err, "strdup failed (rules_load)");
+            rule_set_free(&compiled);
+            fclose(file);
+            return -1;
+        }
+        crack_ctx->num_rules++;
+    }
+
+    rule_set_free(&compiled);
+    fclose(file);
+
+    if (crack_ctx->num_rules == 0)
+    {
+        SET_ERROR(err, "Rules file has no rules");
+        return -1;
+    }
+
+    if (crack_ctx->wordlist_lines > UINT64_MAX / crack_ctx->num_rules)
+    {
+        SET_ERROR(err, "Wordlist x rules keyspace does not fit in 64 bits");
+        return -1;
+    }
+
+    crack_ctx->keyspace_size = crack_ctx->wordlist_lines * crack_ctx->num_rules;
+
+    printf("[SERVER] Rules %s: %zu rules, keyspace=%" PRIu64 "\n", crack_ctx->rules_file, crack_ctx->num_rules,
+           crack_ctx->keyspace_size);
+
+    return 0;
+}
+
+void rules_free(struct cracking_context *crack_ctx)
+{
+    for (size_t i = 0; i < crack_ctx->num_rules; i++)
+        free(crack_ctx->rules[i]);
+
+    free(crack_ctx->rules);
+    crack_ctx->rules     = NULL;
+    crack_ctx->num_rules = 0;
+}
@@ -1,7 +1,13 @@
 #include "command_line.h"
+#include "event_loop.h"
 #include "fsm.h"
+#include "hash_list.h"
+#include "keyspace.h"
+#include "rainbow.h"
 #include "server_config.h"
 #include "utils.h"
+#include "worker_registry.h"
+#include <fcntl.h>
 #include <pthread.h>
 #include <signal.h>
 
@@ -13,6 +19,7 @@ enum application_states
     STATE_CREATE_SOCKET,
     STATE_BIND_SOCKET,
     STATE_LISTEN,
+    STATE_CREATE_EVENT_LOOP,
     STATE_SETUP_SIGNAL,
     STATE_START_TIMER,
     STATE_START_POLLING,
@@ -28,6 +35,7 @@ static int  convert_address_handler(struct fsm_context *context, struct fsm_erro
 static int  create_socket_handler(struct fsm_context *context, struct fsm_error *err);
 static int  bind_socket_handler(struct fsm_context *context, struct fsm_error *err);
 static int  listen_handler(struct fsm_context *context, struct fsm_error *err);
+static int  create_event_loop_handler(struct fsm_context *context, struct fsm_error *err);
 static int  setup_signal_handler(struct fsm_context *context, struct fsm_error *err);
 static int  start_timer_handler(struct fsm_context *context, struct fsm_error *err);
 static int  start_polling_handler(struct fsm_context *context, struct fsm_error *err);
@@ -41,13 +49,11 @@ int main(int argc, char **argv)
 {
     struct fsm_error err;
     struct arguments args = {
-        .crack_ctx.index       = 0,
-        .crack_ctx.found       = 0,
-        .crack_ctx.queue       = NULL,
-        .crack_ctx.queue_len   = 0,
-        .crack_ctx.total_secs  = 0,
-        .crack_ctx.password[0] = '\0',
-        .client_states         = NULL,
+        .crack_ctx.index      = 0,
+        .crack_ctx.found      = 0,
+        .crack_ctx.queue      = NULL,
+        .crack_ctx.queue_len  = 0,
+        .crack_ctx.total_secs = 0,
     };
     struct fsm_context context = {
         .argc = argc,
@@ -62,24 +68,27 @@ int main(int argc, char **argv)
         {STATE_CONVERT_ADDRESS,  STATE_CREATE_SOCKET,    create_socket_handler   },
         {STATE_CREATE_SOCKET,    STATE_BIND_SOCKET,      bind_socket_handler     },
         {STATE_BIND_SOCKET,      STATE_LISTEN,           listen_handler          },
-        {STATE_LISTEN,           STATE_SETUP_SIGNAL,     setup_signal_handler    },
-        {STATE_SETUP_SIGNAL,     STATE_START_TIMER,      start_timer_handler     },
-        {STATE_START_TIMER,      STATE_START_POLLING,    start_polling_handler   },
-        {STATE_START_POLLING,    STATE_STOP_TIMER,       stop_timer_handler      },
-        {STATE_STOP_TIMER,       STATE_CLEANUP,          cleanup_handler         },
-        {STATE_ERROR,            STATE_CLEANUP,          cleanup_handler         },
-        {STATE_PARSE_ARGUMENTS,  STATE_ERROR,            error_handler           },
-        {STATE_HANDLE_ARGUMENTS, STATE_ERROR,            error_handler           },
-        {STATE_CONVERT_ADDRESS,  STATE_ERROR,            error_handler           },
-        {STATE_CREATE_SOCKET,    STATE_ERROR,            error_handler           },
-        {STATE_BIND_SOCKET,      STATE_ERROR,            error_handler           },
-        {STATE_LISTEN,           STATE_ERROR,            error_handler           },
-        {STATE_START_TIMER,      STATE_ERROR,            error_handler           },
-        {STATE_START_POLLING,    STATE_ERROR,            error_handler           },
-        {STATE_STOP_TIMER,       STATE_ERROR,            error_handler           },
-        {STATE_CLEANUP,          FSM_EXIT,               NULL                    },
+        {STATE_LISTEN,            STATE_CREATE_EVENT_LOOP, create_event_loop_handler},
+        {STATE_CREATE_EVENT_LOOP, STATE_SETUP_SIGNAL,      setup_signal_handler     },
+        {STATE_SETUP_SIGNAL,      STATE_START_TIMER,       start_timer_handler      },
+        {STATE_START_TIMER,       STATE_START_POLLING,     start_polling_handler    },
+        {STATE_START_POLLING,     STATE_STOP_TIMER,        stop_timer_handler       },
+        {STATE_STOP_TIMER,        STATE_CLEANUP,           cleanup_handler          },
+        {STATE_ERROR,             STATE_CLEANUP,           cleanup_handler          },
+        {STATE_PARSE_ARGUMENTS,   STATE_ERROR,             error_handler            },
+        {STATE_HANDLE_ARGUMENTS,  STATE_ERROR,             error_handler            },
+        {STATE_CONVERT_ADDRESS,   STATE_ERROR,             error_handler            },
+        {STATE_CREATE_SOCKET,     STATE_ERROR,             error_handler            },
+        {STATE_BIND_SOCKET,       STATE_ERROR,             error_handler            },
+        {STATE_LISTEN,            STATE_ERROR,             error_handler            },
+        {STATE_CREATE_EVENT_LOOP, STATE_ERROR,             error_handler            },
+        {STATE_START_TIMER,       STATE_ERROR,             error_handler            },
+        {STATE_START_POLLING,     STATE_ERROR,             error_handler            },
+        {STATE_STOP_TIMER,        STATE_ERROR,             error_handler            },
+        {STATE_CLEANUP,           FSM_EXIT,                NULL                     },
     };
 
+    fsm_error_init(&err);
     fsm_run(&context, &err, transitions);
 
     return 0;
@@ -159,6 +168,39 @@ static int listen_handler(struct fsm_context *context, struct fsm_error *err)
         return STATE_ERROR;
     }
 
+    return STATE_CREATE_EVENT_LOOP;
+}
+
+static int create_event_loop_handler(struct fsm_context *context, struct fsm_error *err)
+{
+    struct fsm_context *ctx;
+    int                 flags;
+    ctx = context;
+    SET_TRACE(context, "in create event loop", "STATE_CREATE_EVENT_LOOP");
+
+    ctx->args->loop = malloc(sizeof(*ctx->args->loop));
+    if (!ctx->args->loop)
+    {
+        SET_ERROR(err, "malloc failed (create_event_loop_handler)");
+        return STATE_ERROR;
+    }
+
+    if (event_loop_open(ctx->args->loop, ctx->args->event_loop_str, err) == -1)
+        return STATE_ERROR;
+
+    // Every waiting connection is accepted per report, until accept() would block.
+    flags = fcntl(ctx->args->sockfd, F_GETFL);
+    if (flags == -1 || fcntl(ctx->args->sockfd, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        SET_ERROR(err, strerror(errno));
+        return STATE_ERROR;
+    }
+
+    if (event_loop_add(ctx->args->loop, ctx->args->sockfd, NULL, err) == -1)
+        return STATE_ERROR;
+
+    printf("[SERVER] Waiting on sockets with %s\n", event_loop_name(ctx->args->loop));
+
     return STATE_SETUP_SIGNAL;
 }
 
@@ -178,6 +220,15 @@ static int setup_signal_handler(struct fsm_context *context, struct fsm_error *e
         return STATE_ERROR;
     }
 
+    // A worker that went away shows up as EPIPE from writev instead.
+    sa.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &sa, NULL) == -1)
+    {
+        SET_ERROR(err, "sigaction");
+
+        return STATE_ERROR;
+    }
+
     return STATE_START_TIMER;
 }
 
@@ -188,6 +239,9 @@ static int start_timer_handler(struct fsm_context *context, struct fsm_error *er
     SET_TRACE(context, "in start timer", "STATE_START_TIMER");
     clock_gettime(CLOCK_MONOTONIC, &ctx->args->start_wall);
 
+    ctx->args->crack_ctx.now_ms = monotonic_ms();
+    timer_wheel_init(&ctx->args->timers, ctx->args->crack_ctx.now_ms);
+
     return STATE_START_POLLING;
 }
 
@@ -197,10 +251,9 @@ static int start_polling_handler(struct fsm_context *context, struct fsm_error *
     ctx = context;
     SET_TRACE(context, "in start polling", "STATE_START_POLLING");
 
-    while (exit_flag == 0 && ctx->args->crack_ctx.found == 0)
+    while (exit_flag == 0 && ctx->args->crack_ctx.found == 0 && ctx->args->crack_ctx.exhausted == 0)
     {
-        if (polling(ctx->args->sockfd, &ctx->args->file_descriptors, &ctx->args->max_clients,
-                    &ctx->args->client_sockets, &ctx->args->client_states, &ctx->args->crack_ctx,
+        if (polling(ctx->args->sockfd, ctx->args->loop, &ctx->args->workers, &ctx->args->timers, &ctx->args->crack_ctx,
                     err) != 0)
         {
             return STATE_ERROR;
@@ -221,6 +274,24 @@ static int stop_timer_handler(struct fsm_context *context, struct fsm_error *err
     double wall = (ctx->args->end_wall.tv_sec - ctx->args->start_wall.tv_sec) +
                   (ctx->args->end_wall.tv_nsec - ctx->args->start_wall.tv_nsec) / 1e9;
 
+    const cracking_context *crack_ctx = &ctx->args->crack_ctx;
+
+    if (crack_ctx->rainbow_build)
+    {
+        // An interrupted build leaves no table behind.
+        if (crack_ctx->exhausted && rainbow_write(crack_ctx, err) == -1)
+            return STATE_ERROR;
+    }
+    else if (crack_ctx->exhausted && !crack_ctx->found)
+    {
+        printf("Keyspace exhausted, %zu of %zu hashes not found.\n", crack_ctx->num_hashes - crack_ctx->num_cracked,
+               crack_ctx->num_hashes);
+    }
+
+    for (size_t i = 0; i < crack_ctx->num_cracked; i++)
+        printf("Cracked %s: %s\n", crack_ctx->hashes[crack_ctx->cracked[i]],
+               crack_ctx->passwords[crack_ctx->cracked[i]]);
+
     printf("Total time workers spent: %ld seconds\n", ctx->args->crack_ctx.total_secs);
     printf("Server ran for:           %.2f seconds\n", wall);
 
@@ -241,17 +312,26 @@ static int cleanup_handler(struct fsm_context *context, struct fsm_error *err)
         }
     }
 
-    close_clients(ctx->args->client_sockets, ctx->args->client_states, ctx->args->max_clients, err);
+    worker_registry_free(&ctx->args->workers);
 
     fsm_error_clear(err);
 
-    free(ctx->args->client_sockets);
-    free(ctx->args->client_states);
-    free(ctx->args->file_descriptors);
+    if (ctx->args->loop)
+    {
+        event_loop_close(ctx->args->loop);
+        free(ctx->args->loop);
+    }
 
     if (ctx->args->crack_ctx.queue)
         free(ctx->args->crack_ctx.queue);
 
+    hash_list_free(&ctx->args->crack_ctx);
+    mask_free(&ctx->args->crack_ctx);
+    rules_free(&ctx->args->crack_ctx);
+    free(ctx->args->crack_ctx.wordlist_path);
+    free(ctx->args->crack_ctx.markov_path);
+    rainbow_free(&ctx->args->crack_ctx);
+
     return FSM_EXIT;
 }
 
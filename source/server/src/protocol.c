@@ -0,0 +1,322 @@
+#include "protocol.h"
+#include "fsm.h"
+#include <inttypes.h>
+
+typedef struct message_spec
+{
+    const char *keyword; // in text mode
+    size_t      min_values;
+    size_t      max_values;
+    bool        has_text;
+} message_spec;
+
+static const message_spec specs[MSG_TYPE_COUNT] = {
+    [MSG_HELLO]          = {"HELLO", 2, 2, false},
+    [MSG_GROUP]          = {"GROUP", 1, 1, false},
+    [MSG_HASH]           = {"HASH", 0, 0, true},
+    [MSG_HYBRID]         = {"HYBRID", 2, 2, false},
+    [MSG_POS]            = {"POS", 0, 0, true},
+    [MSG_WORDLIST]       = {"WORDLIST", 1, 1, true},
+    [MSG_RULE]           = {"RULE", 0, 0, true},
+    [MSG_MARKOV]         = {"MARKOV", 1, 1, true},
+    [MSG_RAINBOW_BUILD]  = {"RAINBOW build", 1, 1, true},
+    [MSG_RAINBOW_LOOKUP] = {"RAINBOW lookup", 1, 1, true},
+    [MSG_END]            = {"END", 0, 0, false},
+    [MSG_READY]          = {"READY", 0, 0, false},
+    [MSG_WORK]           = {"WORK", 4, 4, false},
+    [MSG_CRACKED]        = {"CRACKED", 0, 0, true},
+    [MSG_STOP]           = {"STOP", 0, 0, false},
+    [MSG_CHECKPOINT]     = {"CHECKPOINT", 1, 1, false},
+    [MSG_FOUND]          = {"FOUND", 1, 1, true},
+    [MSG_CHAIN]          = {"CHAIN", 2, PROTOCOL_MAX_VALUES, false},
+    [MSG_DONE]           = {"DONE", 0, 0, false},
+    [MSG_NEXT]           = {"NEXT", 0, 0, false},
+};
+
+static const message_spec *spec_of(message_type type);
+static ssize_t             encode_text(const protocol_message *msg, char *buf, size_t cap);
+static ssize_t             encode_binary(const protocol_message *msg, char *buf, size_t cap);
+static int                 decode_text(const char *line, size_t len, protocol_message *msg);
+static int                 decode_binary(const char *data, size_t len, protocol_message *msg);
+static const char         *parse_value(const char *p, uint64_t *value);
+static bool                valid_message(const protocol_message *msg);
+
+static const message_spec *spec_of(message_type type)
+{
+    if ((int)type <= 0 || (int)type >= MSG_TYPE_COUNT)
+        return NULL;
+
+    return &specs[type];
+}
+
+const char *protocol_message_name(message_type type)
+{
+    const message_spec *spec = spec_of(type);
+
+    return spec ? spec->keyword : "unknown";
+}
+
+ssize_t protocol_encode(protocol_mode mode, const protocol_message *msg, char *buf, size_t cap)
+{
+    if (!valid_message(msg))
+        return -1;
+
+    return (mode == PROTOCOL_BINARY) ? encode_binary(msg, buf, cap) : encode_text(msg, buf, cap);
+}
+
+int protocol_decode(protocol_mode mode, const char *data, size_t len, protocol_message *msg, struct fsm_error *err)
+{
+    memset(msg, 0, sizeof(*msg));
+
+    if (((mode == PROTOCOL_BINARY) ? decode_binary(data, len, msg) : decode_text(data, len, msg)) == -1 ||
+        !valid_message(msg))
+    {
+        char message[256];
+
+        if (mode == PROTOCOL_BINARY)
+            snprintf(message, sizeof(message), "Malformed %s frame (%zu bytes)",
+                     protocol_message_name(len > 2 ? (message_type)(unsigned char)data[2] : 0), len);
+        else
+            snprintf(message, sizeof(message), "Malformed message: %.200s", data);
+        SET_ERROR(err, message);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+// The text of a FOUND is the hash, a space and the password, values[0]
+// the length of the hash, so the two need no copying apart.
+static bool valid_message(const protocol_message *msg)
+{
+    const message_spec *spec = spec_of(msg->type);
+
+    if (!spec || msg->num_values < spec->min_values || msg->num_values > spec->max_values)
+        return false;
+
+    if (!spec->has_text && msg->text_len > 0)
+        return false;
+
+    if (msg->type == MSG_FOUND && (msg->values[0] == 0 || msg->values[0] >= msg->text_len ||
+                                   msg->text[msg->values[0]] != ' '))
+        return false;
+
+    return true;
+}
+
+static ssize_t encode_binary(const protocol_message *msg, char *buf, size_t cap)
+{
+    size_t         payload = msg->num_values * sizeof(uint64_t) + msg->text_len;
+    unsigned char *out     = (unsigned char *)buf;
+
+    if (payload > UINT16_MAX || PROTOCOL_FRAME_HEADER + payload > cap)
+        return -1;
+
+    out[0] = (unsigned char)(payload >> 8);
+    out[1] = (unsigned char)payload;
+    out[2] = (unsigned char)msg->type;
+    out[3] = 0;
+    out += PROTOCOL_FRAME_HEADER;
+
+    for (size_t i = 0; i < msg->num_values; i++)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+            *out++ = (unsigned char)(msg->values[i] >> shift);
+    }
+
+    if (msg->text_len > 0)
+        memcpy(out, msg->text, msg->text_len);
+
+    return (ssize_t)(PROTOCOL_FRAME_HEADER + payload);
+}
+
+static int decode_binary(const char *data, size_t len, protocol_message *msg)
+{
+    const unsigned char *in = (const unsigned char *)data;
+    const message_spec  *spec;
+    size_t               payload;
+    size_t               num_values;
+
+    if (len < PROTOCOL_FRAME_HEADER || protocol_frame_length(in) != len || in[3] != 0)
+        return -1;
+
+    spec = spec_of((message_type)in[2]);
+    if (!spec)
+        return -1;
+
+    payload = len - PROTOCOL_FRAME_HEADER;
+
+    // Messages with a string have a fixed count of numbers ahead of it;
+    // the others are all numbers.
+    if (spec->has_text)
+        num_values = spec->max_values;
+    else if (payload % sizeof(uint64_t) == 0)
+        num_values = payload / sizeof(uint64_t);
+    else
+        return -1;
+
+    if (num_values > PROTOCOL_MAX_VALUES || num_values * sizeof(uint64_t) > payload)
+        return -1;
+
+    msg->type       = (message_type)in[2];
+    msg->num_values = num_values;
+    in += PROTOCOL_FRAME_HEADER;
+
+    for (size_t i = 0; i < num_values; i++)
+    {
+        uint64_t value = 0;
+
+        for (size_t b = 0; b < sizeof(uint64_t); b++)
+            value = (value << 8) | *in++;
+
+        msg->values[i] = value;
+    }
+
+    msg->text     = (const char *)in;
+    msg->text_len = payload - num_values * sizeof(uint64_t);
+
+    return 0;
+}
+
+// HYBRID, RAINBOW build and FOUND keep the shape they had before there
+// was a binary mode; everything else is the keyword, the numbers, then
+// the string.
+static ssize_t encode_text(const protocol_message *msg, char *buf, size_t cap)
+{
+    const message_spec *spec = &specs[msg->type]; // valid_message() checked the type
+    int                 len;
+
+    if (msg->text_len > 0 && memchr(msg->text, '\n', msg->text_len))
+        return -1;
+
+    if (msg->type == MSG_HYBRID)
+        len = snprintf(buf, cap, "HYBRID %s %s", msg->values[0] ? "prepend" : "append",
+                       msg->values[1] ? "mask" : "word");
+    else if (msg->type == MSG_RAINBOW_BUILD)
+        len = snprintf(buf, cap, "RAINBOW build %.*s %" PRIu64, (int)msg->text_len, msg->text, msg->values[0]);
+    else
+        len = snprintf(buf, cap, "%s", spec->keyword);
+
+    if (msg->type != MSG_HYBRID && msg->type != MSG_RAINBOW_BUILD)
+    {
+        for (size_t i = 0; i < msg->num_values && msg->type != MSG_FOUND && len >= 0 && (size_t)len < cap; i++)
+            len += snprintf(buf + len, cap - (size_t)len, " %" PRIu64, msg->values[i]);
+
+        if (spec->has_text && len >= 0 && (size_t)len < cap)
+            len += snprintf(buf + len, cap - (size_t)len, " %.*s", (int)msg->text_len, msg->text);
+    }
+
+    if (len < 0 || (size_t)len + 1 >= cap)
+        return -1;
+
+    buf[len++] = '\n';
+
+    return len;
+}
+
+static const char *parse_value(const char *p, uint64_t *value)
+{
+    uint64_t v = 0;
+
+    if (*p < '0' || *p > '9')
+        return NULL;
+
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        unsigned digit = (unsigned)(*p - '0');
+
+        if (v > (UINT64_MAX - digit) / 10)
+            return NULL;
+        v = v * 10 + digit;
+    }
+
+    *value = v;
+
+    return p;
+}
+
+static int decode_text(const char *line, size_t len, protocol_message *msg)
+{
+    const message_spec *spec = NULL;
+    const char         *p    = NULL;
+    const char         *end  = line + len;
+
+    for (int type = 1; type < MSG_TYPE_COUNT; type++)
+    {
+        size_t klen = strlen(specs[type].keyword);
+
+        if (klen <= len && memcmp(line, specs[type].keyword, klen) == 0 && (line[klen] == ' ' || line[klen] == '\0'))
+        {
+            spec      = &specs[type];
+            msg->type = (message_type)type;
+            p         = line + klen;
+            break;
+        }
+    }
+
+    if (!spec)
+        return -1;
+
+    msg->text = end; // empty unless there is one
+
+    if (msg->type == MSG_HYBRID)
+    {
+        if (strcmp(p, " prepend mask") != 0 && strcmp(p, " prepend word") != 0 && strcmp(p, " append mask") != 0 &&
+            strcmp(p, " append word") != 0)
+            return -1;
+
+        msg->values[0]  = strncmp(p, " prepend", 8) == 0;
+        msg->values[1]  = strstr(p, " mask") != NULL;
+        msg->num_values = 2;
+
+        return 0;
+    }
+
+    if (msg->type == MSG_RAINBOW_BUILD)
+    {
+        const char *space;
+
+        if (*p != ' ' || (space = memchr(p + 1, ' ', (size_t)(end - p - 1))) == NULL ||
+            (p = parse_value(space + 1, &msg->values[0])) != end)
+            return -1;
+
+        msg->text       = line + strlen(spec->keyword) + 1;
+        msg->text_len   = (size_t)(space - msg->text);
+        msg->num_values = 1;
+
+        return 0;
+    }
+
+    if (msg->type == MSG_FOUND)
+    {
+        const char *space;
+
+        if (*p != ' ' || (space = memchr(p + 1, ' ', (size_t)(end - p - 1))) == NULL)
+            return -1;
+
+        msg->text       = p + 1;
+        msg->text_len   = (size_t)(end - msg->text);
+        msg->values[0]  = (uint64_t)(space - msg->text);
+        msg->num_values = 1;
+
+        return 0;
+    }
+
+    while (msg->num_values < spec->max_values && *p == ' ')
+    {
+        p = parse_value(p + 1, &msg->values[msg->num_values]);
+        if (!p)
+            return -1;
+        msg->num_values++;
+    }
+
+    if (spec->has_text && *p == ' ')
+    {
+        msg->text     = p + 1;
+        msg->text_len = (size_t)(end - msg->text);
+        p             = end;
+    }
+
+    return (p == end) ? 0 : -1;
+}
@@ -0,0 +1,300 @@
+#include "rainbow.h"
+#include "keyspace.h"
+#include "utils.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+
+typedef struct rainbow_entry
+{
+    uint64_t end;
+    uint64_t start;
+} rainbow_entry;
+
+static const char *const rainbow_schemes[] = {"md5", "sha1", "sha256", "ntlm"};
+
+static bool known_scheme(const char *name);
+static int  compare_entries(const void *a, const void *b);
+static int  header_value(FILE *file, const char *key, uint64_t *value, struct fsm_error *err);
+
+static bool known_scheme(const char *name)
+{
+    for (size_t i = 0; i < sizeof(rainbow_schemes) / sizeof(rainbow_schemes[0]); i++)
+    {
+        if (strcmp(name, rainbow_schemes[i]) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    const rainbow_entry *x = a;
+    const rainbow_entry *y = b;
+
+    if (x->end != y->end)
+        return (x->end < y->end) ? -1 : 1;
+    if (x->start != y->start)
+        return (x->start < y->start) ? -1 : 1;
+
+    return 0;
+}
+
+// Reads one "<key> <number>" header line.
+static int header_value(FILE *file, const char *key, uint64_t *value, struct fsm_error *err)
+{
+    char   line[64];
+    size_t key_len = strlen(key);
+    char   message[64];
+
+    if (fgets(line, sizeof(line), file) && strncmp(line, key, key_len) == 0 && line[key_len] == ' ')
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (string_to_uint64(line + key_len + 1, value, NULL) == 0)
+            return 0;
+    }
+
+    snprintf(message, sizeof(message), "Rainbow table has no valid %s line", key);
+    SET_ERROR(err, message);
+
+    return -1;
+}
+
+// Chain i starts at mask index i, so there can be no more chains than the
+// mask has candidates. The default aims at every candidate being covered
+// about twice before chains merge.
+int rainbow_build_prepare(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    uint64_t space = crack_ctx->keyspace_size;
+
+    if (crack_ctx->rainbow_scheme == NULL)
+        crack_ctx->rainbow_scheme = "md5";
+
+    if (!known_scheme(crack_ctx->rainbow_scheme))
+    {
+        SET_ERROR(err, "Rainbow scheme must be md5, sha1, sha256 or ntlm");
+        return -1;
+    }
+
+    if (crack_ctx->chain_len_str == NULL)
+        crack_ctx->chain_len = RAINBOW_DEFAULT_CHAIN_LEN;
+    else if (string_to_uint64(crack_ctx->chain_len_str, &crack_ctx->chain_len, err) != 0)
+        return -1;
+
+    if (crack_ctx->chain_len == 0)
+    {
+        SET_ERROR(err, "Chain length must be at least 1");
+        return -1;
+    }
+
+    if (crack_ctx->chains_str == NULL)
+    {
+        crack_ctx->num_chains = space / crack_ctx->chain_len;
+        crack_ctx->num_chains = (crack_ctx->num_chains > space / 2) ? space : crack_ctx->num_chains * 2;
+        if (crack_ctx->num_chains == 0)
+            crack_ctx->num_chains = 1;
+    }
+    else if (string_to_uint64(crack_ctx->chains_str, &crack_ctx->num_chains, err) != 0)
+    {
+        return -1;
+    }
+
+    if (crack_ctx->num_chains == 0 || crack_ctx->num_chains > space)
+    {
+        SET_ERROR(err, "Number of chains must be between 1 and the mask's keyspace");
+        return -1;
+    }
+
+    if (crack_ctx->num_chains > SIZE_MAX / sizeof(*crack_ctx->chain_ends))
+    {
+        SET_ERROR(err, "Too many chains to hold in memory");
+        return -1;
+    }
+
+    crack_ctx->chain_ends = malloc(crack_ctx->num_chains * sizeof(*crack_ctx->chain_ends));
+    if (!crack_ctx->chain_ends)
+    {
+        SET_ERROR(err, "malloc failed (rainbow_build_prepare)");
+        return -1;
+    }
+
+    memset(crack_ctx->chain_ends, 0xff, crack_ctx->num_chains * sizeof(*crack_ctx->chain_ends));
+
+    crack_ctx->chain_space   = space;
+    crack_ctx->keyspace_size = crack_ctx->num_chains;
+
+    printf("[SERVER] Rainbow build %s: %s, %" PRIu64 " chains of length %" PRIu64 " over %" PRIu64
+           " candidates\n",
+           crack_ctx->rainbow_build, crack_ctx->rainbow_scheme, crack_ctx->num_chains, crack_ctx->chain_len, space);
+
+    return 0;
+}
+
+// Workers read the positions from the table themselves; the server only
+// needs the chain length to hand out columns, and the chain count so a
+// worker can tell its copy is the same table.
+int rainbow_lookup_prepare(struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    char   line[MAX_POSITION_CHARSET + 8];
+    char   scheme[16];
+    char   resolved[PATH_MAX];
+    size_t positions = 0;
+    FILE  *file;
+
+    file = fopen(crack_ctx->rainbow, "r");
+    if (!file)
+    {
+        SET_ERROR(err, strerror(errno));
+        return -1;
+    }
+
+    if (!fgets(line, sizeof(line), file) || strcmp(line, RAINBOW_MAGIC "\n") != 0)
+    {
+        SET_ERROR(err, "Not a rainbow table");
+        fclose(file);
+        return -1;
+    }
+
+    if (!fgets(line, sizeof(line), file) || sscanf(line, "SCHEME %15s", scheme) != 1 || !known_scheme(scheme))
+    {
+        SET_ERROR(err, "Rainbow table has no valid SCHEME line");
+        fclose(file);
+        return -1;
+    }
+
+    if (header_value(file, "CHAIN_LEN", &crack_ctx->chain_len, err) == -1 ||
+        header_value(file, "CHAINS", &crack_ctx->num_chains, err) == -1)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) && strncmp(line, "POS ", 4) == 0)
+        positions++;
+
+    fclose(file);
+
+    if (strcmp(line, "END\n") != 0 || positions == 0 || crack_ctx->chain_len == 0)
+    {
+        SET_ERROR(err, "Rainbow table header is malformed");
+        return -1;
+    }
+
+    if (realpath(crack_ctx->rainbow, resolved) != NULL)
+    {
+        crack_ctx->rainbow_path = strdup(resolved);
+        if (!crack_ctx->rainbow_path)
+        {
+            SET_ERROR(err, "strdup failed (rainbow_lookup_prepare)");
+            return -1;
+        }
+    }
+
+    crack_ctx->keyspace_size = crack_ctx->chain_len;
+
+    printf("[SERVER] Rainbow table %s: %s, %" PRIu64 " chains of length %" PRIu64 " over %zu positions\n",
+           crack_ctx->rainbow, scheme, crack_ctx->num_chains, crack_ctx->chain_len, positions);
+
+    return 0;
+}
+
+int rainbow_record(struct cracking_context *crack_ctx, const uint64_t *values, size_t num_values)
+{
+    uint64_t chain = values[0];
+
+    if (!crack_ctx->chain_ends || num_values < 2)
+        return -1;
+
+    for (size_t i = 1; i < num_values; i++)
+    {
+        if (chain >= crack_ctx->num_chains || values[i] >= crack_ctx->chain_space)
+            return -1;
+
+        crack_ctx->chain_ends[chain++] = values[i];
+    }
+
+    return 0;
+}
+
+int rainbow_write(const struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    rainbow_entry *entries = malloc(crack_ctx->num_chains * sizeof(*entries));
+    size_t         count   = 0;
+    FILE          *file;
+    long           header;
+    bool           failed;
+
+    if (!entries)
+    {
+        SET_ERROR(err, "malloc failed (rainbow_write)");
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < crack_ctx->num_chains; i++)
+    {
+        if (crack_ctx->chain_ends[i] == UINT64_MAX)
+        {
+            SET_ERROR(err, "Rainbow build finished with chains missing");
+            free(entries);
+            return -1;
+        }
+
+        entries[i].end   = crack_ctx->chain_ends[i];
+        entries[i].start = i;
+    }
+
+    qsort(entries, crack_ctx->num_chains, sizeof(*entries), compare_entries);
+
+    // Chains that reach the same end cover the same candidates from there
+    // on; keeping only the first start saves the space without losing much.
+    for (uint64_t i = 0; i < crack_ctx->num_chains; i++)
+    {
+        if (count == 0 || entries[i].end != entries[count - 1].end)
+            entries[count++] = entries[i];
+    }
+
+    file = fopen(crack_ctx->rainbow_build, "wb");
+    if (!file)
+    {
+        SET_ERROR(err, strerror(errno));
+        free(entries);
+        return -1;
+    }
+
+    fprintf(file, RAINBOW_MAGIC "\nSCHEME %s\nCHAIN_LEN %" PRIu64 "\nCHAINS %zu\n", crack_ctx->rainbow_scheme,
+            crack_ctx->chain_len, count);
+    for (size_t i = 0; i < crack_ctx->mask_len; i++)
+        fprintf(file, "POS %s\n", crack_ctx->mask_positions[i]);
+    fputs("END\n", file);
+
+    header = ftell(file);
+    while (header >= 0 && header % RAINBOW_ALIGN != 0)
+    {
+        fputc('\0', file);
+        header++;
+    }
+
+    failed = header < 0 || fwrite(entries, sizeof(*entries), count, file) != count;
+    failed |= fclose(file) != 0;
+    free(entries);
+
+    if (failed)
+    {
+        SET_ERROR(err, "Failed to write the rainbow table");
+        return -1;
+    }
+
+    printf("[SERVER] Rainbow table %s: %zu chains written, %" PRIu64 " merged into others\n",
+           crack_ctx->rainbow_build, count, crack_ctx->num_chains - count);
+
+    return 0;
+}
+
+void rainbow_free(struct cracking_context *crack_ctx)
+{
+    free(crack_ctx->chain_ends);
+    free(crack_ctx->rainbow_path);
+    crack_ctx->chain_ends   = NULL;
+    crack_ctx->rainbow_path = NULL;
+}
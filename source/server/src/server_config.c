@@ -1,12 +1,40 @@
 #include "server_config.h"
 #include "fsm.h"
+#include "hash_list.h"
+#include "keyspace.h"
+#include "protocol.h"
+#include "rainbow.h"
 #include "utils.h"
+#include "worker_registry.h"
+#include <fcntl.h>
 #include <stdio.h>
 #include <time.h>
 
 void push_work_back_into_queue(struct cracking_context *crack_ctx, uint64_t start, uint64_t remaining);
 bool pop_next_work_chunk(struct cracking_context *ctx, uint64_t *out_start, uint64_t *out_len);
 int  send_hash_to_worker(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err);
+int  send_cracked(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err);
+int  record_found(worker_state *ws, struct cracking_context *crack_ctx, const protocol_message *msg);
+int  greet_worker(worker_state *ws, struct cracking_context *crack_ctx, const protocol_message *msg,
+                  struct fsm_error *err);
+void accept_clients(int sockfd, event_loop *loop, worker_registry *workers, timer_wheel *timers,
+                    struct cracking_context *crack_ctx, struct fsm_error *err);
+void touch_worker(worker_state *ws, timer_wheel *timers, const struct cracking_context *crack_ctx);
+int  queue_to_worker(worker_state *ws, const char *data, size_t len, struct fsm_error *err);
+int  queue_message(worker_state *ws, message_type type, const uint64_t *values, size_t num_values, const char *text,
+                   struct fsm_error *err);
+int  flush_worker(worker_state *ws, event_loop *loop, struct fsm_error *err);
+void copy_out(const struct iovec iov[2], int n, char *dst, size_t len);
+int  handle_messages(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err);
+void reclaim_leases(worker_state *ws, struct cracking_context *crack_ctx);
+void wake_parked_workers(event_loop *loop, worker_registry *workers, timer_wheel *timers,
+                         struct cracking_context *crack_ctx);
+void stop_parked_workers(event_loop *loop, worker_registry *workers);
+
+static inline time_t now_secs(const struct cracking_context *crack_ctx)
+{
+    return (time_t)(crack_ctx->now_ms / 1000);
+}
 
 int socket_create(int domain, int type, int protocol, struct fsm_error *err)
 {
@@ -48,7 +76,8 @@ int socket_accept_connection(int sockfd, struct fsm_error *err)
 
     if (client_fd == -1)
     {
-        if (errno != EINTR)
+        // The listener is non-blocking, so EAGAIN just means nobody else is waiting.
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
         {
             perror("Error in connecting to client.");
         }
@@ -60,7 +89,7 @@ int socket_accept_connection(int sockfd, struct fsm_error *err)
     return client_fd;
 }
 
-int handle_new_client(int sockfd, int **client_sockets, nfds_t *max_clients, struct fsm_error *err)
+int handle_new_client(int sockfd, struct fsm_error *err)
 {
     int client_sockfd;
 
@@ -68,36 +97,21 @@ int handle_new_client(int sockfd, int **client_sockets, nfds_t *max_clients, str
     if (client_sockfd == -1)
         return -1;
 
-    (*max_clients)++;
-    int *tmp = realloc(*client_sockets, sizeof(int) * (*max_clients));
-    if (!tmp)
+    // Output that does not fit waits in the worker's ring, so no single
+    // worker can hold up the rest.
+    int flags = fcntl(client_sockfd, F_GETFL);
+    if (flags == -1 || fcntl(client_sockfd, F_SETFL, flags | O_NONBLOCK) == -1)
     {
-        perror("Realloc error");
-        (*max_clients)--;
-        socket_close(client_sockfd, err);
+        SET_ERROR(err, strerror(errno));
+        socket_close(client_sockfd, NULL);
         return -1;
     }
 
-    *client_sockets                       = tmp;
-    (*client_sockets)[(*max_clients) - 1] = client_sockfd;
-
     printf("Connected to client: %d\n\n", client_sockfd);
 
     return client_sockfd;
 }
 
-void close_clients(int *client_sockets, worker_state **client_states, nfds_t max_clients, struct fsm_error *err)
-{
-    for (size_t i = 0; i < max_clients; i++)
-    {
-        if (client_sockets[i] > 0)
-            socket_close(client_sockets[i], err);
-
-        if (client_states[i])
-            free(client_states[i]);
-    }
-}
-
 int socket_close(int sockfd, struct fsm_error *err)
 {
     if (close(sockfd) == -1)
@@ -111,129 +125,293 @@ int socket_close(int sockfd, struct fsm_error *err)
 
 int send_hash_to_worker(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err)
 {
-    char buffer[512];
+    // Job header: a HASH per hash still standing, with a GROUP ahead of each
+    // run of hashes that share a salt if the worker checks them together, a
+    // HYBRID when a mask is combined with a wordlist, one POS per mask
+    // position, a WORDLIST followed by its RULEs, a MARKOV, a RAINBOW build
+    // or lookup, then END.
+    const char *wordlist = crack_ctx->wordlist_path ? crack_ctx->wordlist_path : crack_ctx->wordlist;
+    const char *markov   = crack_ctx->markov_path ? crack_ctx->markov_path : crack_ctx->markov;
+    const char *rainbow  = crack_ctx->rainbow_path ? crack_ctx->rainbow_path : crack_ctx->rainbow;
+
+    for (size_t i = 0, end; i < crack_ctx->num_hashes; i = end)
+    {
+        uint64_t standing = 0;
+
+        for (end = i; end < crack_ctx->num_hashes && hash_list_same_group(crack_ctx->hashes[i], crack_ctx->hashes[end]);
+             end++)
+        {
+            if (!crack_ctx->passwords[end])
+                standing++;
+        }
 
-    int n = snprintf(buffer, sizeof(buffer), "HASH %s\n", crack_ctx->hash);
+        if (standing > 1 && (ws->io->caps & PROTOCOL_CAP_GROUPS) &&
+            queue_message(ws, MSG_GROUP, &standing, 1, NULL, err) == -1)
+            return -1;
+
+        for (size_t j = i; j < end; j++)
+        {
+            if (!crack_ctx->passwords[j] && queue_message(ws, MSG_HASH, NULL, 0, crack_ctx->hashes[j], err) == -1)
+                return -1;
+        }
+    }
 
-    if (n <= 0)
+    if (wordlist && crack_ctx->mask_len > 0)
     {
-        SET_ERROR(err, "Failed to format HASH message");
-        return -1;
+        uint64_t hybrid[] = {(uint64_t)crack_ctx->hybrid_prepend, (uint64_t)crack_ctx->hybrid_mask_major};
+
+        if (queue_message(ws, MSG_HYBRID, hybrid, 2, NULL, err) == -1)
+            return -1;
     }
 
-    if (send(ws->sockfd, buffer, n, 0) < 0)
+    for (size_t i = 0; i < crack_ctx->mask_len; i++)
     {
-        SET_ERROR(err, "Failed to send HASH to worker");
+        if (queue_message(ws, MSG_POS, NULL, 0, crack_ctx->mask_positions[i], err) == -1)
+            return -1;
+    }
+
+    if (wordlist && queue_message(ws, MSG_WORDLIST, &crack_ctx->wordlist_lines, 1, wordlist, err) == -1)
         return -1;
+
+    for (size_t i = 0; i < crack_ctx->num_rules; i++)
+    {
+        if (queue_message(ws, MSG_RULE, NULL, 0, crack_ctx->rules[i], err) == -1)
+            return -1;
     }
 
-    printf("[SERVER] Sent HASH to worker(fd=%d)\n", ws->sockfd);
+    if (markov && queue_message(ws, MSG_MARKOV, &crack_ctx->markov_threshold, 1, markov, err) == -1)
+        return -1;
+
+    if (crack_ctx->rainbow_build &&
+        queue_message(ws, MSG_RAINBOW_BUILD, &crack_ctx->chain_len, 1, crack_ctx->rainbow_scheme, err) == -1)
+        return -1;
+
+    if (rainbow && queue_message(ws, MSG_RAINBOW_LOOKUP, &crack_ctx->num_chains, 1, rainbow, err) == -1)
+        return -1;
+
+    if (queue_message(ws, MSG_END, NULL, 0, NULL, err) == -1)
+        return -1;
+
+    // Everything cracked so far was left out above.
+    ws->cracked_sent = crack_ctx->num_cracked;
+
+    if (crack_ctx->rainbow_build)
+        printf("[SERVER] Sent rainbow build job to worker(fd=%d)\n", ws->sockfd);
+    else
+        printf("[SERVER] Sent %zu hashes to worker(fd=%d)\n", crack_ctx->num_hashes - crack_ctx->num_cracked,
+               ws->sockfd);
 
     return 0;
 }
 
-int polling(int sockfd, struct pollfd **file_descriptors, nfds_t *max_clients, int **client_sockets,
-            worker_state ***client_states, struct cracking_context *crack_ctx, struct fsm_error *err)
+// Tells the worker which hashes other workers cracked since it last heard,
+// ahead of its next WORK, so it stops spending time on them.
+int send_cracked(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err)
 {
-    int            num_ready;
-    struct pollfd *temp_fds;
-
-    temp_fds = (struct pollfd *)realloc((*file_descriptors), (*max_clients + 2) * sizeof(struct pollfd));
-    if (!temp_fds)
+    for (; ws->cracked_sent < crack_ctx->num_cracked; ws->cracked_sent++)
     {
-        SET_ERROR(err, "Error reallocing for fd's in polling");
-        return -1;
+        const char *hash = crack_ctx->hashes[crack_ctx->cracked[ws->cracked_sent]];
+
+        if (queue_message(ws, MSG_CRACKED, NULL, 0, hash, err) == -1)
+            return -1;
     }
 
-    (*file_descriptors) = temp_fds;
+    return 0;
+}
+
+// FOUND: the hash, a space, then the password. Returns 1 once every hash
+// is cracked, 0 otherwise, and -1 for a hash that is not part of the job.
+int record_found(worker_state *ws, struct cracking_context *crack_ctx, const protocol_message *msg)
+{
+    size_t      len      = (size_t)msg->values[0];
+    const char *password = msg->text + len + 1;
+    size_t      pw_len   = msg->text_len - len - 1;
+    char        hash[MAX_HASH_LEN + 1];
+    size_t      index;
+
+    if (len > MAX_HASH_LEN)
+        return -1;
+
+    memcpy(hash, msg->text, len);
+    hash[len] = '\0';
+
+    if (!hash_list_find(crack_ctx, hash, &index))
+        return -1;
+
+    // Workers that had not heard yet may crack the same hash again.
+    if (crack_ctx->passwords[index])
+        return 0;
+
+    crack_ctx->passwords[index] = strndup(password, pw_len);
+    if (!crack_ctx->passwords[index])
+        return -1;
 
-    (*file_descriptors)[0].fd      = sockfd;
-    (*file_descriptors)[0].events  = POLLIN;
-    (*file_descriptors)[0].revents = 0;
+    crack_ctx->cracked[crack_ctx->num_cracked++] = index;
 
-    for (uint32_t i = 0; i < *max_clients; i++)
+    time_t now        = now_secs(crack_ctx);
+    time_t started_at = (ws->num_leases > 0) ? ws->leases[0].started_at : ws->last_heard;
+
+    printf("[SERVER] WORKER %d FOUND PASSWORD: %s for %s in %ld seconds (%zu of %zu cracked).\n", ws->sockfd,
+           crack_ctx->passwords[index], hash, now - started_at, crack_ctx->num_cracked, crack_ctx->num_hashes);
+
+    if (crack_ctx->num_cracked < crack_ctx->num_hashes)
+        return 0;
+
+    crack_ctx->found = 1;
+
+    return 1;
+}
+
+// Accepts every connection already waiting on the non-blocking listener,
+// since the event loop only reports it again once another one arrives.
+void accept_clients(int sockfd, event_loop *loop, worker_registry *workers, timer_wheel *timers,
+                    struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    int newfd;
+
+    while ((newfd = handle_new_client(sockfd, err)) >= 0)
     {
-        int tempfd;
+        worker_state *ws = worker_registry_add(workers, newfd, err);
 
-        tempfd = (*client_sockets)[i];
+        if (!ws)
+        {
+            printf("[SERVER] No room for worker(fd=%d): %s\n", newfd, err ? err->err_msg : "");
+            socket_close(newfd, err);
+            continue;
+        }
 
-        (*file_descriptors)[i + 1].fd      = tempfd;
-        (*file_descriptors)[i + 1].events  = POLLIN;
-        (*file_descriptors)[i + 1].revents = 0;
-        (*client_states)[i]->sockfd        = tempfd;
+        // A worker parsing a long hash list or loading a wordlist may take
+        // a while to answer READY, so the job's timeout applies from the start.
+        ws->timeout_seconds = crack_ctx->timeout;
+        ws->timer.data       = ws;
+        ws->lease_timer.data = ws;
+        touch_worker(ws, timers, crack_ctx);
+
+        // The job goes out once the worker's HELLO says how to write it.
+        if (event_loop_add(loop, newfd, ws, err) == -1)
+        {
+            printf("[SERVER] Could not watch worker(fd=%d): %s\n", newfd, err ? err->err_msg : "");
+            handle_client_disconnect(ws, loop, workers, timers);
+        }
     }
+}
 
-    num_ready = poll((*file_descriptors), *max_clients + 1, 1000);
+// Hearing from a worker pushes its deadline back, and its lease's when
+// the lease moved. A parked worker owes the server nothing, so it has no
+// deadline until it is given work.
+void touch_worker(worker_state *ws, timer_wheel *timers, const struct cracking_context *crack_ctx)
+{
+    uint64_t deadline = crack_ctx->now_ms + (uint64_t)ws->timeout_seconds * 1000;
 
-    if (num_ready < 0)
-    {
-        if (errno == EINTR)
-            return 0;
+    ws->last_heard = now_secs(crack_ctx);
 
-        SET_ERROR(err, "Polling error");
-        return -1;
+    if (ws->parked)
+    {
+        timer_wheel_cancel(timers, &ws->timer);
+        timer_wheel_cancel(timers, &ws->lease_timer);
+        return;
     }
 
-    if ((*file_descriptors)[0].revents & POLLIN)
+    timer_wheel_schedule(timers, &ws->timer, deadline);
+
+    if (ws->lease_moved)
     {
-        int newfd;
+        if (ws->num_leases > 0)
+            timer_wheel_schedule(timers, &ws->lease_timer, deadline);
+        else
+            timer_wheel_cancel(timers, &ws->lease_timer);
 
-        newfd = handle_new_client(sockfd, &*client_sockets, &*max_clients, err);
+        ws->lease_moved = false;
+    }
+}
+
+// Only the sockets the event loop reports ready are looked at; the
+// listener is registered with no worker behind it. The wait lasts until
+// the next worker deadline, capped so a SIGINT that lands just before it
+// is still noticed.
+int polling(int sockfd, event_loop *loop, worker_registry *workers, timer_wheel *timers,
+            struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    void        *ready[EVENT_LOOP_MAX_EVENTS];
+    int          num_ready;
+    int64_t      wait_ms = timer_wheel_next_timeout(timers, crack_ctx->now_ms);
+    timer_entry *expired;
 
-        if (newfd >= 0)
+    if (wait_ms < 0 || wait_ms > POLL_MAX_WAIT_MS)
+        wait_ms = POLL_MAX_WAIT_MS;
+
+    num_ready = event_loop_wait(loop, ready, EVENT_LOOP_MAX_EVENTS, (int)wait_ms, err);
+    if (num_ready < 0)
+        return -1;
+
+    crack_ctx->now_ms = monotonic_ms();
+
+    for (int r = 0; r < num_ready; r++)
+    {
+        worker_state *ws = ready[r];
+
+        if (ws == NULL)
         {
-            worker_state *ws;
+            accept_clients(sockfd, loop, workers, timers, crack_ctx, err);
+            continue;
+        }
 
-            *client_states                     = realloc(*client_states, (*max_clients) * sizeof(worker_state *));
-            (*client_states)[*max_clients - 1] = calloc(1, sizeof(worker_state));
+        if (!ws->alive)
+            continue;
 
-            ws             = (*client_states)[*max_clients - 1];
-            ws->sockfd     = newfd;
-            ws->alive      = 1;
-            ws->assigned   = 0;
-            ws->last_heard = time(NULL);
-            ws->recv_len   = 0;
+        // A report may only mean the socket takes output again.
+        int heard = process_client_message(ws->sockfd, ws, crack_ctx, err);
 
-            send_hash_to_worker(ws, crack_ctx, err);
+        if (heard == -1 || flush_worker(ws, loop, err) == -1)
+        {
+            if (!crack_ctx->found)
+                reclaim_and_redistribute(ws, loop, workers, timers, crack_ctx);
 
-            num_ready--;
+            handle_client_disconnect(ws, loop, workers, timers);
+            continue;
         }
+
+        if (heard)
+            touch_worker(ws, timers, crack_ctx);
     }
 
-    for (uint32_t i = 0; i < *max_clients; i++)
+    // Only workers whose deadline passed come back; the rest are not looked at.
+    expired = timer_wheel_expire(timers, crack_ctx->now_ms);
+    while (expired)
     {
-        worker_state *ws;
-        int           sd;
+        worker_state *ws    = expired->data;
+        bool          lease = expired == &ws->lease_timer;
 
-        ws = (*client_states)[i];
+        expired = expired->next;
+
+        // Both of a worker's deadlines may fall due in the same pass.
         if (!ws->alive)
             continue;
 
-        if ((*file_descriptors)[i + 1].revents & POLLIN)
-        {
-            sd = (*client_sockets)[i];
+        printf(lease ? "Lease timed out! Reassigning work.\n" : "Worker timed out! Reassigning work.\n");
+        reclaim_and_redistribute(ws, loop, workers, timers, crack_ctx);
+        handle_client_disconnect(ws, loop, workers, timers);
+    }
 
-            if (process_client_message(sd, ws, crack_ctx, err) == -1)
-            {
-                if (!crack_ctx->found)
-                    reclaim_and_redistribute(ws, crack_ctx);
+    // A bounded keyspace is finished once nothing is queued and no worker holds a lease.
+    if (crack_ctx->keyspace_size != 0 && crack_ctx->index >= crack_ctx->keyspace_size && crack_ctx->queue_len == 0)
+    {
+        bool busy = false;
 
-                handle_client_disconnect(i, client_sockets, client_states, max_clients);
-                continue;
-            }
+        for (uint32_t id = 0; id < workers->next_id && !busy; id++)
+        {
+            const worker_state *ws = worker_registry_slot(workers, id);
 
-            ws->last_heard = time(NULL);
-            num_ready--;
+            busy = ws->alive && ws->num_leases > 0;
         }
 
-        if (time(NULL) - ws->last_heard > ws->timeout_seconds)
-        {
-            printf("Worker timed out! Reassigning work.\n");
-            reclaim_and_redistribute(ws, crack_ctx);
-            handle_client_disconnect(i, client_sockets, client_states, max_clients);
-        }
+        if (!busy)
+            crack_ctx->exhausted = 1;
     }
 
+    if (crack_ctx->found || crack_ctx->exhausted)
+        stop_parked_workers(loop, workers);
+
     return 0;
 }
 
@@ -241,102 +419,307 @@ int assign_work_to_client(struct worker_state *ws, struct cracking_context *crac
 {
     if (crack_ctx->found)
     {
-        const char *msg = "STOP\n";
-        send(ws->sockfd, msg, strlen(msg), 0);
+        queue_message(ws, MSG_STOP, NULL, 0, NULL, err);
         return 1;
     }
 
+    if (ws->num_leases == MAX_LEASES)
+    {
+        printf("[SERVER] Worker(fd=%d) already holds %d leases, not assigning more\n", ws->sockfd, MAX_LEASES);
+        return 0;
+    }
+
     uint64_t start = 0;
     uint64_t len   = 0;
 
-    pop_next_work_chunk(crack_ctx, &start, &len);
-
-    ws->start_index           = start;
-    ws->work_size             = len;
-    ws->end_index             = start + len - 1;
-    ws->last_checkpoint_index = start;
-    ws->assigned              = 1;
-    ws->started_at            = time(NULL);
-    ws->last_heard            = ws->started_at;
-    ws->checkpoint_interval   = crack_ctx->checkpoint;
-    ws->timeout_seconds       = crack_ctx->timeout;
-
-    char buffer[256];
-    int  n = snprintf(buffer, sizeof(buffer),
-                      "WORK %" PRIu64 " %" PRIu64 " %" PRIu64 " %u\n",
-                      ws->start_index,
-                      ws->work_size,
-                      ws->checkpoint_interval,
-                      ws->timeout_seconds);
-
-    ssize_t sent = send(ws->sockfd, buffer, n, 0);
-    if (sent < 0)
-    {
-        SET_ERROR(err, "assign_work_to_client(): send() failed");
-        return -1;
+    if (!pop_next_work_chunk(crack_ctx, &start, &len))
+    {
+        // Nothing to hand out now, but another worker's leases come back if
+        // it fails, so an idle worker is parked until then. STOP waits for
+        // the job to be found or exhausted.
+        if (ws->num_leases == 0)
+            ws->parked = true;
+        return 1;
     }
 
+    ws->parked = false;
+
+    if (send_cracked(ws, crack_ctx, err) == -1)
+        return -1;
+
+    work_lease *lease = &ws->leases[ws->num_leases++];
+
+    lease->start_index           = start;
+    lease->work_size             = len;
+    lease->end_index             = start + len - 1;
+    lease->last_checkpoint_index = start;
+    lease->started_at            = now_secs(crack_ctx);
+    ws->last_heard               = lease->started_at;
+    if (ws->num_leases == 1)
+        ws->lease_moved = true;
+    ws->checkpoint_interval      = crack_ctx->checkpoint;
+    ws->timeout_seconds          = crack_ctx->timeout;
+
+    uint64_t work[] = {lease->start_index, lease->work_size, ws->checkpoint_interval, ws->timeout_seconds};
+
+    if (queue_message(ws, MSG_WORK, work, 4, NULL, err) == -1)
+        return -1;
+
     printf("[SERVER] Assigned worker(fd=%d) work: start=%" PRIu64
-           ", size=%" PRIu64 ", checkpoint=%" PRIu64 ", timeout=%u\n",
-           ws->sockfd, ws->start_index, ws->work_size,
-           ws->checkpoint_interval, ws->timeout_seconds);
+           ", size=%" PRIu64 ", checkpoint=%" PRIu64 ", timeout=%u, leases=%zu\n",
+           ws->sockfd, lease->start_index, lease->work_size,
+           ws->checkpoint_interval, ws->timeout_seconds, ws->num_leases);
 
     return 0;
 }
 
-int process_client_message(int sd, worker_state *ws,
-                           struct cracking_context *crack_ctx,
-                           struct fsm_error        *err)
+int queue_to_worker(worker_state *ws, const char *data, size_t len, struct fsm_error *err)
 {
-    char    temp[256];
-    ssize_t n = recv(sd, temp, sizeof(temp), 0);
+    if (byte_ring_append(&ws->io->out, data, len) == -1)
+    {
+        SET_ERROR(err, "Worker send buffer allocation failed");
+        return -1;
+    }
 
-    if (n <= 0)
+    return 0;
+}
+
+int queue_message(worker_state *ws, message_type type, const uint64_t *values, size_t num_values, const char *text,
+                  struct fsm_error *err)
+{
+    protocol_message msg = {.type = type, .num_values = num_values, .text = text, .text_len = text ? strlen(text) : 0};
+    char             buffer[PROTOCOL_MAX_MESSAGE];
+    ssize_t          len;
+
+    if (num_values > 0)
+        memcpy(msg.values, values, num_values * sizeof(*values));
+
+    len = protocol_encode(ws->io->protocol, &msg, buffer, sizeof(buffer));
+    if (len < 0)
+    {
+        SET_ERROR(err, "Message to worker does not fit in a frame");
         return -1;
+    }
+
+    return queue_to_worker(ws, buffer, (size_t)len, err);
+}
 
-    if (ws->recv_len + n >= RECV_BUF_SIZE)
+// Hands the socket as much queued output as it takes, in one writev per
+// pass, and only asks to hear about writability while some is left over.
+int flush_worker(worker_state *ws, event_loop *loop, struct fsm_error *err)
+{
+    byte_ring *out = &ws->io->out;
+
+    while (byte_ring_len(out) > 0)
+    {
+        struct iovec iov[2];
+        int          n    = byte_ring_data(out, iov);
+        ssize_t      sent = writev(ws->sockfd, iov, n);
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return event_loop_watch_output(loop, ws->sockfd, true, err);
+
+            SET_ERROR(err, strerror(errno));
+            return -1;
+        }
+
+        byte_ring_consume(out, (size_t)sent);
+    }
+
+    return event_loop_watch_output(loop, ws->sockfd, false, err);
+}
+
+// Copies the first len bytes of the ring's pieces out to dst.
+void copy_out(const struct iovec iov[2], int n, char *dst, size_t len)
+{
+    size_t first = (iov[0].iov_len < len) ? iov[0].iov_len : len;
+
+    memcpy(dst, iov[0].iov_base, first);
+    if (n == 2 && len > first)
+        memcpy(dst + first, iov[1].iov_base, len - first);
+}
+
+// Handles every complete message in the input ring where it lies; only one
+// that wraps past the end of the buffer is copied out first. Until the
+// worker's HELLO is answered, its first byte says which protocol it speaks.
+int handle_messages(worker_state *ws, struct cracking_context *crack_ctx, struct fsm_error *err)
+{
+    byte_ring *in = &ws->io->in;
+
+    while (byte_ring_len(in) > 0)
+    {
+        struct iovec     iov[2];
+        char             joined[RECV_BUF_SIZE + 1];
+        int              n    = byte_ring_data(in, iov);
+        char            *data = iov[0].iov_base;
+        size_t           len;  // of the message, without a line's newline
+        size_t           used; // of the ring
+        protocol_message msg;
+
+        if (!ws->io->greeted)
+            ws->io->protocol = (data[0] == '\0') ? PROTOCOL_BINARY : PROTOCOL_TEXT;
+
+        if (ws->io->protocol == PROTOCOL_BINARY)
+        {
+            unsigned char header[PROTOCOL_FRAME_HEADER];
+
+            if (byte_ring_len(in) < PROTOCOL_FRAME_HEADER)
+                break;
+
+            copy_out(iov, n, (char *)header, sizeof(header));
+            len = used = protocol_frame_length(header);
+
+            if (len > RECV_BUF_SIZE)
+            {
+                SET_ERROR(err, "Frame from worker too long");
+                return -1;
+            }
+
+            if (byte_ring_len(in) < len)
+                break;
+
+            if (iov[0].iov_len < len)
+            {
+                copy_out(iov, n, joined, len);
+                data = joined;
+            }
+        }
+        else
+        {
+            char *nl = memchr(data, '\n', iov[0].iov_len);
+
+            if (nl)
+            {
+                *nl = '\0';
+                len = (size_t)(nl - data);
+            }
+            else if (n == 2 && (nl = memchr(iov[1].iov_base, '\n', iov[1].iov_len)) != NULL)
+            {
+                len = iov[0].iov_len + (size_t)(nl - (char *)iov[1].iov_base);
+                copy_out(iov, n, joined, len);
+                joined[len] = '\0';
+                data        = joined;
+            }
+            else
+            {
+                break;
+            }
+
+            used = len + 1;
+        }
+
+        if (protocol_decode(ws->io->protocol, data, len, &msg, err) == -1 ||
+            handle_single_message(ws->sockfd, ws, crack_ctx, &msg, err) != 0)
+            return -1;
+
+        byte_ring_consume(in, used);
+    }
+
+    if (byte_ring_len(in) == in->cap)
     {
         SET_ERROR(err, "Worker recv buffer overflow");
         return -1;
     }
 
-    memcpy(ws->recv_buf + ws->recv_len, temp, n);
-    ws->recv_len += n;
+    return 0;
+}
 
-    size_t start = 0;
+// Readiness is only reported for new input, so everything already queued
+// on the socket is read, straight into the worker's input ring, and
+// handled before returning. Returns 1 if anything arrived, 0 if not.
+int process_client_message(int sd, worker_state *ws,
+                           struct cracking_context *crack_ctx,
+                           struct fsm_error        *err)
+{
+    int heard = 0;
 
-    for (size_t i = 0; i < ws->recv_len; i++)
+    for (;;)
     {
-        if (ws->recv_buf[i] == '\n')
+        struct iovec iov[2];
+        int          n = byte_ring_space(&ws->io->in, iov);
+        ssize_t      received;
+
+        received = readv(sd, iov, n);
+
+        if (received == 0)
+            return -1;
+
+        if (received < 0)
         {
-            ws->recv_buf[i] = '\0';
+            if (errno == EINTR)
+                continue;
 
-            char *msg = ws->recv_buf + start;
-            if (handle_single_message(sd, ws, crack_ctx, msg, err) != 0)
-                return -1;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return heard;
 
-            start = i + 1;
+            return -1;
         }
+
+        heard = 1;
+        byte_ring_produce(&ws->io->in, (size_t)received);
+
+        if (handle_messages(ws, crack_ctx, err) == -1)
+            return -1;
     }
+}
+
+// Settles on the version and capabilities both sides have, answers HELLO
+// with them, and sends the job the way the worker speaks. The job never
+// goes out before HELLO, in text mode as well.
+int greet_worker(worker_state *ws, struct cracking_context *crack_ctx, const protocol_message *msg,
+                 struct fsm_error *err)
+{
+    uint64_t version = (msg->values[0] < PROTOCOL_VERSION) ? msg->values[0] : PROTOCOL_VERSION;
+    uint64_t caps    = msg->values[1] & PROTOCOL_CAPS;
 
-    if (start < ws->recv_len)
+    if (version < PROTOCOL_MIN_VERSION)
     {
-        size_t leftover = ws->recv_len - start;
-        memmove(ws->recv_buf, ws->recv_buf + start, leftover);
-        ws->recv_len = leftover;
+        printf("[SERVER] Worker(fd=%d) speaks protocol version %" PRIu64 ", at least %d is needed\n", ws->sockfd,
+               msg->values[0], PROTOCOL_MIN_VERSION);
+        SET_ERROR(err, "Worker protocol version too old");
+        return -1;
     }
-    else
+
+    if ((crack_ctx->rainbow_build || crack_ctx->rainbow) && !(caps & PROTOCOL_CAP_RAINBOW))
     {
-        ws->recv_len = 0;
+        printf("[SERVER] Worker(fd=%d) cannot run rainbow table jobs\n", ws->sockfd);
+        SET_ERROR(err, "Worker cannot run rainbow table jobs");
+        return -1;
     }
 
-    return 0;
+    ws->io->caps    = (uint32_t)caps;
+    ws->io->greeted = true;
+
+    printf("[SERVER] Worker(fd=%d) speaks %s protocol version %" PRIu64 "\n", ws->sockfd,
+           (ws->io->protocol == PROTOCOL_BINARY) ? "binary" : "text", version);
+
+    uint64_t hello[] = {version, caps};
+
+    if (queue_message(ws, MSG_HELLO, hello, 2, NULL, err) == -1)
+        return -1;
+
+    return send_hash_to_worker(ws, crack_ctx, err);
 }
 
 int handle_single_message(int sd, worker_state *ws, struct cracking_context *crack_ctx,
-                          const char *buffer, struct fsm_error *err)
+                          const protocol_message *msg, struct fsm_error *err)
 {
-    if (strncmp(buffer, "READY", 5) == 0)
+    if ((msg->type == MSG_HELLO) == ws->io->greeted)
+    {
+        SET_ERROR(err, ws->io->greeted ? "HELLO from worker already greeted" : "Worker did not start with HELLO");
+        return -1;
+    }
+
+    if (msg->type == MSG_HELLO)
+    {
+        return greet_worker(ws, crack_ctx, msg, err);
+    }
+    else if (msg->type == MSG_READY)
     {
         printf("[SERVER] Worker %d is READY\n", sd);
 
@@ -348,53 +731,91 @@ int handle_single_message(int sd, worker_state *ws, struct cracking_context *cra
 
         return 0;
     }
-    else if (strncmp(buffer, "CHECKPOINT ", 11) == 0)
+    else if (msg->type == MSG_CHECKPOINT)
     {
-        uint64_t idx = strtoull(buffer + 11, NULL, 10);
-        if (idx < ws->start_index || idx > ws->end_index)
+        uint64_t    idx   = msg->values[0];
+        work_lease *lease = NULL;
+
+        for (size_t i = 0; i < ws->num_leases; i++)
+        {
+            if (idx >= ws->leases[i].start_index && idx <= ws->leases[i].end_index)
+            {
+                lease = &ws->leases[i];
+                break;
+            }
+        }
+
+        if (!lease)
         {
             SET_ERROR(err, "Checkpoint out of range");
             return -1;
         }
 
-        time_t now = time(NULL);
+        time_t now = now_secs(crack_ctx);
 
         crack_ctx->total_secs += now - ws->last_heard;
 
-        ws->last_checkpoint_index = idx;
-        ws->last_heard            = now;
+        lease->last_checkpoint_index = idx;
+        ws->last_heard               = now;
+        if (lease == &ws->leases[0])
+            ws->lease_moved = true;
 
         printf("[SERVER] Worker %d checkpoint → %" PRIu64 "\n", sd, idx);
         return 0;
     }
-    else if (strncmp(buffer, "FOUND ", 6) == 0)
+    else if (msg->type == MSG_FOUND)
     {
-        const char *pw = buffer + 6;
-
-        time_t now = time(NULL);
+        time_t now = now_secs(crack_ctx);
 
         crack_ctx->total_secs += now - ws->last_heard;
+        ws->last_heard = now;
 
-        printf("[SERVER] WORKER %d FOUND PASSWORD: %s in %ld seconds.\n", sd, pw, now - ws->started_at);
+        int rc = record_found(ws, crack_ctx, msg);
+        if (rc == -1)
+            SET_ERROR(err, "FOUND for a hash that is not part of the job");
 
-        crack_ctx->found = 1;
-        strncpy(crack_ctx->password, pw, sizeof(crack_ctx->password));
+        return rc;
+    }
+    else if (msg->type == MSG_CHAIN)
+    {
+        time_t now = now_secs(crack_ctx);
 
-        return 1;
+        crack_ctx->total_secs += now - ws->last_heard;
+        ws->last_heard = now;
+
+        if (rainbow_record(crack_ctx, msg->values, msg->num_values) == -1)
+        {
+            SET_ERROR(err, "Invalid CHAIN from worker");
+            return -1;
+        }
+
+        return 0;
     }
-    else if (strncmp(buffer, "DONE", 4) == 0)
+    else if (msg->type == MSG_DONE)
     {
-        time_t now = time(NULL);
+        time_t now = now_secs(crack_ctx);
 
         crack_ctx->total_secs += now - ws->last_heard;
 
-        ws->duration_secs = now - ws->started_at;
+        if (ws->num_leases == 0)
+        {
+            SET_ERROR(err, "DONE from worker with no outstanding work");
+            return -1;
+        }
+
+        ws->duration_secs = now - ws->leases[0].started_at;
 
         printf("[SERVER] Worker %d finished its work in %ld seconds.\n", sd, ws->duration_secs);
 
-        ws->assigned = 0;
+        // Work is done in lease order, so DONE always retires the oldest lease.
+        ws->num_leases--;
+        memmove(&ws->leases[0], &ws->leases[1], ws->num_leases * sizeof(work_lease));
+        if (ws->num_leases > 0)
+            ws->leases[0].started_at = now;
+        ws->lease_moved = true;
 
-        if (!crack_ctx->found)
+        // Workers that did not prefetch still get their next chunk here.
+        if (!crack_ctx->found && ws->num_leases == 0)
         {
             if (assign_work_to_client(ws, crack_ctx, err) == -1)
                 return -1;
@@ -402,39 +823,32 @@ int handle_single_message(int sd, worker_state *ws, struct cracking_context *cra
 
         return 0;
     }
-    else
+    else if (msg->type == MSG_NEXT)
     {
-        SET_ERROR(err, "Invalid message from worker");
-        return -1;
-    }
-}
-
-void handle_client_disconnect(uint32_t i, int **client_sockets, worker_state ***client_states, nfds_t *max_clients)
-{
-    int fd = (*client_sockets)[i];
-    close(fd);
+        printf("[SERVER] Worker %d requested its next chunk\n", sd);
 
-    free((*client_states)[i]);
+        if (assign_work_to_client(ws, crack_ctx, err) == -1)
+            return -1;
 
-    for (uint32_t j = i; j < (*max_clients) - 1; j++)
-    {
-        (*client_sockets)[j] = (*client_sockets)[j + 1];
-        (*client_states)[j]  = (*client_states)[j + 1];
+        return 0;
     }
-
-    (*max_clients)--;
-
-    if (*max_clients == 0)
+    else
     {
-        free(*client_sockets);
-        free(*client_states);
-        *client_sockets = NULL;
-        *client_states  = NULL;
-        return;
+        char message[64];
+
+        snprintf(message, sizeof(message), "Unexpected %s from worker", protocol_message_name(msg->type));
+        SET_ERROR(err, message);
+        return -1;
     }
+}
 
-    *client_sockets = realloc(*client_sockets, *max_clients * sizeof(int));
-    *client_states  = realloc(*client_states, *max_clients * sizeof(worker_state *));
+void handle_client_disconnect(worker_state *ws, event_loop *loop, worker_registry *workers, timer_wheel *timers)
+{
+    timer_wheel_cancel(timers, &ws->timer);
+    timer_wheel_cancel(timers, &ws->lease_timer);
+    event_loop_remove(loop, ws->sockfd);
+    close(ws->sockfd);
+    worker_registry_remove(workers, ws);
 }
 
 void push_work_back_into_queue(struct cracking_context *crack_ctx, uint64_t start, uint64_t remaining)
@@ -459,26 +873,84 @@ void push_work_back_into_queue(struct cracking_context *crack_ctx, uint64_t star
     crack_ctx->queue_len = new_len;
 }
 
-void reclaim_and_redistribute(worker_state *ws, struct cracking_context *crack_ctx)
+void reclaim_leases(worker_state *ws, struct cracking_context *crack_ctx)
 {
-    uint64_t start = ws->last_checkpoint_index;
-    uint64_t end   = ws->end_index;
-
-    if (start > end)
+    for (size_t i = 0; i < ws->num_leases; i++)
     {
-        return;
+        uint64_t start = ws->leases[i].last_checkpoint_index;
+        uint64_t end   = ws->leases[i].end_index;
+
+        if (start > end)
+            continue;
+
+        uint64_t remaining = (end - start) + 1;
+
+        printf("[SERVER] Reclaiming %" PRIu64 " units of unfinished work from %d "
+               "(%" PRIu64 " -> %" PRIu64 ")\n",
+               remaining, ws->sockfd, start, end);
+
+        push_work_back_into_queue(crack_ctx, start, remaining);
     }
 
-    uint64_t remaining = (end - start) + 1;
+    ws->num_leases = 0;
+}
 
-    printf("[SERVER] Reclaiming %" PRIu64 " units of unfinished work from %d "
-           "(%" PRIu64 " -> %" PRIu64 ")\n",
-           remaining, ws->sockfd, start, end);
+// The worker is about to be dropped. What it had not finished goes
+// straight to parked workers, since they will not ask again.
+void reclaim_and_redistribute(worker_state *ws, event_loop *loop, worker_registry *workers, timer_wheel *timers,
+                              struct cracking_context *crack_ctx)
+{
+    reclaim_leases(ws, crack_ctx);
+    ws->alive = false;
+
+    wake_parked_workers(loop, workers, timers, crack_ctx);
+}
 
-    push_work_back_into_queue(crack_ctx, start, remaining);
+// A parked worker that cannot be sent its chunk is dropped as well, and
+// the chunk goes on to the next one.
+void wake_parked_workers(event_loop *loop, worker_registry *workers, timer_wheel *timers,
+                         struct cracking_context *crack_ctx)
+{
+    for (uint32_t id = 0; id < workers->next_id && crack_ctx->queue_len > 0; id++)
+    {
+        worker_state    *ws = worker_registry_slot(workers, id);
+        struct fsm_error err;
+
+        if (!ws->alive || !ws->parked)
+            continue;
 
-    ws->assigned = false;
-    ws->alive    = false;
+        fsm_error_init(&err);
+
+        if (assign_work_to_client(ws, crack_ctx, &err) == -1 || flush_worker(ws, loop, &err) == -1)
+        {
+            printf("[SERVER] Could not hand worker(fd=%d) reclaimed work: %s\n", ws->sockfd,
+                   err.err_msg ? err.err_msg : "");
+            reclaim_leases(ws, crack_ctx);
+            handle_client_disconnect(ws, loop, workers, timers);
+        }
+        else
+        {
+            touch_worker(ws, timers, crack_ctx);
+        }
+
+        fsm_error_clear(&err);
+    }
+}
+
+// Parked workers are the ones still waiting to hear that the job is over.
+void stop_parked_workers(event_loop *loop, worker_registry *workers)
+{
+    for (uint32_t id = 0; id < workers->next_id; id++)
+    {
+        worker_state *ws = worker_registry_slot(workers, id);
+
+        if (!ws->alive || !ws->parked)
+            continue;
+
+        ws->parked = false;
+        if (queue_message(ws, MSG_STOP, NULL, 0, NULL, NULL) == 0)
+            flush_worker(ws, loop, NULL);
+    }
 }
 
 bool pop_next_work_chunk(struct cracking_context *ctx, uint64_t *out_start, uint64_t *out_len)
@@ -505,10 +977,16 @@ bool pop_next_work_chunk(struct cracking_context *ctx, uint64_t *out_start, uint
         return true;
     }
 
+    if (ctx->keyspace_size != 0 && ctx->index >= ctx->keyspace_size)
+        return false;
+
     *out_start = ctx->index;
     *out_len   = ctx->work_size;
 
-    ctx->index += ctx->work_size;
+    if (ctx->keyspace_size != 0 && ctx->keyspace_size - ctx->index < ctx->work_size)
+        *out_len = ctx->keyspace_size - ctx->index;
+
+    ctx->index += *out_len;
 
     return true;
 }
@@ -0,0 +1,179 @@
+#include "timer_wheel.h"
+#include <string.h>
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static void link_entry(timer_wheel *wheel, timer_entry *entry);
+static void unlink_entry(timer_wheel *wheel, timer_entry *entry);
+static void cascade(timer_wheel *wheel, unsigned level);
+
+// Files entry on the lowest level whose span covers its distance from the
+// current tick. Past that span it goes on the top level's farthest slot
+// and is filed again, with its real deadline, once the wheel gets there.
+static void link_entry(timer_wheel *wheel, timer_entry *entry)
+{
+    uint64_t expires = (entry->expires > wheel->current) ? entry->expires : wheel->current;
+    uint64_t delta   = expires - wheel->current;
+    unsigned level   = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >> (TIMER_WHEEL_BITS * (level + 1)))
+        level++;
+
+    if (delta >> (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+        expires = wheel->current + (UINT64_C(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+    entry->level = (uint8_t)level;
+    entry->slot  = (uint8_t)((expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+
+    entry->next  = wheel->slots[level][entry->slot];
+    entry->pprev = &wheel->slots[level][entry->slot];
+    if (entry->next)
+        entry->next->pprev = &entry->next;
+    wheel->slots[level][entry->slot] = entry;
+
+    wheel->occupied[level] |= UINT64_C(1) << entry->slot;
+}
+
+static void unlink_entry(timer_wheel *wheel, timer_entry *entry)
+{
+    *entry->pprev = entry->next;
+    if (entry->next)
+        entry->next->pprev = entry->pprev;
+
+    if (!wheel->slots[entry->level][entry->slot])
+        wheel->occupied[entry->level] &= ~(UINT64_C(1) << entry->slot);
+
+    entry->next  = NULL;
+    entry->pprev = NULL;
+}
+
+static void cascade(timer_wheel *wheel, unsigned level)
+{
+    unsigned     slot  = (unsigned)(wheel->current >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    timer_entry *entry = wheel->slots[level][slot];
+
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+
+    while (entry)
+    {
+        timer_entry *next = entry->next;
+
+        link_entry(wheel, entry);
+        entry = next;
+    }
+}
+
+void timer_wheel_init(timer_wheel *wheel, uint64_t now_ms)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->current = now_ms / TIMER_WHEEL_TICK_MS;
+}
+
+void timer_wheel_schedule(timer_wheel *wheel, timer_entry *entry, uint64_t deadline_ms)
+{
+    if (entry->pending)
+        unlink_entry(wheel, entry);
+    else
+        wheel->count++;
+
+    entry->expires = (deadline_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    entry->pending = true;
+    link_entry(wheel, entry);
+}
+
+void timer_wheel_cancel(timer_wheel *wheel, timer_entry *entry)
+{
+    if (!entry->pending)
+        return;
+
+    unlink_entry(wheel, entry);
+    entry->pending = false;
+    wheel->count--;
+}
+
+timer_entry *timer_wheel_expire(timer_wheel *wheel, uint64_t now_ms)
+{
+    uint64_t     now     = now_ms / TIMER_WHEEL_TICK_MS;
+    timer_entry *expired = NULL;
+
+    while (wheel->current <= now)
+    {
+        unsigned slot = (unsigned)wheel->current & TIMER_WHEEL_MASK;
+
+        if (wheel->count == 0)
+        {
+            wheel->current = now + 1;
+            break;
+        }
+
+        // Crossing into a new block of a level brings that block's slot down.
+        if (slot == 0)
+        {
+            for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++)
+            {
+                cascade(wheel, level);
+                if ((wheel->current >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK)
+                    break;
+            }
+        }
+
+        // Nothing due on level 0 this lap: skip to the next cascade, but
+        // not past now, or entries filed meanwhile would be late.
+        if (!wheel->occupied[0])
+        {
+            uint64_t next_block = (wheel->current | TIMER_WHEEL_MASK) + 1;
+
+            wheel->current = (next_block <= now) ? next_block : now + 1;
+            continue;
+        }
+
+        while (wheel->slots[0][slot])
+        {
+            timer_entry *entry = wheel->slots[0][slot];
+
+            unlink_entry(wheel, entry);
+            entry->pending = false;
+            entry->next    = expired;
+            expired        = entry;
+            wheel->count--;
+        }
+
+        wheel->current++;
+    }
+
+    return expired;
+}
+
+// The next tick is either a level-0 slot's or the first cascade of a
+// non-empty higher slot; after a cascade the caller simply asks again. A
+// slot behind the current one, or a higher slot holding it, is a lap away.
+int64_t timer_wheel_next_timeout(const timer_wheel *wheel, uint64_t now_ms)
+{
+    uint64_t next = UINT64_MAX;
+
+    if (wheel->count == 0)
+        return -1;
+
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        unsigned shift = TIMER_WHEEL_BITS * level;
+        uint64_t lap   = UINT64_C(1) << (shift + TIMER_WHEEL_BITS);
+        uint64_t base  = wheel->current & ~(lap - 1);
+
+        for (uint64_t bits = wheel->occupied[level]; bits; bits &= bits - 1)
+        {
+            uint64_t tick = base + ((uint64_t)__builtin_ctzll(bits) << shift);
+
+            if (tick < wheel->current)
+                tick += lap;
+            if (tick < next)
+                next = tick;
+        }
+    }
+
+    if (next * TIMER_WHEEL_TICK_MS <= now_ms)
+        return 0;
+
+    return (int64_t)(next * TIMER_WHEEL_TICK_MS - now_ms);
+}
@@ -79,3 +79,12 @@ int string_to_uint64(const char *str, uint64_t *out, struct fsm_error *err)
     *out = (uint64_t)val;
     return 0;
 }
+
+uint64_t monotonic_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,128 @@
+#include "worker_registry.h"
+#include <unistd.h>
+
+static int add_slab(worker_registry *reg, struct fsm_error *err);
+
+static int add_slab(worker_registry *reg, struct fsm_error *err)
+{
+    size_t         num_slabs = reg->num_slabs + 1;
+    worker_state **hot_slabs = realloc(reg->hot_slabs, num_slabs * sizeof(*hot_slabs));
+    worker_io    **io_slabs;
+    uint32_t      *free_ids;
+
+    if (!hot_slabs)
+    {
+        SET_ERROR(err, "realloc failed (add_slab)");
+        return -1;
+    }
+    reg->hot_slabs = hot_slabs;
+
+    io_slabs = realloc(reg->io_slabs, num_slabs * sizeof(*io_slabs));
+    if (!io_slabs)
+    {
+        SET_ERROR(err, "realloc failed (add_slab)");
+        return -1;
+    }
+    reg->io_slabs = io_slabs;
+
+    free_ids = realloc(reg->free_ids, num_slabs * WORKER_SLAB_SIZE * sizeof(*free_ids));
+    if (!free_ids)
+    {
+        SET_ERROR(err, "realloc failed (add_slab)");
+        return -1;
+    }
+    reg->free_ids = free_ids;
+
+    hot_slabs[reg->num_slabs] = calloc(WORKER_SLAB_SIZE, sizeof(worker_state));
+    io_slabs[reg->num_slabs]  = calloc(WORKER_SLAB_SIZE, sizeof(worker_io));
+    if (!hot_slabs[reg->num_slabs] || !io_slabs[reg->num_slabs])
+    {
+        free(hot_slabs[reg->num_slabs]);
+        free(io_slabs[reg->num_slabs]);
+        SET_ERROR(err, "calloc failed (add_slab)");
+        return -1;
+    }
+
+    reg->num_slabs = num_slabs;
+
+    return 0;
+}
+
+worker_state *worker_registry_add(worker_registry *reg, int sockfd, struct fsm_error *err)
+{
+    uint32_t      id;
+    worker_state *ws;
+
+    if (reg->num_free > 0)
+    {
+        id = reg->free_ids[--reg->num_free];
+    }
+    else
+    {
+        if (reg->next_id == reg->num_slabs * WORKER_SLAB_SIZE && add_slab(reg, err) == -1)
+            return NULL;
+
+        id = reg->next_id++;
+    }
+
+    ws = worker_registry_slot(reg, id);
+    memset(ws, 0, sizeof(*ws));
+    ws->id           = id;
+    ws->sockfd       = sockfd;
+    ws->alive        = 1;
+    ws->io           = &reg->io_slabs[id / WORKER_SLAB_SIZE][id % WORKER_SLAB_SIZE];
+    reg->count++;
+
+    // The slot's buffers are kept for whoever gets it next; only what was
+    // still queued is dropped, along with what the last worker had agreed to.
+    byte_ring_consume(&ws->io->in, byte_ring_len(&ws->io->in));
+    byte_ring_consume(&ws->io->out, byte_ring_len(&ws->io->out));
+    ws->io->caps    = 0;
+    ws->io->greeted = false;
+
+    if (byte_ring_reserve(&ws->io->in, RECV_BUF_SIZE) == -1)
+    {
+        SET_ERROR(err, "malloc failed (worker_registry_add)");
+        worker_registry_remove(reg, ws);
+        return NULL;
+    }
+
+    return ws;
+}
+
+void worker_registry_remove(worker_registry *reg, worker_state *ws)
+{
+    ws->alive  = 0;
+    ws->sockfd = -1;
+
+    reg->free_ids[reg->num_free++] = ws->id;
+    reg->count--;
+}
+
+void worker_registry_free(worker_registry *reg)
+{
+    for (uint32_t id = 0; id < reg->next_id; id++)
+    {
+        worker_state *ws = worker_registry_slot(reg, id);
+
+        if (ws->sockfd > 0)
+            close(ws->sockfd);
+    }
+
+    for (size_t i = 0; i < reg->num_slabs; i++)
+    {
+        for (size_t j = 0; j < WORKER_SLAB_SIZE; j++)
+        {
+            byte_ring_free(&reg->io_slabs[i][j].in);
+            byte_ring_free(&reg->io_slabs[i][j].out);
+        }
+
+        free(reg->hot_slabs[i]);
+        free(reg->io_slabs[i]);
+    }
+
+    free(reg->hot_slabs);
+    free(reg->io_slabs);
+    free(reg->free_ids);
+    memset(reg, 0, sizeof(*reg));
+}